@@ -25,11 +25,19 @@ your library */
 
 
 #include <dirent.h>
+#include <sys/time.h>
 #include "../src/dc_context.h"
 #include "../src/dc_aheader.h"
 #include "../src/dc_apeerstate.h"
 #include "../src/dc_key.h"
 #include "../src/dc_pgp.h"
+#include "../src/dc_mimeparser.h"
+#include "../src/dc_arena.h"
+#include "../src/dc_mediaprobe.h"
+#include "../src/dc_imap.h"
+#include "../src/dc_smtp.h"
+#include "../src/dc_openssl.h"
+#include "../src/dc_utf8.h"
 
 
 
@@ -127,6 +135,503 @@ cleanup:
 }
 
 
+/*******************************************************************************
+ * Count allocations for the bench* commands
+ ******************************************************************************/
+
+
+/* if built with the meson option `bench-alloc` (DC_BENCH_ALLOC), malloc() and
+friends are replaced for the whole process, so that also the
+allocations done by libetpan and by the other libraries are counted; other
+threads are counted as well, so better do not connect while benchmarking.  Only the
+glibc offers the __libc_*() functions to forward to; elsewhere, nothing is counted.
+Memory from memalign() and friends is not counted but may be freed while counting,
+so the bytes may be a little too low.  Normal builds keep the allocator untouched. */
+#if defined(__GLIBC__) && defined(DC_BENCH_ALLOC)
+#define BENCH_COUNT_ALLOCS 1
+#include <malloc.h>
+
+extern void* __libc_malloc  (size_t);
+extern void* __libc_calloc  (size_t, size_t);
+extern void* __libc_realloc (void*, size_t);
+extern void  __libc_free    (void*);
+
+static volatile int  s_bench_allocs_on   = 0; /* volatile: the compiler assumes malloc() does not touch our variables */
+static volatile long s_bench_alloc_cnt   = 0;
+static volatile long s_bench_alloc_bytes = 0;
+static volatile long s_bench_alloc_peak  = 0;
+
+
+static void bench_alloc_count(void* p, int cnt)
+{
+	long bytes = 0, peak = 0;
+
+	if (p==NULL || !s_bench_allocs_on) {
+		return;
+	}
+
+	bytes = (long)malloc_usable_size(p) * (cnt>=0? 1 : -1);
+	if (cnt > 0) {
+		__atomic_add_fetch(&s_bench_alloc_cnt, 1, __ATOMIC_RELAXED);
+	}
+	bytes = __atomic_add_fetch(&s_bench_alloc_bytes, bytes, __ATOMIC_RELAXED);
+
+	peak = __atomic_load_n(&s_bench_alloc_peak, __ATOMIC_RELAXED);
+	while (bytes > peak
+	 && !__atomic_compare_exchange_n(&s_bench_alloc_peak, &peak, bytes, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+		;
+	}
+}
+
+
+void* malloc(size_t bytes)
+{
+	void* p = __libc_malloc(bytes);
+	bench_alloc_count(p, 1);
+	return p;
+}
+
+
+void* calloc(size_t cnt, size_t bytes)
+{
+	void* p = __libc_calloc(cnt, bytes);
+	bench_alloc_count(p, 1);
+	return p;
+}
+
+
+void* realloc(void* old, size_t bytes)
+{
+	void* p = NULL;
+	bench_alloc_count(old, -1);
+	p = __libc_realloc(old, bytes);
+	bench_alloc_count(p? p : old, p? 1 : 0); /* if realloc() fails, the old block is still allocated */
+	return p;
+}
+
+
+void free(void* p)
+{
+	bench_alloc_count(p, -1);
+	__libc_free(p);
+}
+#else
+#define BENCH_COUNT_ALLOCS 0
+static volatile int  s_bench_allocs_on   = 0; /* volatile: the compiler assumes malloc() does not touch our variables */
+static volatile long s_bench_alloc_cnt   = 0;
+static volatile long s_bench_alloc_bytes = 0;
+static volatile long s_bench_alloc_peak  = 0;
+#endif
+
+
+static void bench_allocs_start()
+{
+	s_bench_alloc_cnt   = 0;
+	s_bench_alloc_bytes = 0;
+	s_bench_alloc_peak  = 0;
+	s_bench_allocs_on   = 1;
+}
+
+
+static long bench_allocs_reset_peak()
+{
+	/* start a new peak at the current number of allocated bytes, returns the old peak */
+	long old_peak = s_bench_alloc_peak;
+	s_bench_alloc_peak = s_bench_alloc_bytes;
+	return old_peak;
+}
+
+
+static void bench_allocs_stop()
+{
+	s_bench_allocs_on = 0;
+}
+
+
+static char* bench_receive(dc_context_t* context, const char* filename, int count)
+{
+	/* parse the given message several times; this is the part of dc_receive_imf() that is independent of the database state
+	and that is done by the worker threads on fetching */
+	char*            ret = NULL;
+	char*            data = NULL;
+	size_t           data_bytes = 0;
+	int              i = 0, parts = 0;
+	size_t           allocs = 0, chunk_allocs = 0;
+	long             start_bytes = 0, msg_peak_bytes = 0, peak_bytes = 0;
+	dc_mimeparser_t* mime_parser = NULL;
+	clock_t          start = 0;
+	double           ms = 0;
+
+	if (dc_read_file(filename, (void**)&data, &data_bytes, context)==0) {
+		goto cleanup;
+	}
+
+	bench_allocs_start();
+	start = clock();
+	for (i = 0; i < count; i++) {
+		start_bytes = s_bench_alloc_bytes;
+		bench_allocs_reset_peak();
+		mime_parser = dc_receive_imf_parse(context, data, data_bytes);
+		if (mime_parser) {
+			parts = carray_count(mime_parser->parts);
+			allocs += mime_parser->arena->allocs;
+			chunk_allocs += mime_parser->arena->chunk_allocs;
+		}
+		dc_mimeparser_release(mime_parser);
+		msg_peak_bytes = bench_allocs_reset_peak()-start_bytes;
+		peak_bytes = DC_MAX(peak_bytes, msg_peak_bytes);
+	}
+	ms = (double)(clock()-start)*1000.0/CLOCKS_PER_SEC;
+	bench_allocs_stop();
+
+	ret = dc_mprintf("%i x %lu bytes parsed into %i parts in %.0f ms, %.3f ms per message.\n"
+		"Arena: %.1f allocations per message served by %.1f malloc() calls.\n"
+		"%s%.1f malloc() calls per message in total, peak %li bytes allocated while parsing a message.",
+		count, (unsigned long)data_bytes, parts, ms, ms/count,
+		(double)allocs/count, (double)chunk_allocs/count,
+		BENCH_COUNT_ALLOCS? "" : "(not counted, build with -Dbench-alloc=true and glibc) ", (double)s_bench_alloc_cnt/count, peak_bytes);
+
+cleanup:
+	free(data);
+	return ret;
+}
+
+
+static int s_bench_ingest_stop = 0;
+
+
+static double bench_now_ms()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec*1000.0 + (double)tv.tv_usec/1000.0;
+}
+
+
+static char* bench_probe(dc_context_t* context, const char* filename, int count)
+{
+	/* compare probing the headers using pread() with reading the whole file, as done before */
+	char*           ret = NULL;
+	void*           data = NULL;
+	size_t          data_bytes = 0;
+	int             i = 0, found = 0;
+	dc_mediaprobe_t probe;
+	double          start = 0, probe_ms = 0, read_ms = 0;
+
+	start = bench_now_ms();
+	for (i = 0; i < count; i++) {
+		found = dc_mediaprobe_file(filename, &probe);
+	}
+	probe_ms = bench_now_ms()-start;
+
+	start = bench_now_ms();
+	for (i = 0; i < count; i++) {
+		if (!dc_read_file(filename, &data, &data_bytes, context)) {
+			goto cleanup;
+		}
+		dc_mediaprobe_buf(data, data_bytes, &probe);
+		free(data);
+		data = NULL;
+	}
+	read_ms = bench_now_ms()-start;
+
+	ret = dc_mprintf("%i x %lu bytes probed: %.3f ms per file using the headers, %.3f ms per file reading the whole file (%s).",
+		count, (unsigned long)data_bytes, probe_ms/count, read_ms/count, found? "format recognized" : "format not recognized");
+
+cleanup:
+	free(data);
+	return ret;
+}
+
+
+static char* bench_hash(int count)
+{
+	/* use dc_hash_t as done for every received message: a few addresses and fingerprints are added
+	and looked up; then, as done by the message cache and the change log, many ids are added and looked up */
+	#define BENCH_HASH_ADDR 8
+	#define BENCH_HASH_IDS  2000
+	char*      addr[BENCH_HASH_ADDR*2];
+	dc_hash_t  hash;
+	int        i, j, found = 0;
+	double     start = 0, addr_ms = 0, ids_ms = 0;
+
+	for (i = 0; i < BENCH_HASH_ADDR*2; i++) {
+		addr[i] = dc_mprintf((i%4)==0? "%08X%08X%08X%08X%08X" : "someone%i@example.org", i, i, i, i, i);
+	}
+
+	start = bench_now_ms();
+	for (i = 0; i < count; i++) {
+		dc_hash_init(&hash, DC_HASH_STRING, 1/*copy key*/);
+		for (j = 0; j < BENCH_HASH_ADDR; j++) {
+			dc_hash_insert(&hash, addr[j], strlen(addr[j]), (void*)1);
+		}
+		for (j = 0; j < BENCH_HASH_ADDR*2; j++) {
+			if (dc_hash_find_str(&hash, addr[j])) { found++; } /* half of the lookups fail */
+		}
+		dc_hash_clear(&hash);
+	}
+	addr_ms = bench_now_ms()-start;
+
+	start = bench_now_ms();
+	for (i = 0; i < count/100+1; i++) {
+		dc_hash_init(&hash, DC_HASH_INT, 0);
+		for (j = 0; j < BENCH_HASH_IDS; j++) {
+			dc_hash_insert(&hash, NULL, j*13+1, (void*)1);
+		}
+		for (j = 0; j < BENCH_HASH_IDS; j++) {
+			if (dc_hash_find(&hash, NULL, j*13+1)) { found++; }
+		}
+		dc_hash_clear(&hash);
+	}
+	ids_ms = bench_now_ms()-start;
+
+	for (i = 0; i < BENCH_HASH_ADDR*2; i++) {
+		free(addr[i]);
+	}
+
+	return dc_mprintf("%i x %i addresses added and %i looked up: %.3f us per message.\n"
+		"%i x %i ids added and looked up: %.1f ns per id (%i found).",
+		count, BENCH_HASH_ADDR, BENCH_HASH_ADDR*2, addr_ms*1000.0/count,
+		count/100+1, BENCH_HASH_IDS, ids_ms*1000000.0/((count/100+1)*BENCH_HASH_IDS), found);
+}
+
+
+static char* bench_utf8(int count)
+{
+	/* validate and count a large multilingual text word-wise and byte-wise, then create summaries
+	from a long message as done for the chatlist */
+	static const char* lines[] = {
+		"The quick brown fox jumps over the lazy dog.\n",
+		"Falsches \xc3\x9c" "ben von Xylophonmusik qu\xc3\xa4lt jeden gr\xc3\xb6\xc3\x9f" "eren Zwerg.\n",
+		"\xd0\xa1\xd1\x8a\xd0\xb5\xd1\x88\xd1\x8c \xd0\xb6\xd0\xb5 \xd0\xb5\xd1\x89\xd1\x91 \xd1\x8d\xd1\x82\xd0\xb8\xd1\x85 \xd0\xbc\xd1\x8f\xd0\xb3\xd0\xba\xd0\xb8\xd1\x85 \xd0\xb1\xd1\x83\xd0\xbb\xd0\xbe\xd0\xba.\n",
+		"\xce\x9e\xce\xb5\xcf\x83\xce\xba\xce\xb5\xcf\x80\xce\xac\xce\xb6\xcf\x89 \xcf\x84\xce\xb7\xce\xbd \xcf\x88\xcf\x85\xcf\x87\xce\xbf\xcf\x86\xce\xb8\xcf\x8c\xcf\x81\xce\xb1.\n",
+		"\xe6\x88\x91\xe8\x83\xbd\xe5\x90\x9e\xe4\xb8\x8b\xe7\x8e\xbb\xe7\x92\x83\xe8\x80\x8c\xe4\xb8\x8d\xe4\xbc\xa4\xe8\xba\xab\xe4\xbd\x93\xe3\x80\x82\n",
+		"Ok \xf0\x9f\x98\x80\xf0\x9f\x91\x8d see you later!\n",
+		NULL };
+	#define         BENCH_UTF8_BYTES (1024*1024)
+	dc_strbuilder_t text;
+	char*           summary = NULL;
+	size_t          bytes = 0, valid = 0, chars = 0;
+	int             i = 0;
+	double          start = 0, valid_ms = 0, valid_scalar_ms = 0, len_ms = 0, len_scalar_ms = 0, summary_ms = 0;
+
+	dc_strbuilder_init(&text, BENCH_UTF8_BYTES);
+	while (text.eos-text.buf < BENCH_UTF8_BYTES) {
+		dc_strbuilder_cat(&text, lines[i++]);
+		if (lines[i]==NULL) {
+			i = 0;
+		}
+	}
+	bytes = strlen(text.buf);
+
+	start = bench_now_ms();
+	for (i = 0; i < count; i++) { valid += dc_utf8_valid_bytes(text.buf, bytes); }
+	valid_ms = bench_now_ms()-start;
+
+	start = bench_now_ms();
+	for (i = 0; i < count; i++) { valid += dc_utf8_valid_bytes_scalar(text.buf, bytes); }
+	valid_scalar_ms = bench_now_ms()-start;
+
+	start = bench_now_ms();
+	for (i = 0; i < count; i++) { chars += dc_utf8_strnlen(text.buf, bytes); }
+	len_ms = bench_now_ms()-start;
+
+	start = bench_now_ms();
+	for (i = 0; i < count; i++) { chars += dc_utf8_strnlen_scalar(text.buf, bytes); }
+	len_scalar_ms = bench_now_ms()-start;
+
+	start = bench_now_ms();
+	for (i = 0; i < count*100; i++) {
+		summary = strndup(text.buf, 64*1024);
+		dc_truncate_n_unwrap_str(summary, 160, 1/*unwrap*/);
+		free(summary);
+	}
+	summary_ms = bench_now_ms()-start;
+
+	free(text.buf);
+
+	return dc_mprintf("%i x %lu bytes, %lu characters, %s:\n"
+		"Validate: %.0f MB/s word-wise, %.0f MB/s byte-wise.\n"
+		"Count characters: %.0f MB/s word-wise, %.0f MB/s byte-wise.\n"
+		"%i summaries of 160 characters from 64 KB: %.2f us per summary.",
+		count, (unsigned long)bytes, (unsigned long)(chars/(count*2)), valid==bytes*count*2? "valid" : "INVALID",
+		bytes*count/1000.0/(valid_ms+0.001), bytes*count/1000.0/(valid_scalar_ms+0.001),
+		bytes*count/1000.0/(len_ms+0.001), bytes*count/1000.0/(len_scalar_ms+0.001),
+		count*100, summary_ms*1000.0/(count*100));
+}
+
+
+static void* bench_ingest_thread_entry_point(void* entry_arg)
+{
+	/* simulate a big sync: write transactions with some rows each, as done by dc_receive_imf() */
+	dc_context_t* context = (dc_context_t*)entry_arg;
+	char          data[4096];
+	int           i = 0;
+
+	memset(data, 'x', sizeof(data));
+	while (!s_bench_ingest_stop)
+	{
+		dc_sqlite3_begin_transaction(context->sql);
+			sqlite3_stmt* stmt = dc_sqlite3_prepare(context->sql, "INSERT INTO bench_ingest (data) VALUES (?);");
+			for (i = 0; i < 50; i++) {
+				sqlite3_bind_blob(stmt, 1, data, sizeof(data), SQLITE_STATIC);
+				sqlite3_step(stmt);
+				sqlite3_reset(stmt);
+			}
+			sqlite3_finalize(stmt);
+		dc_sqlite3_commit(context->sql);
+	}
+
+	return NULL;
+}
+
+
+static void bench_ui_reads(dc_context_t* context, int seconds, int* ret_cnt, double* ret_avg_ms, double* ret_max_ms)
+{
+	/* do what the UI does on a refresh and measure the time the calls take */
+	double end = bench_now_ms() + seconds*1000.0, sum = 0, max = 0;
+	int    cnt = 0;
+
+	while (bench_now_ms() < end)
+	{
+		double start = bench_now_ms();
+			dc_chatlist_t* chatlist = dc_get_chatlist(context, 0, NULL, 0);
+			if (dc_chatlist_get_cnt(chatlist) > 0) {
+				dc_array_t* msg_ids = dc_get_chat_msgs(context, dc_chatlist_get_chat_id(chatlist, 0), 0, 0);
+				if (dc_array_get_cnt(msg_ids) > 0) {
+					dc_msg_unref(dc_get_msg(context, dc_array_get_id(msg_ids, dc_array_get_cnt(msg_ids)-1)));
+				}
+				dc_array_unref(msg_ids);
+			}
+			dc_chatlist_unref(chatlist);
+		double ms = bench_now_ms() - start;
+
+		sum += ms;
+		if (ms > max) { max = ms; }
+		cnt++;
+	}
+
+	*ret_cnt    = cnt;
+	*ret_avg_ms = cnt? sum/cnt : 0;
+	*ret_max_ms = max;
+}
+
+
+static char* bench_db(dc_context_t* context, int seconds)
+{
+	/* measure the latency of UI reads while another thread writes, once with the
+	read-only connections and once with all reads done by the writing connection */
+	char*         ret = NULL;
+	pthread_t     ingest_thread;
+	int           readers_cnt = context->sql->readers_cnt;
+	int           cnt[2] = {0, 0};
+	double        avg_ms[2] = {0, 0}, max_ms[2] = {0, 0};
+	int           pass = 0;
+	sqlite3_stmt* stmt = NULL;
+	int           ingested = 0;
+
+	if (!dc_sqlite3_execute(context->sql, "CREATE TABLE IF NOT EXISTS bench_ingest (id INTEGER PRIMARY KEY, data BLOB);")) {
+		goto cleanup;
+	}
+
+	for (pass = 0; pass < 2; pass++)
+	{
+		context->sql->readers_cnt = pass==0? readers_cnt : 0;
+
+		s_bench_ingest_stop = 0;
+		pthread_create(&ingest_thread, NULL, bench_ingest_thread_entry_point, context);
+			bench_ui_reads(context, seconds, &cnt[pass], &avg_ms[pass], &max_ms[pass]);
+		s_bench_ingest_stop = 1;
+		pthread_join(ingest_thread, NULL);
+	}
+
+	context->sql->readers_cnt = readers_cnt;
+
+	stmt = dc_sqlite3_prepare(context->sql, "SELECT COUNT(*) FROM bench_ingest;");
+	if (sqlite3_step(stmt)==SQLITE_ROW) {
+		ingested = sqlite3_column_int(stmt, 0);
+	}
+	sqlite3_finalize(stmt);
+
+	dc_sqlite3_execute(context->sql, "DROP TABLE bench_ingest;");
+	dc_sqlite3_checkpoint(context->sql);
+
+	ret = dc_mprintf("UI reads while writing %i rows in %i seconds:\n"
+		"%i read-only connections: %i reads, %.3f ms average, %.3f ms max.\n"
+		"Reading from the writing connection: %i reads, %.3f ms average, %.3f ms max.",
+		ingested, seconds*2,
+		readers_cnt, cnt[0], avg_ms[0], max_ms[0],
+		cnt[1], avg_ms[1], max_ms[1]);
+
+cleanup:
+	return ret;
+}
+
+
+static char* bench_reconnect(dc_context_t* context, int count)
+{
+	/* compare cold connects, where no TLS session, capabilities or folders are cached,
+	with reconnects as done after network errors; use the configured account, eg. on a local test server */
+	dc_loginparam_t* lp = dc_loginparam_new();
+	dc_imap_t*       imap = dc_imap_new(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, context);
+	dc_smtp_t*       smtp = dc_smtp_new(context);
+	char*            imap_host = NULL;
+	char*            smtp_host = NULL;
+	char*            ret = NULL;
+	int              i, errors = 0;
+	double           start = 0, imap_cold_ms = 0, imap_warm_ms = 0, smtp_cold_ms = 0, smtp_warm_ms = 0;
+
+	dc_loginparam_read(lp, context->sql, "configured_");
+	if (lp->mail_server==NULL || lp->send_server==NULL) {
+		ret = dc_strdup("ERROR: Not configured.");
+		goto cleanup;
+	}
+	imap_host = dc_mprintf("%s:%i", lp->mail_server, (int)lp->mail_port);
+	smtp_host = dc_mprintf("%s:%i", lp->send_server, (int)lp->send_port);
+
+	for (i = 0; i < count; i++) {
+		dc_openssl_forget_tls_session(imap_host);
+		start = bench_now_ms();
+			if (!dc_imap_connect(imap, lp)) { errors++; }
+		imap_cold_ms += bench_now_ms()-start;
+		dc_imap_disconnect(imap);
+	}
+
+	dc_imap_connect(imap, lp);
+	for (i = 0; i < count; i++) {
+		start = bench_now_ms();
+			if (!dc_imap_reconnect(imap)) { errors++; }
+		imap_warm_ms += bench_now_ms()-start;
+	}
+	dc_imap_disconnect(imap);
+
+	for (i = 0; i < count*2; i++) {
+		if (i < count) {
+			dc_openssl_forget_tls_session(smtp_host);
+		}
+		start = bench_now_ms();
+			if (!dc_smtp_connect(smtp, lp)) { errors++; }
+		if (i < count) { smtp_cold_ms += bench_now_ms()-start; } else { smtp_warm_ms += bench_now_ms()-start; }
+		dc_smtp_disconnect(smtp);
+	}
+
+	ret = dc_mprintf("%i x IMAP %s: cold connect %.1f ms, reconnect %.1f ms.\n"
+		"%i x SMTP %s: cold connect %.1f ms, reconnect %.1f ms.\n"
+		"%i errors.",
+		count, imap_host, imap_cold_ms/count, imap_warm_ms/count,
+		count, smtp_host, smtp_cold_ms/count, smtp_warm_ms/count,
+		errors);
+
+cleanup:
+	free(imap_host);
+	free(smtp_host);
+	dc_smtp_unref(smtp);
+	dc_imap_unref(imap);
+	dc_loginparam_unref(lp);
+	return ret;
+}
+
+
 static int poke_public_key(dc_context_t* context, const char* addr, const char* public_key_file)
 {
 	/* mainly for testing: if the partner does not support Autocrypt,
@@ -412,6 +917,7 @@ char* dc_cmdline(dc_context_t* context, const char* cmdline)
 				"continue-key-transfer <msg-id> <setup-code>\n"
 				"has-backup\n"
 				"export-backup\n"
+				"export-incremental-backup\n"
 				"import-backup <backup-file>\n"
 				"export-keys\n"
 				"import-keys\n"
@@ -439,6 +945,7 @@ char* dc_cmdline(dc_context_t* context, const char* cmdline)
 				"listchats [<query>]\n"
 				"listarchived\n"
 				"chat [<chat-id>|0]\n"
+				"chatwindow <anchor-msg-id>|0 <count>\n"
 				"createchat <contact-id>\n"
 				"createchatbymsg <msg-id>\n"
 				"creategroup <name>\n"
@@ -478,6 +985,12 @@ char* dc_cmdline(dc_context_t* context, const char* cmdline)
 				"checkqr <qr-content>\n"
 				"event <event-id to test>\n"
 				"fileinfo <file>\n"
+				"benchreceive <eml-file> [<count>]\n"
+				"benchprobe <file> [<count>]\n"
+				"benchhash [<count>]\n"
+				"benchutf8 [<count>]\n"
+				"benchdb [<seconds>]\n"
+				"benchreconnect [<count>]\n"
 				"clear -- clear screen\n" /* must be implemented by  the caller */
 				"exit\n" /* must be implemented by  the caller */
 				"============================================="
@@ -574,6 +1087,11 @@ char* dc_cmdline(dc_context_t* context, const char* cmdline)
 		dc_imex(context, DC_IMEX_EXPORT_BACKUP, context->blobdir, NULL);
 		ret = COMMAND_SUCCEEDED;
 	}
+	else if (strcmp(cmd, "export-incremental-backup")==0)
+	{
+		dc_imex(context, DC_IMEX_EXPORT_INCREMENTAL_BACKUP, context->blobdir, NULL);
+		ret = COMMAND_SUCCEEDED;
+	}
 	else if (strcmp(cmd, "import-backup")==0)
 	{
 		if (arg1) {
@@ -769,6 +1287,28 @@ char* dc_cmdline(dc_context_t* context, const char* cmdline)
 			ret = dc_strdup("No chat selected.");
 		}
 	}
+	else if (strcmp(cmd, "chatwindow")==0)
+	{
+		if (sel_chat==NULL) {
+			ret = dc_strdup("No chat selected.");
+		}
+		else if (arg1 && arg1[0]) {
+			char* arg2 = strrchr(arg1, ' ');
+			int   count = arg2? atoi(arg2+1) : -20;
+			dc_array_t* msglist = dc_get_chat_msgs_window(context, dc_chat_get_id(sel_chat), DC_GCM_ADDDAYMARKER, 0, atoi(arg1), count);
+			if (msglist) {
+				log_msglist(context, msglist);
+				ret = dc_mprintf("%i items.", (int)dc_array_get_cnt(msglist));
+				dc_array_unref(msglist);
+			}
+			else {
+				ret = COMMAND_FAILED;
+			}
+		}
+		else {
+			ret = dc_strdup("Argument <anchor-msg-id> missing.");
+		}
+	}
 	else if (strcmp(cmd, "createchat")==0)
 	{
 		if (arg1) {
@@ -1221,20 +1761,79 @@ char* dc_cmdline(dc_context_t* context, const char* cmdline)
 	else if (strcmp(cmd, "fileinfo")==0)
 	{
 		if (arg1) {
-			unsigned char* buf = NULL; size_t buf_bytes; uint32_t w, h;
-			if (dc_read_file(arg1, (void**)&buf, &buf_bytes, context)) {
-				dc_get_filemeta(buf, buf_bytes, &w, &h);
-				ret = dc_mprintf("width=%i, height=%i", (int)w, (int)h);
+			dc_mediaprobe_t probe;
+			if (dc_mediaprobe_file(arg1, &probe)) {
+				ret = dc_mprintf("format=%i, width=%i, height=%i, duration=%i ms", probe.format, (int)probe.width, (int)probe.height, (int)probe.duration_ms);
 			}
 			else {
 				ret = dc_strdup("ERROR: Command failed.");
 			}
-			free(buf);
 		}
 		else {
 			ret = dc_strdup("ERROR: Argument <file> missing.");
 		}
 	}
+	else if (strcmp(cmd, "benchreceive")==0)
+	{
+		if (arg1) {
+			int   count = 100;
+			char* arg2 = strchr(arg1, ' ');
+			if (arg2) {
+				*arg2 = 0;
+				arg2++;
+				count = atoi(arg2);
+			}
+			ret = bench_receive(context, arg1, count>0? count : 1);
+			if (ret==NULL) {
+				ret = COMMAND_FAILED;
+			}
+		}
+		else {
+			ret = dc_strdup("ERROR: Argument <eml-file> missing.");
+		}
+	}
+	else if (strcmp(cmd, "benchprobe")==0)
+	{
+		if (arg1) {
+			int   count = 1000;
+			char* arg2 = strchr(arg1, ' ');
+			if (arg2) {
+				*arg2 = 0;
+				arg2++;
+				count = atoi(arg2);
+			}
+			ret = bench_probe(context, arg1, count>0? count : 1);
+			if (ret==NULL) {
+				ret = COMMAND_FAILED;
+			}
+		}
+		else {
+			ret = dc_strdup("ERROR: Argument <file> missing.");
+		}
+	}
+	else if (strcmp(cmd, "benchhash")==0)
+	{
+		int count = arg1? atoi(arg1) : 100000;
+		ret = bench_hash(count>0? count : 1);
+	}
+	else if (strcmp(cmd, "benchutf8")==0)
+	{
+		int count = arg1? atoi(arg1) : 100;
+		ret = bench_utf8(count>0? count : 1);
+	}
+	else if (strcmp(cmd, "benchreconnect")==0)
+	{
+		int count = arg1? atoi(arg1) : 10;
+		ret = bench_reconnect(context, count>0? count : 1);
+	}
+	else if (strcmp(cmd, "benchdb")==0)
+	{
+		int seconds = arg1? atoi(arg1) : 5;
+		ret = bench_db(context, seconds>0? seconds : 1);
+		if (ret==NULL) {
+			ret = COMMAND_FAILED;
+		}
+	}
 	else
 	{
 		ret = COMMAND_UNKNOWN;
@@ -28,8 +28,14 @@ $ valgrind --leak-check=full --tool=memcheck ./deltachat-core <db>
 
 #include <ctype.h>
 #include <assert.h>
+#include <limits.h>
+#include <dirent.h>
+#include <unistd.h>
 #include "../src/dc_context.h"
+#include "../src/dc_filecopy.h"
+#include "../src/dc_mediaprobe.h"
 #include "../src/dc_simplify.h"
+#include "../src/dc_dehtml.h"
 #include "../src/dc_mimeparser.h"
 #include "../src/dc_mimefactory.h"
 #include "../src/dc_pgp.h"
@@ -37,6 +43,11 @@ $ valgrind --leak-check=full --tool=memcheck ./deltachat-core <db>
 #include "../src/dc_aheader.h"
 #include "../src/dc_keyring.h"
 #include "../src/dc_saxparser.h"
+#include "../src/dc_arena.h"
+#include "../src/dc_probe.h"
+#include "../src/dc_scheduler.h"
+#include "../src/dc_job.h"
+#include "../src/dc_utf8.h"
 
 
 /* some data used for testing
@@ -173,6 +184,216 @@ static const char* s_em_setupfile =
 "-----END PGP MESSAGE-----\n";
 
 
+static void stress_sax_text_cb(void* userdata, const char* text, int len)
+{
+	/* a text may be passed in several parts when the document is fed in chunks, join them */
+	dc_strbuilder_t* strbuilder = (dc_strbuilder_t*)userdata;
+	if (strbuilder->eos > strbuilder->buf && strbuilder->eos[-1]==']') {
+		strbuilder->eos--;
+		strbuilder->free++;
+		*strbuilder->eos = 0;
+		dc_strbuilder_catf(strbuilder, "%s]", text);
+	}
+	else {
+		dc_strbuilder_catf(strbuilder, "[%s]", text);
+	}
+}
+
+
+static void stress_sax_starttag_cb(void* userdata, const char* tag, char** attr)
+{
+	dc_strbuilder_catf((dc_strbuilder_t*)userdata, "<%s", tag);
+	for (int i = 0; attr[i]; i += 2) {
+		dc_strbuilder_catf((dc_strbuilder_t*)userdata, " %s=%s", attr[i], attr[i+1]);
+	}
+	dc_strbuilder_cat((dc_strbuilder_t*)userdata, ">");
+}
+
+
+static void stress_sax_endtag_cb(void* userdata, const char* tag)
+{
+	dc_strbuilder_catf((dc_strbuilder_t*)userdata, "</%s>", tag);
+}
+
+
+static int stress_copy_progress_cb(void* userdata, uint64_t copied_bytes, uint64_t total_bytes)
+{
+	uint64_t* last = (uint64_t*)userdata;
+	assert( copied_bytes >= last[0] && copied_bytes <= total_bytes );
+	last[0] = copied_bytes;
+	last[1]++;
+	return last[2]==0 || last[1] < last[2]; /* last[2] is the call that cancels, 0=never */
+}
+
+
+static int s_probe_results_freed = 0;
+
+
+static void stress_probe_free_result(void* result)
+{
+	__sync_fetch_and_add(&s_probe_results_freed, 1);
+	free(result);
+}
+
+
+static void* stress_probe_func(dc_probe_t* probe)
+{
+	int delay_ms = (int)(uintptr_t)probe->arg; /* negative delays fail */
+	usleep(abs(delay_ms)*1000);
+	return delay_ms>=0? dc_mprintf("%i", delay_ms) : NULL;
+}
+
+
+static int stress_ids_equal(dc_array_t* array, const uint32_t* ids, int cnt)
+{
+	/* compares and unrefs the array */
+	int equal = (array && (int)dc_array_get_cnt(array)==cnt);
+	int i;
+	for (i = 0; equal && i < cnt; i++) {
+		equal = (dc_array_get_id(array, i)==ids[i]);
+	}
+	dc_array_unref(array);
+	return equal;
+}
+
+
+typedef struct stress_imex_t
+{
+	int   progress;
+	char* written;
+} stress_imex_t;
+
+
+static uintptr_t stress_imex_cb(dc_context_t* context, int event, uintptr_t data1, uintptr_t data2)
+{
+	stress_imex_t* imex = (stress_imex_t*)dc_get_userdata(context);
+	if (event==DC_EVENT_IMEX_PROGRESS) {
+		imex->progress = (int)data1;
+	}
+	else if (event==DC_EVENT_IMEX_FILE_WRITTEN) {
+		free(imex->written);
+		imex->written = dc_strdup((const char*)data1);
+	}
+	return 0;
+}
+
+
+static int stress_imex(dc_context_t* context, int what, const char* param1)
+{
+	/* runs the job created by dc_imex() at once; the context must be created with stress_imex_cb() */
+	stress_imex_t* imex = (stress_imex_t*)dc_get_userdata(context);
+	dc_job_t       job;
+
+	memset(&job, 0, sizeof(dc_job_t));
+	job.param = dc_param_new();
+	dc_param_set_int(job.param, DC_PARAM_CMD,     what);
+	dc_param_set    (job.param, DC_PARAM_CMD_ARG, param1);
+
+	imex->progress = -1;
+	dc_job_do_DC_JOB_IMEX_IMAP(context, &job);
+
+	dc_param_unref(job.param);
+	return imex->progress==1000;
+}
+
+
+static char* stress_get_rows(dc_context_t* context, const char* query)
+{
+	/* all rows as one string, used to compare the contents of two databases */
+	dc_strbuilder_t ret;
+	sqlite3_stmt*   stmt = dc_sqlite3_prepare(context->sql, query);
+	int             i;
+
+	dc_strbuilder_init(&ret, 0);
+	while (sqlite3_step(stmt)==SQLITE_ROW) {
+		for (i = 0; i < sqlite3_column_count(stmt); i++) {
+			dc_strbuilder_catf(&ret, "%s|", sqlite3_column_text(stmt, i)? (const char*)sqlite3_column_text(stmt, i) : "NULL");
+		}
+		dc_strbuilder_cat(&ret, "\n");
+	}
+	sqlite3_finalize(stmt);
+	return ret.buf;
+}
+
+
+static void stress_delete_dir(const char* dir_name)
+{
+	/* deletes the files in the directory and the directory itself, subdirectories are not supported */
+	DIR*           dir_handle = opendir(dir_name);
+	struct dirent* dir_entry = NULL;
+
+	if (dir_handle) {
+		while ((dir_entry=readdir(dir_handle))!=NULL) {
+			if (strcmp(dir_entry->d_name, ".")!=0 && strcmp(dir_entry->d_name, "..")!=0) {
+				char* pathNfilename = dc_mprintf("%s/%s", dir_name, dir_entry->d_name);
+				unlink(pathNfilename);
+				free(pathNfilename);
+			}
+		}
+		closedir(dir_handle);
+	}
+	rmdir(dir_name);
+}
+
+
+/* the byte-by-byte implementations used before dc_utf8.c, kept to compare the results */
+static int stress_is_valid_utf8_bytewise(const char* buf)
+{
+	const unsigned char* p1 = (const unsigned char*)buf;
+	int ix = strlen(buf), i, j, n, c;
+	for (i = 0; i < ix; i++) {
+		c = p1[i];
+		     if (c > 0 && c <= 0x7f)                            { n=0; }
+		else if ((c & 0xE0) == 0xC0)                            { n=1; }
+		else if (c==0xed && i<(ix-1) && (p1[i+1] & 0xa0)==0xa0) { return 0; }
+		else if ((c & 0xF0) == 0xE0)                            { n=2; }
+		else if ((c & 0xF8) == 0xF0)                            { n=3; }
+		else                                                    { return 0; }
+		for (j = 0; j < n && i < ix; j++) {
+			if ((++i == ix) || (( p1[i] & 0xC0) != 0x80)) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+
+static void stress_truncate_n_unwrap_str_bytewise(char* buf, int approx_characters, int do_unwrap)
+{
+	const char* ellipse_utf8 = do_unwrap? " ..." : " " DC_EDITORIAL_ELLIPSE;
+	int lastIsCharacter = 0;
+	unsigned char* p1 = (unsigned char*)buf;
+	while (*p1) {
+		if (*p1 > ' ') {
+			lastIsCharacter = 1;
+		}
+		else {
+			if (lastIsCharacter) {
+				size_t used_bytes = (size_t)((uintptr_t)p1 - (uintptr_t)buf);
+				if (dc_utf8_strnlen_scalar(buf, used_bytes) >= approx_characters) {
+					if (strlen(buf)-used_bytes >= strlen(ellipse_utf8)) {
+						strcpy((char*)p1, ellipse_utf8);
+					}
+					break;
+				}
+				lastIsCharacter = 0;
+				if (do_unwrap) {
+					*p1 = ' ';
+				}
+			}
+			else if (do_unwrap) {
+				*p1 = '\r';
+			}
+		}
+		p1++;
+	}
+	if (do_unwrap) {
+		dc_remove_cr_chars(buf);
+	}
+}
+
+
 void stress_functions(dc_context_t* context)
 {
 	/* test dc_saxparser_t
@@ -185,6 +406,59 @@ void stress_functions(dc_context_t* context)
 		dc_saxparser_parse(&saxparser, "<tag attr=\"val\"="); // should not crash or cause a deadlock
 	}
 
+	{
+		/* feeding a document in chunks must give the same result as parsing it at once */
+		const char* xml = "<!DOCTYPE a [<!x>]>t1<!-- c -->&amp;<a  href = \"u>v\" b='w' c=x/><?pi ?><![CDATA[<]]></a >t2&lt<b";
+		dc_strbuilder_t whole, chunked;
+		dc_strbuilder_init(&whole, 0);
+		dc_strbuilder_init(&chunked, 0);
+
+		dc_saxparser_t saxparser;
+		dc_saxparser_init(&saxparser, &whole);
+		dc_saxparser_set_tag_handler(&saxparser, stress_sax_starttag_cb, stress_sax_endtag_cb);
+		dc_saxparser_set_text_handler(&saxparser, stress_sax_text_cb);
+		dc_saxparser_parse(&saxparser, xml);
+		assert( strcmp(whole.buf, "[t1&]<a href=u>v b=w c=x></a>[<]</a>[t2&lt]<b>")==0 ); /* texts around the comment are joined by stress_sax_text_cb() */
+
+		for (size_t chunk_bytes = 1; chunk_bytes < strlen(xml); chunk_bytes++) {
+			dc_strbuilder_empty(&chunked);
+			saxparser.userdata = &chunked;
+			for (size_t offset = 0; offset < strlen(xml); offset += chunk_bytes) {
+				dc_saxparser_feed(&saxparser, &xml[offset], DC_MIN(chunk_bytes, strlen(xml)-offset));
+			}
+			dc_saxparser_finish(&saxparser);
+			assert( strcmp(whole.buf, chunked.buf)==0 );
+		}
+
+		free(whole.buf);
+		free(chunked.buf);
+	}
+
+	{
+		/* text without tags is passed on chunk by chunk and counts towards the limit,
+		entities spanning two chunks are still decoded; unclosed markup is not scanned again for every chunk */
+		size_t html_bytes = DC_DEHTML_CHUNK_BYTES*64;
+		char*  html = malloc(html_bytes+1);
+		memset(html, 'x', html_bytes);
+		memcpy(&html[DC_DEHTML_CHUNK_BYTES-2], "&amp;", 5);
+		html[html_bytes] = 0;
+
+		int   truncated = 0;
+		char* plain = dc_dehtml_n(html, html_bytes, DC_DEHTML_CHUNK_BYTES*2, &truncated);
+		assert( truncated );
+		assert( strlen(plain) < DC_DEHTML_CHUNK_BYTES*4 );
+		assert( strncmp(&plain[DC_DEHTML_CHUNK_BYTES-3], "x&x", 3)==0 );
+		free(plain);
+
+		html[10] = '<'; /* a stray `<` swallows the rest of the document, as before */
+		plain = dc_dehtml_n(html, html_bytes, 0, &truncated);
+		assert( !truncated );
+		assert( strcmp(plain, "xxxxxxxxxx")==0 );
+		free(plain);
+
+		free(html);
+	}
+
 	/* test dc_simplify_t and dc_saxparser_t (indirectly used by dc_simplify_t)
 	 **************************************************************************/
 
@@ -211,6 +485,53 @@ void stress_functions(dc_context_t* context)
 		assert( strcmp(plain, "<>\"'& äÄöÖüÜß fooÆçÇ ♦&noent;")==0 );
 		free(plain);
 
+		html = "<p>first paragraph</p><p>second paragraph</p><p>third paragraph</p>";
+		simplify->html_max_bytes = 10; /* stop converting early, the text is marked as being cut */
+		plain = dc_simplify_simplify(simplify, html, strlen(html), 1);
+		assert( strcmp(plain, "first paragraph [...]")==0 );
+		free(plain);
+		simplify->html_max_bytes = 0;
+
+		/* golden texts, the expected results are created by the former carray-based implementation */
+		static const struct { const char* in; const char* out; int is_forwarded, is_cut_at_begin, is_cut_at_end; } golden[] = {
+			{ "Hi,\n\nthis is the answer.\n\nOn 2.9.2016, Bjoern wrote:\n> question\n> more question\n",
+			  "Hi,\n\nthis is the answer. [...]", 0, 0, 1 },
+			{ "> quoted start\n> more\n\nanswer below\n",
+			  "[...] answer below", 0, 1, 0 },
+			{ "Am 01.02.2016 schrieb xy@z:\n\n> quote\n\nanswer\n",
+			  "[...] answer", 0, 1, 0 },
+			{ "text\n-- \nsignature\n",
+			  "text", 0, 0, 0 },
+			{ "text\n--  \nqp-encoded signature\n",
+			  "text", 0, 0, 0 },
+			{ "text\n---\nnon-standard footer\n",
+			  "text [...]", 0, 0, 1 },
+			{ "---------- Forwarded message ----------\nFrom: bob@example.org\n\nforwarded text\n",
+			  "forwarded text", 1, 0, 0 },
+			{ "answer\n\n----- Original message -----\nFrom: alice\nold text\n",
+			  "answer [...]", 0, 0, 1 },
+			{ "line1\n\n\n\nline2\r\n  \nline3",
+			  "line1\n\nline2\n\nline3", 0, 0, 0 },
+			{ "> only\n> quotes\n",
+			  " [...]", 0, 0, 1 },
+			{ "-- \n",
+			  "", 0, 0, 0 },
+			{ "  leading space line\n\n\n\n\ntrailing\n\n\n",
+			  "  leading space line\n\ntrailing", 0, 0, 0 },
+			{ "answer\n_____\nOutlook quote",
+			  "answer [...]", 0, 0, 1 },
+			{ "x\n\n> q1\n\ny\n\n> q2\n",
+			  "x\n\n> q1\n\ny [...]", 0, 0, 1 },
+		};
+		for (int i = 0; i < sizeof(golden)/sizeof(golden[0]); i++) {
+			plain = dc_simplify_simplify(simplify, golden[i].in, strlen(golden[i].in), 0);
+			assert( strcmp(plain, golden[i].out)==0 );
+			assert( simplify->is_forwarded==golden[i].is_forwarded );
+			assert( simplify->is_cut_at_begin==golden[i].is_cut_at_begin );
+			assert( simplify->is_cut_at_end==golden[i].is_cut_at_end );
+			free(plain);
+		}
+
 		dc_simplify_unref(simplify);
 	}
 
@@ -247,6 +568,17 @@ void stress_functions(dc_context_t* context)
 	/* test dc_mimeparser_t
 	**************************************************************************/
 
+	assert( dc_mimeparser_header_id("Message-ID")==DC_HEADER_MESSAGE_ID );
+	assert( dc_mimeparser_header_id("message-id")==DC_HEADER_MESSAGE_ID );
+	assert( dc_mimeparser_header_id("CHAT-VERSION")==DC_HEADER_CHAT_VERSION );
+	assert( dc_mimeparser_header_id("Secure-Join-Group")==DC_HEADER_SECURE_JOIN_GROUP );
+	assert( dc_mimeparser_header_id("X-MrRemoveFromGrp")==DC_HEADER_X_MRREMOVEFROMGRP );
+	assert( dc_mimeparser_header_id("Return-Path")==DC_HEADER_RETURN_PATH );
+	assert( dc_mimeparser_header_id("Secure-Join-")==-1 );
+	assert( dc_mimeparser_header_id("Foo")==-1 );
+	assert( dc_mimeparser_header_id("")==-1 );
+	assert( dc_mimeparser_header_id(NULL)==-1 );
+
 	{
 		dc_mimeparser_t* mimeparser = dc_mimeparser_new(context->blobdir, context);
 
@@ -282,6 +614,14 @@ void stress_functions(dc_context_t* context)
 		of = dc_mimeparser_lookup_optional_field(mimeparser, "Chat-Version");
 		assert( strcmp(of->fld_value, "1.0")==0 );
 
+		of = dc_mimeparser_get_optional_header(mimeparser, DC_HEADER_CHAT_VERSION);
+		assert( of && strcmp(of->fld_value, "1.0")==0 );
+
+		struct mailimf_field* field = dc_mimeparser_get_header(mimeparser, DC_HEADER_SUBJECT);
+		assert( field && field->fld_type==MAILIMF_FIELD_SUBJECT );
+		assert( field == dc_mimeparser_lookup_field(mimeparser, "subject") );
+		assert( dc_mimeparser_get_header(mimeparser, DC_HEADER_SECURE_JOIN)==NULL );
+
 		assert( carray_count(mimeparser->parts) == 1 );
 
 		dc_mimeparser_unref(mimeparser);
@@ -552,6 +892,1137 @@ void stress_functions(dc_context_t* context)
 		dc_array_unref(arr);
 	}
 
+	/* test dc_hash_t against a plain array holding the same entries
+	 **************************************************************************/
+
+	{
+		#define HASH_TEST_KEYS 300
+		char*      keys[HASH_TEST_KEYS];
+		uintptr_t  ref[HASH_TEST_KEYS];
+		dc_hash_t  hash;
+		int        i, k, cnt = 0;
+
+		srand(42);
+		for (k = 0; k < HASH_TEST_KEYS; k++) {
+			/* short keys are stored inline, long ones are allocated */
+			keys[k] = dc_mprintf("%i@%s.org", k, (k%3)==0? "a-very-long-domain-name-so-that-the-key-is-not-inline" : "b");
+			ref[k] = 0;
+		}
+
+		dc_hash_init(&hash, DC_HASH_STRING, 1/*copy key*/);
+		for (i = 0; i < 20000; i++) {
+			k = rand() % HASH_TEST_KEYS;
+			uintptr_t data = (rand()%3)==0? 0 : (uintptr_t)(i+1);
+			void* old = dc_hash_insert(&hash, keys[k], strlen(keys[k]), (void*)data);
+			assert( (uintptr_t)old==ref[k] );
+			if (ref[k]==0 && data) { cnt++; }
+			if (ref[k] && data==0) { cnt--; }
+			ref[k] = data;
+			assert( dc_hash_cnt(&hash)==cnt );
+
+			k = rand() % HASH_TEST_KEYS;
+			assert( (uintptr_t)dc_hash_find_str(&hash, keys[k])==ref[k] );
+		}
+
+		for (k = 0; k < HASH_TEST_KEYS; k++) {
+			char* upper = dc_strdup(keys[k]);
+			for (i = 0; upper[i]; i++) { upper[i] = toupper(upper[i]); }
+			assert( (uintptr_t)dc_hash_find_str(&hash, upper)==ref[k] ); /* DC_HASH_STRING ignores the case */
+			free(upper);
+		}
+
+		dc_hashelem_t* elem;
+		for (i = 0, elem = dc_hash_first(&hash); elem; elem = dc_hash_next(elem), i++) {
+			assert( dc_hash_find(&hash, dc_hash_key(elem), dc_hash_keysize(elem))==dc_hash_data(elem) );
+		}
+		assert( i==cnt );
+
+		dc_hash_clear(&hash);
+		assert( dc_hash_cnt(&hash)==0 );
+		assert( dc_hash_find_str(&hash, keys[0])==NULL );
+		assert( dc_hash_first(&hash)==NULL );
+
+		dc_hash_init(&hash, DC_HASH_INT, 0);
+		for (i = 0; i < 10000; i++) {
+			dc_hash_insert(&hash, NULL, i*7, (void*)(uintptr_t)(i+1));
+		}
+		for (i = 0; i < 10000; i += 2) {
+			dc_hash_insert(&hash, NULL, i*7, NULL);
+		}
+		assert( dc_hash_cnt(&hash)==5000 );
+		for (i = 0; i < 10000; i++) {
+			assert( (uintptr_t)dc_hash_find(&hash, NULL, i*7)==((i%2)? (uintptr_t)(i+1) : 0) );
+		}
+		dc_hash_clear(&hash);
+
+		for (k = 0; k < HASH_TEST_KEYS; k++) {
+			free(keys[k]);
+		}
+	}
+
+	/* test dc_arena_t
+	 **************************************************************************/
+
+	{
+		dc_arena_t* arena = dc_arena_new();
+		int i;
+
+		char* str = dc_arena_strndup(arena, "foobar", 3);
+		assert( strcmp(str, "foo")==0 );
+		str = dc_arena_strndup(arena, "foo", 100); /* stops at the null-byte */
+		assert( strcmp(str, "foo")==0 );
+		str = dc_arena_mprintf(arena, "%s-%i", "bar", 42);
+		assert( strcmp(str, "bar-42")==0 );
+
+		for (i = 0; i < 1000; i++) {
+			uint32_t* p = dc_arena_alloc(arena, 3*sizeof(uint32_t));
+			assert( ((uintptr_t)p % sizeof(double))==0 );
+			assert( p[0]==0 && p[1]==0 && p[2]==0 );
+			p[0] = p[1] = p[2] = 0xFFFFFFFF;
+		}
+		char* big = dc_arena_alloc(arena, DC_ARENA_CHUNK_BYTES*2);
+		assert( big[0]==0 && big[DC_ARENA_CHUNK_BYTES*2-1]==0 );
+		assert( arena->allocs==1004 );
+		assert( arena->chunk_allocs < 10 );
+
+		size_t chunk_allocs = arena->chunk_allocs;
+		dc_arena_reset(arena);
+		str = dc_arena_strndup(arena, "after reset", 100);
+		assert( strcmp(str, "after reset")==0 );
+		assert( arena->chunk_allocs==chunk_allocs ); /* one chunk is reused */
+
+		dc_arena_unref(arena);
+	}
+
+	/* test dc_probes_t
+	 **************************************************************************/
+
+	{
+		dc_probes_t* probes = NULL;
+		char*        result = NULL;
+		int          index = 0;
+		int          ongoing = dc_alloc_ongoing(context);
+		assert( ongoing );
+
+		/* a slower probe with higher priority wins against a faster one */
+		probes = dc_probes_new(context, stress_probe_free_result, NULL);
+		dc_probes_add(probes, stress_probe_func, (void*)(uintptr_t)200, 5000);
+		dc_probes_add(probes, stress_probe_func, (void*)(uintptr_t)10, 5000);
+		result = dc_probes_get_best(probes, &index);
+		assert( result && strcmp(result, "200")==0 && index==0 );
+		free(result);
+		dc_probes_unref(probes); /* waits for the probe threads */
+		assert( s_probe_results_freed==1 ); /* the result of the faster probe */
+
+		/* failed and timed out probes are skipped; we do not wait for probes with a lower priority */
+		probes = dc_probes_new(context, stress_probe_free_result, NULL);
+		dc_probes_add(probes, stress_probe_func, (void*)(uintptr_t)-10, 5000);
+		dc_probes_add(probes, stress_probe_func, (void*)(uintptr_t)300, 50);
+		dc_probes_add(probes, stress_probe_func, (void*)(uintptr_t)100, 5000);
+		dc_probes_add(probes, stress_probe_func, (void*)(uintptr_t)400, 5000);
+		result = dc_probes_get_best(probes, &index);
+		assert( result && strcmp(result, "100")==0 && index==2 );
+		free(result);
+		dc_probes_unref(probes);
+		assert( s_probe_results_freed==3 ); /* the late results of the timed out and of the last probe */
+
+		/* all probes fail */
+		probes = dc_probes_new(context, stress_probe_free_result, NULL);
+		dc_probes_add(probes, stress_probe_func, (void*)(uintptr_t)-10, 5000);
+		dc_probes_add(probes, stress_probe_func, (void*)(uintptr_t)-20, 5000);
+		result = dc_probes_get_best(probes, &index);
+		assert( result==NULL && index==-1 );
+		dc_probes_unref(probes);
+
+		/* dc_stop_ongoing_process() cancels all probes */
+		probes = dc_probes_new(context, stress_probe_free_result, NULL);
+		dc_probes_add(probes, stress_probe_func, (void*)(uintptr_t)300, 5000);
+		context->shall_stop_ongoing = 1;
+		result = dc_probes_get_best(probes, &index);
+		assert( result==NULL && index==-1 );
+		assert( dc_probes_add(probes, stress_probe_func, (void*)(uintptr_t)10, 5000)==0 );
+		dc_probes_unref(probes);
+		assert( s_probe_results_freed==4 );
+
+		dc_free_ongoing(context);
+	}
+
+	/* test dc_scheduler_t
+	 **************************************************************************/
+
+	{
+		dc_context_t*   account = dc_context_new(NULL, NULL, "stress"); /* not opened, so steps return at once */
+		dc_scheduler_t* scheduler = dc_scheduler_new(2, 1);
+		uint64_t        steps = 0;
+		int             i;
+
+		assert( dc_scheduler_add(scheduler, account) );
+		assert( !dc_scheduler_add(scheduler, account) ); /* a context can be added only once */
+		assert( account->scheduler==scheduler );
+
+		for (i = 0; i < 50 && steps < 2; i++) { /* the IMAP- and the SMTP-task are due at once */
+			usleep(100*1000);
+			pthread_mutex_lock(&scheduler->mutex);
+				steps = scheduler->steps;
+			pthread_mutex_unlock(&scheduler->mutex);
+		}
+		assert( steps==2 );
+
+		dc_interrupt_smtp_idle(account);
+		for (i = 0; i < 50 && steps < 3; i++) {
+			usleep(100*1000);
+			pthread_mutex_lock(&scheduler->mutex);
+				steps = scheduler->steps;
+			pthread_mutex_unlock(&scheduler->mutex);
+		}
+		assert( steps==3 );
+
+		dc_scheduler_remove(scheduler, account);
+		assert( account->scheduler==NULL );
+		dc_scheduler_unref(scheduler);
+
+		scheduler = dc_scheduler_new(1, 0);
+		dc_scheduler_add(scheduler, account);
+		dc_context_unref(account); /* removes the context from the scheduler */
+		dc_scheduler_unref(scheduler);
+	}
+
+	/* test dc_utf8_valid_bytes() and dc_utf8_strnlen() against the bytewise implementations
+	 **************************************************************************/
+
+	{
+		static const char* pieces[] = { "a", "Delta ", "Chat\n", " ", "  ", "\t", "\xc3\xa4", "\xc3\x9f", "\xd0\x96", "\xce\xa9",
+			"\xe4\xb8\xad", "\xe6\x96\x87 ", "\xf0\x9f\x98\x80", "\xed\x9f\xbf", /* valid */
+			"\xc4", "\xed\xa0\x80", "\xf0\x9f", "\x80", "\xf8\x88\x80\x80\x80", "\xff", NULL }; /* invalid */
+		#define         UTF8_TEST_BYTES 300
+		char            buf[UTF8_TEST_BYTES+8], buf2[UTF8_TEST_BYTES+8];
+		int             pieces_cnt = 0, valid_pieces_cnt = 14;
+		uint32_t        rnd = 1;
+		size_t          bytes = 0, i = 0;
+		int             round = 0, approx = 0;
+
+		while (pieces[pieces_cnt]) {
+			pieces_cnt++;
+		}
+
+		assert( dc_utf8_strlen("") == 0 );
+		assert( dc_utf8_strlen("Bj\xc3\xb6rn \xe4\xb8\xad\xf0\x9f\x98\x80") == 8 );
+		assert( dc_utf8_valid_bytes("abcdefghijklmnop\xc4", 17) == 16 );
+		assert( dc_utf8_valid_bytes("abc\xe4\xb8", 5) == 3 ); /* truncated character */
+		assert( dc_utf8_valid_bytes(NULL, 0) == 0 );
+
+		for (round = 0; round < 2000; round++)
+		{
+			/* every 4th string contains invalid sequences */
+			bytes = 0;
+			while (1) {
+				rnd = rnd*1103515245+12345;
+				const char* piece = pieces[(rnd>>16) % ((round%4)==0? pieces_cnt : valid_pieces_cnt)];
+				if (bytes+strlen(piece) > UTF8_TEST_BYTES || ((rnd>>8)%64)==0) {
+					break;
+				}
+				strcpy(&buf[bytes], piece);
+				bytes += strlen(piece);
+			}
+			buf[bytes] = 0;
+
+			assert( (dc_utf8_valid_bytes(buf, bytes)==bytes) == stress_is_valid_utf8_bytewise(buf) );
+			for (i = 0; i <= bytes; i += 1+(i%3)) {
+				assert( dc_utf8_valid_bytes(&buf[i], bytes-i) == dc_utf8_valid_bytes_scalar(&buf[i], bytes-i) );
+				assert( dc_utf8_strnlen(&buf[i], bytes-i) == dc_utf8_strnlen_scalar(&buf[i], bytes-i) );
+			}
+
+			approx = (int)((rnd>>4)%80);
+			strcpy(buf2, buf);
+			dc_truncate_n_unwrap_str(buf, approx, round%2);
+			stress_truncate_n_unwrap_str_bytewise(buf2, approx, round%2);
+			assert( strcmp(buf, buf2)==0 );
+		}
+	}
+
+	/* test the job queue
+	 **************************************************************************/
+
+	{
+		#define         STRESS_JOB_MSG_ID 4242001 /* no such message, so the jobs are estimated as small */
+		int             cancelled = 0;
+		int             cnt = 0;
+		int             actions[4], actions_cnt = 0;
+		char*           stats = NULL;
+		sqlite3_stmt*   stmt = NULL;
+
+		pthread_mutex_lock(&context->jobstats_critical);
+			cancelled = context->jobs_cancelled;
+		pthread_mutex_unlock(&context->jobstats_critical);
+
+		dc_job_add(context, DC_JOB_MARKSEEN_MSG_ON_IMAP, STRESS_JOB_MSG_ID, NULL, 100);
+		dc_job_add(context, DC_JOB_DELETE_MSG_ON_IMAP, STRESS_JOB_MSG_ID, NULL, 100);
+		assert( dc_job_get_wait_seconds(context, DC_IMAP_THREAD, 1000)<=100 );
+		assert( dc_job_get_wait_seconds(context, DC_IMAP_THREAD, 5)<=5 );
+
+		dc_job_kill_foreign_id(context, STRESS_JOB_MSG_ID); /* deleting on the server is kept */
+		pthread_mutex_lock(&context->jobstats_critical);
+			assert( context->jobs_cancelled==cancelled+1 );
+		pthread_mutex_unlock(&context->jobstats_critical);
+
+		stmt = dc_sqlite3_prepare(context->sql, "SELECT action, bytes FROM jobs WHERE foreign_id=?;");
+		sqlite3_bind_int(stmt, 1, STRESS_JOB_MSG_ID);
+		while (sqlite3_step(stmt)==SQLITE_ROW) {
+			assert( sqlite3_column_int(stmt, 0)==DC_JOB_DELETE_MSG_ON_IMAP );
+			assert( sqlite3_column_int(stmt, 1)==0 );
+			cnt++;
+		}
+		sqlite3_finalize(stmt);
+		assert( cnt==1 );
+
+		stats = dc_job_get_stats(context);
+		assert( strncmp(stats, "Jobs: ", 6)==0 );
+		free(stats);
+
+		/* big jobs come after all small jobs, even if they were added first and have a higher action */
+		dc_job_add(context, DC_JOB_SEND_MSG_TO_IMAP, STRESS_JOB_MSG_ID, NULL, 100);
+		dc_job_add(context, DC_JOB_MARKSEEN_MSG_ON_IMAP, STRESS_JOB_MSG_ID, NULL, 100);
+		dc_job_add(context, DC_JOB_DELETE_MSG_ON_IMAP, STRESS_JOB_MSG_ID, NULL, 100);
+		stmt = dc_sqlite3_prepare(context->sql, "UPDATE jobs SET bytes=? WHERE foreign_id=? AND action=?;");
+		sqlite3_bind_int(stmt, 1, DC_JOB_BIG_BYTES+1);
+		sqlite3_bind_int(stmt, 2, STRESS_JOB_MSG_ID);
+		sqlite3_bind_int(stmt, 3, DC_JOB_SEND_MSG_TO_IMAP);
+		sqlite3_step(stmt);
+		sqlite3_finalize(stmt);
+
+		stmt = dc_job_prepare_due(context, DC_IMAP_THREAD, time(NULL)+200);
+		while (sqlite3_step(stmt)==SQLITE_ROW) {
+			if (sqlite3_column_int(stmt, 2)==STRESS_JOB_MSG_ID && actions_cnt < 4) {
+				actions[actions_cnt++] = sqlite3_column_int(stmt, 1);
+			}
+		}
+		sqlite3_finalize(stmt);
+		assert( actions_cnt==4 ); /* markseen, the two delete-jobs and send */
+		assert( actions[0]==DC_JOB_MARKSEEN_MSG_ON_IMAP );
+		assert( actions[1]==DC_JOB_DELETE_MSG_ON_IMAP && actions[2]==DC_JOB_DELETE_MSG_ON_IMAP );
+		assert( actions[3]==DC_JOB_SEND_MSG_TO_IMAP );
+
+		/* the backoff doubles with each try, +/- 25% jitter, and reaches the maximum before the job fails finally */
+		for (int tries = 1; tries < DC_JOB_RETRIES; tries++) {
+			int expected = DC_MIN(DC_JOB_BACKOFF_SEC<<(tries-1), DC_JOB_BACKOFF_MAX_SEC);
+			for (int round = 0; round < 100; round++) {
+				int seconds = dc_job_get_backoff_seconds(tries);
+				assert( seconds >= expected-expected/4 && seconds <= expected+expected/4 );
+			}
+		}
+		assert( (DC_JOB_BACKOFF_SEC<<(DC_JOB_RETRIES-2)) >= DC_JOB_BACKOFF_MAX_SEC );
+
+		stmt = dc_sqlite3_prepare(context->sql, "DELETE FROM jobs WHERE foreign_id=?;");
+		sqlite3_bind_int(stmt, 1, STRESS_JOB_MSG_ID);
+		sqlite3_step(stmt);
+		sqlite3_finalize(stmt);
+	}
+
+	/* test batched IMAP-jobs
+	 **************************************************************************/
+
+	{
+		dc_imap_batch_item_t       items[7];
+		struct mailimap_set*       set = NULL;
+		struct mailimap_set_item*  si = NULL;
+		uint32_t                   uids[] = { 7, 3, 5, 4, 0, 9, 10 };
+		int                        i = 0;
+
+		memset(items, 0, sizeof(items));
+		for (i = 0; i < 7; i++) {
+			items[i].server_uid = uids[i];
+			items[i].rfc724_mid = "stress@batch";
+			items[i].matches    = 1;
+		}
+		items[5].matches     = 0;               /* 9 */
+		items[6].rfc724_mid  = NULL;            /* 10 */
+		items[1].ms_flags    = DC_MS_ALSO_MOVE; /* 3 */
+		items[2].ms_flags    = DC_MS_ALSO_MOVE; /* 5 */
+		items[2].has_mdnsent = 1;
+
+		set = dc_imap_batch_set_new(items, 7, 0); /* sorted and merged, no UID 0 */
+		assert( clist_count(set->set_list)==3 );
+		si = (struct mailimap_set_item*)clist_content(clist_begin(set->set_list));
+		assert( si->set_first==3 && si->set_last==5 );
+		si = (struct mailimap_set_item*)clist_content(clist_next(clist_begin(set->set_list)));
+		assert( si->set_first==7 && si->set_last==7 );
+		si = (struct mailimap_set_item*)clist_content(clist_next(clist_next(clist_begin(set->set_list))));
+		assert( si->set_first==9 && si->set_last==10 );
+		mailimap_set_free(set);
+
+		set = dc_imap_batch_set_new(items, 7, DC_BATCH_MATCHING|DC_BATCH_HAS_RFC724_MID);
+		assert( clist_count(set->set_list)==2 );
+		si = (struct mailimap_set_item*)clist_content(clist_begin(set->set_list));
+		assert( si->set_first==3 && si->set_last==5 );
+		si = (struct mailimap_set_item*)clist_content(clist_next(clist_begin(set->set_list)));
+		assert( si->set_first==7 && si->set_last==7 );
+		mailimap_set_free(set);
+
+		set = dc_imap_batch_set_new(items, 7, DC_BATCH_MATCHING|DC_BATCH_NO_MDNSENT|DC_MS_ALSO_MOVE);
+		assert( clist_count(set->set_list)==1 );
+		si = (struct mailimap_set_item*)clist_content(clist_begin(set->set_list));
+		assert( si->set_first==3 && si->set_last==3 );
+		mailimap_set_free(set);
+
+		set = dc_imap_batch_set_new(items, 0, 0);
+		assert( set && clist_count(set->set_list)==0 );
+		mailimap_set_free(set);
+	}
+
+	{
+		dc_batch_job_t   jobs[5];
+		dc_batch_job_t*  group[DC_IMAP_BATCH_MAX];
+		carray*          batch_jobs = carray_new(5);
+		int              i = 0;
+
+		memset(jobs, 0, sizeof(jobs));
+		jobs[0].job_id = 1; jobs[0].action = DC_JOB_MARKSEEN_MSG_ON_IMAP; jobs[0].server_folder = "INBOX";
+		jobs[1].job_id = 2; jobs[1].action = DC_JOB_DELETE_MSG_ON_IMAP;   jobs[1].server_folder = "INBOX";
+		jobs[2].job_id = 3; jobs[2].action = DC_JOB_MARKSEEN_MDN_ON_IMAP; jobs[2].server_folder = "INBOX";
+		jobs[3].job_id = 4; jobs[3].action = DC_JOB_MARKSEEN_MSG_ON_IMAP; jobs[3].server_folder = "Chats";
+		jobs[4].job_id = 5; jobs[4].action = DC_JOB_DELETE_MSG_ON_IMAP;   jobs[4].server_folder = "INBOX";
+		for (i = 0; i < 5; i++) {
+			carray_add(batch_jobs, &jobs[i], NULL);
+		}
+
+		/* the markseen-jobs of INBOX, also for MDNs, in their order */
+		assert( dc_job_group_batch(batch_jobs, 0, group)==2 );
+		assert( group[0]->job_id==1 && group[1]->job_id==3 );
+		assert( jobs[0].handled && jobs[2].handled && !jobs[1].handled && !jobs[3].handled );
+
+		/* the delete-jobs of INBOX */
+		assert( dc_job_group_batch(batch_jobs, 1, group)==2 );
+		assert( group[0]->job_id==2 && group[1]->job_id==5 );
+
+		/* another folder */
+		assert( dc_job_group_batch(batch_jobs, 3, group)==1 );
+		assert( group[0]->job_id==4 );
+
+		carray_free(batch_jobs);
+	}
+
+	/* test dc_get_chat_msgs_window()
+	 **************************************************************************/
+
+	{
+		#define       STRESS_WINDOW_CHAT_ID 4242010 /* no such chat, the messages are added directly */
+		time_t        t = 1500000000;
+		time_t        timestamps[] = { t, t, t+1, t+2, t+2, t+3 }; /* ties on the timestamp are ordered by the ID */
+		uint32_t      m[6], foreign_id = 0;
+		sqlite3_stmt* stmt = NULL;
+		int           i = 0;
+
+		stmt = dc_sqlite3_prepare(context->sql, "INSERT INTO msgs (rfc724_mid, chat_id, timestamp, hidden) VALUES (?, ?, ?, 0);");
+		for (i = 0; i <= 6; i++) {
+			char* rfc724_mid = dc_mprintf("stress%i@window", i);
+			sqlite3_reset(stmt);
+			sqlite3_bind_text (stmt, 1, rfc724_mid, -1, SQLITE_STATIC);
+			sqlite3_bind_int  (stmt, 2, i<6? STRESS_WINDOW_CHAT_ID : STRESS_WINDOW_CHAT_ID+1);
+			sqlite3_bind_int64(stmt, 3, i<6? timestamps[i] : t+1);
+			sqlite3_step(stmt);
+			if (i<6) {
+				m[i] = dc_sqlite3_get_rowid(context->sql, "msgs", "rfc724_mid", rfc724_mid);
+			}
+			else {
+				foreign_id = dc_sqlite3_get_rowid(context->sql, "msgs", "rfc724_mid", rfc724_mid);
+			}
+			free(rfc724_mid);
+		}
+		sqlite3_finalize(stmt);
+
+		/* backward pages from the newest message, the tie at t+2 is split between the pages */
+		assert( stress_ids_equal(dc_get_chat_msgs_window(context, STRESS_WINDOW_CHAT_ID, 0, 0, 0, -100), m, 6) );
+		assert( stress_ids_equal(dc_get_chat_msgs_window(context, STRESS_WINDOW_CHAT_ID, 0, 0, 0, -2), &m[4], 2) );
+		assert( stress_ids_equal(dc_get_chat_msgs_window(context, STRESS_WINDOW_CHAT_ID, 0, 0, m[4], -2), &m[2], 2) );
+		assert( stress_ids_equal(dc_get_chat_msgs_window(context, STRESS_WINDOW_CHAT_ID, 0, 0, m[2], -2), &m[0], 2) );
+		assert( stress_ids_equal(dc_get_chat_msgs_window(context, STRESS_WINDOW_CHAT_ID, 0, 0, m[1], -2), &m[0], 1) );
+		assert( stress_ids_equal(dc_get_chat_msgs_window(context, STRESS_WINDOW_CHAT_ID, 0, 0, m[0], -2), NULL, 0) ); /* the anchor is the oldest message */
+
+		/* forward pages from the oldest message, the tie at t is split between the pages */
+		assert( stress_ids_equal(dc_get_chat_msgs_window(context, STRESS_WINDOW_CHAT_ID, 0, 0, 0, 1), &m[0], 1) );
+		assert( stress_ids_equal(dc_get_chat_msgs_window(context, STRESS_WINDOW_CHAT_ID, 0, 0, m[0], 3), &m[1], 3) );
+		assert( stress_ids_equal(dc_get_chat_msgs_window(context, STRESS_WINDOW_CHAT_ID, 0, 0, m[3], 100), &m[4], 2) );
+		assert( stress_ids_equal(dc_get_chat_msgs_window(context, STRESS_WINDOW_CHAT_ID, 0, 0, m[5], 100), NULL, 0) ); /* the anchor is the newest message */
+
+		/* the marker is added before the given message only if it is in the window */
+		{
+			dc_array_t* window = dc_get_chat_msgs_window(context, STRESS_WINDOW_CHAT_ID, 0, m[3], m[2], 2);
+			uint32_t    expected[] = { DC_MSG_ID_MARKER1, m[3], m[4] };
+			assert( stress_ids_equal(window, expected, 3) );
+		}
+
+		/* anchors of other chats and bad counts are errors */
+		assert( foreign_id!=0 );
+		assert( dc_get_chat_msgs_window(context, STRESS_WINDOW_CHAT_ID, 0, 0, foreign_id, -2)==NULL );
+		assert( dc_get_chat_msgs_window(context, STRESS_WINDOW_CHAT_ID, 0, 0, 0, 0)==NULL );
+		assert( dc_get_chat_msgs_window(context, STRESS_WINDOW_CHAT_ID, 0, 0, 0, INT_MIN)==NULL );
+		assert( stress_ids_equal(dc_get_chat_msgs_window(context, STRESS_WINDOW_CHAT_ID, 0, 0, 0, INT_MAX), m, 6) );
+		assert( stress_ids_equal(dc_get_chat_msgs_window(context, STRESS_WINDOW_CHAT_ID, 0, 0, 0, -INT_MAX), m, 6) );
+
+		stmt = dc_sqlite3_prepare(context->sql, "DELETE FROM msgs WHERE chat_id IN (?, ?);");
+		sqlite3_bind_int(stmt, 1, STRESS_WINDOW_CHAT_ID);
+		sqlite3_bind_int(stmt, 2, STRESS_WINDOW_CHAT_ID+1);
+		sqlite3_step(stmt);
+		sqlite3_finalize(stmt);
+	}
+
+	/* test the index of message locations
+	 **************************************************************************/
+
+	{
+		char*    mids[] = { "stress1@index", "stress2@index" };
+		uint32_t uids[] = { 11, 12 };
+		char*    folder = NULL;
+		uint32_t uidvalidity = 0, uid = 0;
+
+		dc_set_imap_location(context, "stress3@index", "StressFolder", 7, 5);
+		dc_set_imap_locations(context, "StressFolder", 7, 0, mids, uids, 2);
+		assert( dc_get_imap_location(context, "stress2@index", &folder, &uidvalidity, &uid) );
+		assert( strcmp(folder, "StressFolder")==0 && uidvalidity==7 && uid==12 );
+		free(folder);
+		assert( dc_get_imap_location(context, "stress3@index", &folder, &uidvalidity, &uid) );
+		free(folder);
+
+		dc_set_imap_locations(context, "StressFolder", 8, 1, mids, uids, 1); /* a full refresh removes the other messages */
+		assert( dc_get_imap_location(context, "stress1@index", &folder, &uidvalidity, &uid) && uidvalidity==8 );
+		free(folder);
+		assert( !dc_get_imap_location(context, "stress2@index", &folder, &uidvalidity, &uid) && folder==NULL );
+		assert( !dc_get_imap_location(context, "stress3@index", &folder, &uidvalidity, &uid) && folder==NULL );
+
+		dc_set_imap_locations(context, "StressFolder", 8, 1, NULL, NULL, 0);
+		assert( !dc_get_imap_location(context, "stress1@index", &folder, &uidvalidity, &uid) && folder==NULL );
+	}
+
+	/* test dc_msgcache_t
+	 **************************************************************************/
+
+	{
+		dc_msgcache_t* cache = dc_msgcache_new(context);
+		dc_msg_t*      msg = dc_msg_new();
+		dc_msg_t*      ret = dc_msg_new();
+		uint32_t       generation = 0;
+		uint32_t       i;
+
+		assert( dc_msgcache_get(cache, 42, ret)==0 );
+
+		generation = dc_msgcache_get_generation(cache);
+		assert( generation!=0 );
+		for (i = 1; i <= DC_MSGCACHE_MAX+10; i++) {
+			dc_msg_empty(msg);
+			msg->id         = i;
+			msg->rfc724_mid = dc_mprintf("%i@stress", (int)i);
+			msg->text       = dc_strdup("text");
+			dc_param_set_int(msg->param, DC_PARAM_WIDTH, i);
+			dc_msgcache_put(cache, msg, generation);
+			if (i==DC_MSGCACHE_MAX) {
+				assert( dc_msgcache_get(cache, 1, ret) ); /* make #1 the most recently used message before the cache overflows */
+			}
+		}
+		assert( dc_hash_cnt(&cache->entries)==DC_MSGCACHE_MAX );
+		assert( dc_msgcache_get(cache, 1, ret) );
+		assert( dc_msgcache_get(cache, 2, ret)==0 ); /* dropped as least recently used */
+		assert( dc_msgcache_get(cache, DC_MSGCACHE_MAX+10, ret) );
+		assert( ret->id==DC_MSGCACHE_MAX+10 && strcmp(ret->text, "text")==0 );
+		assert( dc_param_get_int(ret->param, DC_PARAM_WIDTH, 0)==DC_MSGCACHE_MAX+10 );
+
+		dc_msgcache_invalidate(cache, 1);
+		assert( dc_msgcache_get(cache, 1, ret)==0 );
+
+		dc_msg_empty(msg);
+		msg->id = 1;
+		dc_msgcache_put(cache, msg, generation); /* loaded before the invalidation, not added */
+		assert( dc_msgcache_get(cache, 1, ret)==0 );
+		dc_msgcache_put(cache, msg, dc_msgcache_get_generation(cache));
+		assert( dc_msgcache_get(cache, 1, ret) );
+
+		dc_msgcache_invalidate_rfc724_mid(cache, "100@stress");
+		assert( dc_msgcache_get(cache, 100, ret)==0 );
+		assert( dc_msgcache_get(cache, 101, ret) );
+
+		dc_msgcache_begin_write(cache); /* while a transaction is open, nothing is added */
+		assert( dc_msgcache_get_generation(cache)==0 );
+		dc_msg_empty(msg);
+		msg->id = 2;
+		dc_msgcache_put(cache, msg, generation);
+		assert( dc_msgcache_get(cache, 2, ret)==0 );
+		generation = dc_msgcache_get_generation(cache);
+		dc_msgcache_end_write(cache);
+		assert( generation==0 && dc_msgcache_get_generation(cache)!=0 );
+
+		dc_msgcache_clear(cache);
+		assert( dc_hash_cnt(&cache->entries)==0 );
+		assert( cache->newest==NULL && cache->oldest==NULL );
+
+		dc_msg_unref(ret);
+		dc_msg_unref(msg);
+		dc_msgcache_unref(cache);
+	}
+
+	/* test stored summaries
+	 **************************************************************************/
+
+	{
+		const char*   text = "  Hello\r\n\r\nthis  is a text which is  long enough to be truncated in the chatlist, "
+		                     "it has some line breaks\nand more than one hundred and sixty characters, "
+		                     "so that the summary ends with an ellipsis.";
+		char*         str = NULL;
+		char*         str2 = NULL;
+		uint32_t      msg_id = 0;
+		int32_t       old_backfill_id = dc_sqlite3_get_config_int(context->sql, "summary_backfill_id", 0);
+		dc_msg_t*     msg = dc_msg_new();
+		sqlite3_stmt* stmt = NULL;
+
+		str  = dc_msg_get_summarytext_to_store(DC_MSG_TEXT, text);
+		str2 = dc_msg_get_summarytext_by_raw(DC_MSG_TEXT, text, msg->param, DC_SUMMARY_CHARACTERS, context);
+		assert( strcmp(str, str2)==0 );
+		assert( strstr(str, "\n")==NULL && strlen(str)<strlen(text) );
+		free(str2);
+
+		str2 = dc_msg_get_summarytext_to_store(DC_MSG_IMAGE, text);
+		assert( strcmp(str2, "")==0 ); /* localized, not stored */
+		free(str2);
+		str2 = dc_msg_get_summarytext_to_store(DC_MSG_TEXT, NULL);
+		assert( strcmp(str2, "")==0 );
+		free(str2);
+
+		msg->context     = context;
+		msg->type        = DC_MSG_TEXT;
+		msg->text        = dc_strdup(text);
+		msg->summarytext = dc_strdup("stored");
+		str2 = dc_msg_get_summarytext(msg, DC_SUMMARY_CHARACTERS);
+		assert( strcmp(str2, "stored")==0 );
+		free(str2);
+		str2 = dc_msg_get_summarytext(msg, DC_APPROX_SUBJECT_CHARS); /* other lengths are not stored */
+		assert( strcmp(str2, "stored")!=0 );
+		free(str2);
+
+		msg->type = DC_MSG_IMAGE;
+		str2 = dc_msg_get_summarytext(msg, DC_SUMMARY_CHARACTERS);
+		assert( strcmp(str2, "stored")!=0 );
+		free(str2);
+
+		/* a row from before the column was added is filled by the backfill */
+		stmt = dc_sqlite3_prepare(context->sql, "INSERT INTO msgs (rfc724_mid,chat_id,type,txt) VALUES ('summary@stress',0,?,?);");
+		sqlite3_bind_int (stmt, 1, DC_MSG_TEXT);
+		sqlite3_bind_text(stmt, 2, text, -1, SQLITE_STATIC);
+		assert( sqlite3_step(stmt)==SQLITE_DONE );
+		sqlite3_finalize(stmt);
+		msg_id = dc_sqlite3_get_rowid(context->sql, "msgs", "rfc724_mid", "summary@stress");
+		assert( msg_id > DC_MSG_ID_LAST_SPECIAL );
+
+		dc_sqlite3_set_config_int(context->sql, "summary_backfill_id", msg_id+1);
+		assert( dc_msg_backfill_summaries(context, 1)==1 );
+		assert( dc_sqlite3_get_config_int(context->sql, "summary_backfill_id", 0)==(int32_t)msg_id );
+
+		assert( dc_msg_load_from_db(msg, context, msg_id) );
+		assert( msg->summarytext && strcmp(msg->summarytext, str)==0 );
+
+		dc_sqlite3_set_config_int(context->sql, "summary_backfill_id", 0);
+		assert( dc_msg_backfill_summaries(context, 1)==0 );
+
+		stmt = dc_sqlite3_prepare(context->sql, "DELETE FROM msgs WHERE id=?;");
+		sqlite3_bind_int(stmt, 1, msg_id);
+		sqlite3_step(stmt);
+		sqlite3_finalize(stmt);
+		dc_msgcache_invalidate(context->msgcache, msg_id);
+		dc_sqlite3_set_config_int(context->sql, "summary_backfill_id", old_backfill_id);
+
+		free(str);
+		dc_msg_unref(msg);
+	}
+
+	/* test dc_changelog_t
+	 **************************************************************************/
+
+	{
+		dc_changelog_t* changelog = context->changelog;
+		uint32_t        seq = dc_get_change_seq(context), seq2 = 0;
+		dc_array_t*     arr = NULL;
+		char*           str = NULL;
+		int             i;
+
+		dc_changelog_add(changelog, DC_CHANGE_MSG_INSERTED, 100);
+		dc_changelog_add(changelog, DC_CHANGE_CHAT,          10);
+		dc_changelog_add(changelog, DC_CHANGE_MSG_UPDATED,  100);
+		dc_changelog_add(changelog, DC_CHANGE_MSG_UPDATED,   50);
+		dc_changelog_add(changelog, DC_CHANGE_MSG_UPDATED,   50); /* gets its own sequence number, coalesced by dc_get_changes() */
+		dc_changelog_add(changelog, DC_CHANGE_MSG_INSERTED, 101);
+		dc_changelog_add(changelog, DC_CHANGE_MSG_DELETED,  101);
+		dc_changelog_add(changelog, DC_CHANGE_MSG_DELETED,   40);
+		dc_changelog_add(changelog, DC_CHANGE_CHAT,          11);
+		dc_changelog_add(changelog, DC_CHANGE_CHAT,          10);
+		seq2 = dc_get_change_seq(context);
+		assert( seq2==seq+10 );
+
+		arr = dc_get_changes(context, seq, seq2, DC_CHANGE_MSG_INSERTED);
+		str = dc_array_get_string(arr, ",");
+		assert( strcmp(str, "100")==0 );
+		free(str);
+		dc_array_unref(arr);
+
+		arr = dc_get_changes(context, seq, seq2, DC_CHANGE_MSG_UPDATED);
+		str = dc_array_get_string(arr, ",");
+		assert( strcmp(str, "50")==0 );
+		free(str);
+		dc_array_unref(arr);
+
+		arr = dc_get_changes(context, seq, seq2, DC_CHANGE_MSG_DELETED);
+		str = dc_array_get_string(arr, ",");
+		assert( strcmp(str, "40")==0 );
+		free(str);
+		dc_array_unref(arr);
+
+		arr = dc_get_changes(context, seq, seq2, DC_CHANGE_CHAT);
+		str = dc_array_get_string(arr, ",");
+		assert( strcmp(str, "10,11")==0 );
+		free(str);
+		dc_array_unref(arr);
+
+		arr = dc_get_changes(context, seq+2, seq2, DC_CHANGE_MSG_UPDATED); /* the insertion of #100 is not in the range */
+		str = dc_array_get_string(arr, ",");
+		assert( strcmp(str, "100,50")==0 );
+		free(str);
+		dc_array_unref(arr);
+
+		arr = dc_get_changes(context, seq2, seq2, DC_CHANGE_CHAT);
+		assert( arr && dc_array_get_cnt(arr)==0 );
+		dc_array_unref(arr);
+
+		/* the same message updated twice with a sync point in between, eg. delivered and then read;
+		the second update must not be lost */
+		seq = dc_get_change_seq(context);
+		dc_changelog_add(changelog, DC_CHANGE_MSG_UPDATED, 77);
+		seq2 = dc_get_change_seq(context); /* the frontend syncs here */
+		arr = dc_get_changes(context, seq, seq2, DC_CHANGE_MSG_UPDATED);
+		assert( arr && dc_array_get_cnt(arr)==1 && dc_array_get_id(arr, 0)==77 );
+		dc_array_unref(arr);
+		dc_changelog_add(changelog, DC_CHANGE_MSG_UPDATED, 77);
+		assert( dc_get_change_seq(context)==seq2+1 );
+		arr = dc_get_changes(context, seq2, dc_get_change_seq(context), DC_CHANGE_MSG_UPDATED);
+		assert( arr && dc_array_get_cnt(arr)==1 && dc_array_get_id(arr, 0)==77 );
+		dc_array_unref(arr);
+		arr = dc_get_changes(context, seq, dc_get_change_seq(context), DC_CHANGE_MSG_UPDATED); /* both updates are returned once */
+		assert( arr && dc_array_get_cnt(arr)==1 && dc_array_get_id(arr, 0)==77 );
+		dc_array_unref(arr);
+		seq2 = dc_get_change_seq(context);
+
+		for (i = 0; i < DC_CHANGELOG_SIZE; i++) {
+			dc_changelog_add(changelog, DC_CHANGE_MSG_UPDATED, 1000+i);
+		}
+		arr = dc_get_changes(context, seq2, dc_get_change_seq(context), DC_CHANGE_MSG_UPDATED); /* just fits into the log */
+		assert( arr && dc_array_get_cnt(arr)==DC_CHANGELOG_SIZE );
+		dc_array_unref(arr);
+		dc_changelog_add(changelog, DC_CHANGE_MSG_UPDATED, 1);
+		assert( dc_get_changes(context, seq2, dc_get_change_seq(context), DC_CHANGE_MSG_UPDATED)==NULL ); /* too old */
+
+		seq = dc_get_change_seq(context);
+		dc_changelog_reset(changelog);
+		assert( dc_get_changes(context, seq, dc_get_change_seq(context), DC_CHANGE_CHAT)==NULL );
+		seq = dc_get_change_seq(context);
+		dc_changelog_add(changelog, DC_CHANGE_CHAT, 12);
+		arr = dc_get_changes(context, seq, dc_get_change_seq(context), DC_CHANGE_CHAT);
+		assert( arr && dc_array_get_cnt(arr)==1 && dc_array_get_id(arr, 0)==12 );
+		dc_array_unref(arr);
+	}
+
+	/* test dc_mediaprobe_t
+	 **************************************************************************/
+
+	{
+		static const unsigned char jpeg[] = {
+			0xFF,0xD8, 0xFF,0xE0,0x00,0x10,'J','F','I','F',0,1,1,0,0,1,0,1,0,0, 0xFF,0xFF, /* APP0 followed by a fill byte */
+			0xFF,0xC2,0x00,0x11,0x08, 0x00,0x20, 0x00,0x40, 0x03,0x01,0x22,0x00,0x02,0x11,0x01,0x03,0x11,0x01, 0xFF,0xD9 };
+		static const unsigned char png[] = {
+			0x89,'P','N','G','\r','\n',0x1A,'\n', 0,0,0,13,'I','H','D','R', 0,0,0x01,0x2C, 0,0,0,200, 8,6,0,0,0, 0,0,0,0 };
+		static const unsigned char gif[] = {
+			'G','I','F','8','9','a', 10,0, 20,0, 0,0,0 };
+		static const unsigned char webp_lossy[] = {
+			'R','I','F','F',0,0,0,0,'W','E','B','P', 'V','P','8',' ',0,0,0,0, 0,0,0, 0x9D,0x01,0x2A, 0x80,0x02, 0xE0,0x41 };
+		static const unsigned char webp_lossless[] = {
+			'R','I','F','F',0,0,0,0,'W','E','B','P', 'V','P','8','L',0,0,0,0, 0x2F, 0x7F,0xC0,0x77,0x00, 0,0,0,0,0 }; /* 128 x 480 */
+		static const unsigned char webp_extended[] = {
+			'R','I','F','F',0,0,0,0,'W','E','B','P', 'V','P','8','X',10,0,0,0, 0x10,0,0,0, 0x1F,0x03,0x00, 0x57,0x02,0x00 }; /* 800 x 600 */
+		static const unsigned char bmp[] = {
+			'B','M', 0,0,0,0, 0,0,0,0, 0,0,0,0, 40,0,0,0, 0x10,0x00,0x00,0x00, 0xF8,0xFF,0xFF,0xFF, 1,0, 24,0 }; /* 16 x -8 */
+		static const unsigned char mp4[] = {
+			0,0,0,16,'f','t','y','p','i','s','o','m', 0,0,0,0,
+			0,0,0,136,'m','o','o','v',
+				0,0,0,28,'m','v','h','d', 0,0,0,0, 0,0,0,0, 0,0,0,0, 0,0,0x03,0xE8, 0,0,0x30,0x39, /* timescale 1000, duration 12345 */
+				0,0,0,100,'t','r','a','k',
+					0,0,0,84+8,'t','k','h','d', 0,0,0,0, 0,0,0,0, 0,0,0,0, 0,0,0,1, 0,0,0,0, 0,0,0,0, 0,0,0,0,0,0,0,0, 0,0, 0,0, 0,0, 0,0,
+					0,1,0,0, 0,0,0,0, 0,0,0,0, 0,0,0,0, 0,1,0,0, 0,0,0,0, 0,0,0,0, 0,0,0,0, 0x40,0,0,0,
+					0x02,0x80,0,0, 0x01,0xE0,0,0 }; /* 640 x 480 */
+		static const unsigned char webm[] = {
+			0x1A,0x45,0xDF,0xA3,0x80,
+			0x18,0x53,0x80,0x67, 0x01,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF, /* segment of unknown size */
+				0x15,0x49,0xA9,0x66,0x8E, 0x2A,0xD7,0xB1,0x83,0x0F,0x42,0x40, 0x44,0x89,0x84,0x45,0x9C,0x40,0x00, /* 1 ms per unit, 5000 units */
+				0x16,0x54,0xAE,0x6B,0x8C, 0xAE,0x8A, 0xE0,0x88, 0xB0,0x82,0x02,0x80, 0xBA,0x82,0x01,0xE0, /* 640 x 480 */
+				0x1F,0x43,0xB6,0x75,0x01,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF };
+		static const struct { const unsigned char* buf; size_t bytes; int format; uint32_t width, height, duration_ms; } samples[] = {
+			{ jpeg,          sizeof(jpeg),          DC_MEDIAPROBE_JPEG,  64,  32,     0 },
+			{ png,           sizeof(png),           DC_MEDIAPROBE_PNG,  300, 200,     0 },
+			{ gif,           sizeof(gif),           DC_MEDIAPROBE_GIF,   10,  20,     0 },
+			{ webp_lossy,    sizeof(webp_lossy),    DC_MEDIAPROBE_WEBP, 640, 480,     0 },
+			{ webp_lossless, sizeof(webp_lossless), DC_MEDIAPROBE_WEBP, 128, 480,     0 },
+			{ webp_extended, sizeof(webp_extended), DC_MEDIAPROBE_WEBP, 800, 600,     0 },
+			{ bmp,           sizeof(bmp),           DC_MEDIAPROBE_BMP,   16,   8,     0 },
+			{ mp4,           sizeof(mp4),           DC_MEDIAPROBE_MP4,  640, 480, 12345 },
+			{ webm,          sizeof(webm),          DC_MEDIAPROBE_WEBM, 640, 480,  5000 },
+			{ NULL, 0, 0, 0, 0, 0 }
+		};
+		dc_mediaprobe_t probe;
+		unsigned char   fuzz[256];
+		uint32_t        rnd = 1;
+		size_t          bytes = 0;
+		int             i, j;
+		char*           pathNfilename = dc_mprintf("%s/stress-probe", context->blobdir);
+
+		for (i = 0; samples[i].buf; i++) {
+			assert( dc_mediaprobe_buf(samples[i].buf, samples[i].bytes, &probe) );
+			assert( probe.format==samples[i].format );
+			assert( probe.width==samples[i].width && probe.height==samples[i].height );
+			assert( probe.duration_ms==samples[i].duration_ms );
+
+			if (dc_write_file(pathNfilename, samples[i].buf, samples[i].bytes, context)) {
+				dc_mediaprobe_t probe2;
+				assert( dc_mediaprobe_file(pathNfilename, &probe2) );
+				assert( memcmp(&probe, &probe2, sizeof(dc_mediaprobe_t))==0 );
+				dc_delete_file(pathNfilename, context);
+			}
+
+			/* truncated or corrupted data must never be read out of bounds */
+			for (bytes = 0; bytes < samples[i].bytes; bytes++) {
+				memcpy(fuzz, samples[i].buf, bytes);
+				dc_mediaprobe_buf(fuzz, bytes, &probe);
+			}
+			for (j = 0; j < 10000; j++) {
+				memcpy(fuzz, samples[i].buf, samples[i].bytes);
+				rnd = rnd*1103515245+12345; fuzz[(rnd>>16)%samples[i].bytes] = rnd>>8;
+				rnd = rnd*1103515245+12345; fuzz[(rnd>>16)%samples[i].bytes] = rnd>>8;
+				rnd = rnd*1103515245+12345;
+				dc_mediaprobe_buf(fuzz, samples[i].bytes-(rnd>>16)%4, &probe);
+				assert( probe.width<=0x7FFFFFFF && probe.height<=0x7FFFFFFF && probe.duration_ms<=0x7FFFFFFF );
+			}
+		}
+
+		assert( dc_mediaprobe_buf("foo bar baz", 11, &probe)==0 );
+		assert( dc_mediaprobe_file("/this/file/does/not/exist", &probe)==0 );
+		free(pathNfilename);
+	}
+
+	/* test dc_copy_file_ex()
+	 **************************************************************************/
+
+	{
+		#define         COPY_TEST_BYTES (3*1024*1024+17) /* more than one buffer in the fallback */
+		unsigned char*  data = malloc(COPY_TEST_BYTES);
+		void*           buf = NULL;
+		size_t          buf_bytes = 0;
+		uint64_t        progress[3];
+		int             i, flags;
+		char*           src = dc_mprintf("%s/stress-copy-src", context->blobdir);
+		char*           dest = dc_mprintf("%s/stress-copy-dest", context->blobdir);
+		static const int all_flags[] = { 0, DC_COPY_NO_REFLINK, DC_COPY_NO_REFLINK|DC_COPY_NO_KERNEL, -1 };
+
+		for (i = 0; i < COPY_TEST_BYTES; i++) {
+			data[i] = (unsigned char)(i*7+i/1000);
+		}
+		dc_delete_file(dest, NULL);
+		assert( dc_write_file(src, data, COPY_TEST_BYTES, context) );
+
+		for (i = 0; all_flags[i]!=-1; i++) {
+			flags = all_flags[i];
+			memset(progress, 0, sizeof(progress));
+			assert( dc_copy_file_ex(src, dest, flags, stress_copy_progress_cb, progress, context) );
+			assert( progress[0]==COPY_TEST_BYTES && progress[1]>=1 );
+			assert( dc_read_file(dest, &buf, &buf_bytes, context) );
+			assert( buf_bytes==COPY_TEST_BYTES && memcmp(buf, data, COPY_TEST_BYTES)==0 );
+			free(buf);
+			buf = NULL;
+
+			/* the destination is never overwritten by default */
+			assert( dc_copy_file_ex(src, dest, flags, NULL, NULL, NULL)==0 );
+			assert( dc_copy_file(src, dest, NULL)==0 );
+			assert( dc_copy_file_ex(src, dest, flags|DC_COPY_OVERWRITE, NULL, NULL, context) );
+			assert( dc_get_filebytes(dest)==COPY_TEST_BYTES );
+			dc_delete_file(dest, context);
+
+			/* cancelled copies leave neither the destination nor a temporary file */
+			memset(progress, 0, sizeof(progress));
+			progress[2] = 1;
+			assert( dc_copy_file_ex(src, dest, flags, stress_copy_progress_cb, progress, context)==0 );
+			assert( !dc_file_exist(dest) );
+			{
+				DIR* dir_handle = opendir(context->blobdir);
+				struct dirent* dir_entry = NULL;
+				assert( dir_handle );
+				while ((dir_entry=readdir(dir_handle))!=NULL) {
+					assert( strncmp(dir_entry->d_name, "stress-copy-dest", 16)!=0 );
+				}
+				closedir(dir_handle);
+			}
+		}
+
+		/* empty files */
+		assert( dc_write_file(src, "", 0, context) );
+		assert( dc_copy_file(src, dest, context) );
+		assert( dc_file_exist(dest) && dc_get_filebytes(dest)==0 );
+		dc_delete_file(dest, context);
+
+		assert( dc_copy_file_ex("/this/file/does/not/exist", dest, 0, NULL, NULL, NULL)==0 );
+		assert( !dc_file_exist(dest) );
+		assert( dc_copy_file_ex(src, "/this/dir/does/not/exist/file", 0, NULL, NULL, NULL)==0 );
+
+		dc_delete_file(src, context);
+		free(src);
+		free(dest);
+		free(data);
+	}
+
+	/* test incremental backups
+	 **************************************************************************/
+
+	{
+		stress_imex_t imex_a = { 0, NULL }, imex_b = { 0, NULL };
+		dc_context_t* a = dc_context_new(stress_imex_cb, &imex_a, "stress");
+		dc_context_t* b = dc_context_new(stress_imex_cb, &imex_b, "stress");
+		char*         base_dir = dc_mprintf("%s/stress-backup", context->blobdir);
+		char*         bak_dir = dc_mprintf("%s/bak", base_dir);
+		char*         dbfile_a = dc_mprintf("%s/a.db", base_dir);
+		char*         dbfile_b = dc_mprintf("%s/b.db", base_dir);
+		char*         blobdir_a = dc_mprintf("%s-blobs", dbfile_a);
+		char*         blobdir_b = dc_mprintf("%s-blobs", dbfile_b);
+		char*         full_backup = NULL;
+		char*         increment = NULL;
+		char*         pathNfilename = NULL;
+		char*         rows_a = NULL;
+		char*         rows_b = NULL;
+		void*         buf = NULL;
+		size_t        buf_bytes = 0;
+		sqlite3_stmt* stmt = NULL;
+		int           i;
+		static const char* compare[] = {
+			"SELECT id, rfc724_mid, chat_id, txt FROM msgs ORDER BY id;",
+			"SELECT keyname, value FROM config WHERE keyname IN ('configured_addr', 'displayname') ORDER BY keyname;",
+			"SELECT id, addr, hex(private_key) FROM keypairs ORDER BY id;",
+			NULL };
+
+		stress_delete_dir(blobdir_a); /* leftovers of a crashed run */
+		stress_delete_dir(blobdir_b);
+		stress_delete_dir(bak_dir);
+		stress_delete_dir(base_dir);
+		assert( dc_create_folder(base_dir, context) );
+
+		assert( dc_open(a, dbfile_a, NULL) );
+		dc_sqlite3_set_config(a->sql, "configured_addr", "backup@stress"); /* needed to create the key exported with the backup */
+		dc_sqlite3_set_config(a->sql, "displayname", "before");
+		assert( dc_sqlite3_execute(a->sql, "INSERT INTO msgs (rfc724_mid, chat_id, txt) VALUES"
+			" ('1@backup.stress', 10, 'one'), ('2@backup.stress', 10, 'two'), ('3@backup.stress', 10, 'three');") );
+		pathNfilename = dc_mprintf("%s/old.txt", blobdir_a);
+		assert( dc_write_file(pathNfilename, "old", 3, a) );
+		free(pathNfilename);
+
+		/* without a base, the first incremental backup is a full backup */
+		assert( stress_imex(a, DC_IMEX_EXPORT_INCREMENTAL_BACKUP, bak_dir) );
+		full_backup = imex_a.written;
+		imex_a.written = NULL;
+		assert( full_backup && strstr(full_backup, "-inc.")==NULL );
+
+		assert( dc_sqlite3_execute(a->sql, "INSERT INTO msgs (rfc724_mid, chat_id, txt) VALUES ('4@backup.stress', 10, 'four');") );
+		assert( dc_sqlite3_execute(a->sql, "UPDATE msgs SET txt='TWO' WHERE rfc724_mid='2@backup.stress';") );
+		assert( dc_sqlite3_execute(a->sql, "DELETE FROM msgs WHERE rfc724_mid='3@backup.stress';") );
+		dc_sqlite3_set_config(a->sql, "displayname", "after");
+		pathNfilename = dc_mprintf("%s/new.txt", blobdir_a);
+		assert( dc_write_file(pathNfilename, "new", 3, a) );
+		free(pathNfilename);
+
+		/* tables and keys written by every fetch are not tracked */
+		assert( dc_sqlite3_execute(a->sql, "INSERT INTO jobs (added_timestamp, action, foreign_id) VALUES (0, 100, 0);") );
+		assert( dc_sqlite3_execute(a->sql, "INSERT INTO imap_index (rfc724_mid, folder, uid) VALUES ('4@backup.stress', 'INBOX', 4);") );
+		dc_sqlite3_set_config(a->sql, "imap.mailbox.INBOX", "1:4");
+		stmt = dc_sqlite3_prepare(a->sql, "SELECT COUNT(*), SUM(tbl='msgs') FROM backup_changes;");
+		assert( sqlite3_step(stmt)==SQLITE_ROW );
+		assert( sqlite3_column_int(stmt, 1)==3 );
+		assert( sqlite3_column_int(stmt, 0)==4 ); /* the three messages and `displayname` */
+		sqlite3_finalize(stmt);
+
+		assert( stress_imex(a, DC_IMEX_EXPORT_INCREMENTAL_BACKUP, bak_dir) );
+		increment = imex_a.written;
+		imex_a.written = NULL;
+		assert( increment && strstr(increment, "-inc.")!=NULL );
+
+		/* import the chain to a fresh context */
+		assert( dc_open(b, dbfile_b, NULL) );
+		assert( stress_imex(b, DC_IMEX_IMPORT_BACKUP, increment) );
+
+		for (i = 0; compare[i]; i++) {
+			rows_a = stress_get_rows(a, compare[i]);
+			rows_b = stress_get_rows(b, compare[i]);
+			assert( strcmp(rows_a, rows_b)==0 );
+			free(rows_a);
+			free(rows_b);
+		}
+		rows_b = stress_get_rows(b, "SELECT txt FROM msgs WHERE chat_id=10 ORDER BY id;");
+		assert( strcmp(rows_b, "one|\nTWO|\nfour|\n")==0 );
+		free(rows_b);
+		rows_b = stress_get_rows(b, "SELECT COUNT(*) FROM jobs;"); /* the outdated jobs of the full backup are dropped */
+		assert( strcmp(rows_b, "0|\n")==0 );
+		free(rows_b);
+		assert( dc_sqlite3_get_config(b->sql, "imap.mailbox.INBOX", NULL)==NULL );
+
+		pathNfilename = dc_mprintf("%s/old.txt", blobdir_b);
+		assert( dc_read_file(pathNfilename, &buf, &buf_bytes, b) && buf_bytes==3 && memcmp(buf, "old", 3)==0 );
+		free(buf);
+		free(pathNfilename);
+		pathNfilename = dc_mprintf("%s/new.txt", blobdir_b);
+		assert( dc_read_file(pathNfilename, &buf, &buf_bytes, b) && buf_bytes==3 && memcmp(buf, "new", 3)==0 );
+		free(buf);
+		free(pathNfilename);
+
+		dc_close(a);
+		dc_close(b);
+		dc_context_unref(a);
+		dc_context_unref(b);
+		stress_delete_dir(blobdir_a);
+		stress_delete_dir(blobdir_b);
+		stress_delete_dir(bak_dir);
+		stress_delete_dir(base_dir);
+		free(imex_a.written);
+		free(imex_b.written);
+		free(full_backup);
+		free(increment);
+		free(blobdir_a);
+		free(blobdir_b);
+		free(dbfile_a);
+		free(dbfile_b);
+		free(bak_dir);
+		free(base_dir);
+	}
+
+	/* test importing backups
+	 **************************************************************************/
+
+	{
+		#define       IMPORT_BIG_BYTES (600*1024+7) /* more than two chunks of DC_IMPORT_CHUNK_BYTES */
+		stress_imex_t imex_a = { 0, NULL }, imex_b = { 0, NULL };
+		dc_context_t* a = dc_context_new(stress_imex_cb, &imex_a, "stress");
+		dc_context_t* b = dc_context_new(stress_imex_cb, &imex_b, "stress");
+		char*         base_dir = dc_mprintf("%s/stress-import", context->blobdir);
+		char*         bak_dir = dc_mprintf("%s/bak", base_dir);
+		char*         dbfile_a = dc_mprintf("%s/a.db", base_dir);
+		char*         dbfile_b = dc_mprintf("%s/b.db", base_dir);
+		char*         blobdir_a = dc_mprintf("%s-blobs", dbfile_a);
+		char*         blobdir_b = dc_mprintf("%s-blobs", dbfile_b);
+		char*         tmp_dbfile_b = dc_mprintf("%s-import.tmp", dbfile_b);
+		char*         no_backup = dc_mprintf("%s/delta-chat-garbage.bak", bak_dir);
+		char*         full_backup = NULL;
+		char*         increment = NULL;
+		char*         pathNfilename = NULL;
+		char*         rows_a = NULL;
+		char*         rows_b = NULL;
+		unsigned char* data = malloc(IMPORT_BIG_BYTES);
+		void*         buf = NULL;
+		size_t        buf_bytes = 0;
+		sqlite3*      db = NULL;
+		int           i;
+
+		stress_delete_dir(blobdir_a); /* leftovers of a crashed run */
+		stress_delete_dir(blobdir_b);
+		stress_delete_dir(bak_dir);
+		stress_delete_dir(base_dir);
+		assert( dc_create_folder(base_dir, context) );
+		assert( dc_create_folder(bak_dir, context) );
+
+		assert( dc_open(a, dbfile_a, NULL) );
+		dc_sqlite3_set_config(a->sql, "configured_addr", "import@stress");
+		assert( dc_sqlite3_execute(a->sql, "INSERT INTO msgs (rfc724_mid, chat_id, txt) VALUES ('1@import.stress', 10, 'one');") );
+		for (i = 0; i < IMPORT_BIG_BYTES; i++) {
+			data[i] = (unsigned char)(i*7+i/1000);
+		}
+		pathNfilename = dc_mprintf("%s/big.bin", blobdir_a);
+		assert( dc_write_file(pathNfilename, data, IMPORT_BIG_BYTES, a) );
+		free(pathNfilename);
+		for (i = 0; i < 6; i++) { /* more files than import threads */
+			pathNfilename = dc_mprintf("%s/small-%i.txt", blobdir_a, i);
+			assert( dc_write_file(pathNfilename, pathNfilename, strlen(pathNfilename), a) );
+			free(pathNfilename);
+		}
+
+		assert( stress_imex(a, DC_IMEX_EXPORT_INCREMENTAL_BACKUP, bak_dir) );
+		full_backup = imex_a.written;
+		imex_a.written = NULL;
+		assert( dc_sqlite3_execute(a->sql, "INSERT INTO msgs (rfc724_mid, chat_id, txt) VALUES ('2@import.stress', 10, 'two');") );
+		assert( stress_imex(a, DC_IMEX_EXPORT_INCREMENTAL_BACKUP, bak_dir) );
+		increment = imex_a.written;
+		imex_a.written = NULL;
+		assert( full_backup && increment );
+
+		assert( dc_open(b, dbfile_b, NULL) );
+		assert( dc_sqlite3_execute(b->sql, "INSERT INTO msgs (rfc724_mid, chat_id, txt) VALUES ('kept@import.stress', 10, 'kept');") );
+
+		/* failed imports keep the old database */
+		assert( dc_write_file(no_backup, "no backup", 9, b) );
+		assert( !stress_imex(b, DC_IMEX_IMPORT_BACKUP, no_backup) );
+		assert( dc_sqlite3_is_open(b->sql) );
+		assert( dc_sqlite3_get_rowid(b->sql, "msgs", "rfc724_mid", "kept@import.stress")!=0 );
+
+		assert( sqlite3_open(increment, &db)==SQLITE_OK ); /* the increment fails after the full backup is copied to the temporary file */
+		assert( sqlite3_exec(db, "UPDATE backup_increment SET value='1' WHERE keyname='dbversion';", NULL, NULL, NULL)==SQLITE_OK );
+		sqlite3_close(db);
+		assert( !stress_imex(b, DC_IMEX_IMPORT_BACKUP, increment) );
+		assert( dc_sqlite3_is_open(b->sql) );
+		assert( dc_sqlite3_get_rowid(b->sql, "msgs", "rfc724_mid", "kept@import.stress")!=0 );
+		assert( !dc_file_exist(tmp_dbfile_b) );
+
+		/* the full backup replaces the database, the files are streamed from the backup */
+		assert( stress_imex(b, DC_IMEX_IMPORT_BACKUP, full_backup) );
+		assert( dc_sqlite3_get_rowid(b->sql, "msgs", "rfc724_mid", "kept@import.stress")==0 );
+		assert( dc_sqlite3_get_rowid(b->sql, "msgs", "rfc724_mid", "1@import.stress")!=0 );
+		assert( dc_sqlite3_get_rowid(b->sql, "msgs", "rfc724_mid", "2@import.stress")==0 );
+		rows_a = stress_get_rows(a, "SELECT id, addr, hex(private_key) FROM keypairs ORDER BY id;");
+		rows_b = stress_get_rows(b, "SELECT id, addr, hex(private_key) FROM keypairs ORDER BY id;");
+		assert( strcmp(rows_a, rows_b)==0 );
+		free(rows_a);
+		free(rows_b);
+
+		pathNfilename = dc_mprintf("%s/big.bin", blobdir_b);
+		assert( dc_read_file(pathNfilename, &buf, &buf_bytes, b) );
+		assert( buf_bytes==IMPORT_BIG_BYTES && memcmp(buf, data, IMPORT_BIG_BYTES)==0 );
+		free(buf);
+		free(pathNfilename);
+		for (i = 0; i < 6; i++) {
+			char* expected = dc_mprintf("%s/small-%i.txt", blobdir_a, i);
+			pathNfilename = dc_mprintf("%s/small-%i.txt", blobdir_b, i);
+			assert( dc_read_file(pathNfilename, &buf, &buf_bytes, b) );
+			assert( buf_bytes==strlen(expected) && memcmp(buf, expected, buf_bytes)==0 );
+			free(buf);
+			free(pathNfilename);
+			free(expected);
+		}
+
+		dc_close(a);
+		dc_close(b);
+		dc_context_unref(a);
+		dc_context_unref(b);
+		stress_delete_dir(blobdir_a);
+		stress_delete_dir(blobdir_b);
+		stress_delete_dir(bak_dir);
+		stress_delete_dir(base_dir);
+		free(imex_a.written);
+		free(imex_b.written);
+		free(full_backup);
+		free(increment);
+		free(no_backup);
+		free(tmp_dbfile_b);
+		free(blobdir_a);
+		free(blobdir_b);
+		free(dbfile_a);
+		free(dbfile_b);
+		free(bak_dir);
+		free(base_dir);
+		free(data);
+	}
+
 	/* test dc_param
 	 **************************************************************************/
 
@@ -0,0 +1,280 @@
+/*******************************************************************************
+ *
+ *                              Delta Chat Core
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ ******************************************************************************/
+
+
+#include <stdarg.h>
+#include "dc_context.h"
+#include "dc_arena.h"
+
+
+struct dc_arena_chunk_t
+{
+	dc_arena_chunk_t* prev;
+	size_t            bytes;   /* usable bytes in data[] */
+	double            data[1]; /* double for alignment, the chunk is allocated larger */
+};
+
+
+struct dc_arena_adopted_t
+{
+	dc_arena_adopted_t* prev;
+	void*               malloced;
+};
+
+
+#define ALIGN_BYTES(b) (((b)+sizeof(double)-1) & ~(sizeof(double)-1))
+
+
+static dc_arena_chunk_t* new_chunk(dc_arena_t* arena, size_t bytes)
+{
+	dc_arena_chunk_t* chunk = NULL;
+
+	if ((chunk=malloc(sizeof(dc_arena_chunk_t)+bytes))==NULL) {
+		exit(54); /* cannot allocate memory, unrecoverable error */
+	}
+	chunk->bytes = bytes;
+	arena->chunk_allocs++;
+	return chunk;
+}
+
+
+/**
+ * Create a new arena.
+ * Memory is allocated not before the first call to dc_arena_alloc().
+ *
+ * @private @memberof dc_arena_t
+ * @return The arena object, must be freed using dc_arena_unref().
+ */
+dc_arena_t* dc_arena_new()
+{
+	dc_arena_t* arena = NULL;
+
+	if ((arena=calloc(1, sizeof(dc_arena_t)))==NULL) {
+		exit(54);
+	}
+
+	return arena;
+}
+
+
+/**
+ * Free an arena and all memory allocated from it.
+ *
+ * @private @memberof dc_arena_t
+ * @param arena The arena object as created by dc_arena_new(). If NULL is given, nothing is done.
+ * @return None.
+ */
+void dc_arena_unref(dc_arena_t* arena)
+{
+	if (arena==NULL) {
+		return;
+	}
+
+	dc_arena_reset(arena);
+	free(arena->chunks);
+	free(arena);
+}
+
+
+/**
+ * Free all memory allocated from an arena at once.
+ * All pointers returned by dc_arena_alloc() and friends become invalid.
+ * One chunk of the default size is kept, so the next round typically needs no malloc() at all.
+ *
+ * @private @memberof dc_arena_t
+ * @param arena The arena object.
+ * @return None.
+ */
+void dc_arena_reset(dc_arena_t* arena)
+{
+	if (arena==NULL || arena->chunks==NULL) {
+		return;
+	}
+
+	/* the list of adopted memory lives in the chunks, so free it first */
+	while (arena->adopted) {
+		free(arena->adopted->malloced);
+		arena->adopted = arena->adopted->prev;
+	}
+
+	dc_arena_chunk_t* keep = NULL;
+	while (arena->chunks) {
+		dc_arena_chunk_t* prev = arena->chunks->prev;
+		if (keep==NULL && arena->chunks->bytes==DC_ARENA_CHUNK_BYTES) {
+			keep = arena->chunks;
+			keep->prev = NULL;
+		}
+		else {
+			free(arena->chunks);
+		}
+		arena->chunks = prev;
+	}
+
+	arena->chunks = keep;
+	arena->chunk_used = 0;
+}
+
+
+/**
+ * Allocate zeroed memory from an arena.
+ * The memory must not be free()'d, it is freed by dc_arena_reset() or dc_arena_unref().
+ *
+ * @private @memberof dc_arena_t
+ * @param arena The arena object.
+ * @param bytes Number of bytes to allocate.
+ * @return Pointer to the memory, aligned as needed for any type. If no memory
+ *     is available, the program halts.
+ */
+void* dc_arena_alloc(dc_arena_t* arena, size_t bytes)
+{
+	void* ret = NULL;
+
+	if (arena==NULL) {
+		return NULL;
+	}
+
+	bytes = ALIGN_BYTES(bytes? bytes : 1);
+
+	if (arena->chunks==NULL || arena->chunk_used+bytes > arena->chunks->bytes)
+	{
+		if (bytes > DC_ARENA_CHUNK_BYTES/4 && arena->chunks) {
+			/* large allocations get their own chunk, inserted below the current one
+			so that the space left in the current chunk is not wasted */
+			dc_arena_chunk_t* chunk = new_chunk(arena, bytes);
+			chunk->prev = arena->chunks->prev;
+			arena->chunks->prev = chunk;
+			ret = chunk->data;
+			goto cleanup;
+		}
+
+		dc_arena_chunk_t* chunk = new_chunk(arena, DC_MAX(bytes, DC_ARENA_CHUNK_BYTES));
+		chunk->prev = arena->chunks;
+		arena->chunks = chunk;
+		arena->chunk_used = 0;
+	}
+
+	ret = ((char*)arena->chunks->data) + arena->chunk_used;
+	arena->chunk_used += bytes;
+
+cleanup:
+	memset(ret, 0, bytes);
+	arena->allocs++;
+	arena->bytes += bytes;
+	return ret;
+}
+
+
+/**
+ * Copy a string to an arena.
+ *
+ * @private @memberof dc_arena_t
+ * @param arena The arena object.
+ * @param str The string to copy, must be at least `bytes` bytes long or null-terminated.
+ *     If NULL is given, an empty string is returned.
+ * @param bytes The maximum number of bytes to copy.
+ * @return Null-terminated copy of the string, must not be free()'d.
+ */
+char* dc_arena_strndup(dc_arena_t* arena, const char* str, size_t bytes)
+{
+	char* ret = NULL;
+
+	if (str==NULL) {
+		bytes = 0;
+	}
+	else {
+		const char* nullbyte = memchr(str, 0, bytes);
+		if (nullbyte) {
+			bytes = nullbyte-str;
+		}
+	}
+
+	if ((ret=dc_arena_alloc(arena, bytes+1))!=NULL && bytes>0) {
+		memcpy(ret, str, bytes); /* the terminating null-byte is already set by dc_arena_alloc() */
+	}
+
+	return ret;
+}
+
+
+/**
+ * Format a string and place it in an arena.
+ * Works like dc_mprintf(), however, the returned string must not be free()'d.
+ *
+ * @private @memberof dc_arena_t
+ * @param arena The arena object.
+ * @param format printf-like format string.
+ * @return Null-terminated formatted string.
+ */
+char* dc_arena_mprintf(dc_arena_t* arena, const char* format, ...)
+{
+	char*   ret = NULL;
+	char    testbuf[1];
+	int     char_cnt_without_zero = 0;
+	va_list argp;
+	va_list argp_copy;
+
+	if (arena==NULL || format==NULL) {
+		return NULL;
+	}
+
+	va_start(argp, format);
+	va_copy(argp_copy, argp);
+
+	char_cnt_without_zero = vsnprintf(testbuf, 0, format, argp);
+	va_end(argp);
+	if (char_cnt_without_zero < 0) {
+		va_end(argp_copy);
+		return dc_arena_strndup(arena, "ErrFmt", 6);
+	}
+
+	ret = dc_arena_alloc(arena, char_cnt_without_zero+1);
+	vsnprintf(ret, char_cnt_without_zero+1, format, argp_copy);
+	va_end(argp_copy);
+
+	return ret;
+}
+
+
+/**
+ * Let an arena free memory that was allocated by malloc() and friends.
+ * This is useful for strings created by functions that cannot allocate from the arena
+ * and avoids copying them.
+ *
+ * @private @memberof dc_arena_t
+ * @param arena The arena object.
+ * @param malloced The memory to free on dc_arena_reset() or dc_arena_unref(),
+ *     must not be free()'d by the caller any longer. If NULL is given, nothing is done.
+ * @return The given pointer, NULL if NULL was given.
+ */
+void* dc_arena_adopt(dc_arena_t* arena, void* malloced)
+{
+	dc_arena_adopted_t* adopted = NULL;
+
+	if (arena==NULL || malloced==NULL) {
+		return malloced;
+	}
+
+	adopted = (dc_arena_adopted_t*)dc_arena_alloc(arena, sizeof(dc_arena_adopted_t));
+	adopted->malloced = malloced;
+	adopted->prev = arena->adopted;
+	arena->adopted = adopted;
+
+	return malloced;
+}
@@ -0,0 +1,70 @@
+/*******************************************************************************
+ *
+ *                              Delta Chat Core
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ ******************************************************************************/
+
+
+#ifndef __DC_ARENA_H__
+#define __DC_ARENA_H__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct dc_arena_chunk_t dc_arena_chunk_t;
+typedef struct dc_arena_adopted_t dc_arena_adopted_t;
+
+
+/**
+ * Library-internal.
+ *
+ * An arena hands out memory for objects that are all freed at the same time,
+ * eg. the data created while one message is parsed.
+ * There is no function to free a single allocation; instead,
+ * dc_arena_reset() frees everything at once and keeps the first chunk
+ * for the next round.
+ */
+typedef struct dc_arena_t
+{
+	/** @privatesection */
+	#define           DC_ARENA_CHUNK_BYTES 8192
+	dc_arena_chunk_t* chunks;       /* the current chunk, it links to the older ones */
+	size_t            chunk_used;   /* bytes used in the current chunk */
+	dc_arena_adopted_t* adopted;    /* memory from malloc() to free() on reset, see dc_arena_adopt() */
+
+	/* instrumentation, not reset by dc_arena_reset() */
+	size_t            allocs;       /* number of allocations served */
+	size_t            chunk_allocs; /* number of malloc() calls needed for these allocations */
+	size_t            bytes;        /* number of bytes served */
+} dc_arena_t;
+
+
+dc_arena_t* dc_arena_new        ();
+void        dc_arena_unref      (dc_arena_t*);
+void        dc_arena_reset      (dc_arena_t*);
+
+void*       dc_arena_alloc      (dc_arena_t*, size_t bytes); /* the returned memory is zeroed */
+char*       dc_arena_strndup    (dc_arena_t*, const char*, size_t bytes);
+char*       dc_arena_mprintf    (dc_arena_t*, const char* format, ...);
+void*       dc_arena_adopt      (dc_arena_t*, void* malloced); /* returns the given pointer */
+
+
+#ifdef __cplusplus
+} /* /extern "C" */
+#endif
+#endif /* __DC_ARENA_H__ */
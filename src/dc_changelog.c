@@ -0,0 +1,258 @@
+/*******************************************************************************
+ *
+ *                              Delta Chat Core
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ ******************************************************************************/
+
+
+
+#include "dc_context.h"
+#include "dc_changelog.h"
+#include "dc_hash.h"
+
+
+/**
+ * Create a new, empty change log.
+ *
+ * @private @memberof dc_changelog_t
+ * @return The change log object, must be freed using dc_changelog_unref().
+ */
+dc_changelog_t* dc_changelog_new()
+{
+	dc_changelog_t* changelog = NULL;
+
+	if ((changelog=calloc(1, sizeof(dc_changelog_t)))==NULL) {
+		exit(60); /* cannot allocate little memory, unrecoverable error */
+	}
+
+	pthread_mutex_init(&changelog->critical, NULL);
+
+	return changelog;
+}
+
+
+/**
+ * Free a change log.
+ *
+ * @private @memberof dc_changelog_t
+ * @param changelog The change log object as created by dc_changelog_new().
+ * @return None.
+ */
+void dc_changelog_unref(dc_changelog_t* changelog)
+{
+	if (changelog==NULL) {
+		return;
+	}
+
+	pthread_mutex_destroy(&changelog->critical);
+	free(changelog);
+}
+
+
+/**
+ * Record a change.
+ * Each change gets a new sequence number, even if the last change recorded
+ * is the same; otherwise, a frontend that synced in between would miss the
+ * second change.  Repeated changes are coalesced by dc_get_changes().
+ *
+ * @private @memberof dc_changelog_t
+ * @param changelog The change log object.
+ * @param what One of the DC_CHANGE_* constants.
+ * @param id The ID of the message or chat that has changed.
+ * @return None.
+ */
+void dc_changelog_add(dc_changelog_t* changelog, int what, uint32_t id)
+{
+	int index = 0;
+
+	if (changelog==NULL || id==0) {
+		return;
+	}
+
+	pthread_mutex_lock(&changelog->critical);
+
+		changelog->seq++;
+		index = changelog->seq%DC_CHANGELOG_SIZE;
+		changelog->what[index] = what;
+		changelog->id[index]   = id;
+
+	pthread_mutex_unlock(&changelog->critical);
+}
+
+
+/**
+ * Invalidate all sequence numbers handed out so far.
+ * Used after modifications where the affected messages or chats are unknown,
+ * eg. if all messages of a contact are marked as noticed.
+ *
+ * @private @memberof dc_changelog_t
+ * @param changelog The change log object.
+ * @return None.
+ */
+void dc_changelog_reset(dc_changelog_t* changelog)
+{
+	if (changelog==NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&changelog->critical);
+
+		changelog->seq++; /* the old sequence number must not be valid even if there are no changes afterwards */
+		changelog->valid_since_seq = changelog->seq;
+
+	pthread_mutex_unlock(&changelog->critical);
+}
+
+
+/**
+ * Get the sequence number of the last change.
+ * Use the returned value as `until_seq` for dc_get_changes()
+ * and, on the next call, as `since_seq`.
+ *
+ * A typical frontend loads the chatlist or the messages of a chat and
+ * remembers the sequence number returned by dc_get_change_seq() _before_ loading.
+ * On #DC_EVENT_MSGS_CHANGED, #DC_EVENT_INCOMING_MSG or #DC_EVENT_CHAT_MODIFIED,
+ * it gets the new sequence number and calls dc_get_changes() for the changes
+ * in between.
+ *
+ * @memberof dc_context_t
+ * @param context The context object as returned from dc_context_new().
+ * @return The sequence number of the last change.
+ */
+uint32_t dc_get_change_seq(dc_context_t* context)
+{
+	uint32_t seq = 0;
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
+		return 0;
+	}
+
+	pthread_mutex_lock(&context->changelog->critical);
+		seq = context->changelog->seq;
+	pthread_mutex_unlock(&context->changelog->critical);
+
+	return seq;
+}
+
+
+/**
+ * Get the IDs of the messages or chats changed between two sequence numbers.
+ * The changes are coalesced:
+ * Each ID is returned once and in the order of its first change.
+ * A message inserted and updated in the given range is returned only for
+ * DC_CHANGE_MSG_INSERTED; a message inserted and deleted in the given range
+ * is not returned at all.
+ *
+ * @memberof dc_context_t
+ * @param context The context object as returned from dc_context_new().
+ * @param since_seq Changes after this sequence number are returned.
+ * @param until_seq Changes up to this sequence number are returned,
+ *     typically the value returned by dc_get_change_seq().
+ * @param what One of the following:
+ *     - DC_CHANGE_MSG_INSERTED: IDs of messages added to chats
+ *     - DC_CHANGE_MSG_UPDATED: IDs of messages with a changed state, star or parameters;
+ *       the message objects should be reloaded using dc_get_msg() or dc_get_msgs().
+ *     - DC_CHANGE_MSG_DELETED: IDs of messages deleted or moved to the trash
+ *     - DC_CHANGE_CHAT: IDs of the chats that were created, modified, deleted or that got
+ *       new messages; the chatlist entries should be reloaded.
+ * @return Array of message or chat IDs, must be dc_array_unref()'d when no longer used.
+ *     NULL if the changes since since_seq are not available
+ *     (eg. too many changes or changes where the affected IDs are unknown),
+ *     in this case, the frontend has to reload everything.
+ */
+dc_array_t* dc_get_changes(dc_context_t* context, uint32_t since_seq, uint32_t until_seq, int what)
+{
+	#define         SEEN_INSERTED 0x01
+	#define         SEEN_UPDATED  0x02
+	#define         SEEN_DELETED  0x04
+	#define         RETURNED      0x08
+	int             success = 0;
+	int             locked = 0;
+	dc_changelog_t* changelog = NULL;
+	dc_array_t*     ret = NULL;
+	dc_hash_t       seen;
+	uint32_t        seq = 0;
+	int             index = 0, flags = 0, wanted = 0;
+
+	dc_hash_init(&seen, DC_HASH_INT, 0);
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
+		goto cleanup;
+	}
+
+	changelog = context->changelog;
+	pthread_mutex_lock(&changelog->critical);
+	locked = 1;
+
+		if (until_seq > changelog->seq) {
+			until_seq = changelog->seq;
+		}
+
+		if (since_seq < changelog->valid_since_seq
+		 || (changelog->seq > DC_CHANGELOG_SIZE && since_seq < changelog->seq-DC_CHANGELOG_SIZE)
+		 || since_seq > changelog->seq) {
+			goto cleanup; /* the caller must reload everything */
+		}
+
+		ret = dc_array_new(context, 128);
+
+		/* collect what happened to each ID ... */
+		for (seq = since_seq+1; seq <= until_seq; seq++) {
+			index = seq%DC_CHANGELOG_SIZE;
+			if ((what==DC_CHANGE_CHAT)==(changelog->what[index]==DC_CHANGE_CHAT)) {
+				flags = (int)(uintptr_t)dc_hash_find(&seen, NULL, changelog->id[index]);
+				switch (changelog->what[index]) {
+					case DC_CHANGE_MSG_INSERTED: flags |= SEEN_INSERTED; break;
+					case DC_CHANGE_MSG_UPDATED:  flags |= SEEN_UPDATED;  break;
+					default:                     flags |= SEEN_DELETED;  break;
+				}
+				dc_hash_insert(&seen, NULL, changelog->id[index], (void*)(uintptr_t)flags);
+			}
+		}
+
+		/* ... and return the IDs in the order of their first change */
+		for (seq = since_seq+1; seq <= until_seq; seq++) {
+			index = seq%DC_CHANGELOG_SIZE;
+			flags = (int)(uintptr_t)dc_hash_find(&seen, NULL, changelog->id[index]);
+			if (flags==0 || (flags&RETURNED) || (what==DC_CHANGE_CHAT)!=(changelog->what[index]==DC_CHANGE_CHAT)) {
+				continue;
+			}
+
+			switch (what) {
+				case DC_CHANGE_MSG_INSERTED: wanted = (flags&SEEN_INSERTED) && !(flags&SEEN_DELETED); break;
+				case DC_CHANGE_MSG_UPDATED:  wanted = flags==SEEN_UPDATED; break;
+				case DC_CHANGE_MSG_DELETED:  wanted = (flags&SEEN_DELETED) && !(flags&SEEN_INSERTED); break;
+				default:                     wanted = 1; break;
+			}
+
+			if (wanted) {
+				dc_array_add_id(ret, changelog->id[index]);
+			}
+			dc_hash_insert(&seen, NULL, changelog->id[index], (void*)(uintptr_t)(flags|RETURNED));
+		}
+
+	success = 1;
+
+cleanup:
+	if (locked) { pthread_mutex_unlock(&changelog->critical); }
+	dc_hash_clear(&seen);
+	if (!success) {
+		dc_array_unref(ret);
+		ret = NULL;
+	}
+	return ret;
+}
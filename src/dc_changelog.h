@@ -0,0 +1,66 @@
+/*******************************************************************************
+ *
+ *                              Delta Chat Core
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ ******************************************************************************/
+
+
+
+#ifndef __DC_CHANGELOG_H__
+#define __DC_CHANGELOG_H__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * Library-internal.
+ *
+ * The change log records the IDs of inserted, updated and deleted messages
+ * and of modified chats, each change gets a sequence number.
+ * Frontends can use dc_get_changes() to update only what has changed
+ * instead of reloading everything on each #DC_EVENT_MSGS_CHANGED.
+ *
+ * The log is kept in memory and holds the last DC_CHANGELOG_SIZE changes.
+ * Modifications where the affected IDs are unknown call dc_changelog_reset();
+ * afterwards, older sequence numbers are no longer valid and frontends have to
+ * reload everything.
+ *
+ * All functions are thread-safe.
+ */
+typedef struct dc_changelog_t
+{
+	/** @privatesection */
+	#define          DC_CHANGELOG_SIZE 4096
+	pthread_mutex_t  critical;
+	uint32_t         seq;                        /* sequence number of the last change, the change is stored at seq%DC_CHANGELOG_SIZE */
+	uint32_t         valid_since_seq;            /* changes since this sequence number are complete */
+	int              what[DC_CHANGELOG_SIZE];    /* one of the DC_CHANGE_* constants */
+	uint32_t         id[DC_CHANGELOG_SIZE];      /* message or chat ID */
+} dc_changelog_t;
+
+
+dc_changelog_t* dc_changelog_new   ();
+void            dc_changelog_unref (dc_changelog_t*);
+void            dc_changelog_add   (dc_changelog_t*, int what, uint32_t id);
+void            dc_changelog_reset (dc_changelog_t*);
+
+
+#ifdef __cplusplus
+} /* /extern "C" */
+#endif
+#endif /* __DC_CHANGELOG_H__ */
@@ -21,12 +21,14 @@
 
 
 #include <assert.h>
+#include <limits.h>
 #include "dc_context.h"
 #include "dc_job.h"
 #include "dc_smtp.h"
 #include "dc_imap.h"
 #include "dc_mimefactory.h"
 #include "dc_apeerstate.h"
+#include "dc_mediaprobe.h"
 
 
 #define DC_CHAT_MAGIC 0xc4a7c4a7
@@ -477,21 +479,7 @@ static int dc_chat_set_from_stmt(dc_chat_t* chat, sqlite3_stmt* row)
 }
 
 
-/**
- * Library-internal.
- *
- * Calling this function is not thread-safe, locking is up to the caller.
- *
- * @private @memberof dc_chat_t
- *
- * @param chat The chat object that should be filled with the data from the database.
- *     Existing data are free()'d before using dc_chat_empty().
- *
- * @param chat_id Chat ID that should be loaded from the database.
- *
- * @return 1=success, 0=error.
- */
-int dc_chat_load_from_db(dc_chat_t* chat, uint32_t chat_id)
+static int load_from_db(dc_chat_t* chat, uint32_t chat_id, int committed_only)
 {
 	int           success = 0;
 	sqlite3_stmt* stmt = NULL;
@@ -502,8 +490,9 @@ int dc_chat_load_from_db(dc_chat_t* chat, uint32_t chat_id)
 
 	dc_chat_empty(chat);
 
-	stmt = dc_sqlite3_prepare(chat->context->sql,
-		"SELECT " CHAT_FIELDS " FROM chats c WHERE c.id=?;");
+	#define LOAD_CHAT_SQL "SELECT " CHAT_FIELDS " FROM chats c WHERE c.id=?;"
+	stmt = committed_only? dc_sqlite3_prepare_read(chat->context->sql, LOAD_CHAT_SQL)
+	                     : dc_sqlite3_prepare(chat->context->sql, LOAD_CHAT_SQL);
 	sqlite3_bind_int(stmt, 1, chat_id);
 
 	if (sqlite3_step(stmt)!=SQLITE_ROW) {
@@ -522,6 +511,26 @@ cleanup:
 }
 
 
+/**
+ * Library-internal.
+ *
+ * Calling this function is not thread-safe, locking is up to the caller.
+ *
+ * @private @memberof dc_chat_t
+ *
+ * @param chat The chat object that should be filled with the data from the database.
+ *     Existing data are free()'d before using dc_chat_empty().
+ *
+ * @param chat_id Chat ID that should be loaded from the database.
+ *
+ * @return 1=success, 0=error.
+ */
+int dc_chat_load_from_db(dc_chat_t* chat, uint32_t chat_id)
+{
+	return load_from_db(chat, chat_id, 0);
+}
+
+
 /*******************************************************************************
  * Context functions to work with chats
  ******************************************************************************/
@@ -581,7 +590,7 @@ dc_chat_t* dc_get_chat(dc_context_t* context, uint32_t chat_id)
 		goto cleanup;
 	}
 
-	if (!dc_chat_load_from_db(obj, chat_id)) {
+	if (!load_from_db(obj, chat_id, 1)) { /* the UI does not need to wait for a transaction */
 		goto cleanup;
 	}
 
@@ -624,6 +633,9 @@ void dc_marknoticed_chat(dc_context_t* context, uint32_t chat_id)
 	sqlite3_bind_int(stmt, 1, chat_id);
 	sqlite3_step(stmt);
 	sqlite3_finalize(stmt);
+
+	dc_msgcache_clear(context->msgcache);
+	dc_changelog_add(context->changelog, DC_CHANGE_CHAT, chat_id);
 }
 
 
@@ -728,6 +740,7 @@ uint32_t dc_create_chat_by_contact_id(dc_context_t* context, uint32_t contact_id
 
 cleanup:
 	if (send_event) {
+		dc_changelog_add(context->changelog, DC_CHANGE_CHAT, chat_id);
 		context->cb(context, DC_EVENT_MSGS_CHANGED, 0, 0);
 	}
 
@@ -816,7 +829,7 @@ dc_array_t* dc_get_chat_media(dc_context_t* context, uint32_t chat_id, int msg_t
 
 	dc_array_t* ret = dc_array_new(context, 100);
 
-	sqlite3_stmt* stmt = dc_sqlite3_prepare(context->sql,
+	sqlite3_stmt* stmt = dc_sqlite3_prepare_read(context->sql,
 		"SELECT id FROM msgs WHERE chat_id=? AND (type=? OR type=?) ORDER BY timestamp, id;");
 	sqlite3_bind_int(stmt, 1, chat_id);
 	sqlite3_bind_int(stmt, 2, msg_type);
@@ -941,6 +954,29 @@ cleanup:
 }
 
 
+/* the messages shown in a chat; used by dc_get_chat_msgs() and dc_get_chat_msgs_window() */
+#define DC_CHAT_MSGS_DEADDROP_FROM \
+	" FROM msgs m" \
+	" LEFT JOIN chats ON m.chat_id=chats.id" \
+	" LEFT JOIN contacts ON m.from_id=contacts.id" \
+	" WHERE m.from_id!=" DC_STRINGIFY(DC_CONTACT_ID_SELF) \
+	"   AND m.hidden=0 " \
+	"   AND chats.blocked=" DC_STRINGIFY(DC_CHAT_DEADDROP_BLOCKED) \
+	"   AND contacts.blocked=0"
+
+#define DC_CHAT_MSGS_STARRED_FROM \
+	" FROM msgs m" \
+	" LEFT JOIN contacts ct ON m.from_id=ct.id" \
+	" WHERE m.starred=1 " \
+	"   AND m.hidden=0 " \
+	"   AND ct.blocked=0"
+
+#define DC_CHAT_MSGS_FROM /* the chat_id must be bound as the first parameter */ \
+	" FROM msgs m" \
+	" WHERE m.chat_id=? " \
+	"   AND m.hidden=0 " /* we hide blocked-contacts from starred and deaddrop, but we have to show them in groups (otherwise it may be hard to follow conversation, wa and tg do the same. however, maybe this needs discussion some time :) */
+
+
 /**
  * Get all message IDs belonging to a chat.
  * Optionally, some special markers added to the ID-array may help to
@@ -949,7 +985,7 @@ cleanup:
  * @memberof dc_context_t
  * @param context The context object as returned from dc_context_new().
  * @param chat_id The chat ID of which the messages IDs should be queried.
- * @param flags If set to DC_GCM_ADD_DAY_MARKER, the marker DC_MSG_ID_DAYMARKER will
+ * @param flags If set to DC_GCM_ADDDAYMARKER, the marker DC_MSG_ID_DAYMARKER will
  *     be added before each day (regarding the local timezone).  Set this to 0 if you do not want this behaviour.
  * @param marker1before An optional message ID.  If set, the id DC_MSG_ID_MARKER1 will be added just
  *   before the given ID in the returned array.  Set this to 0 if you do not want this behaviour.
@@ -975,37 +1011,20 @@ dc_array_t* dc_get_chat_msgs(dc_context_t* context, uint32_t chat_id, uint32_t f
 
 	if (chat_id==DC_CHAT_ID_DEADDROP)
 	{
-		stmt = dc_sqlite3_prepare(context->sql,
-			"SELECT m.id, m.timestamp"
-				" FROM msgs m"
-				" LEFT JOIN chats ON m.chat_id=chats.id"
-				" LEFT JOIN contacts ON m.from_id=contacts.id"
-				" WHERE m.from_id!=" DC_STRINGIFY(DC_CONTACT_ID_SELF)
-				"   AND m.hidden=0 "
-				"   AND chats.blocked=" DC_STRINGIFY(DC_CHAT_DEADDROP_BLOCKED)
-				"   AND contacts.blocked=0"
+		stmt = dc_sqlite3_prepare_read(context->sql,
+			"SELECT m.id, m.timestamp" DC_CHAT_MSGS_DEADDROP_FROM
 				" ORDER BY m.timestamp,m.id;"); /* the list starts with the oldest message*/
 	}
 	else if (chat_id==DC_CHAT_ID_STARRED)
 	{
-		stmt = dc_sqlite3_prepare(context->sql,
-			"SELECT m.id, m.timestamp"
-				" FROM msgs m"
-				" LEFT JOIN contacts ct ON m.from_id=ct.id"
-				" WHERE m.starred=1 "
-				"   AND m.hidden=0 "
-				"   AND ct.blocked=0"
+		stmt = dc_sqlite3_prepare_read(context->sql,
+			"SELECT m.id, m.timestamp" DC_CHAT_MSGS_STARRED_FROM
 				" ORDER BY m.timestamp,m.id;"); /* the list starts with the oldest message*/
 	}
 	else
 	{
-		stmt = dc_sqlite3_prepare(context->sql,
-			"SELECT m.id, m.timestamp"
-				" FROM msgs m"
-				//" LEFT JOIN contacts ct ON m.from_id=ct.id"
-				" WHERE m.chat_id=? "
-				"   AND m.hidden=0 "
-				//"   AND ct.blocked=0" -- we hide blocked-contacts from starred and deaddrop, but we have to show them in groups (otherwise it may be hard to follow conversation, wa and tg do the same. however, maybe this needs discussion some time :)
+		stmt = dc_sqlite3_prepare_read(context->sql,
+			"SELECT m.id, m.timestamp" DC_CHAT_MSGS_FROM
 				" ORDER BY m.timestamp,m.id;"); /* the list starts with the oldest message*/
 		sqlite3_bind_int(stmt, 1, chat_id);
 	}
@@ -1051,6 +1070,163 @@ cleanup:
 }
 
 
+/**
+ * Get some message IDs of a chat before or after a given message.
+ * This allows showing large chats without loading all message IDs:
+ * Open the chat with the newest messages by setting anchor_msg_id to 0 and
+ * count to a negative value, eg. -100.  When scrolling up, pass the first ID
+ * of the list as anchor_msg_id with a negative count to get the older messages.
+ * When new messages arrive, pass the last ID of the list with a
+ * positive count to get the newer messages.
+ *
+ * The returned IDs can just be prepended or appended to the list already
+ * loaded; the markers are added as dc_get_chat_msgs() would do for the whole
+ * chat, so, eg. no additional DC_MSG_ID_DAYMARKER is added if the message
+ * before the window was sent on the same day.
+ *
+ * @memberof dc_context_t
+ * @param context The context object as returned from dc_context_new().
+ * @param chat_id The chat ID of which the messages IDs should be queried.
+ * @param flags If set to DC_GCM_ADDDAYMARKER, the marker DC_MSG_ID_DAYMARKER will
+ *     be added before each day (regarding the local timezone).  Set this to 0 if you do not want this behaviour.
+ * @param marker1before An optional message ID.  If set and if the message is part of the
+ *     returned window, the id DC_MSG_ID_MARKER1 will be added just before the given ID.
+ *     Set this to 0 if you do not want this behaviour.
+ * @param anchor_msg_id The message to start from, the message itself is not returned.
+ *     The message must be part of the chat.
+ *     If set to 0, the window starts at the newest message for negative counts or at the oldest
+ *     message for positive counts.
+ * @param count The maximal number of messages to return, negative values return the
+ *     messages before the anchor, positive values the messages after the anchor.
+ *     0 and INT_MIN are not allowed.
+ * @return Array of message IDs, oldest first, must be dc_array_unref()'d when no longer used.
+ *     The array may be empty if there are no more messages in the given direction.
+ *     NULL on errors, eg. if the anchor message does not exist in the chat.
+ */
+dc_array_t* dc_get_chat_msgs_window(dc_context_t* context, uint32_t chat_id, uint32_t flags, uint32_t marker1before, uint32_t anchor_msg_id, int count)
+{
+	int           success = 0;
+	dc_array_t*   ret = NULL;
+	dc_array_t*   ids = NULL;
+	dc_array_t*   timestamps = NULL;
+	sqlite3_stmt* stmt = NULL;
+	char*         q3 = NULL;
+	int           backwards = count<0;
+	int           limit = 0;
+	time_t        anchor_timestamp = 0;
+	int           i = 0, cnt = 0, param = 1;
+	const char*   from = chat_id==DC_CHAT_ID_DEADDROP? DC_CHAT_MSGS_DEADDROP_FROM : (chat_id==DC_CHAT_ID_STARRED? DC_CHAT_MSGS_STARRED_FROM : DC_CHAT_MSGS_FROM);
+
+	int           curr_day, last_day = 0;
+	long          cnv_to_local = dc_gm2local_offset();
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC || count==0 || count==INT_MIN) {
+		goto cleanup;
+	}
+
+	limit = backwards? -count : count;
+
+	if (anchor_msg_id)
+	{
+		/* the anchor must be in the chat, otherwise we would page through the chat at the time of a foreign message */
+		q3 = sqlite3_mprintf("SELECT m.timestamp %s AND m.id=?;", from);
+		stmt = dc_sqlite3_prepare_read(context->sql, q3);
+		if (stmt==NULL) {
+			goto cleanup;
+		}
+		if (chat_id!=DC_CHAT_ID_DEADDROP && chat_id!=DC_CHAT_ID_STARRED) {
+			sqlite3_bind_int(stmt, param++, chat_id);
+		}
+		sqlite3_bind_int(stmt, param++, anchor_msg_id);
+		if (sqlite3_step(stmt)!=SQLITE_ROW) {
+			goto cleanup;
+		}
+		anchor_timestamp = (time_t)sqlite3_column_int64(stmt, 0);
+		sqlite3_finalize(stmt);
+		stmt = NULL;
+		sqlite3_free(q3);
+		q3 = NULL;
+		param = 1;
+	}
+
+	/* read the window using the index over (chat_id, timestamp), going backwards, we read
+	one message more to check if the first message starts a new day */
+	q3 = sqlite3_mprintf("SELECT m.id, m.timestamp %s %s ORDER BY m.timestamp %s, m.id %s LIMIT ?;",
+		from,
+		anchor_msg_id==0? "" : (backwards? " AND (m.timestamp<? OR (m.timestamp=? AND m.id<?))" : " AND (m.timestamp>? OR (m.timestamp=? AND m.id>?))"),
+		backwards? "DESC" : "", backwards? "DESC" : "");
+	stmt = dc_sqlite3_prepare_read(context->sql, q3);
+	if (stmt==NULL) {
+		goto cleanup;
+	}
+
+	if (chat_id!=DC_CHAT_ID_DEADDROP && chat_id!=DC_CHAT_ID_STARRED) {
+		sqlite3_bind_int(stmt, param++, chat_id);
+	}
+
+	if (anchor_msg_id) {
+		sqlite3_bind_int64(stmt, param++, anchor_timestamp);
+		sqlite3_bind_int64(stmt, param++, anchor_timestamp);
+		sqlite3_bind_int  (stmt, param++, anchor_msg_id);
+	}
+
+	sqlite3_bind_int64(stmt, param++, backwards? (sqlite3_int64)limit+1 : limit);
+
+	ids        = dc_array_new(context, DC_MIN(limit, 1000)+1); /* the arrays grow as needed, do not allocate INT_MAX slots */
+	timestamps = dc_array_new(context, DC_MIN(limit, 1000)+1);
+	while (sqlite3_step(stmt)==SQLITE_ROW) {
+		dc_array_add_id  (ids,        sqlite3_column_int(stmt, 0));
+		dc_array_add_uint(timestamps, (uintptr_t)sqlite3_column_int64(stmt, 1));
+	}
+
+	/* the day of the message before the window; if there is no such message, last_day stays 0 as in dc_get_chat_msgs() */
+	cnt = dc_array_get_cnt(ids);
+	if (backwards) {
+		if (cnt > limit) {
+			last_day = ((time_t)dc_array_get_uint(timestamps, limit) + cnv_to_local)/SECONDS_PER_DAY;
+			cnt = limit;
+		}
+	}
+	else if (anchor_msg_id) {
+		last_day = (anchor_timestamp + cnv_to_local)/SECONDS_PER_DAY;
+	}
+
+	ret = dc_array_new(context, cnt*2);
+	for (i = 0; i < cnt; i++)
+	{
+		int      index = backwards? cnt-1-i : i;
+		uint32_t curr_id = dc_array_get_id(ids, index);
+
+		if (curr_id==marker1before) {
+			dc_array_add_id(ret, DC_MSG_ID_MARKER1);
+		}
+
+		if (flags&DC_GCM_ADDDAYMARKER) {
+			curr_day = ((time_t)dc_array_get_uint(timestamps, index) + cnv_to_local)/SECONDS_PER_DAY;
+			if (curr_day!=last_day) {
+				dc_array_add_id(ret, DC_MSG_ID_DAYMARKER);
+				last_day = curr_day;
+			}
+		}
+
+		dc_array_add_id(ret, curr_id);
+	}
+
+	success = 1;
+
+cleanup:
+	sqlite3_finalize(stmt);
+	sqlite3_free(q3);
+	dc_array_unref(ids);
+	dc_array_unref(timestamps);
+	if (!success) {
+		dc_array_unref(ret);
+		ret = NULL;
+	}
+	return ret;
+}
+
+
 /**
  * Save a draft for a chat in the database.
  * If the draft was modified, an #DC_EVENT_MSGS_CHANGED will be sent that you
@@ -1101,6 +1277,7 @@ void dc_set_draft(dc_context_t* context, uint32_t chat_id, const char* msg)
 	sqlite3_bind_int  (stmt, 3, chat->id);
 	sqlite3_step(stmt);
 
+	dc_changelog_add(context->changelog, DC_CHANGE_CHAT, chat_id);
 	context->cb(context, DC_EVENT_MSGS_CHANGED, chat_id, 0);
 
 cleanup:
@@ -1231,7 +1408,7 @@ int dc_get_msg_cnt(dc_context_t* context, uint32_t chat_id)
 		goto cleanup;
 	}
 
-	stmt = dc_sqlite3_prepare(context->sql,
+	stmt = dc_sqlite3_prepare_read(context->sql,
 		"SELECT COUNT(*) FROM msgs WHERE chat_id=?;");
 	sqlite3_bind_int(stmt, 1, chat_id);
 	if (sqlite3_step(stmt)!=SQLITE_ROW) {
@@ -1274,7 +1451,7 @@ int dc_get_fresh_msg_cnt(dc_context_t* context, uint32_t chat_id)
 		goto cleanup;
 	}
 
-	stmt = dc_sqlite3_prepare(context->sql,
+	stmt = dc_sqlite3_prepare_read(context->sql,
 		"SELECT COUNT(*) FROM msgs "
 		" WHERE state=" DC_STRINGIFY(DC_STATE_IN_FRESH)
 		"   AND hidden=0 "
@@ -1324,6 +1501,7 @@ void dc_archive_chat(dc_context_t* context, uint32_t chat_id, int archive)
 	sqlite3_step(stmt);
 	sqlite3_finalize(stmt);
 
+	dc_changelog_add(context->changelog, DC_CHANGE_CHAT, chat_id);
 	context->cb(context, DC_EVENT_MSGS_CHANGED, 0, 0);
 }
 
@@ -1342,6 +1520,9 @@ void dc_block_chat(dc_context_t* context, uint32_t chat_id, int new_blocking)
 	sqlite3_bind_int(stmt, 2, chat_id);
 	sqlite3_step(stmt);
 	sqlite3_finalize(stmt);
+
+	dc_msgcache_clear(context->msgcache); /* the cached messages contain the blocking state of their chat */
+	dc_changelog_add(context->changelog, DC_CHANGE_CHAT, chat_id);
 }
 
 
@@ -1409,6 +1590,8 @@ void dc_delete_chat(dc_context_t* context, uint32_t chat_id)
 		sqlite3_free(q3);
 		q3 = NULL;
 
+		dc_msgcache_clear(context->msgcache);
+
 		q3 = sqlite3_mprintf("DELETE FROM chats_contacts WHERE chat_id=%i;", chat_id);
 		if (!dc_sqlite3_execute(context->sql, q3)) {
 			goto cleanup;
@@ -1426,6 +1609,7 @@ void dc_delete_chat(dc_context_t* context, uint32_t chat_id)
 	dc_sqlite3_commit(context->sql);
 	pending_transaction = 0;
 
+	dc_changelog_add(context->changelog, DC_CHANGE_CHAT, chat_id);
 	context->cb(context, DC_EVENT_MSGS_CHANGED, 0, 0);
 
 cleanup:
@@ -1553,6 +1737,7 @@ cleanup:
 	free(grpid);
 
 	if (chat_id) {
+		dc_changelog_add(context->changelog, DC_CHANGE_CHAT, chat_id);
 		context->cb(context, DC_EVENT_MSGS_CHANGED, 0, 0);
 	}
 
@@ -1615,6 +1800,7 @@ int dc_set_chat_name(dc_context_t* context, uint32_t chat_id, const char* new_na
 		msg->id = dc_send_msg_object(context, chat_id, msg);
 		context->cb(context, DC_EVENT_MSGS_CHANGED, chat_id, msg->id);
 	}
+	dc_changelog_add(context->changelog, DC_CHANGE_CHAT, chat_id);
 	context->cb(context, DC_EVENT_CHAT_MODIFIED, chat_id, 0);
 
 	success = 1;
@@ -1679,6 +1865,7 @@ int dc_set_chat_profile_image(dc_context_t* context, uint32_t chat_id, const cha
 		msg->id = dc_send_msg_object(context, chat_id, msg);
 		context->cb(context, DC_EVENT_MSGS_CHANGED, chat_id, msg->id);
 	}
+	dc_changelog_add(context->changelog, DC_CHANGE_CHAT, chat_id);
 	context->cb(context, DC_EVENT_CHAT_MODIFIED, chat_id, 0);
 
 	success = 1;
@@ -1805,6 +1992,7 @@ int dc_add_contact_to_chat_ex(dc_context_t* context, uint32_t chat_id, uint32_t
 		msg->id = dc_send_msg_object(context, chat_id, msg);
 		context->cb(context, DC_EVENT_MSGS_CHANGED, chat_id, msg->id);
 	}
+	dc_changelog_add(context->changelog, DC_CHANGE_CHAT, chat_id);
 	context->cb(context, DC_EVENT_CHAT_MODIFIED, chat_id, 0);
 
 	success = 1;
@@ -1902,6 +2090,7 @@ int dc_remove_contact_from_chat(dc_context_t* context, uint32_t chat_id, uint32_
 		goto cleanup;
 	}
 
+	dc_changelog_add(context->changelog, DC_CHANGE_CHAT, chat_id);
 	context->cb(context, DC_EVENT_CHAT_MODIFIED, chat_id, 0);
 
 	success = 1;
@@ -1945,6 +2134,7 @@ static int last_msg_in_chat_encrypted(dc_sqlite3_t* sql, uint32_t chat_id)
 static uint32_t dc_send_msg_raw(dc_context_t* context, dc_chat_t* chat, const dc_msg_t* msg, time_t timestamp)
 {
 	char*         rfc724_mid = NULL;
+	char*         summary = NULL;
 	sqlite3_stmt* stmt = NULL;
 	uint32_t      msg_id = 0;
 	uint32_t      to_id = 0;
@@ -2040,8 +2230,9 @@ static uint32_t dc_send_msg_raw(dc_context_t* context, dc_chat_t* chat, const dc
 	dc_param_set(msg->param, DC_PARAM_ERRONEOUS_E2EE, NULL); /* reset eg. on forwarding */
 
 	/* add message to the database */
+	summary = dc_msg_get_summarytext_to_store(msg->type, msg->text);
 	stmt = dc_sqlite3_prepare(context->sql,
-		"INSERT INTO msgs (rfc724_mid,chat_id,from_id,to_id, timestamp,type,state, txt,param,hidden) VALUES (?,?,?,?, ?,?,?, ?,?,?);");
+		"INSERT INTO msgs (rfc724_mid,chat_id,from_id,to_id, timestamp,type,state, txt,param,hidden,txt_summary) VALUES (?,?,?,?, ?,?,?, ?,?,?,?);");
 	sqlite3_bind_text (stmt,  1, rfc724_mid, -1, SQLITE_STATIC);
 	sqlite3_bind_int  (stmt,  2, chat->id);
 	sqlite3_bind_int  (stmt,  3, DC_CONTACT_ID_SELF);
@@ -2052,6 +2243,7 @@ static uint32_t dc_send_msg_raw(dc_context_t* context, dc_chat_t* chat, const dc
 	sqlite3_bind_text (stmt,  8, msg->text? msg->text : "",  -1, SQLITE_STATIC);
 	sqlite3_bind_text (stmt,  9, msg->param->packed, -1, SQLITE_STATIC);
 	sqlite3_bind_int  (stmt, 10, msg->hidden);
+	sqlite3_bind_text (stmt, 11, summary, -1, SQLITE_STATIC);
 	if (sqlite3_step(stmt)!=SQLITE_DONE) {
 		dc_log_error(context, 0, "Cannot send message, cannot insert to database.", chat->id);
 		goto cleanup;
@@ -2060,8 +2252,12 @@ static uint32_t dc_send_msg_raw(dc_context_t* context, dc_chat_t* chat, const dc
 	msg_id = dc_sqlite3_get_rowid(context->sql, "msgs", "rfc724_mid", rfc724_mid);
 	dc_job_add(context, DC_JOB_SEND_MSG_TO_SMTP, msg_id, NULL, 0);
 
+	dc_changelog_add(context->changelog, DC_CHANGE_MSG_INSERTED, msg_id);
+	dc_changelog_add(context->changelog, DC_CHANGE_CHAT, chat->id);
+
 cleanup:
 	free(rfc724_mid);
+	free(summary);
 	sqlite3_finalize(stmt);
 	return msg_id;
 }
@@ -2129,17 +2325,20 @@ uint32_t dc_send_msg_object(dc_context_t* context, uint32_t chat_id, dc_msg_t* m
 				free(better_mime);
 			}
 
-			if ((msg->type==DC_MSG_IMAGE || msg->type==DC_MSG_GIF)
-			 && (dc_param_get_int(msg->param, DC_PARAM_WIDTH, 0)<=0 || dc_param_get_int(msg->param, DC_PARAM_HEIGHT, 0)<=0)) {
-				/* set width/height of images, if not yet done */
-				unsigned char* buf = NULL; size_t buf_bytes; uint32_t w, h;
-				if (dc_read_file(pathNfilename, (void**)&buf, &buf_bytes, msg->context)) {
-					if (dc_get_filemeta(buf, buf_bytes, &w, &h)) {
-						dc_param_set_int(msg->param, DC_PARAM_WIDTH, w);
-						dc_param_set_int(msg->param, DC_PARAM_HEIGHT, h);
+			if (msg->type==DC_MSG_IMAGE || msg->type==DC_MSG_GIF || msg->type==DC_MSG_VIDEO) {
+				/* set width/height of images and videos and the duration of videos, if not yet done; only the headers of the file are read */
+				int need_size     = dc_param_get_int(msg->param, DC_PARAM_WIDTH, 0)<=0 || dc_param_get_int(msg->param, DC_PARAM_HEIGHT, 0)<=0;
+				int need_duration = msg->type==DC_MSG_VIDEO && dc_param_get_int(msg->param, DC_PARAM_DURATION, 0)<=0;
+				dc_mediaprobe_t probe;
+				if ((need_size || need_duration) && dc_mediaprobe_file(pathNfilename, &probe)) {
+					if (need_size && probe.width && probe.height) {
+						dc_param_set_int(msg->param, DC_PARAM_WIDTH, probe.width);
+						dc_param_set_int(msg->param, DC_PARAM_HEIGHT, probe.height);
+					}
+					if (need_duration && probe.duration_ms) {
+						dc_param_set_int(msg->param, DC_PARAM_DURATION, probe.duration_ms);
 					}
 				}
-				free(buf);
 			}
 
 			dc_log_info(context, 0, "Attaching \"%s\" for message type #%i.", pathNfilename, (int)msg->type);
@@ -2498,13 +2697,14 @@ void dc_add_device_msg(dc_context_t* context, uint32_t chat_id, const char* text
 	uint32_t      msg_id = 0;
 	sqlite3_stmt* stmt = NULL;
 	char*         rfc724_mid = dc_create_outgoing_rfc724_mid(NULL, "@device");
+	char*         summary = dc_msg_get_summarytext_to_store(DC_MSG_TEXT, text);
 
 	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC || text==NULL) {
 		goto cleanup;
 	}
 
 	stmt = dc_sqlite3_prepare(context->sql,
-		"INSERT INTO msgs (chat_id,from_id,to_id, timestamp,type,state, txt,rfc724_mid) VALUES (?,?,?, ?,?,?, ?,?);");
+		"INSERT INTO msgs (chat_id,from_id,to_id, timestamp,type,state, txt,rfc724_mid,txt_summary) VALUES (?,?,?, ?,?,?, ?,?,?);");
 	sqlite3_bind_int  (stmt,  1, chat_id);
 	sqlite3_bind_int  (stmt,  2, DC_CONTACT_ID_DEVICE);
 	sqlite3_bind_int  (stmt,  3, DC_CONTACT_ID_DEVICE);
@@ -2513,14 +2713,18 @@ void dc_add_device_msg(dc_context_t* context, uint32_t chat_id, const char* text
 	sqlite3_bind_int  (stmt,  6, DC_STATE_IN_NOTICED);
 	sqlite3_bind_text (stmt,  7, text,  -1, SQLITE_STATIC);
 	sqlite3_bind_text (stmt,  8, rfc724_mid,  -1, SQLITE_STATIC);
+	sqlite3_bind_text (stmt,  9, summary,  -1, SQLITE_STATIC);
 	if (sqlite3_step(stmt)!=SQLITE_DONE) {
 		goto cleanup;
 	}
 	msg_id = dc_sqlite3_get_rowid(context->sql, "msgs", "rfc724_mid", rfc724_mid);
+	dc_changelog_add(context->changelog, DC_CHANGE_MSG_INSERTED, msg_id);
+	dc_changelog_add(context->changelog, DC_CHANGE_CHAT, chat_id);
 	context->cb(context, DC_EVENT_MSGS_CHANGED, chat_id, msg_id);
 
 cleanup:
 	free(rfc724_mid);
+	free(summary);
 	sqlite3_finalize(stmt);
 }
 
@@ -292,7 +292,7 @@ static uint32_t get_last_deaddrop_fresh_msg(dc_context_t* context)
 	uint32_t      ret = 0;
 	sqlite3_stmt* stmt = NULL;
 
-	stmt = dc_sqlite3_prepare(context->sql,
+	stmt = dc_sqlite3_prepare_read(context->sql,
 		"SELECT m.id "
 		" FROM msgs m "
 		" LEFT JOIN chats c ON c.id=m.chat_id "
@@ -352,14 +352,14 @@ int dc_chatlist_load_from_db(dc_chatlist_t* chatlist, int listflags, const char*
 	if (query_contact_id)
 	{
 		// show chats shared with a given contact
-		stmt = dc_sqlite3_prepare(chatlist->context->sql,
+		stmt = dc_sqlite3_prepare_read(chatlist->context->sql,
 			QUR1 " AND c.id IN(SELECT chat_id FROM chats_contacts WHERE contact_id=?) " QUR2);
 		sqlite3_bind_int(stmt, 1, query_contact_id);
 	}
 	else if (listflags & DC_GCL_ARCHIVED_ONLY)
 	{
 		/* show archived chats */
-		stmt = dc_sqlite3_prepare(chatlist->context->sql,
+		stmt = dc_sqlite3_prepare_read(chatlist->context->sql,
 			QUR1 " AND c.archived=1 " QUR2);
 	}
 	else if (query__==NULL)
@@ -374,7 +374,7 @@ int dc_chatlist_load_from_db(dc_chatlist_t* chatlist, int listflags, const char*
 			add_archived_link_item = 1;
 		}
 
-		stmt = dc_sqlite3_prepare(chatlist->context->sql,
+		stmt = dc_sqlite3_prepare_read(chatlist->context->sql,
 			QUR1 " AND c.archived=0 " QUR2);
 	}
 	else
@@ -387,7 +387,7 @@ int dc_chatlist_load_from_db(dc_chatlist_t* chatlist, int listflags, const char*
 			goto cleanup;
 		}
 		strLikeCmd = dc_mprintf("%%%s%%", query);
-		stmt = dc_sqlite3_prepare(chatlist->context->sql,
+		stmt = dc_sqlite3_prepare_read(chatlist->context->sql,
 			QUR1 " AND c.name LIKE ? " QUR2);
 		sqlite3_bind_text(stmt, 1, strLikeCmd, -1, SQLITE_STATIC);
 	}
@@ -424,7 +424,7 @@ cleanup:
 int dc_get_archived_cnt(dc_context_t* context)
 {
 	int ret = 0;
-	sqlite3_stmt* stmt = dc_sqlite3_prepare(context->sql,
+	sqlite3_stmt* stmt = dc_sqlite3_prepare_read(context->sql,
 		"SELECT COUNT(*) FROM chats WHERE blocked=0 AND archived=1;");
 	if (sqlite3_step(stmt)==SQLITE_ROW) {
 		ret = sqlite3_column_int(stmt, 0);
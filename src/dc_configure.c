@@ -28,6 +28,7 @@
 #include "dc_smtp.h"
 #include "dc_saxparser.h"
 #include "dc_job.h"
+#include "dc_probe.h"
 
 
 /*******************************************************************************
@@ -35,13 +36,20 @@
  ******************************************************************************/
 
 
-static char* read_autoconf_file(dc_context_t* context, const char* url)
+static char* read_autoconf_file(dc_probe_t* probe, const char* url)
 {
 	char* filecontent = NULL;
-	dc_log_info(context, 0, "Testing %s ...", url);
-	filecontent = (char*)context->cb(context, DC_EVENT_HTTP_GET, (uintptr_t)url, 0);
+	if (dc_probe_is_cancelled(probe)) {
+		return NULL; /* another autoconfig was faster, do not start a new request */
+	}
+	dc_log_info(probe->context, 0, "Testing %s ...", url);
+	filecontent = (char*)probe->context->cb(probe->context, DC_EVENT_HTTP_GET, (uintptr_t)url, 0);
+	if (dc_probe_is_cancelled(probe)) {
+		free(filecontent); /* another autoconfig was faster */
+		return NULL;
+	}
 	if (filecontent==NULL) {
-		dc_log_info(context, 0, "Can't read file."); /* this is not a warning or an error, we're just testing */
+		dc_log_info(probe->context, 0, "Can't read %s", url); /* this is not a warning or an error, we're just testing */
 		return NULL;
 	}
 	return filecontent;
@@ -58,7 +66,7 @@ static char* read_autoconf_file(dc_context_t* context, const char* url)
 
 typedef struct moz_autoconfigure_t
 {
-	const dc_loginparam_t* in;
+	const char*            in_emailaddress;
 	char*                  in_emaildomain;
 	char*                  in_emaillocalpart;
 
@@ -119,7 +127,7 @@ static void moz_autoconfigure_text_cb(void* userdata, const char* text, int len)
 
 	char* val = dc_strdup(text);
 	dc_trim(val);
-	dc_str_replace(&val, "%EMAILADDRESS%",   moz_ac->in->addr);
+	dc_str_replace(&val, "%EMAILADDRESS%",   moz_ac->in_emailaddress);
 	dc_str_replace(&val, "%EMAILLOCALPART%", moz_ac->in_emaillocalpart);
 	dc_str_replace(&val, "%EMAILDOMAIN%",    moz_ac->in_emaildomain);
 
@@ -200,19 +208,19 @@ static void moz_autoconfigure_endtag_cb(void* userdata, const char* tag)
 }
 
 
-static dc_loginparam_t* moz_autoconfigure(dc_context_t* context, const char* url, const dc_loginparam_t* param_in)
+static dc_loginparam_t* moz_autoconfigure(dc_probe_t* probe, const char* url, const char* addr)
 {
 	char*               xml_raw = NULL;
 	moz_autoconfigure_t moz_ac;
 
 	memset(&moz_ac, 0, sizeof(moz_autoconfigure_t));
 
-	if ((xml_raw=read_autoconf_file(context, url))==NULL) {
+	if ((xml_raw=read_autoconf_file(probe, url))==NULL) {
 		goto cleanup;
 	}
 
-	moz_ac.in                = param_in;
-	moz_ac.in_emaillocalpart = dc_strdup(param_in->addr); char* p = strchr(moz_ac.in_emaillocalpart, '@'); if (p==NULL) { goto cleanup; } *p = 0;
+	moz_ac.in_emailaddress   = addr;
+	moz_ac.in_emaillocalpart = dc_strdup(addr); char* p = strchr(moz_ac.in_emaillocalpart, '@'); if (p==NULL) { goto cleanup; } *p = 0;
 	moz_ac.in_emaildomain    = dc_strdup(p+1);
 	moz_ac.out               = dc_loginparam_new();
 
@@ -227,7 +235,7 @@ static dc_loginparam_t* moz_autoconfigure(dc_context_t* context, const char* url
 	 || moz_ac.out->send_server==NULL
 	 || moz_ac.out->send_port  ==0)
 	{
-		{ char* r = dc_loginparam_get_readable(moz_ac.out); dc_log_warning(context, 0, "Bad or incomplete autoconfig: %s", r); free(r); }
+		if (!dc_probe_is_cancelled(probe)) { char* r = dc_loginparam_get_readable(moz_ac.out); dc_log_warning(probe->context, 0, "Bad or incomplete autoconfig: %s", r); free(r); }
 
 		dc_loginparam_unref(moz_ac.out); /* autoconfig failed for the given URL */
 		moz_ac.out = NULL;
@@ -249,8 +257,6 @@ cleanup:
 
 typedef struct outlk_autodiscover_t
 {
-	const dc_loginparam_t* in;
-
 	dc_loginparam_t*       out;
 	int                    out_imap_set;
 	int                    out_smtp_set;
@@ -342,7 +348,7 @@ static void outlk_autodiscover_endtag_cb(void* userdata, const char* tag)
 }
 
 
-static dc_loginparam_t* outlk_autodiscover(dc_context_t* context, const char* url__, const dc_loginparam_t* param_in)
+static dc_loginparam_t* outlk_autodiscover(dc_probe_t* probe, const char* url__)
 {
 	char*                 xml_raw = NULL;
 	char*                 url = dc_strdup(url__);
@@ -353,11 +359,10 @@ static dc_loginparam_t* outlk_autodiscover(dc_context_t* context, const char* ur
 	{
 		memset(&outlk_ad, 0, sizeof(outlk_autodiscover_t));
 
-		if ((xml_raw=read_autoconf_file(context, url))==NULL) {
+		if ((xml_raw=read_autoconf_file(probe, url))==NULL) {
 			goto cleanup;
 		}
 
-		outlk_ad.in                = param_in;
 		outlk_ad.out               = dc_loginparam_new();
 
 		dc_saxparser_t                 saxparser;
@@ -384,7 +389,7 @@ static dc_loginparam_t* outlk_autodiscover(dc_context_t* context, const char* ur
 	 || outlk_ad.out->send_server==NULL
 	 || outlk_ad.out->send_port  ==0)
 	{
-		{ char* r = dc_loginparam_get_readable(outlk_ad.out); dc_log_warning(context, 0, "Bad or incomplete autoconfig: %s", r); free(r); }
+		if (!dc_probe_is_cancelled(probe)) { char* r = dc_loginparam_get_readable(outlk_ad.out); dc_log_warning(probe->context, 0, "Bad or incomplete autoconfig: %s", r); free(r); }
 		dc_loginparam_unref(outlk_ad.out); /* autoconfig failed for the given URL */
 		outlk_ad.out = NULL;
 		goto cleanup;
@@ -398,6 +403,117 @@ cleanup:
 }
 
 
+/*******************************************************************************
+ * Probes, see dc_probe.c
+ ******************************************************************************/
+
+
+#define DC_AUTOCONFIG_TIMEOUT_MS  15000
+#define DC_SMTP_PROBE_TIMEOUT_MS  (3*DC_SMTP_TIMEOUT_SEC*1000) /* connect, STARTTLS and login have their own timeouts */
+
+
+typedef struct autoconfig_probe_t
+{
+	int   outlook; /* 0=Thunderbird's autoconfig, 1=Outlook's autodiscover */
+	char* url;
+	char* addr;
+} autoconfig_probe_t;
+
+
+static void free_autoconfig_probe(void* arg)
+{
+	autoconfig_probe_t* ap = (autoconfig_probe_t*)arg;
+	free(ap->url);
+	free(ap->addr);
+	free(ap);
+}
+
+
+static void* autoconfig_probe(dc_probe_t* probe)
+{
+	autoconfig_probe_t* ap = (autoconfig_probe_t*)probe->arg;
+	return ap->outlook? outlk_autodiscover(probe, ap->url) : moz_autoconfigure(probe, ap->url, ap->addr);
+}
+
+
+static void add_autoconfig_probe(dc_probes_t* probes, int outlook, char* url /*takes ownership*/, const char* addr)
+{
+	autoconfig_probe_t* ap = NULL;
+
+	if ((ap=calloc(1, sizeof(autoconfig_probe_t)))==NULL) {
+		exit(66);
+	}
+	ap->outlook = outlook;
+	ap->url     = url;
+	ap->addr    = dc_strdup(addr);
+	dc_probes_add(probes, autoconfig_probe, ap, DC_AUTOCONFIG_TIMEOUT_MS);
+}
+
+
+static void free_loginparam(void* arg)
+{
+	dc_loginparam_unref((dc_loginparam_t*)arg);
+}
+
+
+typedef struct smtp_probe_t
+{
+	dc_loginparam_t* param;
+	int              log_connect_errors;
+} smtp_probe_t;
+
+
+static void free_smtp_probe(void* arg)
+{
+	smtp_probe_t* sp = (smtp_probe_t*)arg;
+	dc_loginparam_unref(sp->param);
+	free(sp);
+}
+
+
+static void* smtp_probe(dc_probe_t* probe)
+{
+	/* try to connect and to login; the connection is closed then, the result are the working parameters */
+	smtp_probe_t*    sp = (smtp_probe_t*)probe->arg;
+	dc_smtp_t*       smtp = NULL;
+	dc_loginparam_t* ret = NULL;
+
+	if (dc_probe_is_cancelled(probe)) {
+		goto cleanup;
+	}
+
+	{ char* r = dc_loginparam_get_readable(sp->param); dc_log_info(probe->context, 0, "Trying: %s", r); free(r); }
+
+	smtp = dc_smtp_new(probe->context);
+	smtp->log_connect_errors = sp->log_connect_errors;
+	if (dc_smtp_connect(smtp, sp->param) && !dc_probe_is_cancelled(probe)) {
+		ret = dc_loginparam_dup(sp->param);
+	}
+
+cleanup:
+	dc_smtp_unref(smtp); /* the context is still valid here, dc_probes_unref() waits for us */
+	return ret;
+}
+
+
+static void add_smtp_probe(dc_probes_t* probes, const dc_loginparam_t* param, int socket_flag, int port, int log_connect_errors)
+{
+	smtp_probe_t* sp = NULL;
+
+	if ((sp=calloc(1, sizeof(smtp_probe_t)))==NULL) {
+		exit(66);
+	}
+	sp->param              = dc_loginparam_dup(param);
+	sp->log_connect_errors = log_connect_errors;
+	if (socket_flag) {
+		sp->param->server_flags &= ~DC_LP_SMTP_SOCKET_FLAGS;
+		sp->param->server_flags |=  socket_flag;
+		sp->param->send_port    =   port;
+	}
+	dc_probes_add(probes, smtp_probe, sp, DC_SMTP_PROBE_TIMEOUT_MS);
+}
+
+
 /*******************************************************************************
  * Main interface
  ******************************************************************************/
@@ -408,13 +524,15 @@ void dc_job_do_DC_JOB_CONFIGURE_IMAP(dc_context_t* context, dc_job_t* job)
 	int              success = 0;
 	int              i = 0;
 	int              imap_connected_here = 0;
-	int              smtp_connected_here = 0;
 	int              ongoing_allocated_here = 0;
 
 	dc_loginparam_t* param = NULL;
 	char*            param_domain = NULL; /* just a pointer inside param, must not be freed! */
 	char*            param_addr_urlencoded = NULL;
 	dc_loginparam_t* param_autoconfig = NULL;
+	dc_loginparam_t* param_smtp = NULL;
+	dc_probes_t*     autoconfig_probes = NULL; /* kept until the end, so that we need not to wait for the cancelled probes before connecting */
+	dc_probes_t*     probes = NULL;
 
 	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
 		goto cleanup;
@@ -495,42 +613,30 @@ void dc_job_do_DC_JOB_CONFIGURE_IMAP(dc_context_t* context, dc_job_t* job)
 	/*&&param->send_pw     ==NULL -- the password cannot be auto-configured and is no criterion for autoconfig or not */
 	 && param->server_flags==0)
 	{
-		/* A.  Search configurations from the domain used in the email-address */
+		/* A.  Search configurations from the domain used in the email-address;
+		       all sources are asked at the same time, the order defines the priority */
+		autoconfig_probes = dc_probes_new(context, free_loginparam, free_autoconfig_probe);
+
 		for (i = 0; i <= 1; i++) {
-			if (param_autoconfig==NULL) {
-				char* url = dc_mprintf("%s://autoconfig.%s/mail/config-v1.1.xml?emailaddress=%s", i==0?"https":"http", param_domain, param_addr_urlencoded); /* Thunderbird may or may not use SSL */
-				param_autoconfig = moz_autoconfigure(context, url, param);
-				free(url);
-				PROGRESS(300+i*20)
-			}
+			add_autoconfig_probe(autoconfig_probes, 0, dc_mprintf("%s://autoconfig.%s/mail/config-v1.1.xml?emailaddress=%s", i==0?"https":"http", param_domain, param_addr_urlencoded), param->addr); /* Thunderbird may or may not use SSL */
 		}
 
 		for (i = 0; i <= 1; i++) {
-			if (param_autoconfig==NULL) {
-				char* url = dc_mprintf("%s://%s/.well-known/autoconfig/mail/config-v1.1.xml?emailaddress=%s", i==0?"https":"http", param_domain, param_addr_urlencoded); // the doc does not mention `emailaddress=`, however, Thunderbird adds it, see https://releases.mozilla.org/pub/thunderbird/ ,  which makes some sense
-				param_autoconfig = moz_autoconfigure(context, url, param);
-				free(url);
-				PROGRESS(340+i*30)
-			}
+			add_autoconfig_probe(autoconfig_probes, 0, dc_mprintf("%s://%s/.well-known/autoconfig/mail/config-v1.1.xml?emailaddress=%s", i==0?"https":"http", param_domain, param_addr_urlencoded), param->addr); // the doc does not mention `emailaddress=`, however, Thunderbird adds it, see https://releases.mozilla.org/pub/thunderbird/ ,  which makes some sense
 		}
 
 		for (i = 0; i <= 1; i++) {
-			if (param_autoconfig==NULL) {
-				char* url = dc_mprintf("https://%s%s/autodiscover/autodiscover.xml", i==0?"":"autodiscover.", param_domain); /* Outlook uses always SSL but different domains */
-				param_autoconfig = outlk_autodiscover(context, url, param);
-				free(url);
-				PROGRESS(400+i*50)
-			}
+			add_autoconfig_probe(autoconfig_probes, 1, dc_mprintf("https://%s%s/autodiscover/autodiscover.xml", i==0?"":"autodiscover.", param_domain), param->addr); /* Outlook uses always SSL but different domains */
 		}
 
 		/* B.  If we have no configuration yet, search configuration in Thunderbird's centeral database */
-		if (param_autoconfig==NULL)
-		{
-			char* url = dc_mprintf("https://autoconfig.thunderbird.net/v1.1/%s", param_domain); /* always SSL for Thunderbird's database */
-			param_autoconfig = moz_autoconfigure(context, url, param);
-			free(url);
-			PROGRESS(500)
-		}
+		add_autoconfig_probe(autoconfig_probes, 0, dc_mprintf("https://autoconfig.thunderbird.net/v1.1/%s", param_domain), param->addr); /* always SSL for Thunderbird's database */
+
+		PROGRESS(300)
+
+		param_autoconfig = (dc_loginparam_t*)dc_probes_get_best(autoconfig_probes, NULL); /* also cancels the other probes */
+
+		PROGRESS(500)
 
 		/* C.  Do we have any result? */
 		if (param_autoconfig)
@@ -656,25 +762,21 @@ void dc_job_do_DC_JOB_CONFIGURE_IMAP(dc_context_t* context, dc_job_t* job)
 
 	PROGRESS(800)
 
-	/* try to connect to SMTP - if we did not got an autoconfig, the first try was SSL-465 and we do a second try with STARTTLS-587 */
-	if (!dc_smtp_connect(context->smtp, param))  {
-		if (param_autoconfig) {
-			goto cleanup;
-		}
-
-		PROGRESS(850)
-
-		param->server_flags &= ~DC_LP_SMTP_SOCKET_FLAGS;
-		param->server_flags |=  DC_LP_SMTP_SOCKET_STARTTLS;
-		param->send_port    =   TYPICAL_SMTP_STARTTLS_PORT;
-		{ char* r = dc_loginparam_get_readable(param); dc_log_info(context, 0, "Trying: %s", r); free(r); }
+	/* try to connect to SMTP only after the IMAP login worked, so that a wrong password does not cause more failed logins.
+	if we did not got an autoconfig, we try STARTTLS-587 at the same time; the given parameters (typically SSL-465) are preferred.
+	as before, only the first failure is reported as an error, the others are logged as warnings */
+	probes = dc_probes_new(context, free_loginparam, free_smtp_probe);
+	add_smtp_probe(probes, param, 0, 0, 1);
+	if (param_autoconfig==NULL) {
+		add_smtp_probe(probes, param, DC_LP_SMTP_SOCKET_STARTTLS, TYPICAL_SMTP_STARTTLS_PORT, 0);
+	}
 
-		if (!dc_smtp_connect(context->smtp, param)) {
-			goto cleanup;
-		}
+	if ((param_smtp=(dc_loginparam_t*)dc_probes_get_best(probes, NULL))==NULL) {
+		goto cleanup;
 	}
 
-	smtp_connected_here = 1;
+	param->server_flags = param_smtp->server_flags;
+	param->send_port    = param_smtp->send_port;
 
 	PROGRESS(900)
 
@@ -701,11 +803,13 @@ cleanup:
 	if (imap_connected_here) { dc_imap_disconnect(context->imap); }
 	context->cb(context, DC_EVENT_CONFIGURE_PROGRESS, 960, 0);
 
-	if (smtp_connected_here) { dc_smtp_disconnect(context->smtp); }
+	dc_probes_unref(probes); /* waits for the probes still running, they must not use the context after we return */
+	dc_probes_unref(autoconfig_probes);
 	context->cb(context, DC_EVENT_CONFIGURE_PROGRESS, 970, 0);
 
 	dc_loginparam_unref(param);
 	dc_loginparam_unref(param_autoconfig);
+	dc_loginparam_unref(param_smtp);
 	free(param_addr_urlencoded);
 	if (ongoing_allocated_here) { dc_free_ongoing(context); }
 	context->cb(context, DC_EVENT_CONFIGURE_PROGRESS, 980, 0);
@@ -1046,6 +1046,9 @@ void dc_marknoticed_contact(dc_context_t* context, uint32_t contact_id)
 	sqlite3_bind_int(stmt, 1, contact_id);
 	sqlite3_step(stmt);
 	sqlite3_finalize(stmt);
+
+	dc_msgcache_clear(context->msgcache);
+	dc_changelog_reset(context->changelog); /* the affected chats are unknown */
 }
 
 
@@ -1126,6 +1129,8 @@ void dc_block_contact(dc_context_t* context, uint32_t contact_id, int new_blocki
 				goto cleanup;
 			}
 
+			dc_msgcache_clear(context->msgcache); /* the cached messages contain the blocking state of their chat */
+
 			/* mark all messages from the blocked contact as being noticed (this is to remove the deaddrop popup) */
 			dc_marknoticed_contact(context, contact_id);
 
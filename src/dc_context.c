@@ -30,6 +30,7 @@
 #include "dc_smtp.h"
 #include "dc_openssl.h"
 #include "dc_mimefactory.h"
+#include "dc_mimeparser.h"
 #include "dc_tools.h"
 #include "dc_job.h"
 #include "dc_key.h"
@@ -50,9 +51,10 @@ static uintptr_t cb_dummy(dc_context_t* context, int event, uintptr_t data1, uin
 
 
 /**
- * The following three callback are given to dc_imap_new() to read/write configuration
+ * The following callbacks are given to dc_imap_new() to read/write configuration
  * and to handle received messages. As the imap-functions are typically used in
- * a separate user-thread, also these functions may be called from a different thread.
+ * a separate user-thread, also these functions may be called from a different thread;
+ * cb_parse_imf() is even called from several worker threads at the same time.
  *
  * @private @memberof dc_context_t
  */
@@ -70,10 +72,38 @@ static void cb_set_config(dc_imap_t* imap, const char* key, const char* value)
 }
 
 
-static void cb_receive_imf(dc_imap_t* imap, const char* imf_raw_not_terminated, size_t imf_raw_bytes, const char* server_folder, uint32_t server_uid, uint32_t flags)
+static int cb_get_location(dc_imap_t* imap, const char* rfc724_mid, char** ret_folder, uint32_t* ret_uidvalidity, uint32_t* ret_uid)
 {
 	dc_context_t* context = (dc_context_t*)imap->userData;
-	dc_receive_imf(context, imf_raw_not_terminated, imf_raw_bytes, server_folder, server_uid, flags);
+	return dc_get_imap_location(context, rfc724_mid, ret_folder, ret_uidvalidity, ret_uid);
+}
+
+
+static void cb_set_location(dc_imap_t* imap, const char* rfc724_mid, const char* folder, uint32_t uidvalidity, uint32_t uid)
+{
+	dc_context_t* context = (dc_context_t*)imap->userData;
+	dc_set_imap_location(context, rfc724_mid, folder, uidvalidity, uid);
+}
+
+
+static void cb_set_locations(dc_imap_t* imap, const char* folder, uint32_t uidvalidity, int replace, char** rfc724_mids, const uint32_t* uids, int cnt)
+{
+	dc_context_t* context = (dc_context_t*)imap->userData;
+	dc_set_imap_locations(context, folder, uidvalidity, replace, rfc724_mids, uids, cnt);
+}
+
+
+static void* cb_parse_imf(dc_imap_t* imap, const char* imf_raw_not_terminated, size_t imf_raw_bytes)
+{
+	dc_context_t* context = (dc_context_t*)imap->userData;
+	return (void*)dc_receive_imf_parse(context, imf_raw_not_terminated, imf_raw_bytes);
+}
+
+
+static void cb_receive_imf(dc_imap_t* imap, const char* imf_raw_not_terminated, size_t imf_raw_bytes, const char* server_folder, uint32_t server_uid, uint32_t flags, void* parsed)
+{
+	dc_context_t* context = (dc_context_t*)imap->userData;
+	dc_receive_imf_parsed(context, (dc_mimeparser_t*)parsed, imf_raw_not_terminated, imf_raw_bytes, server_folder, server_uid, flags);
 }
 
 
@@ -111,10 +141,14 @@ dc_context_t* dc_context_new(dc_callback_t cb, void* userdata, const char* os_na
 	}
 
 	pthread_mutex_init(&context->smear_critical, NULL);
+	pthread_mutex_init(&context->peerstate_critical, NULL);
+	pthread_mutex_init(&context->blobdir_critical, NULL);
+	pthread_mutex_init(&context->mimeparser_pool_critical, NULL);
 	pthread_mutex_init(&context->bobs_qr_critical, NULL);
 	pthread_mutex_init(&context->log_ringbuf_critical, NULL);
 	pthread_mutex_init(&context->imapidle_condmutex, NULL);
 	pthread_mutex_init(&context->smtpidle_condmutex, NULL);
+	pthread_mutex_init(&context->jobstats_critical, NULL);
 	pthread_cond_init(&context->smtpidle_cond, NULL);
 
 	context->magic    = DC_CONTEXT_MAGIC;
@@ -127,7 +161,9 @@ dc_context_t* dc_context_new(dc_callback_t cb, void* userdata, const char* os_na
 
 	dc_pgp_init();
 	context->sql      = dc_sqlite3_new(context);
-	context->imap     = dc_imap_new(cb_get_config, cb_set_config, cb_receive_imf, (void*)context, context);
+	context->msgcache = dc_msgcache_new(context);
+	context->changelog= dc_changelog_new();
+	context->imap     = dc_imap_new(cb_get_config, cb_set_config, cb_get_location, cb_set_location, cb_set_locations, cb_parse_imf, cb_receive_imf, (void*)context, context);
 	context->smtp     = dc_smtp_new(context);
 
 	/* Random-seed.  An additional seed with more random data is done just before key generation
@@ -160,6 +196,9 @@ void dc_context_unref(dc_context_t* context)
 		return;
 	}
 
+	dc_scheduler_remove(context->scheduler, context);
+	dc_job_forget_context(context);
+
 	dc_pgp_exit();
 
 	if (dc_is_open(context)) {
@@ -168,16 +207,23 @@ void dc_context_unref(dc_context_t* context)
 
 	dc_imap_unref(context->imap);
 	dc_smtp_unref(context->smtp);
+	dc_msgcache_unref(context->msgcache);
+	dc_changelog_unref(context->changelog);
 	dc_sqlite3_unref(context->sql);
+	dc_mimeparser_free_pool(context);
 
 	dc_openssl_exit();
 
 	pthread_mutex_destroy(&context->smear_critical);
+	pthread_mutex_destroy(&context->peerstate_critical);
+	pthread_mutex_destroy(&context->blobdir_critical);
+	pthread_mutex_destroy(&context->mimeparser_pool_critical);
 	pthread_mutex_destroy(&context->bobs_qr_critical);
 	pthread_mutex_destroy(&context->log_ringbuf_critical);
 	pthread_mutex_destroy(&context->imapidle_condmutex);
 	pthread_cond_destroy(&context->smtpidle_cond);
 	pthread_mutex_destroy(&context->smtpidle_condmutex);
+	pthread_mutex_destroy(&context->jobstats_critical);
 
 	for (int i = 0; i < DC_LOG_RINGBUF_SIZE; i++) {
 		free(context->log_ringbuf[i]);
@@ -246,7 +292,7 @@ int dc_open(dc_context_t* context, const char* dbfile, const char* blobdir)
 	from which all configuration is read/written to. */
 
 	/* Create/open sqlite database */
-	if (!dc_sqlite3_open(context->sql, dbfile, 0)) {
+	if (!dc_sqlite3_open(context->sql, dbfile, DC_OPEN_WAL)) {
 		goto cleanup;
 	}
 
@@ -298,6 +344,9 @@ void dc_close(dc_context_t* context)
 		dc_sqlite3_close(context->sql);
 	}
 
+	dc_msgcache_clear(context->msgcache);
+	dc_changelog_reset(context->changelog);
+
 	free(context->dbfile);
 	context->dbfile = NULL;
 
@@ -467,6 +516,7 @@ char* dc_get_info(dc_context_t* context)
 	char*            l_readable_str = NULL;
 	char*            l2_readable_str = NULL;
 	char*            fingerprint_str = NULL;
+	char*            jobs_str = NULL;
 	dc_loginparam_t* l = NULL;
 	dc_loginparam_t* l2 = NULL;
 	int              contacts = 0;
@@ -530,6 +580,8 @@ char* dc_get_info(dc_context_t* context)
 	l_readable_str = dc_loginparam_get_readable(l);
 	l2_readable_str = dc_loginparam_get_readable(l2);
 
+	jobs_str = dc_job_get_stats(context);
+
 	/* create info
 	- some keys are display lower case - these can be changed using the `set`-command
 	- we do not display the password here; in the cli-utility, you can see it using `get mail_pw`
@@ -550,6 +602,9 @@ char* dc_get_info(dc_context_t* context)
 		"e2ee_enabled=%i\n"
 		"E2EE_DEFAULT_ENABLED=%i\n"
 		"Private keys=%i, public keys=%i, fingerprint=\n%s\n"
+		"IMAP traffic: %llu bytes payload, %llu bytes on the wire%s\n"
+		"IMAP IDLE: %.1f wakeups/hour, %.0f ms from new data to ingest\n"
+		"%s\n"
 		"\n"
 		"Using Delta Chat Core v%s, SQLite %s-ts%i, libEtPan %i.%i, OpenSSL %i.%i.%i%c. Compiled " __DATE__ ", " __TIME__ " for %i bit usage.\n\n"
 		"Log excerpt:\n"
@@ -567,6 +622,12 @@ char* dc_get_info(dc_context_t* context)
 		, e2ee_enabled
 		, DC_E2EE_DEFAULT_ENABLED
 		, prv_key_cnt, pub_key_cnt, fingerprint_str
+		, (unsigned long long)(context->imap->payload_count.bytes_read+context->imap->payload_count.bytes_written)
+		, (unsigned long long)(context->imap->wire_count.bytes_read+context->imap->wire_count.bytes_written)
+		, context->imap->compressed? ", compressed" : ""
+		, context->imap->idle_stats_since? (double)context->imap->idle_wakeups*3600.0/(double)(time(NULL)-context->imap->idle_stats_since+1) : 0.0
+		, context->imap->ingest_cnt? context->imap->ingest_ms/(double)context->imap->ingest_cnt : 0.0
+		, jobs_str
 
 		, DC_VERSION_STR
 		, SQLITE_VERSION, sqlite3_threadsafe()   ,  libetpan_get_version_major(), libetpan_get_version_minor()
@@ -599,6 +660,7 @@ char* dc_get_info(dc_context_t* context)
 	free(l_readable_str);
 	free(l2_readable_str);
 	free(fingerprint_str);
+	free(jobs_str);
 	dc_key_unref(self_public);
 	return ret.buf; /* must be freed by the caller */
 }
@@ -630,7 +692,7 @@ dc_array_t* dc_get_fresh_msgs(dc_context_t* context)
 
 	show_deaddrop = 0;//dc_sqlite3_get_config_int(context->sql, "show_deaddrop", 0);
 
-	stmt = dc_sqlite3_prepare(context->sql,
+	stmt = dc_sqlite3_prepare_read(context->sql,
 		"SELECT m.id"
 			" FROM msgs m"
 			" LEFT JOIN contacts ct ON m.from_id=ct.id"
@@ -709,7 +771,7 @@ dc_array_t* dc_search_msgs(dc_context_t* context, uint32_t chat_id, const char*
 	this must be updated all the time and probably consumes more time than we can save in tenthousands of searches.
 	For now, we just expect the following query to be fast enough :-) */
 	if (chat_id) {
-		stmt = dc_sqlite3_prepare(context->sql,
+		stmt = dc_sqlite3_prepare_read(context->sql,
 			"SELECT m.id, m.timestamp FROM msgs m"
 			" LEFT JOIN contacts ct ON m.from_id=ct.id"
 			" WHERE m.chat_id=? "
@@ -722,7 +784,7 @@ dc_array_t* dc_search_msgs(dc_context_t* context, uint32_t chat_id, const char*
 	}
 	else {
 		int show_deaddrop = 0;//dc_sqlite3_get_config_int(context->sql, "show_deaddrop", 0);
-		stmt = dc_sqlite3_prepare(context->sql,
+		stmt = dc_sqlite3_prepare_read(context->sql,
 			"SELECT m.id, m.timestamp FROM msgs m"
 			" LEFT JOIN contacts ct ON m.from_id=ct.id"
 			" LEFT JOIN chats c ON m.chat_id=c.id"
@@ -45,6 +45,8 @@ extern "C" {
 #include "dc_lot.h"
 #include "dc_msg.h"
 #include "dc_contact.h"
+#include "dc_msgcache.h"
+#include "dc_changelog.h"
 
 
 typedef struct dc_imap_t       dc_imap_t;
@@ -68,6 +70,8 @@ struct _dc_context
 	char*            blobdir;               /**< Full path of the blob directory. This is the directory given to dc_context_new() or a directory in the same directory as dc_context_t::dbfile. */
 
 	dc_sqlite3_t*    sql;                   /**< Internal SQL object, never NULL */
+	dc_msgcache_t*   msgcache;              /**< Internal. Snapshots of recently loaded messages, never NULL */
+	dc_changelog_t*  changelog;             /**< Internal. IDs of changed messages and chats, never NULL */
 
 	dc_imap_t*       imap;                  /**< Internal IMAP object, never NULL */
 	pthread_mutex_t  imapidle_condmutex;
@@ -80,7 +84,6 @@ struct _dc_context
 	int              smtpidle_suspend;
 	int              smtpidle_in_idleing;
 	#define          DC_JOBS_NEEDED_AT_ONCE   1
-	#define          DC_JOBS_NEEDED_AVOID_DOS 2
 	int              perform_smtp_jobs_needed;
 
 	dc_callback_t    cb;                    /**< Internal */
@@ -113,9 +116,31 @@ struct _dc_context
 	time_t           last_smeared_timestamp;
 	pthread_mutex_t  smear_critical;
 
+	// incoming messages are parsed and decrypted in parallel, see dc_receive_imf_parse();
+	// these locks protect the few things the parsers share
+	pthread_mutex_t  peerstate_critical;    /**< Internal. Held while a peerstate is loaded, modified and saved on receiving */
+	pthread_mutex_t  blobdir_critical;      /**< Internal. Held while a free name in the blobdir is searched and the file is created */
+
+	// parsers, with their arenas, are reused for the next messages instead of being freed, see dc_receive_imf_parse();
+	// they are handed from the parsing threads to the receiving thread, so the pool is shared by all of them
+	#define          DC_MIMEPARSER_POOL_MAX  4
+	dc_mimeparser_t* mimeparser_pool[DC_MIMEPARSER_POOL_MAX];
+	int              mimeparser_pool_cnt;
+	pthread_mutex_t  mimeparser_pool_critical;
+
+	// job statistics, see dc_job_get_stats()
+	pthread_mutex_t  jobstats_critical;
+	int              jobs_done;
+	int              jobs_retried;
+	int              jobs_failed;
+	int              jobs_cancelled;
+	double           jobs_latency_sec;      /**< Internal. Sum of the seconds from adding to finishing the done jobs */
+
 	// handling ongoing processes initiated by the user
 	int              ongoing_running;
 	int              shall_stop_ongoing;
+
+	dc_scheduler_t*  scheduler;             /**< Internal. Set if the context is added to a scheduler, see dc_scheduler_add() */
 };
 
 void            dc_log_error         (dc_context_t*, int code, const char* msg, ...);
@@ -123,6 +148,8 @@ void            dc_log_error_if      (int* condition, dc_context_t*, int code, c
 void            dc_log_warning       (dc_context_t*, int code, const char* msg, ...);
 void            dc_log_info          (dc_context_t*, int code, const char* msg, ...);
 void            dc_receive_imf                             (dc_context_t*, const char* imf_raw_not_terminated, size_t imf_raw_bytes, const char* server_folder, uint32_t server_uid, uint32_t flags);
+dc_mimeparser_t* dc_receive_imf_parse                      (dc_context_t*, const char* imf_raw_not_terminated, size_t imf_raw_bytes); /* may be called from any thread */
+void            dc_receive_imf_parsed                      (dc_context_t*, dc_mimeparser_t*, const char* imf_raw_not_terminated, size_t imf_raw_bytes, const char* server_folder, uint32_t server_uid, uint32_t flags); /* takes the ownership of the parser, which may be NULL */
 
 #define         DC_BAK_PREFIX                "delta-chat"
 #define         DC_BAK_SUFFIX                "bak"
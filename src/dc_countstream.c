@@ -0,0 +1,187 @@
+/*******************************************************************************
+ *
+ *                              Delta Chat Core
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ ******************************************************************************/
+
+
+
+#include "dc_context.h"
+#include "dc_countstream.h"
+
+
+/* A mailstream layer that passes all calls to the layer below
+and counts the bytes read and written. As done by the layers of libEtPan,
+the layer below is called directly and not using mailstream_low_read() etc.
+to avoid logging the data twice. */
+
+
+typedef struct countstream_data_t
+{
+	mailstream_low*   inner;
+	dc_streamcount_t* count;
+} countstream_data_t;
+
+
+static ssize_t countstream_read(mailstream_low* s, void* buf, size_t count)
+{
+	countstream_data_t* data = (countstream_data_t*)s->data;
+	ssize_t ret = data->inner->driver->mailstream_read(data->inner, buf, count);
+	if (ret > 0) {
+		data->count->bytes_read += ret;
+	}
+	return ret;
+}
+
+
+static ssize_t countstream_write(mailstream_low* s, const void* buf, size_t count)
+{
+	countstream_data_t* data = (countstream_data_t*)s->data;
+	ssize_t ret = data->inner->driver->mailstream_write(data->inner, buf, count);
+	if (ret > 0) {
+		data->count->bytes_written += ret;
+	}
+	return ret;
+}
+
+
+static int countstream_close(mailstream_low* s)
+{
+	return mailstream_low_close(((countstream_data_t*)s->data)->inner);
+}
+
+
+static int countstream_get_fd(mailstream_low* s)
+{
+	return mailstream_low_get_fd(((countstream_data_t*)s->data)->inner);
+}
+
+
+static void countstream_free(mailstream_low* s)
+{
+	mailstream_low_free(dc_countstream_detach(s));
+}
+
+
+static void countstream_cancel(mailstream_low* s)
+{
+	mailstream_low_cancel(((countstream_data_t*)s->data)->inner);
+}
+
+
+static struct mailstream_cancel* countstream_get_cancel(mailstream_low* s)
+{
+	return mailstream_low_get_cancel(((countstream_data_t*)s->data)->inner);
+}
+
+
+static carray* countstream_get_certificate_chain(mailstream_low* s)
+{
+	return mailstream_low_get_certificate_chain(((countstream_data_t*)s->data)->inner);
+}
+
+
+static int countstream_setup_idle(mailstream_low* s)
+{
+	return mailstream_low_setup_idle(((countstream_data_t*)s->data)->inner);
+}
+
+
+static int countstream_unsetup_idle(mailstream_low* s)
+{
+	return mailstream_low_unsetup_idle(((countstream_data_t*)s->data)->inner);
+}
+
+
+static int countstream_interrupt_idle(mailstream_low* s)
+{
+	return mailstream_low_interrupt_idle(((countstream_data_t*)s->data)->inner);
+}
+
+
+static mailstream_low_driver countstream_driver = {
+	countstream_read,
+	countstream_write,
+	countstream_close,
+	countstream_get_fd,
+	countstream_free,
+	countstream_cancel,
+	countstream_get_cancel,
+	countstream_get_certificate_chain,
+	countstream_setup_idle,
+	countstream_unsetup_idle,
+	countstream_interrupt_idle
+};
+
+
+/**
+ * Put a counting layer on top of the given mailstream layer.
+ * Use mailstream_set_low() to make the returned layer the lowest one
+ * of a mailstream.
+ *
+ * @private @memberof dc_streamcount_t
+ * @param inner The layer to put the counting layer on.
+ *     On success, the inner layer is closed and freed together with the counting layer.
+ * @param count The counters to increase; must be valid as long as the layer is used.
+ * @return The counting layer; NULL if no inner layer or counters are given.
+ */
+mailstream_low* dc_countstream_open(mailstream_low* inner, dc_streamcount_t* count)
+{
+	countstream_data_t* data = NULL;
+	mailstream_low*     s = NULL;
+
+	if (inner==NULL || count==NULL) {
+		return NULL;
+	}
+
+	if ((data=calloc(1, sizeof(countstream_data_t)))==NULL) {
+		exit(64);
+	}
+	data->inner = inner;
+	data->count = count;
+
+	if ((s=mailstream_low_new(data, &countstream_driver))==NULL) {
+		exit(64);
+	}
+
+	mailstream_low_set_timeout(s, mailstream_low_get_timeout(inner));
+	return s;
+}
+
+
+/**
+ * Remove a counting layer without closing the layer below,
+ * eg. to put another layer between them.
+ *
+ * @private @memberof dc_streamcount_t
+ * @param s The counting layer as returned by dc_countstream_open(); the layer is freed.
+ * @return The inner layer, NULL if the given layer is no counting layer.
+ */
+mailstream_low* dc_countstream_detach(mailstream_low* s)
+{
+	mailstream_low* inner = NULL;
+
+	if (s==NULL || s->driver!=&countstream_driver) {
+		return NULL;
+	}
+
+	inner = ((countstream_data_t*)s->data)->inner;
+	free(s->data);
+	free(s->identifier);
+	free(s);
+	return inner;
+}
@@ -0,0 +1,55 @@
+/*******************************************************************************
+ *
+ *                              Delta Chat Core
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ ******************************************************************************/
+
+
+
+#ifndef __DC_COUNTSTREAM_H__
+#define __DC_COUNTSTREAM_H__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <libetpan/libetpan.h>
+
+
+/**
+ * Library-internal.
+ *
+ * Number of bytes passed through a counting stream layer.
+ * A counting layer on top of the socket resp. SSL layer counts the bytes on the wire,
+ * a counting layer on top of a compression layer counts the uncompressed payload.
+ */
+typedef struct dc_streamcount_t
+{
+	/** @privatesection */
+	uint64_t bytes_read;
+	uint64_t bytes_written;
+} dc_streamcount_t;
+
+
+mailstream_low* dc_countstream_open    (mailstream_low* inner, dc_streamcount_t*); /* on success, the returned layer owns the inner one */
+mailstream_low* dc_countstream_detach  (mailstream_low*); /* frees the counting layer only and returns the inner one */
+
+
+#ifdef __cplusplus
+} /* /extern "C" */
+#endif
+#endif /* __DC_COUNTSTREAM_H__ */
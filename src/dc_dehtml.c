@@ -22,6 +22,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include "dc_context.h"
 #include "dc_dehtml.h"
 #include "dc_saxparser.h"
@@ -41,9 +42,23 @@ typedef struct dehtml_t
 
     char*           last_href;
 
+    size_t          max_bytes; /* 0=no limit */
+    int             truncated;
+    dc_saxparser_t* saxparser;
+
 } dehtml_t;
 
 
+static void check_max_bytes(dehtml_t* dehtml)
+{
+	if (dehtml->max_bytes
+	 && (size_t)(dehtml->strbuilder.eos - dehtml->strbuilder.buf) >= dehtml->max_bytes) {
+		dehtml->truncated = 1;
+		dc_saxparser_stop(dehtml->saxparser); /* we have enough text, skip the rest of the document */
+	}
+}
+
+
 static void dehtml_starttag_cb(void* userdata, const char* tag, char** attr)
 {
 	dehtml_t* dehtml = (dehtml_t*)userdata;
@@ -83,6 +98,8 @@ static void dehtml_starttag_cb(void* userdata, const char* tag, char** attr)
 	{
 		dc_strbuilder_cat(&dehtml->strbuilder, "_");
 	}
+
+	check_max_bytes(dehtml);
 }
 
 
@@ -118,6 +135,8 @@ static void dehtml_text_cb(void* userdata, const char* text, int len)
 				p++;
 			}
 		}
+
+		check_max_bytes(dehtml);
 	}
 }
 
@@ -151,31 +170,88 @@ static void dehtml_endtag_cb(void* userdata, const char* tag)
 	{
 		dc_strbuilder_cat(&dehtml->strbuilder, "_");
 	}
+
+	check_max_bytes(dehtml);
 }
 
 
-char* dc_dehtml(char* buf_terminated)
+/**
+ * Convert HTML to text.  The HTML is passed to the parser in chunks, so
+ * beside the returned text, only a chunk and possibly an unclosed tag are
+ * buffered.
+ *
+ * @private
+ * @param html_unterminated The HTML, need not to be null-terminated.
+ * @param html_bytes The number of bytes in html_unterminated.
+ * @param max_bytes Stop converting if the text has at least this size;
+ *     the returned text may be a little larger.  0 for no limit.
+ * @param[out] ret_truncated Set to 1 if converting was stopped because of max_bytes,
+ *     otherwise set to 0.  May be NULL.
+ * @return The text, must be free()'d.  dc_dehtml_n() returns way too many
+ *     lineends; however, they're typically removed in further processing by the caller.
+ */
+char* dc_dehtml_n(const char* html_unterminated, size_t html_bytes, size_t max_bytes, int* ret_truncated)
 {
-	dc_trim(buf_terminated);
-	if (buf_terminated[0]==0) {
+	const char*    nullbyte = NULL;
+	size_t         offset = 0;
+	dehtml_t       dehtml;
+	dc_saxparser_t saxparser;
+
+	if (ret_truncated) {
+		*ret_truncated = 0;
+	}
+
+	if (html_unterminated==NULL) {
+		return dc_strdup("");
+	}
+
+	/* the text ends at the first null-byte; leading and trailing whitespace is skipped as dc_trim() would do */
+	if ((nullbyte=memchr(html_unterminated, 0, html_bytes))!=NULL) {
+		html_bytes = nullbyte - html_unterminated;
+	}
+
+	while (html_bytes > 0 && isspace((unsigned char)html_unterminated[0])) {
+		html_unterminated++;
+		html_bytes--;
+	}
+
+	while (html_bytes > 0 && isspace((unsigned char)html_unterminated[html_bytes-1])) {
+		html_bytes--;
+	}
+
+	if (html_bytes==0) {
 		return dc_strdup(""); /* support at least empty HTML-messages; for empty messages, we'll replace the message by the subject later */
 	}
-	else {
-		dehtml_t       dehtml;
-		dc_saxparser_t saxparser;
 
-		memset(&dehtml, 0, sizeof(dehtml_t));
-		dehtml.add_text   = DO_ADD_REMOVE_LINEENDS;
-		dc_strbuilder_init(&dehtml.strbuilder, strlen(buf_terminated));
+	memset(&dehtml, 0, sizeof(dehtml_t));
+	dehtml.add_text  = DO_ADD_REMOVE_LINEENDS;
+	dehtml.max_bytes = max_bytes;
+	dehtml.saxparser = &saxparser;
+	dc_strbuilder_init(&dehtml.strbuilder, (max_bytes && max_bytes < html_bytes)? max_bytes : html_bytes);
 
-		dc_saxparser_init(&saxparser, &dehtml);
-		dc_saxparser_set_tag_handler(&saxparser, dehtml_starttag_cb, dehtml_endtag_cb);
-		dc_saxparser_set_text_handler(&saxparser, dehtml_text_cb);
-		dc_saxparser_parse(&saxparser, buf_terminated);
+	dc_saxparser_init(&saxparser, &dehtml);
+	dc_saxparser_set_tag_handler(&saxparser, dehtml_starttag_cb, dehtml_endtag_cb);
+	dc_saxparser_set_text_handler(&saxparser, dehtml_text_cb);
+	while (offset < html_bytes && !dehtml.truncated) {
+		size_t chunk_bytes = html_bytes - offset;
+		if (chunk_bytes > DC_DEHTML_CHUNK_BYTES) {
+			chunk_bytes = DC_DEHTML_CHUNK_BYTES;
+		}
+		dc_saxparser_feed(&saxparser, html_unterminated + offset, chunk_bytes);
+		offset += chunk_bytes;
+	}
+	dc_saxparser_finish(&saxparser);
 
-		free(dehtml.last_href);
-		return dehtml.strbuilder.buf;
+	if (ret_truncated) {
+		*ret_truncated = dehtml.truncated;
 	}
+
+	free(dehtml.last_href);
+	return dehtml.strbuilder.buf;
 }
 
 
+char* dc_dehtml(char* buf_terminated)
+{
+	return dc_dehtml_n(buf_terminated, buf_terminated? strlen(buf_terminated) : 0, 0, NULL);
+}
@@ -29,7 +29,10 @@ extern "C" {
 
 /*** library-internal *********************************************************/
 
+#define DC_DEHTML_CHUNK_BYTES 16384
+
 char* dc_dehtml(char* buf_terminated); /* dc_dehtml() returns way too many lineends; however, an optimisation on this issue is not needed as the lineends are typically remove in further processing by the caller */
+char* dc_dehtml_n(const char* html_unterminated, size_t html_bytes, size_t max_bytes, int* ret_truncated);
 
 
 #ifdef __cplusplus
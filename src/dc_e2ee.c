@@ -752,14 +752,16 @@ static dc_hash_t* update_gossip_peerstates(dc_context_t* context, time_t message
 					{
 						/* valid recipient: update peerstate */
 						dc_apeerstate_t* peerstate = dc_apeerstate_new(context);
-						if (!dc_apeerstate_load_by_addr(peerstate, context->sql, gossip_header->addr)) {
-							dc_apeerstate_init_from_gossip(peerstate, gossip_header, message_time);
-							dc_apeerstate_save_to_db(peerstate, context->sql, 1/*create*/);
-						}
-						else {
-							dc_apeerstate_apply_gossip(peerstate, gossip_header, message_time);
-							dc_apeerstate_save_to_db(peerstate, context->sql, 0/*do not create*/);
-						}
+						pthread_mutex_lock(&context->peerstate_critical);
+							if (!dc_apeerstate_load_by_addr(peerstate, context->sql, gossip_header->addr)) {
+								dc_apeerstate_init_from_gossip(peerstate, gossip_header, message_time);
+								dc_apeerstate_save_to_db(peerstate, context->sql, 1/*create*/);
+							}
+							else {
+								dc_apeerstate_apply_gossip(peerstate, gossip_header, message_time);
+								dc_apeerstate_save_to_db(peerstate, context->sql, 0/*do not create*/);
+							}
+						pthread_mutex_unlock(&context->peerstate_critical);
 
 						if (peerstate->degrade_event) {
 							dc_handle_degrade_event(context, peerstate);
@@ -849,10 +851,11 @@ void dc_e2ee_decrypt(dc_context_t* context, struct mailmime* in_out_message,
 
 	/* modify the peerstate (eg. if there is a peer but not autocrypt header, stop encryption) */
 
-	/* apply Autocrypt:-header */
+	/* apply Autocrypt:-header; messages may be decrypted in parallel, so load-modify-save must not be interrupted */
 	if (message_time > 0
 	 && from)
 	{
+		pthread_mutex_lock(&context->peerstate_critical);
 		if (dc_apeerstate_load_by_addr(peerstate, context->sql, from)) {
 			if (autocryptheader) {
 				dc_apeerstate_apply_header(peerstate, autocryptheader, message_time);
@@ -870,6 +873,7 @@ void dc_e2ee_decrypt(dc_context_t* context, struct mailmime* in_out_message,
 			dc_apeerstate_init_from_header(peerstate, autocryptheader, message_time);
 			dc_apeerstate_save_to_db(peerstate, context->sql, 1/*create*/);
 		}
+		pthread_mutex_unlock(&context->peerstate_critical);
 	}
 
 	/* load private key for decryption */
@@ -0,0 +1,367 @@
+/*******************************************************************************
+ *
+ *                              Delta Chat Core
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ ******************************************************************************/
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>   /* for FICLONE */
+#endif
+#include "dc_context.h"
+#include "dc_filecopy.h"
+
+
+#define DC_COPY_CHUNK_BYTES (8*1024*1024) /* bytes per copy_file_range()/sendfile() call */
+#define DC_COPY_BUF_BYTES   (1024*1024)   /* buffer size if the kernel cannot copy for us */
+
+
+typedef struct copy_state_t
+{
+	int                fd_src;
+	int                fd_dest;
+	uint64_t           copied;
+	uint64_t           total;
+	dc_copy_progress_t progress;
+	void*              userdata;
+	int                cancelled;
+	int                error;     /* errno of the failed call, if any */
+} copy_state_t;
+
+
+static int report_progress(copy_state_t* s)
+{
+	if (s->progress && !s->progress(s->userdata, s->copied, s->total)) {
+		s->cancelled = 1;
+		return 0;
+	}
+	return 1;
+}
+
+
+/* The copy_*() functions return 1 if the end of the source is reached,
+0 if the method is not supported and the next one should be tried (the file offsets
+are at the position copied so far) and -1 on errors or if cancelled. */
+
+
+static int copy_reflink(copy_state_t* s)
+{
+	#ifdef FICLONE
+		/* FICLONE shares the data blocks on btrfs, xfs and others, nothing is copied at all.
+		This only works on a file that is not yet written. */
+		if (s->copied==0 && ioctl(s->fd_dest, FICLONE, s->fd_src)==0) {
+			if (lseek(s->fd_src, 0, SEEK_END)<0 || lseek(s->fd_dest, 0, SEEK_END)<0) {
+				s->error = errno;
+				return -1;
+			}
+			s->copied = s->total;
+			return report_progress(s)? 1 : -1;
+		}
+	#endif
+	return 0;
+}
+
+
+static int is_unsupported_error(int error)
+{
+	return (error==ENOSYS || error==EXDEV || error==EINVAL || error==EOPNOTSUPP
+	     || error==ENOTSUP || error==EBADF || error==EPERM);
+}
+
+
+static int copy_range(copy_state_t* s)
+{
+	#if defined(__linux__) && defined(__NR_copy_file_range)
+		/* copy_file_range() copies inside the kernel and may let the filesystem
+		or the server (NFS, CIFS) do the work */
+		while (1) {
+			ssize_t n = syscall(__NR_copy_file_range, s->fd_src, NULL, s->fd_dest, NULL, (size_t)DC_COPY_CHUNK_BYTES, 0);
+			if (n<0) {
+				if (errno==EINTR) {
+					continue;
+				}
+				if (is_unsupported_error(errno)) {
+					return 0;
+				}
+				s->error = errno;
+				return -1;
+			}
+			else if (n==0) {
+				/* some filesystems report 0 bytes instead of an error,
+				let the next method find out whether this really is the end */
+				return s->copied>=s->total? 1 : 0;
+			}
+
+			s->copied += n;
+			if (!report_progress(s)) {
+				return -1;
+			}
+		}
+	#endif
+	return 0;
+}
+
+
+static int copy_sendfile(copy_state_t* s)
+{
+	#ifdef __linux__
+		while (1) {
+			ssize_t n = sendfile(s->fd_dest, s->fd_src, NULL, DC_COPY_CHUNK_BYTES);
+			if (n<0) {
+				if (errno==EINTR) {
+					continue;
+				}
+				if (is_unsupported_error(errno)) {
+					return 0;
+				}
+				s->error = errno;
+				return -1;
+			}
+			else if (n==0) {
+				return s->copied>=s->total? 1 : 0;
+			}
+
+			s->copied += n;
+			if (!report_progress(s)) {
+				return -1;
+			}
+		}
+	#endif
+	return 0;
+}
+
+
+static int copy_buffered(copy_state_t* s)
+{
+	int     ret = -1;
+	char*   buf = NULL;
+	ssize_t bytes_read = 0;
+	ssize_t n = 0;
+	ssize_t written = 0;
+
+	if ((buf=malloc(DC_COPY_BUF_BYTES))==NULL) {
+		exit(61);
+	}
+
+	while (1)
+	{
+		if ((bytes_read=read(s->fd_src, buf, DC_COPY_BUF_BYTES)) < 0) {
+			if (errno==EINTR) {
+				continue;
+			}
+			s->error = errno;
+			goto cleanup;
+		}
+		else if (bytes_read==0) {
+			break;
+		}
+
+		/* write() may write less than requested, eg. if a signal arrives */
+		for (written = 0; written < bytes_read; written += n) {
+			if ((n=write(s->fd_dest, buf+written, bytes_read-written)) < 0) {
+				if (errno==EINTR) {
+					n = 0;
+					continue;
+				}
+				s->error = errno;
+				goto cleanup;
+			}
+			else if (n==0) {
+				s->error = ENOSPC;
+				goto cleanup;
+			}
+		}
+
+		s->copied += bytes_read;
+		if (!report_progress(s)) {
+			goto cleanup;
+		}
+	}
+
+	ret = 1;
+
+cleanup:
+	free(buf);
+	return ret;
+}
+
+
+static void sync_dir_of(const char* pathNfilename)
+{
+	/* make the rename() durable; errors are ignored as not all filesystems support this */
+	char* dir = dc_strdup(pathNfilename);
+	char* p = strrchr(dir, '/');
+	if (p) {
+		if (p==dir) {
+			p++;
+		}
+		*p = 0;
+
+		int fd = open(dir, O_RDONLY);
+		if (fd>=0) {
+			fsync(fd);
+			close(fd);
+		}
+	}
+	free(dir);
+}
+
+
+/**
+ * Copy a file.
+ *
+ * The data is written to a temporary file next to the destination
+ * which is renamed to the destination only after all data are copied and synced to disk,
+ * so the destination is either complete or does not exist.
+ *
+ * To copy, we try cloning the file first (FICLONE);
+ * if this is not supported, we let the kernel copy the data (copy_file_range(), sendfile())
+ * and only if this fails, we read and write the data using a large buffer.
+ *
+ * @private @memberof dc_context_t
+ * @param src Full path of the file to copy.
+ * @param dest Full path of the destination file.
+ *     Unless DC_COPY_OVERWRITE is given, the function fails if the destination exists.
+ * @param flags Combination of the DC_COPY_* flags, 0 for defaults.
+ * @param progress Called after each chunk copied. May be NULL.
+ * @param userdata Passed to the progress callback.
+ * @param log The context to log errors to. May be NULL.
+ * @return 1=success, 0=error or cancelled by the progress callback.
+ */
+int dc_copy_file_ex(const char* src, const char* dest, int flags, dc_copy_progress_t progress, void* userdata, dc_context_t* log/*may be NULL*/)
+{
+	int          success = 0;
+	char*        tmp_pathNfilename = NULL;
+	struct stat  st;
+	copy_state_t s;
+	int          ret = 0;
+	int          i = 0;
+
+	memset(&s, 0, sizeof(copy_state_t));
+	s.fd_src = -1;
+	s.fd_dest = -1;
+	s.progress = progress;
+	s.userdata = userdata;
+
+	if (src==NULL || dest==NULL) {
+		return 0;
+	}
+
+	if ((s.fd_src=open(src, O_RDONLY))<0 || fstat(s.fd_src, &st)!=0) {
+		dc_log_error(log, 0, "Cannot open source file \"%s\".", src);
+		goto cleanup;
+	}
+	s.total = (uint64_t)st.st_size;
+
+	if (!(flags&DC_COPY_OVERWRITE) && dc_file_exist(dest)) {
+		dc_log_error(log, 0, "Cannot copy to \"%s\": file exists.", dest);
+		goto cleanup;
+	}
+
+	for (i = 0; i < 100; i++) {
+		free(tmp_pathNfilename);
+		tmp_pathNfilename = dc_mprintf("%s.%i-%i.tmp", dest, (int)getpid(), i);
+		if ((s.fd_dest=open(tmp_pathNfilename, O_WRONLY|O_CREAT|O_EXCL, 0666))>=0 || errno!=EEXIST) {
+			break;
+		}
+	}
+
+	if (s.fd_dest<0) {
+		dc_log_error(log, 0, "Cannot open destination file \"%s\".", tmp_pathNfilename);
+		free(tmp_pathNfilename);
+		tmp_pathNfilename = NULL; /* not created by us, do not delete */
+		goto cleanup;
+	}
+
+	if (!(flags&DC_COPY_NO_REFLINK)) {
+		ret = copy_reflink(&s);
+	}
+
+	if (ret==0 && !(flags&DC_COPY_NO_KERNEL)) {
+		ret = copy_range(&s);
+		if (ret==0) {
+			ret = copy_sendfile(&s);
+		}
+	}
+
+	if (ret==0) {
+		ret = copy_buffered(&s);
+	}
+
+	if (ret!=1) {
+		if (!s.cancelled) {
+			dc_log_error(log, 0, "Cannot copy \"%s\" to \"%s\": %s", src, dest, strerror(s.error));
+		}
+		goto cleanup;
+	}
+
+	if (s.copied < s.total) {
+		dc_log_error(log, 0, "Different size information for \"%s\".", src);
+		goto cleanup;
+	}
+
+	if (fsync(s.fd_dest)!=0 || close(s.fd_dest)!=0) {
+		s.fd_dest = -1;
+		dc_log_error(log, 0, "Cannot write to \"%s\": %s", dest, strerror(errno));
+		goto cleanup;
+	}
+	s.fd_dest = -1;
+
+	if (flags&DC_COPY_OVERWRITE) {
+		if (rename(tmp_pathNfilename, dest)!=0) {
+			dc_log_error(log, 0, "Cannot rename \"%s\" to \"%s\".", tmp_pathNfilename, dest);
+			goto cleanup;
+		}
+	}
+	else {
+		/* link() fails atomically if the destination was created meanwhile;
+		filesystems without hard links (FAT on sd-cards) get the check above only */
+		if (link(tmp_pathNfilename, dest)==0) {
+			unlink(tmp_pathNfilename);
+		}
+		else if (errno==EEXIST || dc_file_exist(dest)) {
+			dc_log_error(log, 0, "Cannot copy to \"%s\": file exists.", dest);
+			goto cleanup;
+		}
+		else if (rename(tmp_pathNfilename, dest)!=0) {
+			dc_log_error(log, 0, "Cannot rename \"%s\" to \"%s\".", tmp_pathNfilename, dest);
+			goto cleanup;
+		}
+	}
+
+	free(tmp_pathNfilename);
+	tmp_pathNfilename = NULL;
+	sync_dir_of(dest);
+
+	success = 1;
+
+cleanup:
+	if (s.fd_src>=0) { close(s.fd_src); }
+	if (s.fd_dest>=0) { close(s.fd_dest); }
+	if (tmp_pathNfilename) {
+		unlink(tmp_pathNfilename);
+		free(tmp_pathNfilename);
+	}
+	return success;
+}
@@ -0,0 +1,49 @@
+/*******************************************************************************
+ *
+ *                              Delta Chat Core
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ ******************************************************************************/
+
+
+#ifndef __DC_FILECOPY_H__
+#define __DC_FILECOPY_H__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * Library-internal.
+ *
+ * Callback for dc_copy_file_ex(), called after each chunk copied.
+ * If the callback returns 0, the copy is cancelled and the destination is left untouched.
+ */
+typedef int (*dc_copy_progress_t) (void* userdata, uint64_t copied_bytes, uint64_t total_bytes);
+
+
+#define DC_COPY_OVERWRITE  0x01 /* replace an existing destination; default is to fail if the destination exists */
+#define DC_COPY_NO_REFLINK 0x02 /* do not try to clone the file, mainly for testing */
+#define DC_COPY_NO_KERNEL  0x04 /* do not use copy_file_range() or sendfile(), mainly for testing */
+
+
+int dc_copy_file_ex (const char* src, const char* dest, int flags, dc_copy_progress_t progress, void* userdata, dc_context_t* log);
+
+
+#ifdef __cplusplus
+} /* /extern "C" */
+#endif
+#endif /* __DC_FILECOPY_H__ */
@@ -82,324 +82,295 @@ static int sjhashStrNICmp(const char *zLeft, const char *zRight, int N)
 
 
 
-/* This function computes a hash on the name of a keyword.
- * Case is not significant.
+/* The elements are looked up by masking the hash with the table size,
+ * so all bits of the input should affect the low bits of the hash.
+ * This is the 64 bit finalizer of MurmurHash3.
  */
-static int sjhashNoCase(const char *z, int n)
+static unsigned int hashMix(uint64_t h)
 {
-	int h = 0;
-	if (n<=0) n = strlen(z);
-	while (n > 0) {
-		h = (h<<3) ^ h ^ sjhashUpperToLower[(unsigned char)*z++];
-		n--;
-	}
-	return h & 0x7fffffff;
-}
-
-
-
-/* Turn bulk memory into a hash table object by initializing the
- * fields of the Hash structure.
- *
- * "pNew" is a pointer to the hash table that is to be initialized.
- * keyClass is one of the constants SJHASH_INT, SJHASH_POINTER,
- * SJHASH_BINARY, or SJHASH_STRING.  The value of keyClass
- * determines what kind of key the hash table will use.  "copyKey" is
- * true if the hash table should make its own private copy of keys and
- * false if it should just use the supplied pointer.  CopyKey only makes
- * sense for SJHASH_STRING and SJHASH_BINARY and is ignored
- * for other key classes.
- */
-void dc_hash_init(dc_hash_t *pNew, int keyClass, int copyKey)
-{
-	assert( pNew!=0);
-	assert( keyClass>=DC_HASH_INT && keyClass<=DC_HASH_BINARY);
-	pNew->keyClass = keyClass;
-
-	if (keyClass==DC_HASH_POINTER || keyClass==DC_HASH_INT) copyKey = 0;
-
-	pNew->copyKey = copyKey;
-	pNew->first = 0;
-	pNew->count = 0;
-	pNew->htsize = 0;
-	pNew->ht = 0;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return (unsigned int)h;
 }
 
 
 
-/* Remove all entries from a hash table.  Reclaim all memory.
- * Call this routine to delete a hash table or to reset a hash table
- * to the empty state.
+/* Strings and binary data are hashed 8 bytes at a time.  For strings, case
+ * is not significant; setting bit 5 of every byte maps upper-case characters to
+ * lower-case ones.  This also maps some other characters onto each other,
+ * which only costs a comparison on lookup.
  */
-void dc_hash_clear(dc_hash_t *pH)
+static unsigned int wordHash(const unsigned char *z, int nKey, uint64_t fold)
 {
-	dc_hashelem_t *elem;         /* For looping over all elements of the table */
-
-	if (pH == NULL) {
-		return;
+	uint64_t h = (uint64_t)nKey, w;
+	while (nKey >= 8)
+	{
+		memcpy(&w, z, 8);
+		h = (h ^ (w|fold)) * 0x9e3779b97f4a7c15ULL;
+		h ^= h >> 32;
+		z += 8;
+		nKey -= 8;
 	}
-
-	elem = pH->first;
-	pH->first = 0;
-	if (pH->ht) sjhashFree(pH->ht);
-	pH->ht = 0;
-	pH->htsize = 0;
-	while (elem)
+	if (nKey > 0)
 	{
-		dc_hashelem_t *next_elem = elem->next;
-		if (pH->copyKey && elem->pKey)
-		{
-			sjhashFree(elem->pKey);
-		}
-		sjhashFree(elem);
-		elem = next_elem;
+		w = 0;
+		memcpy(&w, z, nKey);
+		h = (h ^ (w|fold)) * 0x9e3779b97f4a7c15ULL;
 	}
-	pH->count = 0;
+	return hashMix(h);
 }
 
 
 
-/* Hash and comparison functions when the mode is SJHASH_INT
+/* Hash functions for the different key classes.
  */
-static int intHash(const void *pKey, int nKey)
-{
-	return nKey ^ (nKey<<8) ^ (nKey>>8);
-}
-
-static int intCompare(const void *pKey1, int n1, const void *pKey2, int n2)
+static unsigned int intHash(const void *pKey, int nKey)
 {
-	return n2 - n1;
+	return hashMix((uint64_t)(unsigned int)nKey);
 }
 
-
-
-/* Hash and comparison functions when the mode is SJHASH_POINTER
- */
-static int ptrHash(const void *pKey, int nKey)
+static unsigned int ptrHash(const void *pKey, int nKey)
 {
-	uintptr_t x = Addr(pKey);
-	return x ^ (x<<8) ^ (x>>8);
+	return hashMix((uint64_t)Addr(pKey));
 }
 
-static int ptrCompare(const void *pKey1, int n1, const void *pKey2, int n2)
+static unsigned int strHash(const void *pKey, int nKey)
 {
-	if (pKey1==pKey2) return 0;
-	if (pKey1<pKey2) return -1;
-	return 1;
+	if (nKey<=0) nKey = strlen((const char*)pKey);
+	return wordHash((const unsigned char*)pKey, nKey, 0x2020202020202020ULL);
 }
 
-
-
-/* Hash and comparison functions when the mode is SJHASH_STRING
- */
-static int strHash(const void *pKey, int nKey)
+static unsigned int binHash(const void *pKey, int nKey)
 {
-	return sjhashNoCase((const char*)pKey, nKey);
+	return wordHash((const unsigned char*)pKey, nKey, 0);
 }
 
-static int strCompare(const void *pKey1, int n1, const void *pKey2, int n2)
+static unsigned int keyHash(int keyClass, const void *pKey, int nKey)
 {
-	if (n1!=n2) return 1;
-	return sjhashStrNICmp((const char*)pKey1,(const char*)pKey2,n1);
+	switch (keyClass)
+	{
+		case DC_HASH_INT:     return intHash(pKey, nKey);
+		case DC_HASH_POINTER: return ptrHash(pKey, nKey);
+		case DC_HASH_STRING:  return strHash(pKey, nKey);
+		default:              return binHash(pKey, nKey);
+	}
 }
 
 
 
-/* Hash and comparison functions when the mode is SJHASH_BINARY
+/* Return 1 if the key of the given element matches pKey,nKey.
  */
-static int binHash(const void *pKey, int nKey)
+static int keyEquals(int keyClass, const dc_hashelem_t *elem, const void *pKey, int nKey)
 {
-	int h = 0;
-	const char *z = (const char *)pKey;
-	while (nKey-- > 0)
+	switch (keyClass)
 	{
-		h = (h<<3) ^ h ^ *(z++);
+		case DC_HASH_INT:     return elem->nKey==nKey;
+		case DC_HASH_POINTER: return elem->pKey==pKey;
+		case DC_HASH_STRING:  return elem->nKey==nKey && sjhashStrNICmp((const char*)elem->pKey, (const char*)pKey, nKey)==0;
+		default:              return elem->nKey==nKey && memcmp(elem->pKey, pKey, nKey)==0;
 	}
-	return h & 0x7fffffff;
 }
 
-static int binCompare(const void *pKey1, int n1, const void *pKey2, int n2)
-{
-	if (n1!=n2) return 1;
-	return memcmp(pKey1,pKey2,n1);
-}
 
 
-
-/* Return a pointer to the appropriate hash function given the key class.
+/* Turn bulk memory into a hash table object by initializing the
+ * fields of the Hash structure.
  *
- * About the syntax:
- * The name of the function is "hashFunction".  The function takes a
- * single parameter "keyClass".  The return value of hashFunction()
- * is a pointer to another function.  Specifically, the return value
- * of hashFunction() is a pointer to a function that takes two parameters
- * with types "const void*" and "int" and returns an "int".
+ * "pNew" is a pointer to the hash table that is to be initialized.
+ * keyClass is one of the constants DC_HASH_INT, DC_HASH_POINTER,
+ * DC_HASH_BINARY, or DC_HASH_STRING.  The value of keyClass
+ * determines what kind of key the hash table will use.  "copyKey" is
+ * true if the hash table should make its own private copy of keys and
+ * false if it should just use the supplied pointer.  CopyKey only makes
+ * sense for DC_HASH_STRING and DC_HASH_BINARY and is ignored
+ * for other key classes.
  */
-static int (*hashFunction(int keyClass))(const void*,int)
+void dc_hash_init(dc_hash_t *pNew, int keyClass, int copyKey)
 {
-	switch (keyClass)
-	{
-		case DC_HASH_INT:    return &intHash;
-		case DC_HASH_POINTER:return &ptrHash;
-		case DC_HASH_STRING: return &strHash;
-		case DC_HASH_BINARY: return &binHash;;
-		default:            break;
-	}
-	return 0;
+	assert( pNew!=0);
+	assert( keyClass>=DC_HASH_INT && keyClass<=DC_HASH_BINARY);
+	pNew->keyClass = keyClass;
+
+	if (keyClass==DC_HASH_POINTER || keyClass==DC_HASH_INT) copyKey = 0;
+
+	pNew->copyKey = copyKey;
+	pNew->count = 0;
+	pNew->elemCnt = 0;
+	pNew->elemMax = 0;
+	pNew->elem = 0;
+	pNew->htsize = 0;
+	pNew->ht = 0;
 }
 
 
 
-/* Return a pointer to the appropriate hash function given the key class.
+/* Remove all entries from a hash table.  Reclaim all memory.
+ * Call this routine to delete a hash table or to reset a hash table
+ * to the empty state.
  */
-static int (*compareFunction(int keyClass))(const void*,int,const void*,int)
+void dc_hash_clear(dc_hash_t *pH)
 {
-	switch (keyClass)
+	int i;
+
+	if (pH == NULL) {
+		return;
+	}
+
+	for (i = 0; i < pH->elemCnt; i++)
 	{
-		case DC_HASH_INT:     return &intCompare;
-		case DC_HASH_POINTER: return &ptrCompare;
-		case DC_HASH_STRING:  return &strCompare;
-		case DC_HASH_BINARY:  return &binCompare;
-		default: break;
+		dc_hashelem_t *elem = &pH->elem[i];
+		if (elem->data && pH->copyKey && elem->pKey && !(elem->flags&DC_HASHELEM_INLINE))
+		{
+			sjhashFree(elem->pKey);
+		}
 	}
-	return 0;
+
+	if (pH->elem) sjhashFree(pH->elem);
+	if (pH->ht) sjhashFree(pH->ht);
+	pH->elem = 0;
+	pH->ht = 0;
+	pH->elemCnt = 0;
+	pH->elemMax = 0;
+	pH->htsize = 0;
+	pH->count = 0;
 }
 
 
 
-/* Link an element into the hash table
+/* Return the given element or, if it was removed, the next element
+ * that is still in use.  Returns NULL at the end of the elements.
+ * Used by dc_hash_first() and dc_hash_next().
  */
-static void insertElement(dc_hash_t *pH,           /* The complete hash table */
-                          struct _ht *pEntry,   /* The entry into which pNew is inserted */
-                          dc_hashelem_t *pNew)     /* The element to be inserted */
+dc_hashelem_t* dc_hash_skip_removed(dc_hashelem_t *elem)
 {
-	dc_hashelem_t *pHead; /* First element already in pEntry */
-	pHead = pEntry->chain;
-	if (pHead)
+	while (elem->data==0)
 	{
-		pNew->next = pHead;
-		pNew->prev = pHead->prev;
-		if (pHead->prev) { pHead->prev->next = pNew; }
-		else             { pH->first = pNew; }
-		pHead->prev = pNew;
+		if (elem->flags&DC_HASHELEM_END) return 0;
+		elem++;
 	}
-	else
-	{
-		pNew->next = pH->first;
-		if (pH->first) { pH->first->prev = pNew; }
-		pNew->prev = 0;
-		pH->first = pNew;
-	}
-	pEntry->count++;
-	pEntry->chain = pNew;
+	return elem;
 }
 
 
 
-/* Resize the hash table so that it cantains "new_size" buckets.
- * "new_size" must be a power of 2.  The hash table might fail
- * to resize if sjhashMalloc() fails.
+/* Return the slot in the hash table that refers to the element with
+ * the given key, or the empty slot where such an element would be added.
  */
-static void rehash(dc_hash_t *pH, int new_size)
+static int findSlot(const dc_hash_t *pH, const void *pKey, int nKey, unsigned int h)
 {
-	struct _ht *new_ht;            /* The new hash table */
-	dc_hashelem_t *elem, *next_elem;    /* For looping over existing elements */
-	int (*xHash)(const void*,int); /* The hash function */
-
-	assert( (new_size & (new_size-1))==0);
-	new_ht = (struct _ht *)sjhashMalloc( new_size*sizeof(struct _ht));
-	if (new_ht==0) return;
-	if (pH->ht) sjhashFree(pH->ht);
-	pH->ht = new_ht;
-	pH->htsize = new_size;
-	xHash = hashFunction(pH->keyClass);
-	for(elem=pH->first, pH->first=0; elem; elem = next_elem)
+	int mask = pH->htsize-1;
+	int slot = h & mask;
+	while (pH->ht[slot])
 	{
-		int h = (*xHash)(elem->pKey, elem->nKey) & (new_size-1);
-		next_elem = elem->next;
-		insertElement(pH, &new_ht[h], elem);
+		const dc_hashelem_t *elem = &pH->elem[pH->ht[slot]-1];
+		if (elem->hash==h && keyEquals(pH->keyClass, elem, pKey, nKey))
+		{
+			return slot;
+		}
+		slot = (slot+1) & mask;
 	}
+	return slot;
 }
 
 
 
-/* This function (for internal use only) locates an element in an
- * hash table that matches the given key.  The hash for this key has
- * already been computed and is passed as the 4th parameter.
+/* Remove a slot from the hash table.  As linear probing is used, the
+ * following slots are shifted back where possible so that no lookup
+ * stops early at the emptied slot.
  */
-static dc_hashelem_t *findElementGivenHash(const dc_hash_t *pH,   /* The pH to be searched */
-                                        const void *pKey,   /* The key we are searching for */
-                                        int nKey,
-                                        int h)              /* The hash for this key. */
+static void removeSlot(dc_hash_t *pH, int slot)
 {
-	dc_hashelem_t *elem; /* Used to loop thru the element list */
-	int count; /* Number of elements left to test */
-	int (*xCompare)(const void*,int,const void*,int);  /* comparison function */
-
-	if (pH->ht)
+	int mask = pH->htsize-1;
+	int next = (slot+1) & mask;
+	while (pH->ht[next])
 	{
-		struct _ht *pEntry = &pH->ht[h];
-		elem = pEntry->chain;
-		count = pEntry->count;
-		xCompare = compareFunction(pH->keyClass);
-		while (count-- && elem)
+		int home = pH->elem[pH->ht[next]-1].hash & mask;
+		if (((next-home)&mask) >= ((next-slot)&mask))
 		{
-			if ((*xCompare)(elem->pKey,elem->nKey,pKey,nKey)==0)
-			{
-				return elem;
-			}
-			elem = elem->next;
+			pH->ht[slot] = pH->ht[next];
+			slot = next;
 		}
+		next = (next+1) & mask;
 	}
-	return 0;
+	pH->ht[slot] = 0;
 }
 
 
 
-/* Remove a single entry from the hash table given a pointer to that
- * element and a hash on the element's key.
+/* Make room for at least one more element.  If many elements were
+ * removed, the holes are reclaimed; otherwise the element array and the
+ * hash table double in size.  The hash table is always rebuilt; it has
+ * at least twice as many slots as there are elements.  Returns 0 if
+ * sjhashMalloc() fails; the table is unchanged in this case.
  */
-static void removeElementGivenHash(dc_hash_t *pH,         /* The pH containing "elem" */
-                                   dc_hashelem_t* elem,   /* The element to be removed from the pH */
-                                   int h)              /* Hash value for the element */
+static int growTable(dc_hash_t *pH)
 {
-	struct _ht *pEntry;
+	int            i, j;
+	int            new_max = pH->elemMax;
+	dc_hashelem_t  *new_elem = pH->elem;
+	int            *new_ht;
+	int            mask;
 
-	if (elem->prev)
-	{
-		elem->prev->next = elem->next;
-	}
-	else
+	if (pH->elemMax==0)
 	{
-		pH->first = elem->next;
+		new_max = 8;
 	}
-
-	if (elem->next)
+	else if (pH->count > pH->elemMax/2)
 	{
-		elem->next->prev = elem->prev;
+		new_max = pH->elemMax*2;
 	}
 
-	pEntry = &pH->ht[h];
+	new_ht = (int*)sjhashMalloc(new_max*2*sizeof(int));
+	if (new_ht==0) return 0;
 
-	if (pEntry->chain==elem)
+	if (new_max!=pH->elemMax)
 	{
-		pEntry->chain = elem->next;
+		new_elem = (dc_hashelem_t*)sjhashMallocRaw((new_max+1)*sizeof(dc_hashelem_t));
+		if (new_elem==0)
+		{
+			sjhashFree(new_ht);
+			return 0;
+		}
 	}
 
-	pEntry->count--;
-
-	if (pEntry->count<=0)
+	/* copy or compact the used elements; the inline keys must be re-pointed */
+	for (i = 0, j = 0; i < pH->elemCnt; i++)
 	{
-		pEntry->chain = 0;
+		if (pH->elem[i].data)
+		{
+			if (i!=j || new_elem!=pH->elem)
+			{
+				new_elem[j] = pH->elem[i];
+			}
+			if (new_elem[j].flags&DC_HASHELEM_INLINE)
+			{
+				new_elem[j].pKey = new_elem[j].inlineKey;
+			}
+			j++;
+		}
 	}
+	new_elem[j].data = 0;
+	new_elem[j].flags = DC_HASHELEM_END;
+
+	if (new_elem!=pH->elem && pH->elem) sjhashFree(pH->elem);
+	if (pH->ht) sjhashFree(pH->ht);
+	pH->elem = new_elem;
+	pH->elemCnt = j;
+	pH->elemMax = new_max;
+	pH->ht = new_ht;
+	pH->htsize = new_max*2;
 
-	if (pH->copyKey && elem->pKey)
+	mask = pH->htsize-1;
+	for (i = 0; i < pH->elemCnt; i++)
 	{
-		sjhashFree(elem->pKey);
+		int slot = pH->elem[i].hash & mask;
+		while (pH->ht[slot]) slot = (slot+1) & mask;
+		pH->ht[slot] = i+1;
 	}
-
-	sjhashFree( elem);
-	pH->count--;
+	return 1;
 }
 
 
@@ -410,17 +381,13 @@ static void removeElementGivenHash(dc_hash_t *pH,         /* The pH containing "
  */
 void* dc_hash_find(const dc_hash_t *pH, const void *pKey, int nKey)
 {
-	int h;             /* A hash on key */
-	dc_hashelem_t *elem;    /* The element that matches key */
-	int (*xHash)(const void*,int);  /* The hash function */
-
-	if (pH==0 || pH->ht==0) return 0;
-	xHash = hashFunction(pH->keyClass);
-	assert( xHash!=0);
-	h = (*xHash)(pKey,nKey);
-	assert( (pH->htsize & (pH->htsize-1))==0);
-	elem = findElementGivenHash(pH,pKey,nKey, h & (pH->htsize-1));
-	return elem ? elem->data : 0;
+	unsigned int h;
+	int slot;
+
+	if (pH==0 || pH->ht==0 || pH->count==0) return 0;
+	h = keyHash(pH->keyClass, pKey, nKey);
+	slot = findSlot(pH, pKey, nKey, h);
+	return pH->ht[slot] ? pH->elem[pH->ht[slot]-1].data : 0;
 }
 
 
@@ -442,47 +409,60 @@ void* dc_hash_find(const dc_hash_t *pH, const void *pKey, int nKey)
  */
 void* dc_hash_insert(dc_hash_t *pH, const void *pKey, int nKey, void *data)
 {
-	int hraw;                       /* Raw hash value of the key */
-	int h;                          /* the hash of the key modulo hash table size */
-	dc_hashelem_t *elem;               /* Used to loop thru the element list */
-	dc_hashelem_t *new_elem;           /* New element added to the pH */
-	int (*xHash)(const void*,int);  /* The hash function */
+	unsigned int h;                 /* Hash of the key */
+	int slot;                       /* Slot in the hash table */
+	dc_hashelem_t *new_elem;        /* New element added to the pH */
 
 	assert( pH!=0);
-	xHash = hashFunction(pH->keyClass);
-	assert( xHash!=0);
-	hraw = (*xHash)(pKey, nKey);
-	assert( (pH->htsize & (pH->htsize-1))==0);
-	h = hraw & (pH->htsize-1);
-	elem = findElementGivenHash(pH,pKey,nKey,h);
-
-	if (elem)
+	h = keyHash(pH->keyClass, pKey, nKey);
+
+	if (pH->ht)
 	{
-		void *old_data = elem->data;
-		if (data==0)
+		slot = findSlot(pH, pKey, nKey, h);
+		if (pH->ht[slot])
 		{
-			removeElementGivenHash(pH,elem,h);
-		}
-		else
-		{
-			elem->data = data;
+			dc_hashelem_t *elem = &pH->elem[pH->ht[slot]-1];
+			void *old_data = elem->data;
+			if (data==0)
+			{
+				if (pH->copyKey && elem->pKey && !(elem->flags&DC_HASHELEM_INLINE))
+				{
+					sjhashFree(elem->pKey);
+				}
+				elem->data = 0;
+				elem->pKey = 0;
+				removeSlot(pH, slot);
+				pH->count--;
+			}
+			else
+			{
+				elem->data = data;
+			}
+			return old_data;
 		}
-		return old_data;
 	}
 
 	if (data==0) return 0;
 
-	new_elem = (dc_hashelem_t*)sjhashMalloc( sizeof(dc_hashelem_t));
+	if (pH->elemCnt>=pH->elemMax)
+	{
+		if (!growTable(pH)) return data;
+	}
 
-	if (new_elem==0) return data;
+	new_elem = &pH->elem[pH->elemCnt];
+	new_elem->flags = 0;
 
 	if (pH->copyKey && pKey!=0)
 	{
-		new_elem->pKey = sjhashMallocRaw( nKey);
-		if (new_elem->pKey==0)
+		if (nKey>=0 && nKey<=DC_HASH_INLINE_KEY)
+		{
+			new_elem->pKey = new_elem->inlineKey;
+			new_elem->flags = DC_HASHELEM_INLINE;
+		}
+		else
 		{
-			sjhashFree(new_elem);
-			return data;
+			new_elem->pKey = sjhashMallocRaw(nKey);
+			if (new_elem->pKey==0) return data;
 		}
 		memcpy((void*)new_elem->pKey, pKey, nKey);
 	}
@@ -492,29 +472,15 @@ void* dc_hash_insert(dc_hash_t *pH, const void *pKey, int nKey, void *data)
 	}
 
 	new_elem->nKey = nKey;
-	pH->count++;
-
-	if (pH->htsize==0)
-	{
-		rehash(pH,8);
-		if (pH->htsize==0)
-		{
-			pH->count = 0;
-			sjhashFree(new_elem);
-			return data;
-		}
-	}
+	new_elem->hash = h;
+	new_elem->data = data;
 
-	if (pH->count > pH->htsize)
-	{
-		rehash(pH,pH->htsize*2);
-	}
+	pH->elemCnt++;
+	pH->elem[pH->elemCnt].data = 0;
+	pH->elem[pH->elemCnt].flags = DC_HASHELEM_END;
+	pH->count++;
 
-	assert( pH->htsize>0);
-	assert( (pH->htsize & (pH->htsize-1))==0);
-	h = hraw & (pH->htsize-1);
-	insertElement(pH, &pH->ht[h], new_elem);
-	new_elem->data = data;
+	slot = findSlot(pH, pKey, nKey, h);
+	pH->ht[slot] = pH->elemCnt;
 	return 0;
 }
-
@@ -40,34 +40,45 @@ typedef struct dc_hashelem_t   dc_hashelem_t;
  * However, many of the "procedures" and "functions" for modifying and
  * accessing this structure are really macros, so we can't really make
  * this structure opaque.
+ *
+ * The elements are stored in insertion order in a single array; a second
+ * array of element indices is used as an open-addressing table with
+ * linear probing.  Removed elements leave a hole in the element array
+ * that is reclaimed the next time the array needs to grow.
  */
 typedef struct dc_hash_t
 {
-	char              keyClass;       /* SJHASH_INT, _POINTER, _STRING, _BINARY */
+	char              keyClass;       /* DC_HASH_INT, _POINTER, _STRING, _BINARY */
 	char              copyKey;        /* True if copy of key made on insert */
 	int               count;          /* Number of entries in this table */
-	dc_hashelem_t     *first;         /* The first element of the array */
-	int               htsize;         /* Number of buckets in the hash table */
-	struct _ht
-	{	/* the hash table */
-		int           count;          /* Number of entries with this hash */
-		dc_hashelem_t *chain;         /* Pointer to first entry with this hash */
-	} *ht;
+	int               elemCnt;        /* Number of used elements in elem, including removed ones */
+	int               elemMax;        /* Number of elements allocated, not counting the end marker */
+	dc_hashelem_t     *elem;          /* The elements, terminated by an end marker */
+	int               htsize;         /* Number of slots in the hash table, a power of 2 */
+	int               *ht;            /* The hash table: 0 for empty slots, else the element index + 1 */
 } dc_hash_t;
 
 
 /* Each element in the hash table is an instance of the following
- * structure.  All elements are stored on a single doubly-linked list.
+ * structure.  Copied keys up to DC_HASH_INLINE_KEY bytes are stored in the
+ * element itself, so that short keys as addresses or fingerprints
+ * need no additional allocation.
  *
  * Again, this structure is intended to be opaque, but it can't really
  * be opaque because it is used by macros.
  */
+#define DC_HASH_INLINE_KEY 40
+
 typedef struct dc_hashelem_t
 {
-	dc_hashelem_t     *next, *prev;   /* Next and previous elements in the table */
-	void*             data;           /* Data associated with this element */
+	void*             data;           /* Data associated with this element, NULL for removed elements */
 	void*             pKey;           /* Key associated with this element */
 	int               nKey;           /* Key associated with this element */
+	unsigned int      hash;           /* Hash of the key, not reduced to the table size */
+	#define           DC_HASHELEM_INLINE 0x01
+	#define           DC_HASHELEM_END    0x02
+	char              flags;
+	char              inlineKey[DC_HASH_INLINE_KEY];
 } dc_hashelem_t;
 
 
@@ -101,13 +112,14 @@ void    dc_hash_init     (dc_hash_t*, int keytype, int copyKey);
 void*   dc_hash_insert   (dc_hash_t*, const void *pKey, int nKey, void *pData);
 void*   dc_hash_find     (const dc_hash_t*, const void *pKey, int nKey);
 void    dc_hash_clear    (dc_hash_t*);
+dc_hashelem_t* dc_hash_skip_removed(dc_hashelem_t*);
 
 #define dc_hash_find_str(H, s) dc_hash_find((H), (s), strlen((s)))
 
 
 /*
- * Macros for looping over all elements of a hash table.  The idiom is
- * like this:
+ * Macros for looping over all elements of a hash table in insertion order.
+ * Elements must not be inserted while looping.  The idiom is like this:
  *
  *   SjHash h;
  *   SjHashElem *p;
@@ -117,8 +129,8 @@ void    dc_hash_clear    (dc_hash_t*);
  *     // do something with pData
  *   }
  */
-#define dc_hash_first(H)      ((H)->first)
-#define dc_hash_next(E)       ((E)->next)
+#define dc_hash_first(H)      ((H)->elem? dc_hash_skip_removed((H)->elem) : NULL)
+#define dc_hash_next(E)       dc_hash_skip_removed((E)+1)
 #define dc_hash_data(E)       ((E)->data)
 #define dc_hash_key(E)        ((E)->pKey)
 #define dc_hash_keysize(E)    ((E)->nKey)
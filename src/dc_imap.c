@@ -25,10 +25,13 @@
 #include <sys/stat.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
 #include "dc_context.h"
 #include "dc_imap.h"
 #include "dc_job.h"
 #include "dc_loginparam.h"
+#include "dc_openssl.h"
 
 
 static int  setup_handle_if_needed   (dc_imap_t*);
@@ -326,6 +329,28 @@ static void free_folders(clist* folders)
 }
 
 
+static clist* get_folders(dc_imap_t* imap)
+{
+	/* return the cached folder list, the list is only fetched again if it is outdated or known to be wrong;
+	so, eg. a reconnect does not require a LIST command. The returned list must not be freed and is valid until
+	the next call to get_folders(). */
+	#define DC_FOLDERS_MAX_AGE_SECONDS (60*60)
+	if (imap->folders==NULL || imap->folders_time==0 || time(NULL)-imap->folders_time > DC_FOLDERS_MAX_AGE_SECONDS)
+	{
+		clist* folders = list_folders(imap);
+		if (clist_count(folders)>0 || imap->folders==NULL) {
+			free_folders(imap->folders);
+			imap->folders = folders;
+			imap->folders_time = clist_count(folders)>0? time(NULL) : 0;
+		}
+		else {
+			free_folders(folders); /* keep the old list on errors */
+		}
+	}
+	return imap->folders;
+}
+
+
 static int init_chat_folders(dc_imap_t* imap)
 {
 	int        success = 0;
@@ -350,7 +375,7 @@ static int init_chat_folders(dc_imap_t* imap)
 	free(imap->moveto_folder);
 	imap->moveto_folder = NULL;
 	//this sets imap->imap_delimiter as side-effect
-	folder_list = list_folders(imap);
+	folder_list = get_folders(imap);
 
 	//as a fallback, the chats_folder is created under INBOX as required e.g. for DomainFactory
 	char fallback_folder[64];
@@ -389,6 +414,7 @@ static int init_chat_folders(dc_imap_t* imap)
 			chats_folder = dc_strdup(DC_CHATS_FOLDER);
 			dc_log_info(imap->context, 0, "IMAP-folder created.");
 		}
+		imap->folders_time = 0; /* the cached folder list lacks the created folder */
 	}
 
 	/* Subscribe to the created folder.  Otherwise, although a top-level folder, if clients use LSUB for listing, the created folder may be hidden.
@@ -413,7 +439,6 @@ static int init_chat_folders(dc_imap_t* imap)
 	}
 
 cleanup:
-	free_folders(folder_list);
 	free(chats_folder);
 	free(sent_folder);
 	free(normal_folder);
@@ -463,45 +488,161 @@ static int select_folder(dc_imap_t* imap, const char* folder /*may be NULL*/)
 }
 
 
-static uint32_t search_uid(dc_imap_t* imap, const char* message_id)
+/*******************************************************************************
+ * Parse received messages in parallel
+ ******************************************************************************/
+
+
+typedef struct dc_parse_item_t
 {
-	/* Search Message-ID in all folders.
-	On success, the folder containing the message is selected and the UID is returned.
-	On failure, 0 is returned and any or none folder is selected. */
-	clist*                      folders = list_folders(imap);
-	clist*                      search_result = NULL;
-	clistiter*                  cur = NULL;
-	clistiter*                  cur2 = NULL;
-	struct mailimap_search_key* key = mailimap_search_key_new_header(strdup("Message-ID"), dc_mprintf("<%s>", message_id));
-	uint32_t                    uid = 0;
+	clist*      fetch_result; /* owned by the item, imf_raw points into it */
+	const char* imf_raw;
+	size_t      imf_raw_bytes;
+	uint32_t    server_uid;
+	uint32_t    flags;
+	#define     DC_PARSE_PENDING 0
+	#define     DC_PARSE_RUNNING 1
+	#define     DC_PARSE_DONE    2
+	int         state;
+	void*       parsed;
+} dc_parse_item_t;
+
+
+static void* parse_thread_entry_point(void* entry_arg)
+{
+	dc_imap_t*       imap = (dc_imap_t*)entry_arg;
+	dc_parse_item_t* item = NULL;
+	int              i = 0, icnt = 0;
 
-	for (cur = clist_begin(folders); cur!=NULL ; cur = clist_next(cur))
+	pthread_mutex_lock(&imap->parse_condmutex);
+	while (1)
 	{
-		dc_imapfolder_t* folder = (dc_imapfolder_t*)clist_content(cur);
-		if (select_folder(imap, folder->name_to_select))
-		{
-			int r = mailimap_uid_search(imap->etpan, "utf-8", key, &search_result);
-			if (!is_error(imap, r) && search_result) {
-				if ((cur2=clist_begin(search_result))!=NULL) {
-					uint32_t* ptr_uid = (uint32_t *)clist_content(cur2);
-					if (ptr_uid) {
-						uid = *ptr_uid;
-					}
-				}
-				mailimap_search_result_free(search_result);
-				search_result = NULL;
-				if (uid) {
-					goto cleanup;
-				}
+		/* find the oldest message not yet parsed by another thread */
+		item = NULL;
+		icnt = carray_count(imap->parse_queue);
+		for (i = 0; i < icnt; i++) {
+			dc_parse_item_t* test = (dc_parse_item_t*)carray_get(imap->parse_queue, i);
+			if (test->state==DC_PARSE_PENDING) {
+				item = test;
+				break;
+			}
+		}
+
+		if (item==NULL) {
+			if (imap->parse_shutdown) {
+				break;
 			}
+			pthread_cond_wait(&imap->parse_cond, &imap->parse_condmutex); /* unlock mutex -> wait -> lock mutex */
+			continue;
 		}
+
+		item->state = DC_PARSE_RUNNING;
+		pthread_mutex_unlock(&imap->parse_condmutex);
+
+			void* parsed = imap->parse_imf(imap, item->imf_raw, item->imf_raw_bytes);
+
+		pthread_mutex_lock(&imap->parse_condmutex);
+		item->parsed = parsed;
+		item->state = DC_PARSE_DONE;
+		pthread_cond_broadcast(&imap->parsed_cond);
 	}
+	pthread_mutex_unlock(&imap->parse_condmutex);
 
-cleanup:
-	if (search_result) { mailimap_search_result_free(search_result); }
-	if (key) { mailimap_search_key_free(key); }
-	free_folders(folders);
-	return uid;
+	return NULL;
+}
+
+
+static void start_parse_threads(dc_imap_t* imap)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int  i = 0;
+
+	/* even with a single cpu, parsing and decrypting overlaps with waiting for the network */
+	int threads_wanted = cpus<1? 1 : (cpus>DC_IMAP_MAX_PARSE_THREADS? DC_IMAP_MAX_PARSE_THREADS : (int)cpus);
+
+	imap->parse_shutdown = 0; /* no thread is running here, see stop_parse_threads() */
+
+	for (i = 0; i < threads_wanted; i++) {
+		if (pthread_create(&imap->parse_threads[imap->parse_threads_cnt], NULL, parse_thread_entry_point, imap)!=0) {
+			break; /* we can live with less threads, in the worst case, receive_imf() parses the messages itself */
+		}
+		imap->parse_threads_cnt++;
+	}
+}
+
+
+static void stop_parse_threads(dc_imap_t* imap)
+{
+	int i = 0;
+
+	if (imap->parse_threads_cnt<=0) {
+		return;
+	}
+
+	pthread_mutex_lock(&imap->parse_condmutex);
+		imap->parse_shutdown = 1;
+		pthread_cond_broadcast(&imap->parse_cond);
+	pthread_mutex_unlock(&imap->parse_condmutex);
+
+	for (i = 0; i < imap->parse_threads_cnt; i++) {
+		pthread_join(imap->parse_threads[i], NULL);
+	}
+	imap->parse_threads_cnt = 0;
+}
+
+
+static void add_to_parse_queue(dc_imap_t* imap, clist* fetch_result, const char* imf_raw_not_terminated, size_t imf_raw_bytes, uint32_t server_uid, uint32_t flags)
+{
+	/* the function takes the ownership of fetch_result; the message is not copied,
+	instead, the fetch result is kept until the message is received */
+	dc_parse_item_t* item = NULL;
+
+	if ((item=calloc(1, sizeof(dc_parse_item_t)))==NULL) {
+		exit(26); /* cannot allocate little memory, unrecoverable error */
+	}
+	item->fetch_result  = fetch_result;
+	item->imf_raw       = imf_raw_not_terminated;
+	item->imf_raw_bytes = imf_raw_bytes;
+	item->server_uid    = server_uid;
+	item->flags         = flags;
+	item->state         = DC_PARSE_PENDING;
+
+	pthread_mutex_lock(&imap->parse_condmutex);
+		carray_add(imap->parse_queue, (void*)item, NULL);
+		pthread_cond_signal(&imap->parse_cond);
+	pthread_mutex_unlock(&imap->parse_condmutex);
+}
+
+
+static void receive_parsed_msgs(dc_imap_t* imap, const char* folder, int max_pending)
+{
+	/* hand over all parsed messages from the start of the queue to receive_imf();
+	if there are more than max_pending messages left, wait until the next ones are parsed.
+	the messages are received strictly in the order they were added, which is the UID order */
+	dc_parse_item_t* item = NULL;
+
+	pthread_mutex_lock(&imap->parse_condmutex);
+	while (carray_count(imap->parse_queue) > 0)
+	{
+		item = (dc_parse_item_t*)carray_get(imap->parse_queue, 0);
+		if (item->state!=DC_PARSE_DONE) {
+			if ((int)carray_count(imap->parse_queue) <= max_pending) {
+				break;
+			}
+			pthread_cond_wait(&imap->parsed_cond, &imap->parse_condmutex); /* unlock mutex -> wait -> lock mutex */
+			continue;
+		}
+
+		carray_delete_slow(imap->parse_queue, 0);
+		pthread_mutex_unlock(&imap->parse_condmutex);
+
+			imap->receive_imf(imap, item->imf_raw, item->imf_raw_bytes, folder, item->server_uid, item->flags, item->parsed); /* takes the ownership of item->parsed */
+			mailimap_fetch_list_free(item->fetch_result);
+			free(item);
+
+		pthread_mutex_lock(&imap->parse_condmutex);
+	}
+	pthread_mutex_unlock(&imap->parse_condmutex);
 }
 
 
@@ -715,7 +856,19 @@ static int fetch_single_msg(dc_imap_t* imap, const char* folder, uint32_t server
 		goto cleanup;
 	}
 
-	imap->receive_imf(imap, msg_content, msg_bytes, folder, server_uid, flags);
+	/* the parse threads are started with the first message of a fetch and stopped at its end,
+	so that idle connections do not keep threads; in the worst case, receive_imf() parses the messages itself */
+	if (imap->parse_imf && imap->parse_threads_cnt==0) {
+		start_parse_threads(imap);
+	}
+
+	if (imap->parse_threads_cnt > 0) {
+		add_to_parse_queue(imap, fetch_result, msg_content, msg_bytes, server_uid, flags); /* received by receive_parsed_msgs() */
+		fetch_result = NULL;
+	}
+	else {
+		imap->receive_imf(imap, msg_content, msg_bytes, folder, server_uid, flags, NULL);
+	}
 
 cleanup:
 
@@ -726,6 +879,248 @@ cleanup:
 }
 
 
+static void get_config_indexeduid(dc_imap_t* imap, const char* folder, uint32_t* uidvalidity, uint32_t* indexeduid)
+{
+	*uidvalidity = 0;
+	*indexeduid = 0;
+
+	/* the entry has the format `imap.index.<folder>=<uidvalidity>:<indexeduid>`; all messages up to indexeduid are in the index */
+	char* key = dc_mprintf("imap.index.%s", folder);
+	char* val1 = imap->get_config(imap, key, NULL), *val2 = NULL;
+	if (val1 && (val2=strchr(val1, ':'))!=NULL) {
+		*val2 = 0;
+		val2++;
+		*uidvalidity = atol(val1);
+		*indexeduid = atol(val2);
+	}
+	free(val1);
+	free(key);
+}
+
+
+static void set_config_indexeduid(dc_imap_t* imap, const char* folder, uint32_t uidvalidity, uint32_t indexeduid)
+{
+	char* key = dc_mprintf("imap.index.%s", folder);
+	char* val = dc_mprintf("%lu:%lu", uidvalidity, indexeduid);
+	imap->set_config(imap, key, val);
+	free(val);
+	free(key);
+}
+
+
+static void index_fetch_result(dc_imap_t* imap, const char* folder, uint32_t uidvalidity, uint32_t first_uid_minus_one, uint32_t last_uid, int replace, clist* fetch_result)
+{
+	/* add the locations of the messages in a FETCH (UID ENVELOPE) result for all UIDs above first_uid_minus_one to the index.
+	as UIDs are strictly ascending, new messages in a folder always have larger UIDs than the indexed ones;
+	so, if the fetched range continues the indexed range, the indexed range can be extended up to the largest UID fetched
+	or up to last_uid, if the result is known to contain all messages up to this UID.
+	replace=1 is used for the first part of the whole folder, the locations replace the indexed ones then,
+	which removes messages deleted or moved by others.
+	all locations are written at once, so that a large folder is indexed in one transaction. */
+	clistiter* cur = NULL;
+	uint32_t   max_uid = 0, indexed_uidvalidity = 0, indexeduid = 0;
+	char**     rfc724_mids = NULL;
+	uint32_t*  uids = NULL;
+	int        cnt = 0, i = 0;
+
+	if (imap->set_locations==NULL || uidvalidity==0) {
+		return;
+	}
+
+	if ((rfc724_mids=calloc((fetch_result? clist_count(fetch_result) : 0)+1, sizeof(char*)))==NULL
+	 || (uids=calloc((fetch_result? clist_count(fetch_result) : 0)+1, sizeof(uint32_t)))==NULL) {
+		exit(70);
+	}
+
+	for (cur = fetch_result? clist_begin(fetch_result) : NULL; cur!=NULL ; cur = clist_next(cur))
+	{
+		struct mailimap_msg_att* msg_att = (struct mailimap_msg_att*)clist_content(cur);
+		uint32_t                 uid = peek_uid(msg_att);
+		const char*              quoted_rfc724_mid = peek_rfc724_mid(msg_att);
+		if (uid > first_uid_minus_one && quoted_rfc724_mid) {
+			char* rfc724_mid = unquote_rfc724_mid(quoted_rfc724_mid);
+			if (rfc724_mid[0]) {
+				rfc724_mids[cnt] = rfc724_mid;
+				uids[cnt] = uid;
+				cnt++;
+			}
+			else {
+				free(rfc724_mid);
+			}
+		}
+		if (uid > max_uid) {
+			max_uid = uid;
+		}
+	}
+
+	imap->set_locations(imap, folder, uidvalidity, replace, rfc724_mids, uids, cnt);
+
+	for (i = 0; i < cnt; i++) {
+		free(rfc724_mids[i]);
+	}
+	free(rfc724_mids);
+	free(uids);
+
+	max_uid = DC_MAX(max_uid, last_uid);
+	get_config_indexeduid(imap, folder, &indexed_uidvalidity, &indexeduid);
+	if (indexed_uidvalidity==uidvalidity && indexeduid >= first_uid_minus_one && max_uid > indexeduid) {
+		set_config_indexeduid(imap, folder, uidvalidity, max_uid);
+	}
+}
+
+
+static int refresh_index(dc_imap_t* imap, const char* folder)
+{
+	/* add the messages of the folder not yet in the index, these are the ones with a larger UID than the last indexed one;
+	`UID FETCH <indexeduid+1>:<indexeduid+DC_INDEX_CHUNK_UIDS> (UID ENVELOPE)` up to UIDNEXT, so that the first refresh of a
+	large folder does not hold all envelopes in memory at once; indexeduid is stored after each chunk.
+	if the server does not tell UIDNEXT, `UID FETCH <indexeduid+1>:* (UID ENVELOPE)` is used. */
+	#define              DC_INDEX_CHUNK_UIDS 1000
+	int                  r = 0;
+	uint32_t             uidvalidity = 0, indexeduid = 0, uidnext = 0, last_uid = 0;
+	clist*               fetch_result = NULL;
+	struct mailimap_set* set = NULL;
+
+	if (select_folder(imap, folder)==0) {
+		return 0;
+	}
+
+	get_config_indexeduid(imap, folder, &uidvalidity, &indexeduid);
+	if (uidvalidity!=imap->etpan->imap_selection_info->sel_uidvalidity) {
+		uidvalidity = imap->etpan->imap_selection_info->sel_uidvalidity;
+		indexeduid = 0;
+		set_config_indexeduid(imap, folder, uidvalidity, indexeduid);
+	}
+
+	uidnext = imap->etpan->imap_selection_info->sel_uidnext;
+
+	do
+	{
+		last_uid = 0; /* `*` */
+		if (uidnext > indexeduid+1) {
+			last_uid = DC_MIN((uint64_t)uidnext-1, (uint64_t)indexeduid+DC_INDEX_CHUNK_UIDS);
+		}
+
+		set = mailimap_set_new_interval(indexeduid+1, last_uid);
+			r = mailimap_uid_fetch(imap->etpan, set, imap->fetch_type_index, &fetch_result);
+		mailimap_set_free(set);
+
+		if (is_error(imap, r)) {
+			break;
+		}
+
+		/* an empty range may be returned as no list, all messages up to last_uid are indexed anyway */
+		index_fetch_result(imap, folder, uidvalidity, indexeduid, last_uid, indexeduid==0, fetch_result);
+
+		if (fetch_result) {
+			mailimap_fetch_list_free(fetch_result);
+			fetch_result = NULL;
+		}
+
+		indexeduid = last_uid;
+	}
+	while (last_uid!=0 && last_uid+1 < uidnext);
+
+	if (fetch_result) {
+		mailimap_fetch_list_free(fetch_result);
+	}
+	return imap->should_reconnect? 0 : 1;
+}
+
+
+static int uid_has_rfc724_mid(dc_imap_t* imap, uint32_t server_uid, const char* rfc724_mid)
+{
+	/* check if the UID in the selected folder matches the Message-ID
+	(to detect if the messages was moved around by other MUAs and in place of an UIDVALIDITY check) */
+	int                  matches = 0;
+	int                  r = 0;
+	clist*               fetch_result = NULL;
+	clistiter*           cur = NULL;
+	const char*          is_quoted_rfc724_mid = NULL;
+	char*                is_rfc724_mid = NULL;
+	struct mailimap_set* set = mailimap_set_new_single(server_uid);
+
+	r = mailimap_uid_fetch(imap->etpan, set, imap->fetch_type_message_id, &fetch_result);
+	mailimap_set_free(set);
+
+	if (!is_error(imap, r) && fetch_result
+	 && (cur=clist_begin(fetch_result))!=NULL
+	 && (is_quoted_rfc724_mid=peek_rfc724_mid((struct mailimap_msg_att*)clist_content(cur)))!=NULL
+	 && (is_rfc724_mid=unquote_rfc724_mid(is_quoted_rfc724_mid))!=NULL
+	 && strcmp(is_rfc724_mid, rfc724_mid)==0) {
+		matches = 1;
+	}
+
+	if (fetch_result) {
+		mailimap_fetch_list_free(fetch_result);
+	}
+	free(is_rfc724_mid);
+	return matches;
+}
+
+
+static uint32_t locate_msg(dc_imap_t* imap, const char* rfc724_mid)
+{
+	/* Find the Message-ID using the local index; if it is not found, the index is refreshed for all folders, which is
+	cheap as only the messages arrived since the last refresh are fetched. The location is verified with a single FETCH.
+	On success, the folder containing the message is selected and the UID is returned.
+	On failure, 0 is returned and any or none folder is selected. */
+	#define    DC_INDEX_REFRESH_SECONDS 60
+	char*      folder = NULL;
+	uint32_t   uidvalidity = 0, uid = 0, ret_uid = 0;
+	int        tries = 0;
+	clist*     folders = NULL;
+	clistiter* cur = NULL;
+
+	if (imap->get_location==NULL) {
+		return 0;
+	}
+
+	for (tries = 0; tries < 2; tries++)
+	{
+		if (imap->get_location(imap, rfc724_mid, &folder, &uidvalidity, &uid))
+		{
+			if (select_folder(imap, folder)
+			 && (uidvalidity==0 /*unknown*/ || uidvalidity==imap->etpan->imap_selection_info->sel_uidvalidity)
+			 && uid_has_rfc724_mid(imap, uid, rfc724_mid)) {
+				ret_uid = uid;
+				goto cleanup;
+			}
+
+			if (imap->should_reconnect) {
+				goto cleanup;
+			}
+
+			/* the message was deleted or moved by another MUA, the refresh below may find the new location */
+			if (imap->set_location) {
+				imap->set_location(imap, rfc724_mid, NULL, 0, 0);
+			}
+		}
+		free(folder);
+		folder = NULL;
+
+		if (tries==0) {
+			if (time(NULL)-imap->last_index_refresh_time < DC_INDEX_REFRESH_SECONDS) {
+				goto cleanup; /* the index is up to date, the message is not on the server */
+			}
+
+			dc_log_info(imap->context, 0, "Refreshing the location index...");
+			folders = get_folders(imap);
+			for (cur = clist_begin(folders); cur!=NULL ; cur = clist_next(cur)) {
+				if (!refresh_index(imap, ((dc_imapfolder_t*)clist_content(cur))->name_to_select) && imap->should_reconnect) {
+					goto cleanup;
+				}
+			}
+			imap->last_index_refresh_time = time(NULL);
+		}
+	}
+
+cleanup:
+	free(folder);
+	return ret_uid;
+}
+
+
 static int fetch_from_single_folder(dc_imap_t* imap, const char* folder)
 {
 	int                  r;
@@ -749,6 +1144,7 @@ static int fetch_from_single_folder(dc_imap_t* imap, const char* folder)
 
 	if (select_folder(imap, folder)==0) {
 		dc_log_warning(imap->context, 0, "Cannot select folder \"%s\".", folder);
+		imap->folders_time = 0; /* maybe the folder does no longer exist, list the folders again next time */
 		goto cleanup;
 	}
 
@@ -803,9 +1199,10 @@ static int fetch_from_single_folder(dc_imap_t* imap, const char* folder)
 		set_config_lastseenuid(imap, folder, uidvalidity, lastseenuid);
 	}
 
-	/* fetch messages with larger UID than the last one seen (`UID FETCH lastseenuid+1:*)`, see RFC 4549 */
+	/* fetch messages with larger UID than the last one seen (`UID FETCH lastseenuid+1:*)`, see RFC 4549;
+	the Message-IDs are fetched along with the UIDs to update the index of message locations */
 	set = mailimap_set_new_interval(lastseenuid+1, 0);
-		r = mailimap_uid_fetch(imap->etpan, set, imap->fetch_type_uid, &fetch_result);
+		r = mailimap_uid_fetch(imap->etpan, set, imap->fetch_type_index, &fetch_result);
 	mailimap_set_free(set);
 
 	if (is_error(imap, r) || fetch_result==NULL)
@@ -835,9 +1232,16 @@ static int fetch_from_single_folder(dc_imap_t* imap, const char* folder)
 				new_lastseenuid = cur_uid;
 			}
 
+			receive_parsed_msgs(imap, folder, DC_IMAP_MAX_PARSE_AHEAD-1); /* bound the memory used by downloaded but not yet received messages */
 		}
 	}
 
+	/* all fetched messages must be in the database before lastseenuid is updated;
+	otherwise, they may get lost if the app is killed in between */
+	receive_parsed_msgs(imap, folder, 0);
+
+	index_fetch_result(imap, folder, uidvalidity, lastseenuid, 0, 0, fetch_result);
+
 	if (!read_errors && new_lastseenuid > 0) {
 		set_config_lastseenuid(imap, folder, uidvalidity, new_lastseenuid);
 	}
@@ -845,6 +1249,8 @@ static int fetch_from_single_folder(dc_imap_t* imap, const char* folder)
 	/* done */
 cleanup:
 
+	stop_parse_threads(imap); /* the queue is empty here, it is emptied by receive_parsed_msgs() above */
+
 	if (read_errors) {
 		dc_log_warning(imap->context, 0, "%i mails read from \"%s\" with %i errors.", (int)read_cnt, folder, (int)read_errors);
 	}
@@ -866,7 +1272,7 @@ static int fetch_from_all_folders(dc_imap_t* imap)
 	clistiter* cur = NULL;
 	int        total_cnt = 0;
 
-		folder_list = list_folders(imap);
+	folder_list = get_folders(imap);
 
 	/* first, read the INBOX, this looks much better on the initial load as the INBOX
 	has the most recent mails.  Moreover, this is for speed reasons, as the other folders only have few new messages. */
@@ -889,8 +1295,6 @@ static int fetch_from_all_folders(dc_imap_t* imap)
 		}
 	}
 
-	free_folders(folder_list);
-
 	return total_cnt;
 }
 
@@ -900,8 +1304,18 @@ static int fetch_from_all_folders(dc_imap_t* imap)
  ******************************************************************************/
 
 
+static double now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (double)ts.tv_sec*1000.0 + (double)ts.tv_nsec/1000000.0;
+}
+
+
 int dc_imap_fetch(dc_imap_t* imap)
 {
+	int read_cnt = 0;
+
 	if (imap==NULL || !imap->connected) {
 		return 0;
 	}
@@ -919,8 +1333,14 @@ int dc_imap_fetch(dc_imap_t* imap)
 	// get any more. if IDLE is called directly after, there is only a small chance that
 	// messages are missed and delayed until the next IDLE call
 	while (fetch_from_single_folder(imap, "INBOX") > 0) {
-		;
+		read_cnt++;
+	}
+
+	if (imap->idle_data_ms && read_cnt) {
+		imap->ingest_ms += now_ms() - imap->idle_data_ms;
+		imap->ingest_cnt++;
 	}
+	imap->idle_data_ms = 0;
 
 	return 1;
 }
@@ -979,11 +1399,35 @@ static void fake_idle(dc_imap_t* imap)
 }
 
 
-void dc_imap_idle(dc_imap_t* imap)
+static void drain_interrupt_fd(dc_imap_t* imap)
+{
+	char buf[64];
+	while (read(imap->interrupt_fd[0], buf, sizeof(buf)) > 0) {
+		;
+	}
+}
+
+
+static void count_idle_wakeup(dc_imap_t* imap, int has_data, double data_ms /*0=now*/)
+{
+	if (imap->idle_stats_since==0) {
+		imap->idle_stats_since = time(NULL);
+	}
+	imap->idle_wakeups++;
+
+	if (has_data && imap->idle_data_ms==0) {
+		imap->idle_data_ms = data_ms? data_ms : now_ms();
+	}
+}
+
+
+void dc_imap_idle(dc_imap_t* imap, int max_seconds)
 {
 	int r = 0;
 	int r2 = 0;
 
+	dc_imap_idle_done(imap); /* in case IDLE was started by dc_imap_idle_start(); this also drains the interrupt-fd, which is not needed here */
+
 	if (imap->can_idle)
 	{
 		setup_handle_if_needed(imap);
@@ -1011,13 +1455,9 @@ void dc_imap_idle(dc_imap_t* imap)
 			return;
 		}
 
-		// most servers do not allow more than ~28 minutes; stay clearly below that.
-		// a good value is 23 minutes.  however, as we do all imap in the same thread,
-		// we use a shorter delay to let failed jobs run again from time to time.
-		#define IDLE_DELAY_SECONDS (1*60)
-
-		r = mailstream_wait_idle(imap->etpan->imap_stream, IDLE_DELAY_SECONDS);
+		r = mailstream_wait_idle(imap->etpan->imap_stream, max_seconds);
 		r2 = mailimap_idle_done(imap->etpan);
+		count_idle_wakeup(imap, r==MAILSTREAM_IDLE_HASDATA, 0);
 
 		if (r==MAILSTREAM_IDLE_ERROR /*0*/ || r==MAILSTREAM_IDLE_CANCELLED /*4*/) {
 			dc_log_info(imap->context, 0, "IMAP-IDLE wait cancelled, r=%i, r2=%i; we'll reconnect soon.", r, r2);
@@ -1062,54 +1502,286 @@ void dc_imap_interrupt_idle(dc_imap_t* imap)
 		imap->watch_condflag = 1;
 		pthread_cond_signal(&imap->watch_cond);
 	pthread_mutex_unlock(&imap->watch_condmutex);
+
+	// wake up event loops waiting for dc_imap_get_interrupt_fd(); if the pipe is full, there is already a wakeup pending
+	if (write(imap->interrupt_fd[1], "i", 1) < 0) {
+		;
+	}
 }
 
 
 /*******************************************************************************
- * Setup handle
+ * IDLE driven by an external event loop
  ******************************************************************************/
 
 
-static int setup_handle_if_needed(dc_imap_t* imap)
+/* Instead of blocking in dc_imap_idle(), an event loop can start IDLE using
+dc_imap_idle_start() and wait for the returned socket and for dc_imap_get_interrupt_fd()
+to become readable.  After that, or after a timeout, dc_imap_idle_done() must be called.
+So, a thread is only needed when there is really something to do. */
+
+
+/**
+ * Start IDLE without waiting for the result.
+ *
+ * @private @memberof dc_imap_t
+ * @param imap The IMAP object.
+ * @return The socket the event loop should wait for, -1 if IDLE is not possible;
+ *     in this case, the event loop should wait for the interrupt-fd and call dc_imap_fetch() from time to time.
+ */
+int dc_imap_idle_start(dc_imap_t* imap)
 {
 	int r = 0;
-	int success = 0;
 
-	if (imap==NULL || imap->imap_server==NULL) {
-		goto cleanup;
+	if (imap==NULL) {
+		return -1;
 	}
 
-    if (imap->should_reconnect) {
-		unsetup_handle(imap);
-    }
+	if (imap->idling) {
+		return mailstream_low_get_fd(mailstream_get_low(imap->etpan->imap_stream));
+	}
 
-    if (imap->etpan) {
-		success = 1;
-		goto cleanup;
-    }
+	if (!imap->can_idle || !setup_handle_if_needed(imap) || !select_folder(imap, "INBOX")) {
+		return -1;
+	}
 
-	if (imap->context->cb(imap->context, DC_EVENT_IS_OFFLINE, 0, 0)!=0) {
-		dc_log_error_if(&imap->log_connect_errors, imap->context, DC_ERROR_NO_NETWORK, NULL);
-		goto cleanup;
+	r = mailimap_idle(imap->etpan);
+	if (is_error(imap, r)) {
+		dc_log_warning(imap->context, 0, "IMAP-IDLE: Cannot start.");
+		return -1;
 	}
+	imap->idling = 1;
 
-	imap->etpan = mailimap_new(0, NULL);
+	if (imap->etpan->imap_stream->read_buffer_len > 0) {
+		/* the data are already read from the socket, which will not get readable therefore */
+		if (imap->idle_data_ms==0) {
+			imap->idle_data_ms = now_ms(); /* the data arrived now, not when the event loop gets to dc_imap_idle_done() */
+		}
+		if (write(imap->interrupt_fd[1], "d", 1) < 0) {
+			;
+		}
+	}
 
-	mailimap_set_timeout(imap->etpan, DC_IMAP_TIMEOUT_SEC);
+	return mailstream_low_get_fd(mailstream_get_low(imap->etpan->imap_stream));
+}
 
-	if (imap->server_flags&(DC_LP_IMAP_SOCKET_STARTTLS|DC_LP_IMAP_SOCKET_PLAIN))
-	{
-		r = mailimap_socket_connect(imap->etpan, imap->imap_server, imap->imap_port);
-		if (is_error(imap, r)) {
-			dc_log_error_if(&imap->log_connect_errors, imap->context, 0, "Could not connect to IMAP-server %s:%i. (Error #%i)", imap->imap_server, (int)imap->imap_port, (int)r);
-			goto cleanup;
-		}
 
-		if (imap->server_flags&DC_LP_IMAP_SOCKET_STARTTLS)
-		{
-			r = mailimap_socket_starttls(imap->etpan);
-			if (is_error(imap, r)) {
-				dc_log_error_if(&imap->log_connect_errors, imap->context, 0, "Could not connect to IMAP-server %s:%i using STARTTLS. (Error #%i)", imap->imap_server, (int)imap->imap_port, (int)r);
+/**
+ * Tell the IMAP object when the event loop has seen the socket returned by
+ * dc_imap_idle_start() getting readable.  If the event loop does not call
+ * dc_imap_idle_done() at once, eg. as the call is queued, this time is used
+ * as the arrival time of new messages instead of the time of dc_imap_idle_done().
+ *
+ * @private @memberof dc_imap_t
+ * @param imap The IMAP object.
+ * @param readable_ms The time the socket was seen readable in milliseconds since the epoch, 0=unknown.
+ * @return None.
+ */
+void dc_imap_idle_readable(dc_imap_t* imap, double readable_ms)
+{
+	if (imap==NULL || !imap->idling) {
+		return;
+	}
+
+	imap->idle_readable_ms = readable_ms;
+}
+
+
+/**
+ * End IDLE started by dc_imap_idle_start().
+ * If IDLE is not started, nothing happens.
+ *
+ * @private @memberof dc_imap_t
+ * @param imap The IMAP object.
+ * @return None.
+ */
+void dc_imap_idle_done(dc_imap_t* imap)
+{
+	int           r = 0;
+	int           has_data = 0;
+	double        readable_ms = 0;
+	struct pollfd pfd;
+
+	if (imap==NULL) {
+		return;
+	}
+
+	drain_interrupt_fd(imap); /* also if IDLE is not started, the event loop may have waited for the interrupt only */
+
+	if (!imap->idling) {
+		return;
+	}
+	imap->idling = 0;
+	readable_ms = imap->idle_readable_ms;
+	imap->idle_readable_ms = 0;
+
+	if (imap->etpan==NULL || imap->etpan->imap_stream==NULL) {
+		return;
+	}
+
+	memset(&pfd, 0, sizeof(pfd));
+	pfd.fd     = mailstream_low_get_fd(mailstream_get_low(imap->etpan->imap_stream));
+	pfd.events = POLLIN;
+	has_data   = (imap->etpan->imap_stream->read_buffer_len > 0) || (poll(&pfd, 1, 0)==1 && (pfd.revents&POLLIN));
+
+	r = mailimap_idle_done(imap->etpan);
+	count_idle_wakeup(imap, has_data, readable_ms);
+
+	if (is_error(imap, r)) {
+		dc_log_info(imap->context, 0, "IMAP-IDLE done failed, r=%i; we'll reconnect soon.", r);
+		imap->should_reconnect = 1;
+	}
+	else {
+		dc_log_info(imap->context, 0, has_data? "IMAP-IDLE has data." : "IMAP-IDLE done.");
+	}
+}
+
+
+/**
+ * Get a file descriptor that gets readable when dc_imap_interrupt_idle() is called.
+ * The descriptor is drained by dc_imap_idle_done().
+ *
+ * @private @memberof dc_imap_t
+ * @param imap The IMAP object.
+ * @return The file descriptor, valid until dc_imap_unref() is called.
+ */
+int dc_imap_get_interrupt_fd(dc_imap_t* imap)
+{
+	return imap? imap->interrupt_fd[0] : -1;
+}
+
+
+/*******************************************************************************
+ * Setup handle
+ ******************************************************************************/
+
+
+static void count_traffic(dc_imap_t* imap)
+{
+	/* count the bytes on the wire (below) and the payload (above); the difference is the compression layer put between them by enable_compression() */
+	mailstream_low* wire_layer = dc_countstream_open(mailstream_get_low(imap->etpan->imap_stream), &imap->wire_count);
+	mailstream_set_low(imap->etpan->imap_stream, dc_countstream_open(wire_layer, &imap->payload_count));
+}
+
+
+static void enable_compression(dc_imap_t* imap)
+{
+	/* enable COMPRESS=DEFLATE, RFC 4978, if supported by the server; this should be done after the login.
+	mailimap_compress() puts libEtPan's compression layer on top of the lowest layer of the stream, so we
+	remove the payload counting layer before and put it on top of the compression layer afterwards. */
+	int r = 0;
+
+	imap->compressed = 0;
+	if (!imap->has_compress) {
+		return;
+	}
+
+	mailstream_set_low(imap->etpan->imap_stream, dc_countstream_detach(mailstream_get_low(imap->etpan->imap_stream)));
+
+	r = mailimap_compress(imap->etpan);
+	if (is_error(imap, r)) {
+		dc_log_warning(imap->context, 0, "Cannot enable IMAP-compression. (Error #%i)", (int)r);
+	}
+	else {
+		dc_log_info(imap->context, 0, "IMAP-compression enabled.");
+		imap->compressed = 1;
+	}
+
+	mailstream_set_low(imap->etpan->imap_stream, dc_countstream_open(mailstream_get_low(imap->etpan->imap_stream), &imap->payload_count));
+}
+
+
+static void read_capabilities(dc_imap_t* imap)
+{
+	/* the capabilities are normally sent with the greeting or the login response; otherwise, ask for them.
+	they are cached until dc_imap_disconnect() so that reconnects need no CAPABILITY command. */
+	struct mailimap_capability_data* capdata = NULL;
+
+	if (imap->etpan->imap_connection_info==NULL || imap->etpan->imap_connection_info->imap_capability==NULL) {
+		if (!is_error(imap, mailimap_capability(imap->etpan, &capdata)) && capdata) {
+			mailimap_capability_data_free(capdata);
+		}
+	}
+
+	imap->can_idle     = mailimap_has_idle(imap->etpan);
+	imap->has_xlist    = mailimap_has_xlist(imap->etpan);
+	imap->has_uidplus  = mailimap_has_uidplus(imap->etpan);
+	imap->has_compress = mailimap_has_compress_deflate(imap->etpan);
+
+	#ifdef __APPLE__
+	imap->can_idle = 0; // HACK to force iOS not to work IMAP-IDLE which does not work for now, see also (*)
+	#endif
+
+	if (!imap->skip_log_capabilities
+	 && imap->etpan->imap_connection_info && imap->etpan->imap_connection_info->imap_capability)
+	{
+		/* just log the whole capabilities list (the mailimap_has_*() function also use this list, so this is a good overview on problems) */
+		imap->skip_log_capabilities = 1;
+		dc_strbuilder_t capinfostr;
+		dc_strbuilder_init(&capinfostr, 0);
+		clist* list = imap->etpan->imap_connection_info->imap_capability->cap_list;
+		if (list) {
+			clistiter* cur;
+			for(cur = clist_begin(list) ; cur!=NULL ; cur = clist_next(cur)) {
+				struct mailimap_capability * cap = clist_content(cur);
+				if (cap && cap->cap_type==MAILIMAP_CAPABILITY_NAME) {
+					dc_strbuilder_cat(&capinfostr, " ");
+					dc_strbuilder_cat(&capinfostr, cap->cap_data.cap_name);
+				}
+			}
+		}
+		dc_log_info(imap->context, 0, "IMAP-capabilities:%s", capinfostr.buf);
+		free(capinfostr.buf);
+	}
+
+	imap->capabilities_read = 1;
+}
+
+
+static int setup_handle_if_needed(dc_imap_t* imap)
+{
+	int   r = 0;
+	int   success = 0;
+	char* tls_host = NULL;
+
+	if (imap==NULL || imap->imap_server==NULL) {
+		goto cleanup;
+	}
+
+    if (imap->should_reconnect) {
+		unsetup_handle(imap);
+    }
+
+    if (imap->etpan) {
+		success = 1;
+		goto cleanup;
+    }
+
+	if (imap->context->cb(imap->context, DC_EVENT_IS_OFFLINE, 0, 0)!=0) {
+		dc_log_error_if(&imap->log_connect_errors, imap->context, DC_ERROR_NO_NETWORK, NULL);
+		goto cleanup;
+	}
+
+	imap->etpan = mailimap_new(0, NULL);
+
+	mailimap_set_timeout(imap->etpan, DC_IMAP_TIMEOUT_SEC);
+
+	/* TLS sessions are cached by host to speed up reconnects, see dc_openssl_tls_session_cb() */
+	tls_host = dc_mprintf("%s:%i", imap->imap_server, (int)imap->imap_port);
+
+	if (imap->server_flags&(DC_LP_IMAP_SOCKET_STARTTLS|DC_LP_IMAP_SOCKET_PLAIN))
+	{
+		r = mailimap_socket_connect(imap->etpan, imap->imap_server, imap->imap_port);
+		if (is_error(imap, r)) {
+			dc_log_error_if(&imap->log_connect_errors, imap->context, 0, "Could not connect to IMAP-server %s:%i. (Error #%i)", imap->imap_server, (int)imap->imap_port, (int)r);
+			goto cleanup;
+		}
+
+		if (imap->server_flags&DC_LP_IMAP_SOCKET_STARTTLS)
+		{
+			r = mailimap_socket_starttls_with_callback(imap->etpan, dc_openssl_tls_session_cb, tls_host);
+			if (is_error(imap, r)) {
+				dc_log_error_if(&imap->log_connect_errors, imap->context, 0, "Could not connect to IMAP-server %s:%i using STARTTLS. (Error #%i)", imap->imap_server, (int)imap->imap_port, (int)r);
 				goto cleanup;
 			}
 			dc_log_info(imap->context, 0, "IMAP-server %s:%i STARTTLS-connected.", imap->imap_server, (int)imap->imap_port);
@@ -1121,7 +1793,7 @@ static int setup_handle_if_needed(dc_imap_t* imap)
 	}
 	else
 	{
-		r = mailimap_ssl_connect(imap->etpan, imap->imap_server, imap->imap_port);
+		r = mailimap_ssl_connect_with_callback(imap->etpan, imap->imap_server, imap->imap_port, dc_openssl_tls_session_cb, tls_host);
 		if (is_error(imap, r)) {
 			dc_log_error_if(&imap->log_connect_errors, imap->context, 0, "Could not connect to IMAP-server %s:%i using SSL. (Error #%i)", imap->imap_server, (int)imap->imap_port, (int)r);
 			goto cleanup;
@@ -1129,6 +1801,8 @@ static int setup_handle_if_needed(dc_imap_t* imap)
 		dc_log_info(imap->context, 0, "IMAP-server %s:%i SSL-connected.", imap->imap_server, (int)imap->imap_port);
 	}
 
+	count_traffic(imap);
+
 		/* TODO: There are more authorisation types, see mailcore2/MCIMAPSession.cpp, however, I'm not sure of they are really all needed */
 		/*if (imap->server_flags&DC_LP_AUTH_XOAUTH2)
 		{
@@ -1156,12 +1830,20 @@ static int setup_handle_if_needed(dc_imap_t* imap)
 
 	dc_log_info(imap->context, 0, "IMAP-login as %s ok.", imap->imap_user);
 
+	if (!imap->capabilities_read) {
+		read_capabilities(imap);
+	}
+
+	enable_compression(imap);
+
 	success = 1;
 
 cleanup:
 	if (success==0) {
+		dc_openssl_forget_tls_session(tls_host); /* in case the session is the reason for the error */
 		unsetup_handle(imap);
 	}
+	free(tls_host);
 
 	imap->should_reconnect = 0;
 	return success;
@@ -1176,6 +1858,8 @@ static void unsetup_handle(dc_imap_t* imap)
 
 	if (imap->etpan)
 	{
+		imap->idling = 0; /* the server ends IDLE when the connection is closed */
+
 		if (imap->idle_set_up) {
 			mailstream_unsetup_idle(imap->etpan->imap_stream);
 			imap->idle_set_up = 0;
@@ -1188,8 +1872,11 @@ static void unsetup_handle(dc_imap_t* imap)
 
 		mailimap_free(imap->etpan);
 		imap->etpan = NULL;
+		imap->compressed = 0;
 
-		dc_log_info(imap->context, 0, "IMAP disconnected.");
+		dc_log_info(imap->context, 0, "IMAP disconnected. (Traffic so far: %llu bytes payload, %llu bytes on the wire)",
+			(unsigned long long)(imap->payload_count.bytes_read+imap->payload_count.bytes_written),
+			(unsigned long long)(imap->wire_count.bytes_read+imap->wire_count.bytes_written));
 	}
 
 	imap->selected_folder[0] = 0;
@@ -1223,8 +1910,16 @@ static void free_connect_param(dc_imap_t* imap)
 	imap->sent_folder = NULL;
 
 	imap->imap_port = 0;
-	imap->can_idle  = 0;
-	imap->has_xlist = 0;
+
+	imap->capabilities_read = 0;
+	imap->can_idle     = 0;
+	imap->has_xlist    = 0;
+	imap->has_uidplus  = 0;
+	imap->has_compress = 0;
+
+	free_folders(imap->folders);
+	imap->folders = NULL;
+	imap->folders_time = 0;
 }
 
 
@@ -1247,41 +1942,11 @@ int dc_imap_connect(dc_imap_t* imap, const dc_loginparam_t* lp)
 	imap->imap_pw      = dc_strdup(lp->mail_pw);
 	imap->server_flags = lp->server_flags;
 
+	/* the capabilities are read by setup_handle_if_needed() on the first connection and must not change during connection */
 	if (!setup_handle_if_needed(imap)) {
 		goto cleanup;
 	}
 
-	/* we set the following flags here and not in setup_handle_if_needed() as they must not change during connection */
-	imap->can_idle = mailimap_has_idle(imap->etpan);
-	imap->has_xlist = mailimap_has_xlist(imap->etpan);
-
-	#ifdef __APPLE__
-	imap->can_idle = 0; // HACK to force iOS not to work IMAP-IDLE which does not work for now, see also (*)
-	#endif
-
-
-	if (!imap->skip_log_capabilities
-	 && imap->etpan->imap_connection_info && imap->etpan->imap_connection_info->imap_capability)
-	{
-		/* just log the whole capabilities list (the mailimap_has_*() function also use this list, so this is a good overview on problems) */
-		imap->skip_log_capabilities = 1;
-		dc_strbuilder_t capinfostr;
-		dc_strbuilder_init(&capinfostr, 0);
-		clist* list = imap->etpan->imap_connection_info->imap_capability->cap_list;
-		if (list) {
-			clistiter* cur;
-			for(cur = clist_begin(list) ; cur!=NULL ; cur = clist_next(cur)) {
-				struct mailimap_capability * cap = clist_content(cur);
-				if (cap && cap->cap_type==MAILIMAP_CAPABILITY_NAME) {
-					dc_strbuilder_cat(&capinfostr, " ");
-					dc_strbuilder_cat(&capinfostr, cap->cap_data.cap_name);
-				}
-			}
-		}
-		dc_log_info(imap->context, 0, "IMAP-capabilities:%s", capinfostr.buf);
-		free(capinfostr.buf);
-	}
-
 	imap->connected = 1;
 	success = 1;
 
@@ -1294,6 +1959,26 @@ cleanup:
 }
 
 
+/**
+ * Drop the current connection and connect again, eg. after the network has changed.
+ * Other than dc_imap_disconnect() and dc_imap_connect(), this keeps the capabilities
+ * and the folder list and resumes the TLS session, if possible.
+ *
+ * @private @memberof dc_imap_t
+ * @param imap The IMAP object.
+ * @return 1=reconnected, 0=not connected or the connection failed; in the latter case, we'll try over on the next command.
+ */
+int dc_imap_reconnect(dc_imap_t* imap)
+{
+	if (imap==NULL || !imap->connected) {
+		return 0;
+	}
+
+	imap->should_reconnect = 1;
+	return setup_handle_if_needed(imap);
+}
+
+
 void dc_imap_disconnect(dc_imap_t* imap)
 {
 	if (imap==NULL) {
@@ -1320,7 +2005,7 @@ int dc_imap_is_connected(dc_imap_t* imap)
  ******************************************************************************/
 
 
-dc_imap_t* dc_imap_new(dc_get_config_t get_config, dc_set_config_t set_config, dc_receive_imf_t receive_imf, void* userData, dc_context_t* context)
+dc_imap_t* dc_imap_new(dc_get_config_t get_config, dc_set_config_t set_config, dc_get_location_t get_location, dc_set_location_t set_location, dc_set_locations_t set_locations, dc_parse_imf_t parse_imf, dc_receive_imf_t receive_imf, void* userData, dc_context_t* context)
 {
 	dc_imap_t* imap = NULL;
 
@@ -1333,12 +2018,29 @@ dc_imap_t* dc_imap_new(dc_get_config_t get_config, dc_set_config_t set_config, d
 	imap->context        = context;
 	imap->get_config     = get_config;
 	imap->set_config     = set_config;
+	imap->get_location   = get_location;
+	imap->set_location   = set_location;
+	imap->set_locations  = set_locations;
+	imap->parse_imf      = parse_imf;
 	imap->receive_imf    = receive_imf;
 	imap->userData       = userData;
 
 	pthread_mutex_init(&imap->watch_condmutex, NULL);
 	pthread_cond_init(&imap->watch_cond, NULL);
 
+	if (pipe(imap->interrupt_fd)!=0) {
+		exit(68);
+	}
+	fcntl(imap->interrupt_fd[0], F_SETFL, O_NONBLOCK);
+	fcntl(imap->interrupt_fd[1], F_SETFL, O_NONBLOCK);
+	fcntl(imap->interrupt_fd[0], F_SETFD, FD_CLOEXEC);
+	fcntl(imap->interrupt_fd[1], F_SETFD, FD_CLOEXEC);
+
+	pthread_mutex_init(&imap->parse_condmutex, NULL);
+	pthread_cond_init(&imap->parse_cond, NULL);
+	pthread_cond_init(&imap->parsed_cond, NULL);
+	imap->parse_queue = carray_new(DC_IMAP_MAX_PARSE_AHEAD); /* the parse threads are started by fetch_single_msg() */
+
 	//imap->enter_watch_wait_time = 0;
 
 	imap->selected_folder = calloc(1, 1);
@@ -1367,6 +2069,10 @@ dc_imap_t* dc_imap_new(dc_get_config_t get_config, dc_set_config_t set_config, d
 	imap->fetch_type_flags = mailimap_fetch_type_new_fetch_att_list_empty(); /* object to fetch flags only */
 	mailimap_fetch_type_new_fetch_att_list_add(imap->fetch_type_flags, mailimap_fetch_att_new_flags());
 
+	imap->fetch_type_index = mailimap_fetch_type_new_fetch_att_list_empty(); /* object to fetch the ID and the Message-ID */
+	mailimap_fetch_type_new_fetch_att_list_add(imap->fetch_type_index, mailimap_fetch_att_new_uid());
+	mailimap_fetch_type_new_fetch_att_list_add(imap->fetch_type_index, mailimap_fetch_att_new_envelope());
+
     return imap;
 }
 
@@ -1379,14 +2085,24 @@ void dc_imap_unref(dc_imap_t* imap)
 
 	dc_imap_disconnect(imap);
 
+	stop_parse_threads(imap); /* normally, the threads are already stopped at the end of fetch_from_single_folder() */
+	carray_free(imap->parse_queue);
+	pthread_cond_destroy(&imap->parsed_cond);
+	pthread_cond_destroy(&imap->parse_cond);
+	pthread_mutex_destroy(&imap->parse_condmutex);
+
 	pthread_cond_destroy(&imap->watch_cond);
 	pthread_mutex_destroy(&imap->watch_condmutex);
+	close(imap->interrupt_fd[0]);
+	close(imap->interrupt_fd[1]);
 
+	free_folders(imap->folders);
 	free(imap->selected_folder);
 
 	if (imap->fetch_type_uid)  { mailimap_fetch_type_free(imap->fetch_type_uid);  }
 	if (imap->fetch_type_body) { mailimap_fetch_type_free(imap->fetch_type_body); }
 	if (imap->fetch_type_flags){ mailimap_fetch_type_free(imap->fetch_type_flags);}
+	if (imap->fetch_type_index){ mailimap_fetch_type_free(imap->fetch_type_index);}
 
 	free(imap);
 }
@@ -1458,20 +2174,20 @@ cleanup:
 }
 
 
-static int add_flag(dc_imap_t* imap, uint32_t server_uid, struct mailimap_flag* flag)
+static int add_flag_to_set(dc_imap_t* imap, struct mailimap_set* set, struct mailimap_flag* flag)
 {
 	int                              r               = 0;
 	struct mailimap_flag_list*       flag_list       = NULL;
 	struct mailimap_store_att_flags* store_att_flags = NULL;
-	struct mailimap_set*             set             = mailimap_set_new_single(server_uid);
-
-	if (imap==NULL || imap->etpan==NULL) {
-		goto cleanup;
-	}
 
 	flag_list = mailimap_flag_list_new_empty();
 	mailimap_flag_list_add(flag_list, flag);
 
+	if (imap==NULL || imap->etpan==NULL || set==NULL) {
+		mailimap_flag_list_free(flag_list);
+		goto cleanup;
+	}
+
 	store_att_flags = mailimap_store_att_flags_new_add_flags(flag_list); /* FLAGS.SILENT does not return the new value */
 
 	r = mailimap_uid_store(imap->etpan, set, store_att_flags);
@@ -1483,10 +2199,47 @@ cleanup:
 	if (store_att_flags) {
 		mailimap_store_att_flags_free(store_att_flags);
 	}
+	return (imap==NULL || imap->should_reconnect)? 0 : 1; /* all non-connection states are treated as success - the mail may already be deleted or moved away on the server */
+}
+
+
+static int add_flag(dc_imap_t* imap, uint32_t server_uid, struct mailimap_flag* flag)
+{
+	struct mailimap_set* set = mailimap_set_new_single(server_uid);
+	int                  ret = add_flag_to_set(imap, set, flag);
 	if (set) {
 		mailimap_set_free(set);
 	}
-	return imap->should_reconnect? 0 : 1; /* all non-connection states are treated as success - the mail may already be deleted or moved away on the server */
+	return ret;
+}
+
+
+static int can_create_mdnsent_flag(dc_imap_t* imap)
+{
+	/* Check if the selected folder can handle the `$MDNSent` flag (see RFC 3503). */
+	clistiter* iter;
+
+	if (imap->etpan->imap_selection_info==NULL || imap->etpan->imap_selection_info->sel_perm_flags==NULL) {
+		return 0;
+	}
+
+	for (iter=clist_begin(imap->etpan->imap_selection_info->sel_perm_flags); iter!=NULL; iter=clist_next(iter))
+	{
+		struct mailimap_flag_perm* fp = (struct mailimap_flag_perm*)clist_content(iter);
+		if (fp) {
+			if (fp->fl_type==MAILIMAP_FLAG_PERM_ALL) {
+				return 1;
+			}
+			else if (fp->fl_type==MAILIMAP_FLAG_PERM_FLAG && fp->fl_flag) {
+				struct mailimap_flag* fl = (struct mailimap_flag*)fp->fl_flag;
+				if (fl->fl_type==MAILIMAP_FLAG_KEYWORD && fl->fl_data.fl_keyword && strcmp(fl->fl_data.fl_keyword, "$MDNSent")==0) {
+					return 1;
+				}
+			}
+		}
+	}
+
+	return 0;
 }
 
 
@@ -1494,227 +2247,514 @@ int dc_imap_markseen_msg(dc_imap_t* imap, const char* folder, uint32_t server_ui
                         char** ret_server_folder, uint32_t* ret_server_uid, int* ret_ms_flags)
 {
 	// when marking as seen, there is no real need to check against the rfc724_mid - in the worst case, when the UID validity or the mailbox has changed, we mark the wrong message as "seen" - as the very most messages are seen, this is no big thing.
-	// command would be "STORE 123,456,678 +FLAGS (\Seen)"
-	int                  r   = 0;
-	struct mailimap_set* set = NULL;
+	dc_imap_batch_item_t item;
+	int                  ret = 0;
 
 	if (imap==NULL || folder==NULL || server_uid==0 || ret_server_folder==NULL || ret_server_uid==NULL || ret_ms_flags==NULL
 	 || *ret_server_folder!=NULL || *ret_server_uid!=0 || *ret_ms_flags!=0) {
 		return 1; /* job done */
 	}
 
-	if ((set=mailimap_set_new_single(server_uid))==NULL) {
-		goto cleanup;
+	memset(&item, 0, sizeof(dc_imap_batch_item_t));
+	item.server_uid = server_uid;
+	item.ms_flags   = ms_flags;
+
+	ret = dc_imap_markseen_msgs(imap, folder, &item, 1);
+
+	*ret_ms_flags = item.ret_ms_flags;
+	if (item.ret_server_uid && imap->moveto_folder) {
+		*ret_server_uid = item.ret_server_uid;
+		*ret_server_folder = dc_strdup(imap->moveto_folder);
 	}
 
-	if (imap->etpan==NULL) {
+	return ret;
+}
+
+
+int dc_imap_delete_msg(dc_imap_t* imap, const char* rfc724_mid, const char* folder, uint32_t server_uid)
+{
+	int success = 0;
+
+	if (imap==NULL || rfc724_mid==NULL || folder==NULL || folder[0]==0) {
+		success = 1; /* job done, do not try over */
 		goto cleanup;
 	}
 
-	dc_log_info(imap->context, 0, "Marking message %s/%i as seen...", folder, (int)server_uid);
+	dc_log_info(imap->context, 0, "Marking message \"%s\", %s/%i for deletion...", rfc724_mid, folder, (int)server_uid);
 
 	if (select_folder(imap, folder)==0) {
-		dc_log_warning(imap->context, 0, "Cannot select folder.");
+		dc_log_warning(imap->context, 0, "Cannot select folder \"%s\".", folder); /* maybe the folder does no longer exist */
 		goto cleanup;
 	}
 
-	if (add_flag(imap, server_uid, mailimap_flag_new_seen())==0) {
-		dc_log_warning(imap->context, 0, "Cannot mark message as seen.");
+	/* check if Folder+UID matches the Message-ID
+	(we also detect messages moved around when we do a fetch-all, see
+	dc_update_server_uid() in receive_imf(), however this may take a while) */
+	if (server_uid && !uid_has_rfc724_mid(imap, server_uid, rfc724_mid))
+	{
+		dc_log_warning(imap->context, 0, "UID not found in the given folder or does not match Message-ID.");
+		server_uid = 0;
+	}
+
+	/* server_uid is 0 now if it was not given or if it does not match the given message id;
+	look up the location in the index (the message may be moved by another MUA to a folder we do not sync or the sync is a moment ago) */
+	if (server_uid==0) {
+		dc_log_info(imap->context, 0, "Locating Message-ID \"%s\"...", rfc724_mid);
+		if ((server_uid=locate_msg(imap, rfc724_mid))==0) {
+			dc_log_warning(imap->context, 0, "Message-ID \"%s\" not found in any folder, cannot delete message.", rfc724_mid);
+			goto cleanup;
+		}
+		dc_log_info(imap->context, 0, "Message-ID \"%s\" found in %s/%i", rfc724_mid, imap->selected_folder, server_uid);
+	}
+
+
+	/* mark the message for deletion */
+	if (add_flag(imap, server_uid, mailimap_flag_new_deleted())==0) {
+		dc_log_warning(imap->context, 0, "Cannot mark message as \"Deleted\"."); /* maybe the message is already deleted */
+		goto cleanup;
+	}
+
+	/* force an EXPUNGE resp. CLOSE for the selected folder */
+	imap->selected_folder_needs_expunge = 1;
+
+	if (imap->set_location) {
+		imap->set_location(imap, rfc724_mid, NULL, 0, 0);
+	}
+
+	success = 1;
+
+cleanup:
+	return success? 1 : dc_imap_is_connected(imap); /* only return 0 on connection problems; we should try later again in this case */
+}
+
+
+/*******************************************************************************
+ * Handle several messages of a folder with one command
+ ******************************************************************************/
+
+
+static int cmp_uids(const void* p1, const void* p2)
+{
+	uint32_t v1 = *(const uint32_t*)p1, v2 = *(const uint32_t*)p2;
+	return (v1<v2)? -1 : ((v1>v2)? 1 : 0);
+}
+
+
+/**
+ * Get the UIDs of some batch items as a set for a single UID command.
+ * The UIDs are sorted and consecutive UIDs are merged into ranges,
+ * so that eg. `1,2,3,7` becomes `1:3,7`.  Items without a UID are never added.
+ *
+ * @private @memberof dc_imap_t
+ * @param items The items.
+ * @param cnt The number of items.
+ * @param flags DC_BATCH_MATCHING=only items with a matching Message-ID,
+ *     DC_BATCH_HAS_RFC724_MID=only items with a Message-ID,
+ *     DC_BATCH_NO_MDNSENT=only items without the `$MDNSent` flag on the server;
+ *     DC_MS_ALSO_MOVE or DC_MS_SET_MDNSent_FLAG=only items with these `ms_flags`.
+ * @return The set, must be freed using mailimap_set_free(); may be empty.
+ */
+struct mailimap_set* dc_imap_batch_set_new(const dc_imap_batch_item_t* items, int cnt, int flags)
+{
+	struct mailimap_set* set = mailimap_set_new_empty();
+	uint32_t*            uids = NULL;
+	int                  uids_cnt = 0, i = 0, j = 0;
+	int                  ms_flags = flags&(DC_MS_ALSO_MOVE|DC_MS_SET_MDNSent_FLAG);
+
+	if (set==NULL || items==NULL || cnt<=0) {
+		return set;
+	}
+
+	if ((uids=calloc(cnt, sizeof(uint32_t)))==NULL) {
+		exit(71);
+	}
+
+	for (i = 0; i < cnt; i++) {
+		if (items[i].server_uid
+		 && (!(flags&DC_BATCH_MATCHING) || items[i].matches)
+		 && (!(flags&DC_BATCH_HAS_RFC724_MID) || items[i].rfc724_mid)
+		 && (!(flags&DC_BATCH_NO_MDNSENT) || !items[i].has_mdnsent)
+		 && (items[i].ms_flags&ms_flags)==ms_flags) {
+			uids[uids_cnt++] = items[i].server_uid;
+		}
+	}
+
+	qsort(uids, uids_cnt, sizeof(uint32_t), cmp_uids);
+
+	for (i = 0; i < uids_cnt; i = j) {
+		for (j = i+1; j < uids_cnt && uids[j]<=uids[j-1]+1; j++) {
+			; /* consecutive or duplicate UIDs */
+		}
+		if (uids[i]==uids[j-1]) {
+			mailimap_set_add_single(set, uids[i]);
+		}
+		else {
+			mailimap_set_add_interval(set, uids[i], uids[j-1]);
+		}
+	}
+
+	free(uids);
+	return set;
+}
+
+
+static int get_set_uid_cnt(const struct mailimap_set* set)
+{
+	/* the number of UIDs in a set built by dc_imap_batch_set_new(), which contains no `*` */
+	int        cnt = 0;
+	clistiter* cur = NULL;
+	for (cur = clist_begin(set->set_list); cur!=NULL ; cur = clist_next(cur)) {
+		struct mailimap_set_item* item = (struct mailimap_set_item*)clist_content(cur);
+		cnt += (int)(item->set_last - item->set_first) + 1;
+	}
+	return cnt;
+}
+
+
+static int verify_batch(dc_imap_t* imap, dc_imap_batch_item_t* items, int cnt)
+{
+	/* fetch the Message-IDs and the flags of all given messages with a single UID FETCH.
+	items without a rfc724_mid are not checked against the Message-ID. */
+	int                         i = 0, r = 0;
+	struct mailimap_set*        set = NULL;
+	struct mailimap_fetch_type* fetch_type = NULL;
+	clist*                      fetch_result = NULL;
+	clistiter*                  cur = NULL;
+
+	for (i = 0; i < cnt; i++) {
+		items[i].matches     = (items[i].rfc724_mid==NULL);
+		items[i].has_mdnsent = 0;
+	}
+	set = dc_imap_batch_set_new(items, cnt, 0);
+
+	if (set==NULL || clist_count(set->set_list)==0) {
 		goto cleanup;
 	}
 
-	dc_log_info(imap->context, 0, "Message marked as seen.");
+	fetch_type = mailimap_fetch_type_new_fetch_att_list_empty();
+	mailimap_fetch_type_new_fetch_att_list_add(fetch_type, mailimap_fetch_att_new_envelope());
+	mailimap_fetch_type_new_fetch_att_list_add(fetch_type, mailimap_fetch_att_new_flags());
 
-	if ((ms_flags&DC_MS_SET_MDNSent_FLAG)
-	 && imap->etpan->imap_selection_info!=NULL && imap->etpan->imap_selection_info->sel_perm_flags!=NULL)
+	r = mailimap_uid_fetch(imap->etpan, set, fetch_type, &fetch_result);
+	if (is_error(imap, r) || fetch_result==NULL) {
+		goto cleanup;
+	}
+
+	for (cur = clist_begin(fetch_result); cur!=NULL; cur = clist_next(cur))
 	{
-		/* Check if the folder can handle the `$MDNSent` flag (see RFC 3503).  If so, and not set: set the flags and return this information.
-		If the folder cannot handle the `$MDNSent` flag, we risk duplicated MDNs; it's up to the receiving MUA to handle this then (eg. Delta Chat has no problem with this). */
-		int can_create_flag = 0;
-		clistiter* iter;
-		for (iter=clist_begin(imap->etpan->imap_selection_info->sel_perm_flags); iter!=NULL; iter=clist_next(iter))
-		{
-			struct mailimap_flag_perm* fp = (struct mailimap_flag_perm*)clist_content(iter);
-			if (fp) {
-				if (fp->fl_type==MAILIMAP_FLAG_PERM_ALL) {
-					can_create_flag = 1;
-					break;
-				}
-				else if (fp->fl_type==MAILIMAP_FLAG_PERM_FLAG && fp->fl_flag) {
-					struct mailimap_flag* fl = (struct mailimap_flag*)fp->fl_flag;
-					if (fl->fl_type==MAILIMAP_FLAG_KEYWORD && fl->fl_data.fl_keyword && strcmp(fl->fl_data.fl_keyword, "$MDNSent")==0) {
-						can_create_flag = 1;
-						break;
-					}
+		struct mailimap_msg_att* msg_att = (struct mailimap_msg_att*)clist_content(cur);
+		uint32_t                 uid = peek_uid(msg_att);
+		const char*              quoted_rfc724_mid = peek_rfc724_mid(msg_att);
+		char*                    rfc724_mid = quoted_rfc724_mid? unquote_rfc724_mid(quoted_rfc724_mid) : NULL;
+
+		for (i = 0; i < cnt; i++) {
+			if (items[i].server_uid==uid && uid!=0) {
+				if (items[i].rfc724_mid && rfc724_mid && strcmp(items[i].rfc724_mid, rfc724_mid)==0) {
+					items[i].matches = 1;
 				}
+				items[i].has_mdnsent = peek_flag_keyword(msg_att, "$MDNSent");
 			}
 		}
 
-		if (can_create_flag)
-		{
-			clist* fetch_result = NULL;
-			r = mailimap_uid_fetch(imap->etpan, set, imap->fetch_type_flags, &fetch_result);
-			if (!is_error(imap, r) && fetch_result) {
-				clistiter* cur=clist_begin(fetch_result);
-				if (cur) {
-					if (!peek_flag_keyword((struct mailimap_msg_att*)clist_content(cur), "$MDNSent")) {
-						add_flag(imap, server_uid, mailimap_flag_new_flag_keyword(dc_strdup("$MDNSent")));
-						*ret_ms_flags |= DC_MS_MDNSent_JUST_SET;
-					}
-				}
-				mailimap_fetch_list_free(fetch_result);
-			}
-			dc_log_info(imap->context, 0, ((*ret_ms_flags)&DC_MS_MDNSent_JUST_SET)? "$MDNSent just set and MDN will be sent." : "$MDNSent already set and MDN already sent.");
+		free(rfc724_mid);
+	}
+
+cleanup:
+	if (fetch_result) { mailimap_fetch_list_free(fetch_result); }
+	if (fetch_type) { mailimap_fetch_type_free(fetch_type); }
+	if (set) { mailimap_set_free(set); }
+	return imap->should_reconnect? 0 : 1;
+}
+
+
+static void move_batch(dc_imap_t* imap, const char* folder, dc_imap_batch_item_t* items, int cnt, struct mailimap_set* set)
+{
+	/* move the messages in the given set to imap->moveto_folder; on success, ret_server_uid of the items is set to the new UID */
+	int                  r = 0, i = 0;
+	uint32_t             res_uidvalidity = 0;
+	struct mailimap_set* res_setsrc = NULL;
+	struct mailimap_set* res_setdest = NULL;
+
+	dc_log_info(imap->context, 0, "Moving %i messages from %s to %s...", get_set_uid_cnt(set), folder, imap->moveto_folder);
+
+	r = mailimap_uidplus_uid_move(imap->etpan, set, imap->moveto_folder, &res_uidvalidity, &res_setsrc, &res_setdest);
+	if (is_error(imap, r)) {
+		if (imap->should_reconnect) {
+			goto cleanup;
 		}
-		else
-		{
-			*ret_ms_flags |= DC_MS_MDNSent_JUST_SET;
-			dc_log_info(imap->context, 0, "Cannot store $MDNSent flags, risk sending duplicate MDN.");
+
+		dc_log_info(imap->context, 0, "Cannot move messages, fallback to COPY/DELETE from %s to %s...", folder, imap->moveto_folder);
+		r = mailimap_uidplus_uid_copy(imap->etpan, set, imap->moveto_folder, &res_uidvalidity, &res_setsrc, &res_setdest);
+		if (is_error(imap, r)) {
+			dc_log_info(imap->context, 0, "Cannot copy messages. Leaving in %s.", folder);
+			goto cleanup;
+		}
+
+		if (add_flag_to_set(imap, set, mailimap_flag_new_deleted())==0) {
+			dc_log_warning(imap->context, 0, "Cannot mark messages as \"Deleted\"."); /* maybe the messages are already deleted */
 		}
+
+		/* force an EXPUNGE resp. CLOSE for the selected folder */
+		imap->selected_folder_needs_expunge = 1;
 	}
 
-	if ((ms_flags&DC_MS_ALSO_MOVE) && (imap->server_flags&DC_NO_MOVE_TO_CHATS)==0)
+	/* COPYUID lists the source and the destination UIDs in the same order, see RFC 4315 */
+	if (res_setsrc && res_setdest)
 	{
-		init_chat_folders(imap);
-		if (imap->moveto_folder && strcmp(folder, imap->moveto_folder)==0)
-		{
-			dc_log_info(imap->context, 0, "Message %s/%i is already in %s...", folder, (int)server_uid, imap->moveto_folder);
-			/* avoid deadlocks as moving messages in the same folder may be result in a new server_uid and the state "fresh" -
-			we will catch these messages again on the next poll, try to move them away and so on, see also (***) in dc_receive_imf.c */
-		}
-		else if (imap->moveto_folder)
+		clistiter* src_iter = clist_begin(res_setsrc->set_list);
+		clistiter* dest_iter = clist_begin(res_setdest->set_list);
+		uint32_t   src_uid = src_iter? ((struct mailimap_set_item*)clist_content(src_iter))->set_first : 0;
+		uint32_t   dest_uid = dest_iter? ((struct mailimap_set_item*)clist_content(dest_iter))->set_first : 0;
+		while (src_iter && dest_iter)
 		{
-			dc_log_info(imap->context, 0, "Moving message %s/%i to %s...", folder, (int)server_uid, imap->moveto_folder);
-
-			/* TODO/TOCHECK: MOVE may not be supported on servers, if this is often the case, we should fallback to a COPY/DELETE implementation.
-			Same for the UIDPLUS extension (if in doubt, we can find out the resulting UID using "imap_selection_info->sel_uidnext" then). */
-			uint32_t             res_uid = 0;
-			struct mailimap_set* res_setsrc = NULL;
-			struct mailimap_set* res_setdest = NULL;
-			r = mailimap_uidplus_uid_move(imap->etpan, set, imap->moveto_folder, &res_uid, &res_setsrc, &res_setdest); /* the correct folder is already selected in add_flag() above */
-			if (is_error(imap, r)) {
-								dc_log_info(imap->context, 0, "Cannot move message, fallback to COPY/DELETE %s/%i to %s...", folder, (int)server_uid, imap->moveto_folder);
-								r = mailimap_uidplus_uid_copy(imap->etpan, set, imap->moveto_folder, &res_uid, &res_setsrc, &res_setdest);
-								if (is_error(imap, r)) {
-									dc_log_info(imap->context, 0, "Cannot copy message. Leaving in INBOX");
-									goto cleanup;
-								}
-								else {
-									dc_log_info(imap->context, 0, "Deleting msg ...");
-									if (add_flag(imap, server_uid, mailimap_flag_new_deleted())==0) {
-											dc_log_warning(imap->context, 0, "Cannot mark message as \"Deleted\".");/* maybe the message is already deleted */
-									}
-
-									/* force an EXPUNGE resp. CLOSE for the selected folder */
-									imap->selected_folder_needs_expunge = 1;
-								}
-
-							}
+			for (i = 0; i < cnt; i++) {
+				if (items[i].server_uid==src_uid && items[i].done) {
+					items[i].ret_server_uid = dest_uid;
+				}
+			}
 
-			if (res_setsrc) {
-				mailimap_set_free(res_setsrc);
+			if (src_uid < ((struct mailimap_set_item*)clist_content(src_iter))->set_last) {
+				src_uid++;
+			}
+			else if ((src_iter=clist_next(src_iter))!=NULL) {
+				src_uid = ((struct mailimap_set_item*)clist_content(src_iter))->set_first;
 			}
 
-			if (res_setdest) {
-				clistiter* cur = clist_begin(res_setdest->set_list);
-				if (cur!=NULL) {
-					struct mailimap_set_item* item;
-					item = clist_content(cur);
-					*ret_server_uid = item->set_first;
-					*ret_server_folder = dc_strdup(imap->moveto_folder);
-				}
-				mailimap_set_free(res_setdest);
+			if (dest_uid < ((struct mailimap_set_item*)clist_content(dest_iter))->set_last) {
+				dest_uid++;
+			}
+			else if ((dest_iter=clist_next(dest_iter))!=NULL) {
+				dest_uid = ((struct mailimap_set_item*)clist_content(dest_iter))->set_first;
 			}
+		}
+	}
 
-			// TODO: If the new UID is equal to lastuid.Chats, we should increase lastuid.Chats by one
-			// (otherwise, we'll download the mail in moment again from the chats folder ...)
+	// TODO: If the new UID is equal to lastuid.Chats, we should increase lastuid.Chats by one
+	// (otherwise, we'll download the mail in moment again from the chats folder ...)
 
-			dc_log_info(imap->context, 0, "Message moved.");
+	/* without COPYUID, the new location is unknown; the old one is outdated in any case.
+	messages with a new UID are added to the index by dc_update_server_uid() */
+	if (imap->set_location) {
+		for (i = 0; i < cnt; i++) {
+			if (items[i].done && items[i].ret_server_uid==0 && items[i].rfc724_mid
+			 && (items[i].ms_flags&DC_MS_ALSO_MOVE) && items[i].server_uid && items[i].matches) {
+				imap->set_location(imap, items[i].rfc724_mid, NULL, 0, 0);
+			}
 		}
 	}
 
+	dc_log_info(imap->context, 0, "Messages moved.");
+
 cleanup:
-	if (set) {
-		mailimap_set_free(set);
-	}
-	return imap->should_reconnect? 0 : 1;
+	if (res_setsrc) { mailimap_set_free(res_setsrc); }
+	if (res_setdest) { mailimap_set_free(res_setdest); }
 }
 
 
-int dc_imap_delete_msg(dc_imap_t* imap, const char* rfc724_mid, const char* folder, uint32_t server_uid)
+/**
+ * Mark several messages of a folder as seen, set `$MDNSent` and move them to
+ * the chats folder as requested by the `ms_flags` of each item.
+ *
+ * Instead of a SELECT, a FETCH and several STOREs per message, the folder is
+ * selected once and there is at most one UID FETCH, one UID STORE per flag and one
+ * UID MOVE for all messages.
+ *
+ * Items with a `rfc724_mid` are only touched if the Message-ID on the server
+ * matches; items that do not match are not marked as `done` and should be
+ * handled using dc_imap_markseen_msg() then.
+ * If a message was moved, `ret_server_uid` is its new UID in imap->moveto_folder.
+ *
+ * @private @memberof dc_imap_t
+ * @param imap The IMAP object.
+ * @param folder The folder containing all messages.
+ * @param items The messages, at most DC_IMAP_BATCH_MAX.
+ * @param cnt The number of items.
+ * @return 0 on connection problems, the caller should try again later then; 1 otherwise.
+ */
+int dc_imap_markseen_msgs(dc_imap_t* imap, const char* folder, dc_imap_batch_item_t* items, int cnt)
 {
-	int    success       = 0;
-	int    r             = 0;
-	clist* fetch_result  = NULL;
-	char*  is_rfc724_mid = NULL;
-	char*  new_folder    = NULL;
+	int                  i = 0;
+	int                  needs_fetch = 0;
+	int                  can_create_flag = 0;
+	struct mailimap_set* seen_set = NULL;
+	struct mailimap_set* mdnsent_set = NULL;
+	struct mailimap_set* move_set = NULL;
+
+	if (imap==NULL || folder==NULL || items==NULL || cnt<=0) {
+		return 1;
+	}
 
-	if (imap==NULL || rfc724_mid==NULL || folder==NULL || folder[0]==0) {
-		success = 1; /* job done, do not try over */
+	if (imap->etpan==NULL) {
 		goto cleanup;
 	}
 
-	dc_log_info(imap->context, 0, "Marking message \"%s\", %s/%i for deletion...", rfc724_mid, folder, (int)server_uid);
+	dc_log_info(imap->context, 0, "Marking %i messages in %s as seen...", cnt, folder);
 
 	if (select_folder(imap, folder)==0) {
-		dc_log_warning(imap->context, 0, "Cannot select folder \"%s\".", folder); /* maybe the folder does no longer exist */
+		dc_log_warning(imap->context, 0, "Cannot select folder.");
 		goto cleanup;
 	}
 
-	/* check if Folder+UID matches the Message-ID (to detect if the messages
-	was moved around by other MUAs and in place of an UIDVALIDITY check)
-	(we also detect messages moved around when we do a fetch-all, see
-	dc_update_server_uid() in receive_imf(), however this may take a while) */
-	if (server_uid)
-	{
-		clistiter* cur = NULL;
-		const char* is_quoted_rfc724_mid = NULL;
-
-		struct mailimap_set* set = mailimap_set_new_single(server_uid);
-			r = mailimap_uid_fetch(imap->etpan, set, imap->fetch_type_message_id, &fetch_result);
-		mailimap_set_free(set);
-
-		if (is_error(imap, r) || fetch_result==NULL
-		 || (cur=clist_begin(fetch_result))==NULL
-		 || (is_quoted_rfc724_mid=peek_rfc724_mid((struct mailimap_msg_att*)clist_content(cur)))==NULL
-		 || (is_rfc724_mid=unquote_rfc724_mid(is_quoted_rfc724_mid))==NULL
-		 || strcmp(is_rfc724_mid, rfc724_mid)!=0)
-		{
-			dc_log_warning(imap->context, 0, "UID not found in the given folder or does not match Message-ID.");
-			server_uid = 0;
+	for (i = 0; i < cnt; i++) {
+		if (items[i].rfc724_mid || (items[i].ms_flags&DC_MS_SET_MDNSent_FLAG)) {
+			needs_fetch = 1;
 		}
 	}
 
-	/* server_uid is 0 now if it was not given or if it does not match the given message id;
-	try to search for it in all folders (the message may be moved by another MUA to a folder we do not sync or the sync is a moment ago) */
-	if (server_uid==0) {
-		dc_log_info(imap->context, 0, "Searching UID by Message-ID \"%s\"...", rfc724_mid);
-		if ((server_uid=search_uid(imap, rfc724_mid))==0) {
-			dc_log_warning(imap->context, 0, "Message-ID \"%s\" not found in any folder, cannot delete message.", rfc724_mid);
+	if (needs_fetch) {
+		if (!verify_batch(imap, items, cnt)) {
 			goto cleanup;
 		}
-		dc_log_info(imap->context, 0, "Message-ID \"%s\" found in %s/%i", rfc724_mid, imap->selected_folder, server_uid);
+	}
+	else {
+		for (i = 0; i < cnt; i++) {
+			items[i].matches = 1;
+		}
 	}
 
+	for (i = 0; i < cnt; i++) {
+		if (items[i].server_uid==0) {
+			items[i].done = 1; /* nothing to do */
+		}
+	}
+	seen_set = dc_imap_batch_set_new(items, cnt, DC_BATCH_MATCHING);
 
-	/* mark the message for deletion */
-	if (add_flag(imap, server_uid, mailimap_flag_new_deleted())==0) {
-		dc_log_warning(imap->context, 0, "Cannot mark message as \"Deleted\"."); /* maybe the message is already deleted */
+	if (clist_count(seen_set->set_list)==0) {
 		goto cleanup;
 	}
 
-	/* force an EXPUNGE resp. CLOSE for the selected folder */
-	imap->selected_folder_needs_expunge = 1;
+	if (add_flag_to_set(imap, seen_set, mailimap_flag_new_seen())==0) {
+		dc_log_warning(imap->context, 0, "Cannot mark messages as seen.");
+		goto cleanup;
+	}
 
-	success = 1;
+	for (i = 0; i < cnt; i++) {
+		if (items[i].server_uid && items[i].matches) {
+			items[i].done = 1;
+		}
+	}
 
-cleanup:
+	/* If the folder cannot handle the `$MDNSent` flag, we risk duplicated MDNs; it's up to the receiving MUA to handle this then (eg. Delta Chat has no problem with this). */
+	can_create_flag = can_create_mdnsent_flag(imap);
+	for (i = 0; i < cnt; i++) {
+		if (items[i].server_uid && items[i].matches && (items[i].ms_flags&DC_MS_SET_MDNSent_FLAG)) {
+			if (!can_create_flag) {
+				items[i].ret_ms_flags |= DC_MS_MDNSent_JUST_SET;
+				dc_log_info(imap->context, 0, "Cannot store $MDNSent flags, risk sending duplicate MDN.");
+			}
+			else if (!items[i].has_mdnsent) {
+				items[i].ret_ms_flags |= DC_MS_MDNSent_JUST_SET;
+			}
+		}
+	}
+	mdnsent_set = can_create_flag? dc_imap_batch_set_new(items, cnt, DC_BATCH_MATCHING|DC_BATCH_NO_MDNSENT|DC_MS_SET_MDNSent_FLAG) : mailimap_set_new_empty();
 
-	if (fetch_result) { mailimap_fetch_list_free(fetch_result); }
-	free(is_rfc724_mid);
-	free(new_folder);
+	if (clist_count(mdnsent_set->set_list)>0) {
+		add_flag_to_set(imap, mdnsent_set, mailimap_flag_new_flag_keyword(dc_strdup("$MDNSent")));
+		dc_log_info(imap->context, 0, "$MDNSent set for %i messages, MDNs will be sent.", get_set_uid_cnt(mdnsent_set));
+	}
 
-	return success? 1 : dc_imap_is_connected(imap); /* only return 0 on connection problems; we should try later again in this case */
+	if ((imap->server_flags&DC_NO_MOVE_TO_CHATS)==0)
+	{
+		move_set = dc_imap_batch_set_new(items, cnt, DC_BATCH_MATCHING|DC_MS_ALSO_MOVE);
 
+		if (clist_count(move_set->set_list)>0)
+		{
+			init_chat_folders(imap);
+			if (imap->moveto_folder && strcmp(folder, imap->moveto_folder)==0)
+			{
+				/* avoid deadlocks as moving messages in the same folder may be result in a new server_uid and the state "fresh" -
+				we will catch these messages again on the next poll, try to move them away and so on, see also (***) in dc_receive_imf.c */
+				dc_log_info(imap->context, 0, "Messages are already in %s...", imap->moveto_folder);
+			}
+			else if (imap->moveto_folder)
+			{
+				move_batch(imap, folder, items, cnt, move_set);
+			}
+		}
+	}
+
+cleanup:
+	if (seen_set) { mailimap_set_free(seen_set); }
+	if (mdnsent_set) { mailimap_set_free(mdnsent_set); }
+	if (move_set) { mailimap_set_free(move_set); }
+	return imap->should_reconnect? 0 : 1;
 }
 
+
+/**
+ * Delete several messages of a folder.
+ *
+ * The Message-IDs of all messages are checked using one UID FETCH, the
+ * matching messages are flagged as deleted with one UID STORE and, if the server
+ * supports UIDPLUS, removed with one UID EXPUNGE.  Otherwise, they are removed
+ * when the folder is closed.
+ *
+ * Items that do not match are not marked as `done`; they may have been moved
+ * by another MUA and should be handled using dc_imap_delete_msg() then.
+ *
+ * @private @memberof dc_imap_t
+ * @param imap The IMAP object.
+ * @param folder The folder containing all messages.
+ * @param items The messages, each with `rfc724_mid` set, at most DC_IMAP_BATCH_MAX.
+ * @param cnt The number of items.
+ * @return 0 on connection problems, the caller should try again later then; 1 otherwise.
+ */
+int dc_imap_delete_msgs(dc_imap_t* imap, const char* folder, dc_imap_batch_item_t* items, int cnt)
+{
+	int                  i = 0, r = 0;
+	struct mailimap_set* set = NULL;
+
+	if (imap==NULL || folder==NULL || folder[0]==0 || items==NULL || cnt<=0) {
+		return 1;
+	}
+
+	if (imap->etpan==NULL) {
+		goto cleanup;
+	}
+
+	dc_log_info(imap->context, 0, "Marking %i messages in %s for deletion...", cnt, folder);
+
+	if (select_folder(imap, folder)==0) {
+		dc_log_warning(imap->context, 0, "Cannot select folder \"%s\".", folder); /* maybe the folder does no longer exist */
+		goto cleanup;
+	}
+
+	if (!verify_batch(imap, items, cnt)) {
+		goto cleanup;
+	}
+
+	set = dc_imap_batch_set_new(items, cnt, DC_BATCH_MATCHING|DC_BATCH_HAS_RFC724_MID);
+	if (clist_count(set->set_list)==0) {
+		goto cleanup;
+	}
+
+	if (add_flag_to_set(imap, set, mailimap_flag_new_deleted())==0) {
+		dc_log_warning(imap->context, 0, "Cannot mark messages as \"Deleted\".");
+		goto cleanup;
+	}
+
+	for (i = 0; i < cnt; i++) {
+		if (items[i].server_uid && items[i].rfc724_mid && items[i].matches) {
+			items[i].done = 1;
+			if (imap->set_location) {
+				imap->set_location(imap, items[i].rfc724_mid, NULL, 0, 0);
+			}
+		}
+	}
+
+	/* remove only the messages just flagged; without UIDPLUS, force an EXPUNGE resp. CLOSE for the selected folder */
+	r = MAILIMAP_ERROR_EXTENSION;
+	if (imap->has_uidplus) {
+		r = mailimap_uid_expunge(imap->etpan, set);
+	}
+	if (is_error(imap, r)) {
+		imap->selected_folder_needs_expunge = 1;
+	}
+
+	dc_log_info(imap->context, 0, "%i messages deleted.", get_set_uid_cnt(set));
+
+cleanup:
+	if (set) { mailimap_set_free(set); }
+	return imap->should_reconnect? 0 : 1;
+}
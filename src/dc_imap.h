@@ -32,15 +32,22 @@ extern "C" {
 #endif
 
 
+#include "dc_countstream.h"
+
+
 typedef struct dc_loginparam_t dc_loginparam_t;
 typedef struct dc_imap_t dc_imap_t;
 
 
 typedef char*    (*dc_get_config_t)    (dc_imap_t*, const char*, const char*);
 typedef void     (*dc_set_config_t)    (dc_imap_t*, const char*, const char*);
+typedef int      (*dc_get_location_t)  (dc_imap_t*, const char* rfc724_mid, char** ret_folder, uint32_t* ret_uidvalidity, uint32_t* ret_uid);
+typedef void     (*dc_set_location_t)  (dc_imap_t*, const char* rfc724_mid, const char* folder, uint32_t uidvalidity, uint32_t uid); /* a folder of NULL removes the location */
+typedef void     (*dc_set_locations_t) (dc_imap_t*, const char* folder, uint32_t uidvalidity, int replace, char** rfc724_mids, const uint32_t* uids, int cnt); /* replace=1 removes the other locations in the folder */
 
 #define DC_IMAP_SEEN 0x0001L
-typedef void     (*dc_receive_imf_t)   (dc_imap_t*, const char* imf_raw_not_terminated, size_t imf_raw_bytes, const char* server_folder, uint32_t server_uid, uint32_t flags);
+typedef void*    (*dc_parse_imf_t)     (dc_imap_t*, const char* imf_raw_not_terminated, size_t imf_raw_bytes); /* called from several worker threads */
+typedef void     (*dc_receive_imf_t)   (dc_imap_t*, const char* imf_raw_not_terminated, size_t imf_raw_bytes, const char* server_folder, uint32_t server_uid, uint32_t flags, void* parsed);
 
 
 /**
@@ -66,8 +73,16 @@ typedef struct dc_imap_t
 	int                   selected_folder_needs_expunge;
 	int                   should_reconnect;
 
+	/* capabilities, read on the first connection and kept until dc_imap_disconnect() */
+	int                   capabilities_read;
 	int                   can_idle;
 	int                   has_xlist;
+	int                   has_uidplus;
+	int                   has_compress;
+	int                   compressed;   /* COMPRESS=DEFLATE is active on the current connection */
+
+	clist*                folders;      /* cached folder list, see get_folders() */
+	time_t                folders_time; /* 0=the list needs to be fetched again */
 	char*                 moveto_folder;// Folder, where reveived chat messages should go to.  Normally DC_CHATS_FOLDER, may be NULL to leave them in the INBOX
 	char*                 sent_folder;  // Folder, where send messages should go to.  Normally DC_CHATS_FOLDER.
 	char                  imap_delimiter;/* IMAP Path separator. Set as a side-effect in list_folders__ */
@@ -76,13 +91,47 @@ typedef struct dc_imap_t
 	pthread_mutex_t       watch_condmutex;
 	int                   watch_condflag;
 
+	/* IDLE driven by an external event loop, see dc_imap_idle_start() */
+	int                   idling;       /* IDLE is sent, dc_imap_idle_done() must be called before other commands */
+	double                idle_readable_ms; /* when the event loop saw the socket getting readable, 0=unknown, see dc_imap_idle_readable() */
+	int                   interrupt_fd[2]; /* a pipe, readable after dc_imap_interrupt_idle() */
+
+	/* IDLE statistics */
+	time_t                idle_stats_since;
+	uint32_t              idle_wakeups;
+	double                idle_data_ms;   /* the time the server reported new data, 0=none since the last fetch */
+	double                ingest_ms;      /* sum of the time from the report to the end of the fetch */
+	uint32_t              ingest_cnt;
+
 	struct mailimap_fetch_type* fetch_type_uid;
 	struct mailimap_fetch_type* fetch_type_message_id;
 	struct mailimap_fetch_type* fetch_type_body;
 	struct mailimap_fetch_type* fetch_type_flags;
+	struct mailimap_fetch_type* fetch_type_index;
+
+	/* the location of messages by their Message-ID is tracked using get_location()/set_location()/set_locations();
+	messages not in the index are searched by scanning the UIDs above the ones already indexed, see refresh_index() */
+	time_t                last_index_refresh_time;
+
+	/* while messages are downloaded, the already downloaded ones are parsed by some worker threads;
+	receive_imf() is called with the results in UID order from the thread calling dc_imap_fetch();
+	the worker threads exist only while a folder is fetched, so idle connections do not keep any threads */
+	#define               DC_IMAP_MAX_PARSE_THREADS 4
+	#define               DC_IMAP_MAX_PARSE_AHEAD  16
+	pthread_t             parse_threads[DC_IMAP_MAX_PARSE_THREADS];
+	int                   parse_threads_cnt;
+	pthread_mutex_t       parse_condmutex;
+	pthread_cond_t        parse_cond;   /* signalled when a message is added to parse_queue or on shutdown */
+	pthread_cond_t        parsed_cond;  /* signalled when a message is parsed */
+	carray*               parse_queue;  /* messages in UID order, the first one is the next one to be received */
+	int                   parse_shutdown;
 
 	dc_get_config_t       get_config;
 	dc_set_config_t       set_config;
+	dc_get_location_t     get_location;
+	dc_set_location_t     set_location;
+	dc_set_locations_t    set_locations;
+	dc_parse_imf_t        parse_imf;    /* may be NULL, messages are parsed by receive_imf() then */
 	dc_receive_imf_t      receive_imf;
 	void*                 userData;
 	dc_context_t*         context;
@@ -90,19 +139,30 @@ typedef struct dc_imap_t
 	int                   log_connect_errors;
 	int                   skip_log_capabilities;
 
+	/* traffic of all connections so far; with compression, the payload is larger than the data on the wire */
+	dc_streamcount_t      wire_count;
+	dc_streamcount_t      payload_count;
+
 } dc_imap_t;
 
 
-dc_imap_t* dc_imap_new               (dc_get_config_t, dc_set_config_t, dc_receive_imf_t, void* userData, dc_context_t*);
+dc_imap_t* dc_imap_new               (dc_get_config_t, dc_set_config_t, dc_get_location_t, dc_set_location_t, dc_set_locations_t, dc_parse_imf_t, dc_receive_imf_t, void* userData, dc_context_t*);
 void       dc_imap_unref             (dc_imap_t*);
 
 int        dc_imap_connect           (dc_imap_t*, const dc_loginparam_t*);
+int        dc_imap_reconnect         (dc_imap_t*);
 void       dc_imap_disconnect        (dc_imap_t*);
 int        dc_imap_is_connected      (dc_imap_t*);
 int        dc_imap_fetch             (dc_imap_t*);
 
-void       dc_imap_idle              (dc_imap_t*);
+#define    DC_IDLE_RETRY_SECONDS     60        /* if there are jobs to retry, IDLE is cancelled after this time */
+#define    DC_IDLE_KEEPALIVE_SECONDS (23*60)   /* otherwise, IDLE is re-issued after this time; servers may drop IDLE after 29 minutes, RFC 2177 */
+void       dc_imap_idle              (dc_imap_t*, int max_seconds);
 void       dc_imap_interrupt_idle    (dc_imap_t*);
+int        dc_imap_idle_start        (dc_imap_t*);
+void       dc_imap_idle_readable     (dc_imap_t*, double readable_ms);
+void       dc_imap_idle_done         (dc_imap_t*);
+int        dc_imap_get_interrupt_fd  (dc_imap_t*);
 
 int        dc_imap_append_msg        (dc_imap_t*, time_t timestamp, const char* data_not_terminated, size_t data_bytes, char** ret_server_folder, uint32_t* ret_server_uid);
 
@@ -114,6 +174,31 @@ int        dc_imap_markseen_msg      (dc_imap_t*, const char* folder, uint32_t s
 int        dc_imap_delete_msg        (dc_imap_t*, const char* rfc724_mid, const char* folder, uint32_t server_uid); /* only returns 0 on connection problems; we should try later again in this case */
 
 
+/* a message handled by dc_imap_markseen_msgs() or dc_imap_delete_msgs() */
+typedef struct dc_imap_batch_item_t
+{
+	uint32_t    server_uid;
+	const char* rfc724_mid;     /* if set, the message is only touched if the Message-ID on the server matches */
+	int         ms_flags;       /* DC_MS_ALSO_MOVE and DC_MS_SET_MDNSent_FLAG, used by dc_imap_markseen_msgs() */
+
+	int         done;           /* set if the message was handled, otherwise, the message should be handled by dc_imap_markseen_msg() or dc_imap_delete_msg() */
+	int         ret_ms_flags;   /* DC_MS_MDNSent_JUST_SET */
+	uint32_t    ret_server_uid; /* set if the message was moved to imap->moveto_folder */
+
+	int         matches;        /* used internally */
+	int         has_mdnsent;    /* used internally */
+} dc_imap_batch_item_t;
+
+#define    DC_IMAP_BATCH_MAX        500
+
+#define    DC_BATCH_MATCHING        0x0100 /* flags for dc_imap_batch_set_new(), may be combined with DC_MS_ALSO_MOVE and DC_MS_SET_MDNSent_FLAG */
+#define    DC_BATCH_HAS_RFC724_MID  0x0200
+#define    DC_BATCH_NO_MDNSENT      0x0400
+struct mailimap_set* dc_imap_batch_set_new (const dc_imap_batch_item_t*, int cnt, int flags);
+int        dc_imap_markseen_msgs     (dc_imap_t*, const char* folder, dc_imap_batch_item_t*, int cnt); /* only returns 0 on connection problems; we should try later again in this case */
+int        dc_imap_delete_msgs       (dc_imap_t*, const char* folder, dc_imap_batch_item_t*, int cnt); /* only returns 0 on connection problems; we should try later again in this case */
+
+
 #ifdef __cplusplus
 } /* /extern "C" */
 #endif
@@ -22,7 +22,10 @@
 
 #include <assert.h>
 #include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <unistd.h> /* for sleep() */
+#include <sys/stat.h>
 #include <openssl/rand.h>
 #include <libetpan/mmapstring.h>
 #include <netpgp-extra.h>
@@ -34,6 +37,7 @@
 #include "dc_pgp.h"
 #include "dc_mimefactory.h"
 #include "dc_job.h"
+#include "dc_filecopy.h"
 
 
 /*******************************************************************************
@@ -827,22 +831,177 @@ cleanup:
 }
 
 
+/*******************************************************************************
+ * Track changes for incremental backups
+ ******************************************************************************/
+
+
+/* After a full backup was exported by export_increment(), triggers record the rowids
+of inserted, updated and deleted rows in `backup_changes`. An increment contains these rows,
+the rowids of deleted rows and the files added since the previous backup.
+The backups store their id as `backup_id` in `config` (full backups)
+or in `backup_increment` (increments, together with the id of the previous backup).
+Tables and triggers starting with `backup_` are never restored.
+
+Tables and config-keys that are written all the time and that can be recreated from the server
+are not tracked: `jobs`, the index of message locations (`imap_index` and `imap.*`),
+the state of incremental backups and the progress of the summary backfill.
+On restore, they keep the state of the full backup, however, the outdated jobs are dropped. */
+#define DC_BACKUP_TIME_SLACK 60 /* files modified this number of seconds before the last backup are added again */
+#define DC_BACKUP_UNTRACKED_TABLES "'jobs', 'imap_index'"
+#define DC_BACKUP_UNTRACKED_KEYS(row) \
+	row ".keyname LIKE 'imap.%' OR " row ".keyname LIKE 'backup\\_%' ESCAPE '\\' OR " row ".keyname='summary_backfill_id'"
+
+
+static int backup_exec(sqlite3* db, const char* query, dc_context_t* context)
+{
+	char* errmsg = NULL;
+	if (sqlite3_exec(db, query, NULL, NULL, &errmsg)!=SQLITE_OK) {
+		dc_log_error(context, 0, "Backup: Cannot execute \"%s\": %s", query, errmsg? errmsg : "?");
+		sqlite3_free(errmsg);
+		return 0;
+	}
+	return 1;
+}
+
+
+static int table_has_rowid_alias(sqlite3* db, const char* schema, const char* table)
+{
+	/* rowids are only stable if there is an INTEGER PRIMARY KEY,
+	other tables are restored with new rowids and must be sent as a whole */
+	int           pk_cnt = 0;
+	int           is_integer = 0;
+	char*         q3 = sqlite3_mprintf("PRAGMA \"%w\".table_info(\"%w\");", schema, table);
+	sqlite3_stmt* stmt = NULL;
+
+	if (sqlite3_prepare_v2(db, q3, -1, &stmt, NULL)==SQLITE_OK) {
+		while (sqlite3_step(stmt)==SQLITE_ROW) {
+			if (sqlite3_column_int(stmt, 5)>0) {
+				pk_cnt++;
+				is_integer = sqlite3_column_text(stmt, 2) && strcasecmp((const char*)sqlite3_column_text(stmt, 2), "INTEGER")==0;
+			}
+		}
+	}
+
+	sqlite3_finalize(stmt);
+	sqlite3_free(q3);
+	return (pk_cnt==1 && is_integer);
+}
+
+
+static int backup_tracking_start(dc_context_t* context)
+{
+	int           success = 0;
+	sqlite3_stmt* stmt = NULL;
+	dc_array_t*   triggers = dc_array_new(context, 32);
+	dc_array_t*   tables = dc_array_new(context, 32);
+	char*         q3 = NULL;
+	int           i = 0;
+
+	/* invalidate the old chain first, the recorded changes are dropped below */
+	dc_sqlite3_set_config(context->sql, "backup_base_id", NULL);
+
+	if (!dc_sqlite3_execute(context->sql, "CREATE TABLE IF NOT EXISTS backup_changes (tbl TEXT, id INTEGER, UNIQUE (tbl, id) ON CONFLICT REPLACE);")) {
+		goto cleanup;
+	}
+
+	/* the triggers are created from scratch, so that they match the current schema and the untracked tables */
+	stmt = dc_sqlite3_prepare(context->sql,
+		"SELECT name FROM sqlite_master WHERE type='trigger' AND name LIKE 'backup\\_%' ESCAPE '\\';");
+	while (sqlite3_step(stmt)==SQLITE_ROW) {
+		dc_array_add_ptr(triggers, dc_strdup((const char*)sqlite3_column_text(stmt, 0)));
+	}
+	sqlite3_finalize(stmt);
+	stmt = NULL;
+
+	for (i = 0; i < dc_array_get_cnt(triggers); i++) {
+		sqlite3_free(q3);
+		q3 = sqlite3_mprintf("DROP TRIGGER IF EXISTS \"%w\";", (const char*)dc_array_get_ptr(triggers, i));
+		if (!dc_sqlite3_execute(context->sql, q3)) {
+			goto cleanup;
+		}
+	}
+
+	stmt = dc_sqlite3_prepare(context->sql,
+		"SELECT name FROM sqlite_master WHERE type='table' AND name NOT LIKE 'sqlite\\_%' ESCAPE '\\' AND name NOT LIKE 'backup\\_%' ESCAPE '\\'"
+		" AND name NOT IN (" DC_BACKUP_UNTRACKED_TABLES ");");
+	while (sqlite3_step(stmt)==SQLITE_ROW) {
+		dc_array_add_ptr(tables, dc_strdup((const char*)sqlite3_column_text(stmt, 0)));
+	}
+	sqlite3_finalize(stmt);
+	stmt = NULL;
+
+	/* a REPLACE moves an entry to a new rowid, so entries added after an increment was written survive the cleanup */
+	for (i = 0; i < dc_array_get_cnt(tables); i++) {
+		const char* table = (const char*)dc_array_get_ptr(tables, i);
+		int         is_config = strcmp(table, "config")==0;
+		sqlite3_free(q3);
+		q3 = sqlite3_mprintf(
+			"CREATE TRIGGER \"backup_ins_%w\" AFTER INSERT ON \"%w\" %s BEGIN INSERT INTO backup_changes (tbl, id) VALUES (%Q, NEW.rowid); END;"
+			"CREATE TRIGGER \"backup_upd_%w\" AFTER UPDATE ON \"%w\" %s BEGIN INSERT INTO backup_changes (tbl, id) VALUES (%Q, OLD.rowid), (%Q, NEW.rowid); END;"
+			"CREATE TRIGGER \"backup_del_%w\" AFTER DELETE ON \"%w\" %s BEGIN INSERT INTO backup_changes (tbl, id) VALUES (%Q, OLD.rowid); END;",
+			table, table, is_config? "WHEN NOT (" DC_BACKUP_UNTRACKED_KEYS("NEW") ")" : "", table,
+			table, table, is_config? "WHEN NOT (" DC_BACKUP_UNTRACKED_KEYS("NEW") ") OR NOT (" DC_BACKUP_UNTRACKED_KEYS("OLD") ")" : "", table, table,
+			table, table, is_config? "WHEN NOT (" DC_BACKUP_UNTRACKED_KEYS("OLD") ")" : "", table);
+		if (sqlite3_exec(context->sql->cobj, q3, NULL, NULL, NULL)!=SQLITE_OK) {
+			dc_sqlite3_log_error(context->sql, "Cannot track changes of \"%s\".", table);
+			goto cleanup;
+		}
+	}
+
+	if (!dc_sqlite3_execute(context->sql, "DELETE FROM backup_changes;")) {
+		goto cleanup;
+	}
+
+	success = 1;
+
+cleanup:
+	sqlite3_free(q3);
+	sqlite3_finalize(stmt);
+	dc_array_free_ptr(triggers);
+	dc_array_unref(triggers);
+	dc_array_free_ptr(tables);
+	dc_array_unref(tables);
+	return success;
+}
+
+
 /*******************************************************************************
  * Export backup
  ******************************************************************************/
 
 
+/* copying the database file is reported as the first DB_COPY_PERMILLE permille,
+the files are reported from there on. */
+#define DB_COPY_PERMILLE 200
+
+
 /* the FILE_PROGRESS macro calls the callback with the permille of files processed.
 The macro avoids weird values of 0% or 100% while still working. */
 #define FILE_PROGRESS \
 	processed_files_cnt++; \
-	int permille = (processed_files_cnt*1000)/total_files_cnt; \
+	int permille = DB_COPY_PERMILLE + (processed_files_cnt*(1000-DB_COPY_PERMILLE))/total_files_cnt; \
 	if (permille <  10) { permille =  10; } \
 	if (permille > 990) { permille = 990; } \
 	context->cb(context, DC_EVENT_IMEX_PROGRESS, permille, 0);
 
 
-static int export_backup(dc_context_t* context, const char* dir)
+static int db_copy_progress(void* userdata, uint64_t copied_bytes, uint64_t total_bytes)
+{
+	dc_context_t* context = (dc_context_t*)userdata;
+
+	if (context->shall_stop_ongoing) {
+		return 0;
+	}
+
+	int permille = total_bytes? (int)((copied_bytes*DB_COPY_PERMILLE)/total_bytes) : DB_COPY_PERMILLE;
+	if (permille < 10) { permille = 10; }
+	context->cb(context, DC_EVENT_IMEX_PROGRESS, permille, 0);
+	return 1;
+}
+
+
+static int export_backup(dc_context_t* context, const char* dir, int start_tracking)
 {
 	int            success = 0;
 	int            closed = 0;
@@ -860,6 +1019,7 @@ static int export_backup(dc_context_t* context, const char* dir)
 	int            total_files_cnt = 0;
 	int            processed_files_cnt = 0;
 	int            delete_dest_file = 0;
+	char*          backup_id = dc_create_id();
 
 	/* get a fine backup file name (the name includes the date so that multiple backup instances are possible)
 	FIXME: we should write to a temporary file first and rename it on success. this would guarantee the backup is complete. however, currently it is not clear it the import exists in the long run (may be replaced by a restore-from-imap)*/
@@ -874,16 +1034,21 @@ static int export_backup(dc_context_t* context, const char* dir)
 		}
 	}
 
+	/* for incremental backups, record changes from now on (see export_increment()) */
+	if (start_tracking && !backup_tracking_start(context)) {
+		goto cleanup;
+	}
+
 	/* temporary lock and close the source (we just make a copy of the whole file, this is the fastest and easiest approach) */
 	dc_sqlite3_close(context->sql);
 	closed = 1;
 
 		dc_log_info(context, 0, "Backup \"%s\" to \"%s\".", context->dbfile, dest_pathNfilename);
-		if (!dc_copy_file(context->dbfile, dest_pathNfilename, context)) {
-			goto cleanup; /* error already logged */
+		if (!dc_copy_file_ex(context->dbfile, dest_pathNfilename, 0, db_copy_progress, context, context)) {
+			goto cleanup; /* error already logged or cancelled */
 		}
 
-	dc_sqlite3_open(context->sql, context->dbfile, 0);
+	dc_sqlite3_open(context->sql, context->dbfile, DC_OPEN_WAL);
 	closed = 0;
 
 	/* add all files as blobs to the database copy (this does not require the source to be locked, neigher the destination as it is used only here) */
@@ -964,13 +1129,21 @@ static int export_backup(dc_context_t* context, const char* dir)
 	/* done - set some special config values (do this last to avoid importing crashed backups) */
 	dc_sqlite3_set_config_int(dest_sql, "backup_time", now);
 	dc_sqlite3_set_config    (dest_sql, "backup_for", context->blobdir);
+	dc_sqlite3_set_config    (dest_sql, "backup_id", backup_id);
+
+	if (start_tracking) {
+		dc_sqlite3_set_config    (context->sql, "backup_base_id", backup_id);
+		dc_sqlite3_set_config    (context->sql, "backup_last_id", backup_id);
+		dc_sqlite3_set_config_int(context->sql, "backup_last_time", now);
+		dc_sqlite3_set_config_int(context->sql, "backup_dbversion", dc_sqlite3_get_config_int(context->sql, "dbversion", 0));
+	}
 
 	context->cb(context, DC_EVENT_IMEX_FILE_WRITTEN, (uintptr_t)dest_pathNfilename, 0);
 	success = 1;
 
 cleanup:
 	if (dir_handle) { closedir(dir_handle); }
-	if (closed) { dc_sqlite3_open(context->sql, context->dbfile, 0); }
+	if (closed) { dc_sqlite3_open(context->sql, context->dbfile, DC_OPEN_WAL); }
 
 	sqlite3_finalize(stmt);
 	dc_sqlite3_close(dest_sql);
@@ -980,6 +1153,240 @@ cleanup:
 
 	free(curr_pathNfilename);
 	free(buf);
+	free(backup_id);
+	return success;
+}
+
+
+/*******************************************************************************
+ * Export incremental backup
+ ******************************************************************************/
+
+
+static int export_increment(dc_context_t* context, const char* dir)
+{
+	int            success = 0;
+	char*          base_id = dc_sqlite3_get_config(context->sql, "backup_base_id", NULL);
+	char*          parent_id = dc_sqlite3_get_config(context->sql, "backup_last_id", NULL);
+	time_t         parent_time = dc_sqlite3_get_config_int(context->sql, "backup_last_time", 0);
+	int            dbversion = dc_sqlite3_get_config_int(context->sql, "dbversion", 0);
+	char*          backup_id = NULL;
+	char*          dest_pathNfilename = NULL;
+	int            delete_dest_file = 0;
+	sqlite3*       db = NULL;
+	sqlite3_stmt*  stmt = NULL;
+	dc_array_t*    tables = dc_array_new(context, 32);
+	dc_array_t*    queries = dc_array_new(context, 32);
+	char*          q3 = NULL;
+	sqlite3_int64  max_change = 0;
+	time_t         now = time(NULL);
+	DIR*           dir_handle = NULL;
+	struct dirent* dir_entry = NULL;
+	struct stat    st;
+	int            prefix_len = strlen(DC_BAK_PREFIX);
+	int            suffix_len = strlen(DC_BAK_SUFFIX);
+	char*          curr_pathNfilename = NULL;
+	void*          buf = NULL;
+	size_t         buf_bytes = 0;
+	int            total_files_cnt = 0;
+	int            processed_files_cnt = 0;
+	int            i = 0;
+
+	/* without a complete chain or after a database update, start over with a full backup */
+	if (base_id==NULL || parent_id==NULL || parent_time<=0
+	 || dbversion!=dc_sqlite3_get_config_int(context->sql, "backup_dbversion", 0)
+	 || !dc_sqlite3_table_exists(context->sql, "backup_changes")) {
+		dc_log_info(context, 0, "Backup: No base for an incremental backup, doing a full backup.");
+		success = export_backup(context, dir, 1);
+		goto cleanup;
+	}
+
+	{
+		struct tm* timeinfo;
+		char buffer[256];
+		timeinfo = localtime(&now);
+		strftime(buffer, 256, DC_BAK_PREFIX "-%Y-%m-%d-inc." DC_BAK_SUFFIX, timeinfo);
+		if ((dest_pathNfilename=dc_get_fine_pathNfilename(dir, buffer))==NULL) {
+			dc_log_error(context, 0, "Cannot get backup file name.");
+			goto cleanup;
+		}
+	}
+
+	dc_log_info(context, 0, "Incremental backup to \"%s\", based on %s.", dest_pathNfilename, parent_id);
+	delete_dest_file = 1;
+
+	/* the rollback journal is kept in memory, otherwise it may be added as a file if the backup is written to the blob-directory */
+	if (sqlite3_open_v2(dest_pathNfilename, &db, SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE, NULL)!=SQLITE_OK
+	 || !backup_exec(db, "PRAGMA journal_mode=MEMORY;", context)) {
+		dc_log_error(context, 0, "Cannot create \"%s\".", dest_pathNfilename);
+		goto cleanup;
+	}
+
+	if (sqlite3_prepare_v2(db, "ATTACH DATABASE ? AS live;", -1, &stmt, NULL)!=SQLITE_OK) {
+		goto cleanup;
+	}
+	sqlite3_bind_text(stmt, 1, context->dbfile, -1, SQLITE_STATIC);
+	if (sqlite3_step(stmt)!=SQLITE_DONE) {
+		dc_log_error(context, 0, "Backup: Cannot attach database: %s", sqlite3_errmsg(db));
+		goto cleanup;
+	}
+	sqlite3_finalize(stmt);
+	stmt = NULL;
+
+	/* the first read from `live` starts the read transaction, so all rows and changes are from the same snapshot */
+	if (!backup_exec(db, "BEGIN;", context)
+	 || !backup_exec(db, "CREATE TABLE backup_deleted (tbl TEXT, id INTEGER);" /* id=NULL: the table is sent as a whole */
+	                     "CREATE TABLE backup_blobs (id INTEGER PRIMARY KEY, file_name, file_content);"
+	                     "CREATE TABLE backup_increment (keyname TEXT, value TEXT);", context)) {
+		goto cleanup;
+	}
+
+	if (sqlite3_prepare_v2(db, "SELECT MAX(rowid) FROM live.backup_changes;", -1, &stmt, NULL)!=SQLITE_OK
+	 || sqlite3_step(stmt)!=SQLITE_ROW) {
+		goto cleanup;
+	}
+	max_change = sqlite3_column_int64(stmt, 0);
+	sqlite3_finalize(stmt);
+	stmt = NULL;
+
+	if (sqlite3_prepare_v2(db,
+			"SELECT name, sql FROM live.sqlite_master"
+			" WHERE type='table' AND name NOT LIKE 'sqlite\\_%' ESCAPE '\\' AND name NOT LIKE 'backup\\_%' ESCAPE '\\'"
+			" AND name IN (SELECT tbl FROM live.backup_changes);", -1, &stmt, NULL)!=SQLITE_OK) {
+		goto cleanup;
+	}
+	while (sqlite3_step(stmt)==SQLITE_ROW) {
+		dc_array_add_ptr(tables, dc_strdup((const char*)sqlite3_column_text(stmt, 0)));
+		dc_array_add_ptr(queries, dc_strdup((const char*)sqlite3_column_text(stmt, 1)));
+	}
+	sqlite3_finalize(stmt);
+	stmt = NULL;
+
+	for (i = 0; i < dc_array_get_cnt(tables); i++)
+	{
+		const char* table = (const char*)dc_array_get_ptr(tables, i);
+
+		if (!backup_exec(db, (const char*)dc_array_get_ptr(queries, i), context)) {
+			goto cleanup;
+		}
+
+		sqlite3_free(q3);
+		if (table_has_rowid_alias(db, "live", table)) {
+			q3 = sqlite3_mprintf(
+				"INSERT INTO main.\"%w\" SELECT * FROM live.\"%w\" WHERE rowid IN (SELECT id FROM live.backup_changes WHERE tbl=%Q AND rowid<=%lld);"
+				"INSERT INTO backup_deleted (tbl, id) SELECT tbl, id FROM live.backup_changes WHERE tbl=%Q AND rowid<=%lld AND id NOT IN (SELECT rowid FROM live.\"%w\");",
+				table, table, table, max_change,
+				table, max_change, table);
+		}
+		else {
+			q3 = sqlite3_mprintf(
+				"INSERT INTO main.\"%w\" SELECT * FROM live.\"%w\";"
+				"INSERT INTO backup_deleted (tbl, id) VALUES (%Q, NULL);",
+				table, table, table);
+		}
+
+		if (!backup_exec(db, q3, context)) {
+			goto cleanup;
+		}
+	}
+
+	/* add the files changed since the previous backup */
+	if ((dir_handle=opendir(context->blobdir))==NULL) {
+		dc_log_error(context, 0, "Backup: Cannot get info for blob-directory \"%s\".", context->blobdir);
+		goto cleanup;
+	}
+
+	while ((dir_entry=readdir(dir_handle))!=NULL) {
+		total_files_cnt++;
+	}
+	rewinddir(dir_handle);
+
+	if (sqlite3_prepare_v2(db, "INSERT INTO backup_blobs (file_name, file_content) VALUES (?, ?);", -1, &stmt, NULL)!=SQLITE_OK) {
+		goto cleanup;
+	}
+
+	while ((dir_entry=readdir(dir_handle))!=NULL)
+	{
+		if (context->shall_stop_ongoing) {
+			goto cleanup;
+		}
+
+		FILE_PROGRESS
+
+		char* name = dir_entry->d_name;
+		int name_len = strlen(name);
+		if ((name_len==1 && name[0]=='.')
+		 || (name_len==2 && name[0]=='.' && name[1]=='.')
+		 || (name_len > prefix_len && strncmp(name, DC_BAK_PREFIX, prefix_len)==0 && name_len > suffix_len && strncmp(&name[name_len-suffix_len-1], "." DC_BAK_SUFFIX, suffix_len)==0)) {
+			continue;
+		}
+
+		free(curr_pathNfilename);
+		curr_pathNfilename = dc_mprintf("%s/%s", context->blobdir, name);
+		if (stat(curr_pathNfilename, &st)!=0 || !S_ISREG(st.st_mode)
+		 || DC_MAX(st.st_mtime, st.st_ctime) < parent_time-DC_BACKUP_TIME_SLACK) {
+			continue;
+		}
+
+		free(buf);
+		if (!dc_read_file(curr_pathNfilename, &buf, &buf_bytes, context) || buf==NULL || buf_bytes<=0) {
+			continue;
+		}
+
+		sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+		sqlite3_bind_blob(stmt, 2, buf, buf_bytes, SQLITE_STATIC);
+		if (sqlite3_step(stmt)!=SQLITE_DONE) {
+			dc_log_error(context, 0, "Disk full? Cannot add file \"%s\" to backup.", curr_pathNfilename);
+			goto cleanup;
+		}
+		sqlite3_reset(stmt);
+	}
+	sqlite3_finalize(stmt);
+	stmt = NULL;
+
+	/* done - the ids are written last so that an incomplete increment is never used */
+	backup_id = dc_create_id();
+	sqlite3_free(q3);
+	q3 = sqlite3_mprintf("INSERT INTO backup_increment (keyname, value) VALUES"
+		" ('backup_id', %Q), ('backup_parent_id', %Q), ('backup_base_id', %Q),"
+		" ('backup_time', '%lld'), ('backup_for', %Q), ('dbversion', '%i');",
+		backup_id, parent_id, base_id, (long long)now, context->blobdir, dbversion);
+	if (!backup_exec(db, q3, context)
+	 || !backup_exec(db, "COMMIT;", context)
+	 || !backup_exec(db, "DETACH DATABASE live;", context)) {
+		goto cleanup;
+	}
+
+	sqlite3_close(db);
+	db = NULL;
+
+	/* the next increment is based on this one */
+	dc_sqlite3_set_config    (context->sql, "backup_last_id", backup_id);
+	dc_sqlite3_set_config_int(context->sql, "backup_last_time", now);
+	sqlite3_free(q3);
+	q3 = sqlite3_mprintf("DELETE FROM backup_changes WHERE rowid<=%lld;", max_change);
+	dc_sqlite3_execute(context->sql, q3);
+
+	context->cb(context, DC_EVENT_IMEX_FILE_WRITTEN, (uintptr_t)dest_pathNfilename, 0);
+	delete_dest_file = 0;
+	success = 1;
+
+cleanup:
+	if (dir_handle) { closedir(dir_handle); }
+	sqlite3_finalize(stmt);
+	if (db) { sqlite3_close(db); }
+	if (delete_dest_file) { dc_delete_file(dest_pathNfilename, context); }
+	sqlite3_free(q3);
+	dc_array_free_ptr(tables);
+	dc_array_unref(tables);
+	dc_array_free_ptr(queries);
+	dc_array_unref(queries);
+	free(curr_pathNfilename);
+	free(buf);
+	free(dest_pathNfilename);
+	free(backup_id);
+	free(base_id);
+	free(parent_id);
 	return success;
 }
 
@@ -1001,6 +1408,591 @@ static void ensure_no_slash(char* path)
 }
 
 
+/* Instead of copying the backup over the database and removing the blobs afterwards
+(which needs a VACUUM that rewrites the whole database), the tables are copied from the backup
+to a new database and the blobs are streamed from the backup to the blob-directory. */
+#define DC_IMPORT_THREADS     4           /* threads writing blob-files, each with its own connection to the backup */
+#define DC_IMPORT_CHUNK_BYTES (256*1024)  /* blobs are read and written in chunks of this size */
+
+
+static int import_tables(dc_context_t* context, const char* backup_to_import, const char* dest)
+{
+	int           success = 0;
+	sqlite3*      db = NULL;
+	sqlite3_stmt* stmt = NULL;
+	dc_array_t*   names = dc_array_new(context, 32);
+	dc_array_t*   queries = dc_array_new(context, 32);
+	char*         q3 = NULL;
+	int           i = 0;
+
+	if (sqlite3_open_v2(dest, &db, SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE, NULL)!=SQLITE_OK) {
+		dc_log_error(context, 0, "Import: Cannot create \"%s\".", dest);
+		goto cleanup;
+	}
+
+	/* the file is renamed to the database only on success, no need to journal */
+	if (!backup_exec(db, "PRAGMA journal_mode=OFF;", context)) {
+		goto cleanup;
+	}
+
+	if (sqlite3_prepare_v2(db, "ATTACH DATABASE ? AS bak;", -1, &stmt, NULL)!=SQLITE_OK) {
+		goto cleanup;
+	}
+	sqlite3_bind_text(stmt, 1, backup_to_import, -1, SQLITE_STATIC);
+	if (sqlite3_step(stmt)!=SQLITE_DONE) {
+		dc_log_error(context, 0, "Import: Cannot open \"%s\": %s", backup_to_import, sqlite3_errmsg(db));
+		goto cleanup;
+	}
+	sqlite3_finalize(stmt);
+	stmt = NULL;
+
+	/* get the schema first, the schema of `main` changes while copying. tables come first
+	so that indices are created after the data are inserted, which is faster */
+	if (sqlite3_prepare_v2(db,
+			"SELECT type, name, sql FROM bak.sqlite_master"
+			" WHERE sql IS NOT NULL AND name NOT LIKE 'sqlite\\_%' ESCAPE '\\'"
+			" AND name NOT LIKE 'backup\\_%' ESCAPE '\\' AND tbl_name NOT LIKE 'backup\\_%' ESCAPE '\\'"
+			" ORDER BY type!='table', rowid;", -1, &stmt, NULL)!=SQLITE_OK) {
+		dc_log_error(context, 0, "Import: Cannot read schema of \"%s\": %s", backup_to_import, sqlite3_errmsg(db));
+		goto cleanup;
+	}
+	while (sqlite3_step(stmt)==SQLITE_ROW) {
+		int is_table = strcmp((const char*)sqlite3_column_text(stmt, 0), "table")==0;
+		dc_array_add_ptr(names, is_table? dc_strdup((const char*)sqlite3_column_text(stmt, 1)) : NULL);
+		dc_array_add_ptr(queries, dc_strdup((const char*)sqlite3_column_text(stmt, 2)));
+	}
+	sqlite3_finalize(stmt);
+	stmt = NULL;
+
+	if (dc_array_get_cnt(queries)==0) {
+		dc_log_error(context, 0, "Import: \"%s\" is no backup.", backup_to_import);
+		goto cleanup;
+	}
+
+	if (!backup_exec(db, "BEGIN;", context)) {
+		goto cleanup;
+	}
+
+	for (i = 0; i < dc_array_get_cnt(queries); i++) {
+		if (!backup_exec(db, (const char*)dc_array_get_ptr(queries, i), context)) {
+			goto cleanup;
+		}
+
+		if (dc_array_get_ptr(names, i)) {
+			sqlite3_free(q3);
+			q3 = sqlite3_mprintf("INSERT INTO main.\"%w\" SELECT * FROM bak.\"%w\";",
+				(const char*)dc_array_get_ptr(names, i), (const char*)dc_array_get_ptr(names, i));
+			if (!backup_exec(db, q3, context)) {
+				goto cleanup;
+			}
+		}
+	}
+
+	if (!backup_exec(db, "COMMIT;", context)
+	 || !backup_exec(db, "DETACH DATABASE bak;", context)) {
+		goto cleanup;
+	}
+
+	success = 1;
+
+cleanup:
+	sqlite3_free(q3);
+	sqlite3_finalize(stmt);
+	if (db) { sqlite3_close(db); }
+	dc_array_free_ptr(names);
+	dc_array_unref(names);
+	dc_array_free_ptr(queries);
+	dc_array_unref(queries);
+	return success;
+}
+
+
+typedef struct import_blobs_t
+{
+	dc_context_t*   context;
+	const char*     backup_to_import;
+	dc_array_t*     ids;                  /* ids of backup_blobs to restore */
+	int             next_index;           /* next entry in `ids` to restore */
+	int             processed_files_cnt;
+	int             failed;
+	pthread_mutex_t critical;
+} import_blobs_t;
+
+
+static int write_all(int fd, const char* buf, size_t bytes)
+{
+	ssize_t n = 0;
+	size_t  written = 0;
+	while (written < bytes) {
+		if ((n=write(fd, buf+written, bytes-written)) < 0) {
+			if (errno==EINTR) {
+				continue;
+			}
+			return 0;
+		}
+		else if (n==0) {
+			return 0;
+		}
+		written += n;
+	}
+	return 1;
+}
+
+
+static int import_blob(import_blobs_t* state, sqlite3* db, sqlite3_stmt* stmt, uint32_t id, char* buf)
+{
+	dc_context_t* context = state->context;
+	int           success = 0;
+	sqlite3_blob* blob = NULL;
+	const char*   file_name = NULL;
+	char*         pathNfilename = NULL;
+	int           fd = -1;
+	int           file_bytes = 0;
+	int           offset = 0;
+	int           chunk_bytes = 0;
+
+	sqlite3_reset(stmt);
+	sqlite3_bind_int(stmt, 1, id);
+	if (sqlite3_step(stmt)!=SQLITE_ROW
+	 || (file_name=(const char*)sqlite3_column_text(stmt, 0))==NULL) {
+		success = 1; /* nothing to restore */
+		goto cleanup;
+	}
+
+	/* the name comes from an arbitrary file, it must not point outside the blob-directory */
+	if (file_name[0]==0 || strchr(file_name, '/') || strchr(file_name, '\\') || strcmp(file_name, "..")==0 || strcmp(file_name, ".")==0) {
+		dc_log_warning(context, 0, "Import: Skipping file \"%s\".", file_name);
+		success = 1;
+		goto cleanup;
+	}
+
+	/* empty or NULL contents cannot be opened and were never written by old versions */
+	if (sqlite3_blob_open(db, "main", "backup_blobs", "file_content", id, 0, &blob)!=SQLITE_OK
+	 || (file_bytes=sqlite3_blob_bytes(blob))<=0) {
+		success = 1;
+		goto cleanup;
+	}
+
+	pathNfilename = dc_mprintf("%s/%s", context->blobdir, file_name);
+	if ((fd=open(pathNfilename, O_WRONLY|O_CREAT|O_TRUNC, 0666)) < 0) {
+		dc_log_error(context, 0, "Cannot write file %s.", pathNfilename);
+		goto cleanup;
+	}
+
+	for (offset = 0; offset < file_bytes; offset += chunk_bytes) {
+		chunk_bytes = DC_MIN(file_bytes-offset, DC_IMPORT_CHUNK_BYTES);
+		if (sqlite3_blob_read(blob, buf, chunk_bytes, offset)!=SQLITE_OK) {
+			dc_log_error(context, 0, "Import: Cannot read file %s from backup.", file_name);
+			goto cleanup;
+		}
+		if (!write_all(fd, buf, chunk_bytes)) {
+			dc_log_error(context, 0, "Storage full? Cannot write file %s with %i bytes.", pathNfilename, file_bytes);
+			goto cleanup; /* otherwise the user may believe the stuff is imported correctly, but there are files missing ... */
+		}
+	}
+
+	if (close(fd)!=0) {
+		fd = -1;
+		dc_log_error(context, 0, "Storage full? Cannot write file %s with %i bytes.", pathNfilename, file_bytes);
+		goto cleanup;
+	}
+	fd = -1;
+
+	success = 1;
+
+cleanup:
+	if (fd>=0) { close(fd); }
+	if (blob) { sqlite3_blob_close(blob); }
+	free(pathNfilename);
+	return success;
+}
+
+
+static void* import_blobs_thread(void* userdata)
+{
+	import_blobs_t* state = (import_blobs_t*)userdata;
+	dc_context_t*   context = state->context;
+	sqlite3*        db = NULL;
+	sqlite3_stmt*   stmt = NULL;
+	char*           buf = NULL;
+	int             total_files_cnt = dc_array_get_cnt(state->ids);
+	int             index = 0;
+	int             stop = 0;
+
+	if ((buf=malloc(DC_IMPORT_CHUNK_BYTES))==NULL) {
+		exit(62);
+	}
+
+	if (sqlite3_open_v2(state->backup_to_import, &db, SQLITE_OPEN_READONLY|SQLITE_OPEN_NOMUTEX, NULL)!=SQLITE_OK
+	 || sqlite3_prepare_v2(db, "SELECT file_name FROM backup_blobs WHERE id=?;", -1, &stmt, NULL)!=SQLITE_OK) {
+		dc_log_error(context, 0, "Import: Cannot read files from \"%s\".", state->backup_to_import);
+		pthread_mutex_lock(&state->critical);
+			state->failed = 1;
+		pthread_mutex_unlock(&state->critical);
+		goto cleanup;
+	}
+
+	while (1)
+	{
+		pthread_mutex_lock(&state->critical);
+			index = state->next_index++;
+			stop = state->failed || context->shall_stop_ongoing || index >= total_files_cnt;
+		pthread_mutex_unlock(&state->critical);
+
+		if (stop) {
+			break;
+		}
+
+		if (!import_blob(state, db, stmt, dc_array_get_id(state->ids, index), buf)) {
+			pthread_mutex_lock(&state->critical);
+				state->failed = 1;
+			pthread_mutex_unlock(&state->critical);
+			break;
+		}
+
+		/* progress is reported under the lock so that the values increase */
+		pthread_mutex_lock(&state->critical);
+		{
+			int processed_files_cnt = state->processed_files_cnt;
+			FILE_PROGRESS
+			state->processed_files_cnt = processed_files_cnt;
+		}
+		pthread_mutex_unlock(&state->critical);
+	}
+
+cleanup:
+	sqlite3_finalize(stmt);
+	if (db) { sqlite3_close(db); }
+	free(buf);
+	return NULL;
+}
+
+
+static int import_blobs(dc_context_t* context, const char* backup_to_import)
+{
+	int            success = 0;
+	import_blobs_t state;
+	pthread_t      threads[DC_IMPORT_THREADS];
+	int            threads_cnt = 0;
+	sqlite3*       db = NULL;
+	sqlite3_stmt*  stmt = NULL;
+	int            i = 0;
+
+	memset(&state, 0, sizeof(import_blobs_t));
+	state.context = context;
+	state.backup_to_import = backup_to_import;
+	state.ids = dc_array_new(context, 128);
+	pthread_mutex_init(&state.critical, NULL);
+
+	if (sqlite3_open_v2(backup_to_import, &db, SQLITE_OPEN_READONLY, NULL)!=SQLITE_OK) {
+		dc_log_error(context, 0, "Import: Cannot open \"%s\".", backup_to_import);
+		goto cleanup;
+	}
+
+	/* backups without files may come without the table */
+	if (sqlite3_prepare_v2(db, "SELECT id FROM backup_blobs ORDER BY id;", -1, &stmt, NULL)==SQLITE_OK) {
+		while (sqlite3_step(stmt)==SQLITE_ROW) {
+			dc_array_add_id(state.ids, sqlite3_column_int(stmt, 0));
+		}
+	}
+	sqlite3_finalize(stmt);
+	stmt = NULL;
+	sqlite3_close(db);
+	db = NULL;
+
+	/* if no thread can be started, we do the work ourself */
+	for (i = 0; i < DC_IMPORT_THREADS && i < (int)dc_array_get_cnt(state.ids); i++) {
+		if (pthread_create(&threads[threads_cnt], NULL, import_blobs_thread, &state)==0) {
+			threads_cnt++;
+		}
+	}
+
+	if (threads_cnt==0 && dc_array_get_cnt(state.ids)>0) {
+		import_blobs_thread(&state);
+	}
+
+	for (i = 0; i < threads_cnt; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	if (state.failed || context->shall_stop_ongoing) {
+		goto cleanup;
+	}
+
+	success = 1;
+
+cleanup:
+	sqlite3_finalize(stmt);
+	if (db) { sqlite3_close(db); }
+	pthread_mutex_destroy(&state.critical);
+	dc_array_unref(state.ids);
+	return success;
+}
+
+
+static int read_backup_ids(dc_context_t* context, const char* pathNfilename, char** ret_id, char** ret_parent_id, char** ret_backup_for)
+{
+	/* for full backups, the parent is NULL; backups created by old versions have no id at all.
+	`ret_backup_for` is the blob-directory the backup was created for and may be NULL if not needed. */
+	int           success = 0;
+	sqlite3*      db = NULL;
+	sqlite3_stmt* stmt = NULL;
+	char*         backup_for = NULL;
+
+	*ret_id = NULL;
+	*ret_parent_id = NULL;
+
+	if (sqlite3_open_v2(pathNfilename, &db, SQLITE_OPEN_READONLY, NULL)!=SQLITE_OK) {
+		goto cleanup;
+	}
+
+	if (sqlite3_prepare_v2(db, "SELECT keyname, value FROM backup_increment WHERE keyname IN ('backup_id', 'backup_parent_id', 'backup_for');", -1, &stmt, NULL)!=SQLITE_OK) {
+		sqlite3_finalize(stmt);
+		if (sqlite3_prepare_v2(db, "SELECT keyname, value FROM config WHERE keyname IN ('backup_id', 'backup_for');", -1, &stmt, NULL)!=SQLITE_OK) {
+			goto cleanup; /* no backup at all */
+		}
+	}
+
+	while (sqlite3_step(stmt)==SQLITE_ROW) {
+		const char* key = (const char*)sqlite3_column_text(stmt, 0);
+		const char* value = (const char*)sqlite3_column_text(stmt, 1);
+		if (key && value) {
+			if (strcmp(key, "backup_id")==0) {
+				free(*ret_id);
+				*ret_id = dc_strdup(value);
+			}
+			else if (strcmp(key, "backup_parent_id")==0) {
+				free(*ret_parent_id);
+				*ret_parent_id = dc_strdup(value);
+			}
+			else {
+				free(backup_for);
+				backup_for = dc_strdup(value);
+			}
+		}
+	}
+
+	if (ret_backup_for) {
+		*ret_backup_for = backup_for;
+		backup_for = NULL;
+	}
+
+	success = 1;
+
+cleanup:
+	sqlite3_finalize(stmt);
+	if (db) { sqlite3_close(db); }
+	free(backup_for);
+	return success;
+}
+
+
+static dc_array_t* get_backup_chain(dc_context_t* context, const char* backup_to_import)
+{
+	/* returns the file to import followed by the backups it is based on, the last entry is a full backup.
+	the backups it is based on are searched in the directory of the given file. */
+	dc_array_t*    chain = dc_array_new(context, 8);
+	dc_array_t*    files = dc_array_new(context, 32);
+	dc_array_t*    ids = dc_array_new(context, 32);
+	dc_array_t*    parent_ids = dc_array_new(context, 32);
+	char*          id = NULL;
+	char*          parent_id = NULL;
+	char*          dir_name = NULL;
+	char*          p = NULL;
+	DIR*           dir_handle = NULL;
+	struct dirent* dir_entry = NULL;
+	int            prefix_len = strlen(DC_BAK_PREFIX);
+	int            suffix_len = strlen(DC_BAK_SUFFIX);
+	int            i = 0;
+	int            found = 0;
+
+	if (!read_backup_ids(context, backup_to_import, &id, &parent_id, NULL)) {
+		dc_log_error(context, 0, "Import: Cannot read \"%s\".", backup_to_import);
+		goto cleanup;
+	}
+	dc_array_add_ptr(chain, dc_strdup(backup_to_import));
+
+	if (parent_id==NULL) {
+		goto cleanup; /* a full backup */
+	}
+
+	dir_name = dc_strdup(backup_to_import);
+	if ((p=strrchr(dir_name, '/'))!=NULL) {
+		*p = 0;
+	}
+	else {
+		free(dir_name);
+		dir_name = dc_strdup(".");
+	}
+
+	if ((dir_handle=opendir(dir_name))!=NULL) {
+		while ((dir_entry=readdir(dir_handle))!=NULL) {
+			const char* name = dir_entry->d_name;
+			int name_len = strlen(name);
+			if (name_len > prefix_len && strncmp(name, DC_BAK_PREFIX, prefix_len)==0
+			 && name_len > suffix_len && strncmp(&name[name_len-suffix_len-1], "." DC_BAK_SUFFIX, suffix_len)==0) {
+				char* curr_pathNfilename = dc_mprintf("%s/%s", dir_name, name);
+				char* curr_id = NULL;
+				char* curr_parent_id = NULL;
+				if (read_backup_ids(context, curr_pathNfilename, &curr_id, &curr_parent_id, NULL) && curr_id) {
+					dc_array_add_ptr(files, curr_pathNfilename);
+					dc_array_add_ptr(ids, curr_id);
+					dc_array_add_ptr(parent_ids, curr_parent_id);
+				}
+				else {
+					free(curr_pathNfilename);
+					free(curr_id);
+					free(curr_parent_id);
+				}
+			}
+		}
+	}
+
+	/* follow the parents; the number of steps is limited in case of a loop */
+	while (parent_id && dc_array_get_cnt(chain) <= dc_array_get_cnt(files)) {
+		found = 0;
+		for (i = 0; i < dc_array_get_cnt(ids); i++) {
+			if (strcmp((const char*)dc_array_get_ptr(ids, i), parent_id)==0) {
+				dc_array_add_ptr(chain, dc_strdup((const char*)dc_array_get_ptr(files, i)));
+				free(parent_id);
+				parent_id = dc_array_get_ptr(parent_ids, i)? dc_strdup((const char*)dc_array_get_ptr(parent_ids, i)) : NULL;
+				found = 1;
+				break;
+			}
+		}
+
+		if (!found) {
+			break;
+		}
+	}
+
+	if (parent_id) {
+		dc_log_error(context, 0, "Import: Cannot find backup %s in \"%s\", \"%s\" is based on it.", parent_id, dir_name, backup_to_import);
+		dc_array_free_ptr(chain);
+		dc_array_empty(chain);
+	}
+
+cleanup:
+	if (dir_handle) { closedir(dir_handle); }
+	dc_array_free_ptr(files);
+	dc_array_unref(files);
+	dc_array_free_ptr(ids);
+	dc_array_unref(ids);
+	dc_array_free_ptr(parent_ids);
+	dc_array_unref(parent_ids);
+	free(dir_name);
+	free(id);
+	free(parent_id);
+	if (dc_array_get_cnt(chain)==0) {
+		dc_array_unref(chain);
+		chain = NULL;
+	}
+	return chain;
+}
+
+
+static int import_increment_tables(dc_context_t* context, const char* increment, const char* dest)
+{
+	int           success = 0;
+	sqlite3*      db = NULL;
+	sqlite3_stmt* stmt = NULL;
+	dc_array_t*   tables = dc_array_new(context, 32);
+	dc_array_t*   has_rows = dc_array_new(context, 32);
+	char*         q3 = NULL;
+	int           i = 0;
+
+	dc_log_info(context, 0, "Import: Applying \"%s\".", increment);
+
+	if (sqlite3_open_v2(dest, &db, SQLITE_OPEN_READWRITE, NULL)!=SQLITE_OK
+	 || !backup_exec(db, "PRAGMA journal_mode=OFF;", context)) {
+		dc_log_error(context, 0, "Import: Cannot open \"%s\".", dest);
+		goto cleanup;
+	}
+
+	if (sqlite3_prepare_v2(db, "ATTACH DATABASE ? AS inc;", -1, &stmt, NULL)!=SQLITE_OK) {
+		goto cleanup;
+	}
+	sqlite3_bind_text(stmt, 1, increment, -1, SQLITE_STATIC);
+	if (sqlite3_step(stmt)!=SQLITE_DONE) {
+		dc_log_error(context, 0, "Import: Cannot open \"%s\": %s", increment, sqlite3_errmsg(db));
+		goto cleanup;
+	}
+	sqlite3_finalize(stmt);
+	stmt = NULL;
+
+	/* rows can only be applied to the database version they were taken from */
+	if (sqlite3_prepare_v2(db,
+			"SELECT COUNT(*) FROM inc.backup_increment i, main.config c"
+			" WHERE i.keyname='dbversion' AND c.keyname='dbversion' AND i.value=c.value;", -1, &stmt, NULL)!=SQLITE_OK
+	 || sqlite3_step(stmt)!=SQLITE_ROW
+	 || sqlite3_column_int(stmt, 0)!=1) {
+		dc_log_error(context, 0, "Import: \"%s\" does not match the database version of the backup it is based on.", increment);
+		goto cleanup;
+	}
+	sqlite3_finalize(stmt);
+	stmt = NULL;
+
+	if (sqlite3_prepare_v2(db,
+			"SELECT name, 1 FROM inc.sqlite_master"
+			" WHERE type='table' AND name NOT LIKE 'sqlite\\_%' ESCAPE '\\' AND name NOT LIKE 'backup\\_%' ESCAPE '\\'"
+			" UNION SELECT tbl, 0 FROM inc.backup_deleted WHERE tbl NOT IN (SELECT name FROM inc.sqlite_master);", -1, &stmt, NULL)!=SQLITE_OK) {
+		goto cleanup;
+	}
+	while (sqlite3_step(stmt)==SQLITE_ROW) {
+		dc_array_add_ptr(tables, dc_strdup((const char*)sqlite3_column_text(stmt, 0)));
+		dc_array_add_id(has_rows, sqlite3_column_int(stmt, 1));
+	}
+	sqlite3_finalize(stmt);
+	stmt = NULL;
+
+	if (!backup_exec(db, "BEGIN;", context)) {
+		goto cleanup;
+	}
+
+	/* deletions first, the rowids may be used again by inserted rows */
+	for (i = 0; i < dc_array_get_cnt(tables); i++) {
+		const char* table = (const char*)dc_array_get_ptr(tables, i);
+		sqlite3_free(q3);
+		q3 = sqlite3_mprintf(
+			"DELETE FROM main.\"%w\" WHERE rowid IN (SELECT id FROM inc.backup_deleted WHERE tbl=%Q);"
+			"DELETE FROM main.\"%w\" WHERE EXISTS (SELECT 1 FROM inc.backup_deleted WHERE tbl=%Q AND id IS NULL);",
+			table, table, table, table);
+		if (!backup_exec(db, q3, context)) {
+			goto cleanup;
+		}
+	}
+
+	for (i = 0; i < dc_array_get_cnt(tables); i++) {
+		const char* table = (const char*)dc_array_get_ptr(tables, i);
+		if (dc_array_get_id(has_rows, i)) {
+			sqlite3_free(q3);
+			q3 = sqlite3_mprintf("INSERT OR REPLACE INTO main.\"%w\" SELECT * FROM inc.\"%w\";", table, table);
+			if (!backup_exec(db, q3, context)) {
+				goto cleanup;
+			}
+		}
+	}
+
+	/* jobs are not tracked, the ones of the full backup may be done meanwhile, eg. messages may be sent already */
+	if (!backup_exec(db, "DELETE FROM main.jobs;", context)
+	 || !backup_exec(db, "COMMIT;", context)
+	 || !backup_exec(db, "DETACH DATABASE inc;", context)) {
+		goto cleanup;
+	}
+
+	success = 1;
+
+cleanup:
+	sqlite3_free(q3);
+	sqlite3_finalize(stmt);
+	if (db) { sqlite3_close(db); }
+	dc_array_free_ptr(tables);
+	dc_array_unref(tables);
+	dc_array_unref(has_rows);
+	return success;
+}
+
+
 static int import_backup(dc_context_t* context, const char* backup_to_import)
 {
 	/* command for testing eg.
@@ -1008,12 +2000,14 @@ static int import_backup(dc_context_t* context, const char* backup_to_import)
 	*/
 
 	int           success = 0;
-	int           processed_files_cnt = 0;
-	int           total_files_cnt = 0;
-	sqlite3_stmt* stmt = NULL;
-	char*         pathNfilename = NULL;
+	dc_array_t*   chain = NULL;
+	int           chain_cnt = 0;
+	char*         tmp_dbfile = NULL;
+	char*         wal_file = NULL;
+	char*         shm_file = NULL;
 	char*         repl_from = NULL;
 	char*         repl_to = NULL;
+	int           i = 0;
 
 	dc_log_info(context, 0, "Import \"%s\" to \"%s\".", backup_to_import, context->dbfile);
 
@@ -1022,7 +2016,13 @@ static int import_backup(dc_context_t* context, const char* backup_to_import)
 		goto cleanup;
 	}
 
-	/* close and delete the original file - FIXME: we should import to a .bak file and rename it on success. however, currently it is not clear it the import exists in the long run (may be replaced by a restore-from-imap) */
+	/* an incremental backup is applied on top of the backups it is based on */
+	if ((chain=get_backup_chain(context, backup_to_import))==NULL) {
+		goto cleanup; /* error already logged */
+	}
+	chain_cnt = dc_array_get_cnt(chain);
+
+	/* close the original file, it is kept until the imported database is complete */
 
 //dc_sqlite3_lock(context->sql);  // TODO: check if this works while threads running
 //locked = 1;
@@ -1031,62 +2031,63 @@ static int import_backup(dc_context_t* context, const char* backup_to_import)
 		dc_sqlite3_close(context->sql);
 	}
 
-	dc_delete_file(context->dbfile, context);
-
-	if (dc_file_exist(context->dbfile)) {
-		dc_log_error(context, 0, "Cannot import backups: Cannot delete the old file.");
-		goto cleanup;
+	/* copy the tables to a temporary file that becomes the database only if complete */
+	tmp_dbfile = dc_mprintf("%s-import.tmp", context->dbfile);
+	if (dc_file_exist(tmp_dbfile)) {
+		dc_delete_file(tmp_dbfile, context);
 	}
 
-	/* copy the database file */
-	if (!dc_copy_file(backup_to_import, context->dbfile, context)) {
+	if (!import_tables(context, (const char*)dc_array_get_ptr(chain, chain_cnt-1), tmp_dbfile)) {
 		goto cleanup; /* error already logged */
 	}
 
-	/* re-open copied database file */
-	if (!dc_sqlite3_open(context->sql, context->dbfile, 0)) {
-		goto cleanup;
+	for (i = chain_cnt-2; i >= 0; i--) {
+		if (!import_increment_tables(context, (const char*)dc_array_get_ptr(chain, i), tmp_dbfile)) {
+			goto cleanup; /* error already logged */
+		}
 	}
 
-	/* copy all blobs to files */
-	stmt = dc_sqlite3_prepare(context->sql, "SELECT COUNT(*) FROM backup_blobs;");
-	sqlite3_step(stmt);
-	total_files_cnt = sqlite3_column_int(stmt, 0);
-	sqlite3_finalize(stmt);
-	stmt = NULL;
-
-	stmt = dc_sqlite3_prepare(context->sql, "SELECT file_name, file_content FROM backup_blobs ORDER BY id;");
-	while (sqlite3_step(stmt)==SQLITE_ROW)
-	{
-		if (context->shall_stop_ongoing) {
-			goto cleanup;
-		}
+	/* the write-ahead-log of the old file must not be applied to the new one;
+	normally, it is already checkpointed and deleted when the database is closed */
+	wal_file = dc_mprintf("%s-wal", context->dbfile);
+	shm_file = dc_mprintf("%s-shm", context->dbfile);
+	if (dc_file_exist(wal_file)) { dc_delete_file(wal_file, context); }
+	if (dc_file_exist(shm_file)) { dc_delete_file(shm_file, context); }
 
-        FILE_PROGRESS
+	if (rename(tmp_dbfile, context->dbfile)!=0) {
+		dc_log_error(context, 0, "Cannot rename \"%s\" to \"%s\".", tmp_dbfile, context->dbfile);
+		goto cleanup;
+	}
 
-        const char* file_name    = (const char*)sqlite3_column_text (stmt, 0);
-        int         file_bytes   = sqlite3_column_bytes(stmt, 1);
-        const void* file_content = sqlite3_column_blob (stmt, 1);
+	context->cb(context, DC_EVENT_IMEX_PROGRESS, DB_COPY_PERMILLE, 0);
 
-        if (file_bytes > 0 && file_content) {
-			free(pathNfilename);
-			pathNfilename = dc_mprintf("%s/%s", context->blobdir, file_name);
-			if (!dc_write_file(pathNfilename, file_content, file_bytes, context)) {
-				dc_log_error(context, 0, "Storage full? Cannot write file %s with %i bytes.", pathNfilename, file_bytes);
-				goto cleanup; /* otherwise the user may believe the stuff is imported correctly, but there are files missing ... */
-			}
-		}
+	/* re-open the new database file */
+	if (!dc_sqlite3_open(context->sql, context->dbfile, DC_OPEN_WAL)) {
+		goto cleanup;
 	}
 
-	/* finalize/reset all statements - otherwise the table cannot be DROPped below */
-	sqlite3_finalize(stmt);
-	stmt = 0;
+	/* the restored database is no base for incremental backups, a full backup is needed first */
+	dc_sqlite3_execute(context->sql, "DELETE FROM config WHERE keyname IN ('backup_base_id', 'backup_last_id', 'backup_last_time', 'backup_dbversion');");
 
-	dc_sqlite3_execute(context->sql, "DROP TABLE backup_blobs;");
-	dc_sqlite3_execute(context->sql, "VACUUM;");
+	/* write all blobs to files, read directly from the backups */
+	for (i = chain_cnt-1; i >= 0; i--) {
+		if (!import_blobs(context, (const char*)dc_array_get_ptr(chain, i))) {
+			goto cleanup; /* error already logged or cancelled */
+		}
+	}
 
-	/* rewrite references to the blobs */
-	repl_from = dc_sqlite3_get_config(context->sql, "backup_for", NULL);
+	/* rewrite references to the blobs; the config-rows of the backup may be replaced by the rows of an increment,
+	so the directory is read from the newest backup */
+	{
+		char* id = NULL;
+		char* parent_id = NULL;
+		read_backup_ids(context, (const char*)dc_array_get_ptr(chain, 0), &id, &parent_id, &repl_from);
+		free(id);
+		free(parent_id);
+	}
+	if (repl_from==NULL) {
+		repl_from = dc_sqlite3_get_config(context->sql, "backup_for", NULL);
+	}
 	if (repl_from && strlen(repl_from)>1 && context->blobdir && strlen(context->blobdir)>1)
 	{
 		ensure_no_slash(repl_from);
@@ -1101,6 +2102,8 @@ static int import_backup(dc_context_t* context, const char* backup_to_import)
 		char* q3 = sqlite3_mprintf("UPDATE msgs SET param=replace(param, 'f=%q/', 'f=%q/');", repl_from, repl_to); /* cannot use dc_mprintf() because of "%q" */
 			dc_sqlite3_execute(context->sql, q3);
 		sqlite3_free(q3);
+		dc_msgcache_clear(context->msgcache);
+		dc_changelog_reset(context->changelog);
 
 		q3 = sqlite3_mprintf("UPDATE chats SET param=replace(param, 'i=%q/', 'i=%q/');", repl_from, repl_to);
 			dc_sqlite3_execute(context->sql, q3);
@@ -1114,10 +2117,22 @@ static int import_backup(dc_context_t* context, const char* backup_to_import)
 	success = 1;
 
 cleanup:
-	free(pathNfilename);
+	if (tmp_dbfile && dc_file_exist(tmp_dbfile)) {
+		dc_delete_file(tmp_dbfile, context);
+	}
+
+	/* if the import failed before the new database was ready, the old one is used again */
+	if (!dc_sqlite3_is_open(context->sql)) {
+		dc_sqlite3_open(context->sql, context->dbfile, DC_OPEN_WAL);
+	}
+
+	free(tmp_dbfile);
+	free(wal_file);
+	free(shm_file);
 	free(repl_from);
 	free(repl_to);
-	sqlite3_finalize(stmt);
+	dc_array_free_ptr(chain);
+	dc_array_unref(chain);
 
 // if (locked) { dc_sqlite3_unlock(context->sql); }  // TODO: check if this works while threads running
 
@@ -1143,8 +2158,13 @@ cleanup:
  *   The name of the backup is typically `delta-chat.<day>.bak`, if more than one backup is create on a day,
  *   the format is `delta-chat.<day>-<number>.bak`
  *
+ * - **DC_IMEX_EXPORT_INCREMENTAL_BACKUP** (13) - Export an incremental backup to the directory given as `param1`.
+ *   The backup only contains the changes and the files added since the last backup created this way,
+ *   if there is no such backup or if the database was updated meanwhile, a full backup is written.
+ *   To import an incremental backup, all backups it is based on must be in the same directory.
+ *
  * - **DC_IMEX_IMPORT_BACKUP** (12) - `param1` is the file (not: directory) to import. The file is normally
- *   created by DC_IMEX_EXPORT_BACKUP and detected by dc_imex_has_backup(). Importing a backup
+ *   created by DC_IMEX_EXPORT_BACKUP or DC_IMEX_EXPORT_INCREMENTAL_BACKUP and detected by dc_imex_has_backup(). Importing a backup
  *   is only possible as long as the context is not configured or used in another way.
  *
  * - **DC_IMEX_EXPORT_SELF_KEYS** (1) - Export all private keys and all public keys of the user to the
@@ -1224,7 +2244,7 @@ void dc_job_do_DC_JOB_IMEX_IMAP(dc_context_t* context, dc_job_t* job)
 		goto cleanup;
 	}
 
-	if (what==DC_IMEX_EXPORT_SELF_KEYS || what==DC_IMEX_EXPORT_BACKUP) {
+	if (what==DC_IMEX_EXPORT_SELF_KEYS || what==DC_IMEX_EXPORT_BACKUP || what==DC_IMEX_EXPORT_INCREMENTAL_BACKUP) {
 		/* before we export anything, make sure the private key exists */
 		if (!dc_ensure_secret_key_exists(context)) {
 			dc_log_error(context, 0, "Import/export: Cannot create private key or private key not available.");
@@ -1249,7 +2269,13 @@ void dc_job_do_DC_JOB_IMEX_IMAP(dc_context_t* context, dc_job_t* job)
 			break;
 
 		case DC_IMEX_EXPORT_BACKUP:
-			if (!export_backup(context, param1)) {
+			if (!export_backup(context, param1, 0)) {
+				goto cleanup;
+			}
+			break;
+
+		case DC_IMEX_EXPORT_INCREMENTAL_BACKUP:
+			if (!export_increment(context, param1)) {
 				goto cleanup;
 			}
 			break;
@@ -1360,6 +2386,13 @@ char* dc_imex_has_backup(dc_context_t* context, const char* dir_name)
 			 && dc_sqlite3_open(test_sql, curr_pathNfilename, DC_OPEN_READONLY))
 			{
 				time_t curr_backup_time = dc_sqlite3_get_config_int(test_sql, "backup_time", 0); /* reading the backup time also checks if the database is readable and the table `config` exists */
+				if (dc_sqlite3_table_exists(test_sql, "backup_increment")) {
+					sqlite3_stmt* stmt = dc_sqlite3_prepare(test_sql, "SELECT value FROM backup_increment WHERE keyname='backup_time';");
+					if (sqlite3_step(stmt)==SQLITE_ROW) {
+						curr_backup_time = sqlite3_column_int64(stmt, 0);
+					}
+					sqlite3_finalize(stmt);
+				}
 				if (curr_backup_time > 0
 				 && curr_backup_time > ret_backup_time/*use the newest if there are multiple backup*/)
 				{
@@ -28,6 +28,7 @@
 #include "dc_imap.h"
 #include "dc_smtp.h"
 #include "dc_mimefactory.h"
+#include "dc_scheduler.h"
 
 
 /*******************************************************************************
@@ -113,40 +114,10 @@ cleanup:
 }
 
 
-static void dc_job_do_DC_JOB_DELETE_MSG_ON_IMAP(dc_context_t* context, dc_job_t* job)
+static void delete_msg_locally(dc_context_t* context, dc_msg_t* msg)
 {
-	int           delete_from_server = 1;
-	dc_msg_t*     msg = dc_msg_new(context);
 	sqlite3_stmt* stmt = NULL;
 
-	if (!dc_msg_load_from_db(msg, context, job->foreign_id)
-	 || msg->rfc724_mid==NULL || msg->rfc724_mid[0]==0 /* eg. device messages have no Message-ID */) {
-		goto cleanup;
-	}
-
-	if (dc_rfc724_mid_cnt(context, msg->rfc724_mid)!=1) {
-		dc_log_info(context, 0, "The message is deleted from the server when all parts are deleted.");
-		delete_from_server = 0;
-	}
-
-	/* if this is the last existing part of the message, we delete the message from the server */
-	if (delete_from_server)
-	{
-		if (!dc_imap_is_connected(context->imap)) {
-			connect_to_imap(context, NULL);
-			if (!dc_imap_is_connected(context->imap)) {
-				dc_job_try_again_later(job, DC_STANDARD_DELAY, NULL);
-				goto cleanup;
-			}
-		}
-
-		if (!dc_imap_delete_msg(context->imap, msg->rfc724_mid, msg->server_folder, msg->server_uid))
-		{
-			dc_job_try_again_later(job, DC_AT_ONCE, NULL);
-			goto cleanup;
-		}
-	}
-
 	/* we delete the database entry ...
 	- if the message is successfully removed from the server
 	- or if there are other parts of the message in the database (in this case we have not deleted if from the server)
@@ -158,6 +129,8 @@ static void dc_job_do_DC_JOB_DELETE_MSG_ON_IMAP(dc_context_t* context, dc_job_t*
 	sqlite3_finalize(stmt);
 	stmt = NULL;
 
+	dc_msgcache_invalidate(context->msgcache, msg->id);
+
 	stmt = dc_sqlite3_prepare(context->sql,
 		"DELETE FROM msgs_mdns WHERE msg_id=?;");
 	sqlite3_bind_int(stmt, 1, msg->id);
@@ -203,13 +176,81 @@ static void dc_job_do_DC_JOB_DELETE_MSG_ON_IMAP(dc_context_t* context, dc_job_t*
 		}
 		free(pathNfilename);
 	}
+}
+
+
+static void dc_job_do_DC_JOB_DELETE_MSG_ON_IMAP(dc_context_t* context, dc_job_t* job)
+{
+	int           delete_from_server = 1;
+	dc_msg_t*     msg = dc_msg_new(context);
+
+	if (!dc_msg_load_from_db(msg, context, job->foreign_id)
+	 || msg->rfc724_mid==NULL || msg->rfc724_mid[0]==0 /* eg. device messages have no Message-ID */) {
+		goto cleanup;
+	}
+
+	if (dc_rfc724_mid_cnt(context, msg->rfc724_mid)!=1) {
+		dc_log_info(context, 0, "The message is deleted from the server when all parts are deleted.");
+		delete_from_server = 0;
+	}
+
+	/* if this is the last existing part of the message, we delete the message from the server */
+	if (delete_from_server)
+	{
+		if (!dc_imap_is_connected(context->imap)) {
+			connect_to_imap(context, NULL);
+			if (!dc_imap_is_connected(context->imap)) {
+				dc_job_try_again_later(job, DC_STANDARD_DELAY, NULL);
+				goto cleanup;
+			}
+		}
+
+		if (!dc_imap_delete_msg(context->imap, msg->rfc724_mid, msg->server_folder, msg->server_uid))
+		{
+			dc_job_try_again_later(job, DC_AT_ONCE, NULL);
+			goto cleanup;
+		}
+	}
+
+	delete_msg_locally(context, msg);
 
 cleanup:
-	sqlite3_finalize(stmt);
 	dc_msg_unref(msg);
 }
 
 
+static int get_markseen_flags(dc_context_t* context, const dc_msg_t* msg)
+{
+	int ms_flags = 0;
+
+	/* add an additional job for sending the MDN (here in a thread for fast ui resonses) (an extra job as the MDN has a lower priority) */
+	if (dc_param_get_int(msg->param, DC_PARAM_WANTS_MDN, 0) /* DC_PARAM_WANTS_MDN is set only for one part of a multipart-message */
+	 && dc_sqlite3_get_config_int(context->sql, "mdns_enabled", DC_MDNS_DEFAULT_ENABLED)) {
+		ms_flags |= DC_MS_SET_MDNSent_FLAG;
+	}
+
+	if (msg->is_msgrmsg) {
+		ms_flags |= DC_MS_ALSO_MOVE;
+	}
+
+	return ms_flags;
+}
+
+
+static void msg_marked_seen(dc_context_t* context, const dc_msg_t* msg, const char* new_server_folder, uint32_t new_server_uid, int out_ms_flags)
+{
+	if (new_server_folder && new_server_uid)
+	{
+		dc_update_server_uid(context, msg->rfc724_mid, new_server_folder, new_server_uid);
+	}
+
+	if (out_ms_flags&DC_MS_MDNSent_JUST_SET)
+	{
+		dc_job_add(context, DC_JOB_SEND_MDN, msg->id, NULL, 0);
+	}
+}
+
+
 static void dc_job_do_DC_JOB_MARKSEEN_MSG_ON_IMAP(dc_context_t* context, dc_job_t* job)
 {
 	dc_msg_t* msg = dc_msg_new(context);
@@ -230,31 +271,12 @@ static void dc_job_do_DC_JOB_MARKSEEN_MSG_ON_IMAP(dc_context_t* context, dc_job_
 		goto cleanup;
 	}
 
-	/* add an additional job for sending the MDN (here in a thread for fast ui resonses) (an extra job as the MDN has a lower priority) */
-	if (dc_param_get_int(msg->param, DC_PARAM_WANTS_MDN, 0) /* DC_PARAM_WANTS_MDN is set only for one part of a multipart-message */
-	 && dc_sqlite3_get_config_int(context->sql, "mdns_enabled", DC_MDNS_DEFAULT_ENABLED)) {
-		in_ms_flags |= DC_MS_SET_MDNSent_FLAG;
-	}
-
-	if (msg->is_msgrmsg) {
-		in_ms_flags |= DC_MS_ALSO_MOVE;
-	}
+	in_ms_flags = get_markseen_flags(context, msg);
 
 	if (dc_imap_markseen_msg(context->imap, msg->server_folder, msg->server_uid,
 		   in_ms_flags, &new_server_folder, &new_server_uid, &out_ms_flags)!=0)
 	{
-		if ((new_server_folder && new_server_uid) || out_ms_flags&DC_MS_MDNSent_JUST_SET)
-		{
-			if (new_server_folder && new_server_uid)
-			{
-				dc_update_server_uid(context, msg->rfc724_mid, new_server_folder, new_server_uid);
-			}
-
-			if (out_ms_flags&DC_MS_MDNSent_JUST_SET)
-			{
-				dc_job_add(context, DC_JOB_SEND_MDN, msg->id, NULL, 0);
-			}
-		}
+		msg_marked_seen(context, msg, new_server_folder, new_server_uid, out_ms_flags);
 	}
 	else
 	{
@@ -466,6 +488,39 @@ static void dc_suspend_smtp_thread(dc_context_t* context, int suspend)
  ******************************************************************************/
 
 
+/* estimate the bytes a job sends; only jobs sending messages with attachments may get big */
+static size_t estimate_bytes(dc_context_t* context, int action, uint32_t foreign_id)
+{
+	size_t        bytes = 0;
+	sqlite3_stmt* stmt = NULL;
+	dc_param_t*   param = dc_param_new();
+	char*         file = NULL;
+
+	if (action!=DC_JOB_SEND_MSG_TO_SMTP && action!=DC_JOB_SEND_MSG_TO_IMAP) {
+		goto cleanup;
+	}
+
+	stmt = dc_sqlite3_prepare(context->sql,
+		"SELECT LENGTH(txt), param FROM msgs WHERE id=?;");
+	sqlite3_bind_int(stmt, 1, foreign_id);
+	if (sqlite3_step(stmt)!=SQLITE_ROW) {
+		goto cleanup;
+	}
+
+	bytes = sqlite3_column_int(stmt, 0);
+	dc_param_set_packed(param, (const char*)sqlite3_column_text(stmt, 1));
+	if ((file=dc_param_get(param, DC_PARAM_FILE, NULL))!=NULL) {
+		bytes += dc_get_filebytes(file)/3*4; /* the attachment is sent base64-encoded */
+	}
+
+cleanup:
+	sqlite3_finalize(stmt);
+	dc_param_unref(param);
+	free(file);
+	return bytes;
+}
+
+
 void dc_job_add(dc_context_t* context, int action, int foreign_id, const char* param, int delay_seconds)
 {
 	time_t        timestamp = time(NULL);
@@ -483,13 +538,14 @@ void dc_job_add(dc_context_t* context, int action, int foreign_id, const char* p
 	}
 
 	stmt = dc_sqlite3_prepare(context->sql,
-		"INSERT INTO jobs (added_timestamp, thread, action, foreign_id, param, desired_timestamp) VALUES (?,?,?,?,?,?);");
+		"INSERT INTO jobs (added_timestamp, thread, action, foreign_id, param, desired_timestamp, bytes) VALUES (?,?,?,?,?,?,?);");
 	sqlite3_bind_int64(stmt, 1, timestamp);
 	sqlite3_bind_int  (stmt, 2, thread);
 	sqlite3_bind_int  (stmt, 3, action);
 	sqlite3_bind_int  (stmt, 4, foreign_id);
 	sqlite3_bind_text (stmt, 5, param? param : "",  -1, SQLITE_STATIC);
 	sqlite3_bind_int64(stmt, 6, delay_seconds>0? (timestamp+delay_seconds) : 0);
+	sqlite3_bind_int64(stmt, 7, estimate_bytes(context, action, foreign_id));
 	sqlite3_step(stmt);
 	sqlite3_finalize(stmt);
 
@@ -502,12 +558,13 @@ void dc_job_add(dc_context_t* context, int action, int foreign_id, const char* p
 }
 
 
-static void dc_job_update(dc_context_t* context, const dc_job_t* job)
+static void dc_job_update(dc_context_t* context, const dc_job_t* job, time_t desired_timestamp)
 {
 	sqlite3_stmt* update_stmt = dc_sqlite3_prepare(context->sql,
-		"UPDATE jobs SET desired_timestamp=0, param=? WHERE id=?;");
-	sqlite3_bind_text (update_stmt, 1, job->param->packed, -1, SQLITE_STATIC);
-	sqlite3_bind_int  (update_stmt, 2, job->job_id);
+		"UPDATE jobs SET desired_timestamp=?, param=? WHERE id=?;");
+	sqlite3_bind_int64(update_stmt, 1, desired_timestamp);
+	sqlite3_bind_text (update_stmt, 2, job->param->packed, -1, SQLITE_STATIC);
+	sqlite3_bind_int  (update_stmt, 3, job->job_id);
 	sqlite3_step(update_stmt);
 	sqlite3_finalize(update_stmt);
 }
@@ -523,6 +580,19 @@ static void dc_job_delete(dc_context_t* context, const dc_job_t* job)
 }
 
 
+/* the seconds after which the job is tried again after the given number of failed tries, see DC_JOB_BACKOFF_SEC */
+int dc_job_get_backoff_seconds(int tries)
+{
+	int seconds = DC_JOB_BACKOFF_SEC;
+	for (int i = 1; i < tries && seconds < DC_JOB_BACKOFF_MAX_SEC; i++) {
+		seconds *= 2;
+	}
+	seconds = DC_MIN(seconds, DC_JOB_BACKOFF_MAX_SEC);
+	seconds += (int)(random() % (seconds/4*2+1)) - seconds/4;
+	return DC_MAX(seconds, 1);
+}
+
+
 void dc_job_try_again_later(dc_job_t* job, int try_again, const char* pending_error)
 {
 	if (job==NULL) {
@@ -551,129 +621,547 @@ void dc_job_kill_actions(dc_context_t* context, int action1, int action2)
 }
 
 
+void dc_job_kill_foreign_id(dc_context_t* context, uint32_t msg_id)
+{
+	int killed = 0;
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC || msg_id==0) {
+		return;
+	}
+
+	/* a job already running is not affected; it finds the message gone or finishes as usual */
+	sqlite3_stmt* stmt = dc_sqlite3_prepare(context->sql,
+		"DELETE FROM jobs WHERE foreign_id=? AND action IN (?,?,?);");
+	sqlite3_bind_int(stmt, 1, msg_id);
+	sqlite3_bind_int(stmt, 2, DC_JOB_SEND_MSG_TO_SMTP);
+	sqlite3_bind_int(stmt, 3, DC_JOB_SEND_MSG_TO_IMAP);
+	sqlite3_bind_int(stmt, 4, DC_JOB_MARKSEEN_MSG_ON_IMAP);
+	if (sqlite3_step(stmt)==SQLITE_DONE) {
+		killed = sqlite3_changes(context->sql->cobj);
+	}
+	sqlite3_finalize(stmt);
+
+	if (killed > 0) {
+		pthread_mutex_lock(&context->jobstats_critical);
+			context->jobs_cancelled += killed;
+		pthread_mutex_unlock(&context->jobstats_critical);
+		dc_log_info(context, 0, "%i pending job(s) for message #%i cancelled.", killed, (int)msg_id);
+	}
+}
+
+
+int dc_job_get_wait_seconds(dc_context_t* context, int thread, int max_seconds)
+{
+	int           seconds = max_seconds;
+	sqlite3_stmt* stmt = dc_sqlite3_prepare_read(context->sql,
+		"SELECT MIN(desired_timestamp) FROM jobs WHERE thread=?;");
+	sqlite3_bind_int(stmt, 1, thread);
+	if (sqlite3_step(stmt)==SQLITE_ROW && sqlite3_column_type(stmt, 0)!=SQLITE_NULL) {
+		time_t due = (time_t)sqlite3_column_int64(stmt, 0) - time(NULL);
+		if (due <= 0) {
+			/* a job that failed while offline, waits for a file in creation or a big job waiting for others;
+			the latter also interrupt idle when the other big jobs end */
+			seconds = DC_MIN(DC_JOB_OFFLINE_RETRY_SEC, max_seconds);
+		}
+		else {
+			seconds = (int)DC_MIN(due, max_seconds);
+		}
+	}
+	sqlite3_finalize(stmt);
+	return seconds;
+}
+
+
+char* dc_job_get_stats(dc_context_t* context)
+{
+	int           imap_cnt = 0, smtp_cnt = 0, big_cnt = 0;
+	time_t        oldest = 0;
+	char*         ret = NULL;
+	sqlite3_stmt* stmt = dc_sqlite3_prepare_read(context->sql,
+		"SELECT thread, COUNT(*), SUM(bytes>?), MIN(added_timestamp) FROM jobs GROUP BY thread;");
+	sqlite3_bind_int(stmt, 1, DC_JOB_BIG_BYTES);
+	while (sqlite3_step(stmt)==SQLITE_ROW) {
+		if (sqlite3_column_int(stmt, 0)==DC_IMAP_THREAD) {
+			imap_cnt = sqlite3_column_int(stmt, 1);
+		}
+		else {
+			smtp_cnt = sqlite3_column_int(stmt, 1);
+		}
+		big_cnt += sqlite3_column_int(stmt, 2);
+		if (oldest==0 || sqlite3_column_int64(stmt, 3) < oldest) {
+			oldest = (time_t)sqlite3_column_int64(stmt, 3);
+		}
+	}
+	sqlite3_finalize(stmt);
+
+	pthread_mutex_lock(&context->jobstats_critical);
+		ret = dc_mprintf("Jobs: %i IMAP, %i SMTP queued (%i big, oldest %i s); %i done in %.1f s avg., %i retries, %i failed, %i cancelled",
+			imap_cnt, smtp_cnt, big_cnt, oldest? (int)(time(NULL)-oldest) : 0,
+			context->jobs_done, context->jobs_done? context->jobs_latency_sec/context->jobs_done : 0.0,
+			context->jobs_retried, context->jobs_failed, context->jobs_cancelled);
+	pthread_mutex_unlock(&context->jobstats_critical);
+
+	return ret;
+}
+
+
+/*******************************************************************************
+ * Batched IMAP-jobs
+ ******************************************************************************/
+
+
+#define IS_BATCH_JOB(a) ((a)==DC_JOB_MARKSEEN_MSG_ON_IMAP || (a)==DC_JOB_MARKSEEN_MDN_ON_IMAP || (a)==DC_JOB_DELETE_MSG_ON_IMAP)
+
+
+static dc_batch_job_t* load_batch_job(dc_context_t* context, uint32_t job_id, int action, uint32_t foreign_id, const char* packed_param)
+{
+	/* returns NULL if the job cannot be batched, it is performed on its own then */
+	dc_batch_job_t* bj = NULL;
+	dc_param_t*     param = dc_param_new();
+
+	if ((bj=calloc(1, sizeof(dc_batch_job_t)))==NULL) {
+		exit(63);
+	}
+	bj->job_id = job_id;
+	bj->action = action;
+
+	if (action==DC_JOB_MARKSEEN_MDN_ON_IMAP)
+	{
+		dc_param_set_packed(param, packed_param);
+		bj->server_folder   = dc_param_get(param, DC_PARAM_SERVER_FOLDER, NULL);
+		bj->item.server_uid = dc_param_get_int(param, DC_PARAM_SERVER_UID, 0);
+		bj->item.ms_flags   = DC_MS_ALSO_MOVE;
+	}
+	else
+	{
+		bj->msg = dc_msg_new();
+		if (!dc_msg_load_from_db(bj->msg, context, foreign_id)
+		 || bj->msg->rfc724_mid==NULL || bj->msg->rfc724_mid[0]==0) {
+			goto cleanup;
+		}
+
+		if (action==DC_JOB_DELETE_MSG_ON_IMAP && dc_rfc724_mid_cnt(context, bj->msg->rfc724_mid)!=1) {
+			goto cleanup; /* other parts of the message are left, no server command needed */
+		}
+
+		bj->server_folder   = dc_strdup_keep_null(bj->msg->server_folder);
+		bj->item.server_uid = bj->msg->server_uid;
+		bj->item.rfc724_mid = bj->msg->rfc724_mid;
+		if (action==DC_JOB_MARKSEEN_MSG_ON_IMAP) {
+			bj->item.ms_flags = get_markseen_flags(context, bj->msg);
+		}
+	}
+
+	if (bj->server_folder==NULL || bj->server_folder[0]==0 || bj->item.server_uid==0) {
+		goto cleanup;
+	}
+
+	dc_param_unref(param);
+	return bj;
+
+cleanup:
+	dc_msg_unref(bj->msg);
+	free(bj->server_folder);
+	free(bj);
+	dc_param_unref(param);
+	return NULL;
+}
+
+
+static void free_batch_jobs(carray* batch_jobs)
+{
+	int i;
+	for (i = 0; i < carray_count(batch_jobs); i++) {
+		dc_batch_job_t* bj = (dc_batch_job_t*)carray_get(batch_jobs, i);
+		dc_msg_unref(bj->msg);
+		free(bj->server_folder);
+		free(bj);
+	}
+	carray_free(batch_jobs);
+}
+
+
+/**
+ * Collect the next group of batched jobs that can be done with single commands:
+ * starting with the given job, all jobs not yet handled of the same folder and
+ * of the same kind, markseen or delete, are added in their order and marked as handled.
+ *
+ * @private @memberof dc_job_t
+ * @param batch_jobs The jobs, dc_batch_job_t objects.
+ * @param first_index The first job of the group, must not be handled.
+ * @param[out] ret_group Receives the jobs of the group, room for DC_IMAP_BATCH_MAX pointers.
+ * @return The number of jobs in the group, at most DC_IMAP_BATCH_MAX.
+ */
+int dc_job_group_batch(carray* batch_jobs, int first_index, dc_batch_job_t** ret_group)
+{
+	dc_batch_job_t* first = (dc_batch_job_t*)carray_get(batch_jobs, first_index);
+	int             is_delete = (first->action==DC_JOB_DELETE_MSG_ON_IMAP);
+	int             j = 0, cnt = 0;
+
+	for (j = first_index; j < carray_count(batch_jobs) && cnt < DC_IMAP_BATCH_MAX; j++) {
+		dc_batch_job_t* bj = (dc_batch_job_t*)carray_get(batch_jobs, j);
+		if (!bj->handled && (bj->action==DC_JOB_DELETE_MSG_ON_IMAP)==is_delete
+		 && strcmp(bj->server_folder, first->server_folder)==0) {
+			bj->handled = 1; /* the group is not tried again; unhandled items are left to the normal jobs */
+			ret_group[cnt++] = bj;
+		}
+	}
+	return cnt;
+}
+
+
+static void perform_imap_batch(dc_context_t* context, dc_hash_t* handled_job_ids)
+{
+	/* Marking messages as seen, moving and deleting them is done for all pending jobs of a folder with single commands
+	using dc_imap_markseen_msgs() and dc_imap_delete_msgs() instead of several commands per job.
+	The ids of the jobs handled this way are added to handled_job_ids; all other jobs are performed one by one as usual,
+	this is also the fallback if the Message-ID or the folder do not match. */
+	sqlite3_stmt*          stmt = NULL;
+	carray*                batch_jobs = carray_new(16);
+	dc_imap_batch_item_t*  items = NULL;
+	dc_batch_job_t**       group = NULL;
+	int                    i = 0, j = 0, cnt = 0;
+
+	if (!dc_imap_is_connected(context->imap)) {
+		connect_to_imap(context, NULL);
+		if (!dc_imap_is_connected(context->imap)) {
+			goto cleanup;
+		}
+	}
+
+	stmt = dc_sqlite3_prepare(context->sql,
+		"SELECT id, action, foreign_id, param FROM jobs WHERE thread=? AND action IN (?,?,?) AND desired_timestamp<=? ORDER BY action DESC, added_timestamp;");
+	sqlite3_bind_int  (stmt, 1, DC_IMAP_THREAD);
+	sqlite3_bind_int  (stmt, 2, DC_JOB_MARKSEEN_MSG_ON_IMAP);
+	sqlite3_bind_int  (stmt, 3, DC_JOB_MARKSEEN_MDN_ON_IMAP);
+	sqlite3_bind_int  (stmt, 4, DC_JOB_DELETE_MSG_ON_IMAP);
+	sqlite3_bind_int64(stmt, 5, time(NULL));
+	while (sqlite3_step(stmt)==SQLITE_ROW) {
+		dc_batch_job_t* bj = load_batch_job(context, sqlite3_column_int(stmt, 0), sqlite3_column_int(stmt, 1),
+			sqlite3_column_int(stmt, 2), (const char*)sqlite3_column_text(stmt, 3));
+		if (bj) {
+			carray_add(batch_jobs, bj, NULL);
+		}
+	}
+	sqlite3_finalize(stmt);
+	stmt = NULL;
+
+	if (carray_count(batch_jobs)<=1) {
+		goto cleanup; /* nothing to gain */
+	}
+
+	if ((items=calloc(DC_IMAP_BATCH_MAX, sizeof(dc_imap_batch_item_t)))==NULL
+	 || (group=calloc(DC_IMAP_BATCH_MAX, sizeof(dc_batch_job_t*)))==NULL) {
+		exit(63);
+	}
+
+	/* group the jobs by folder and by markseen/delete, keeping the order of the jobs */
+	for (i = 0; i < carray_count(batch_jobs); i++)
+	{
+		dc_batch_job_t* first = (dc_batch_job_t*)carray_get(batch_jobs, i);
+		int             is_delete = (first->action==DC_JOB_DELETE_MSG_ON_IMAP);
+		int             ok = 0, done_cnt = 0;
+		if (first->handled) {
+			continue;
+		}
+
+		cnt = dc_job_group_batch(batch_jobs, i, group);
+		for (j = 0; j < cnt; j++) {
+			items[j] = group[j]->item;
+		}
+
+		ok = is_delete? dc_imap_delete_msgs(context->imap, first->server_folder, items, cnt)
+		              : dc_imap_markseen_msgs(context->imap, first->server_folder, items, cnt);
+
+		for (j = 0; j < cnt; j++) {
+			if (items[j].done) {
+				if (group[j]->action==DC_JOB_DELETE_MSG_ON_IMAP) {
+					delete_msg_locally(context, group[j]->msg);
+				}
+				else if (group[j]->action==DC_JOB_MARKSEEN_MSG_ON_IMAP) {
+					msg_marked_seen(context, group[j]->msg, context->imap->moveto_folder, items[j].ret_server_uid, items[j].ret_ms_flags);
+				}
+
+				dc_job_t job;
+				memset(&job, 0, sizeof(dc_job_t));
+				job.job_id = group[j]->job_id;
+				dc_job_delete(context, &job);
+				dc_hash_insert(handled_job_ids, NULL, job.job_id, (void*)1);
+				done_cnt++;
+			}
+		}
+
+		dc_log_info(context, 0, "IMAP-jobs for %i of %i messages in %s done at once.", done_cnt, cnt, first->server_folder);
+
+		if (!ok) {
+			break; /* connection problems, the remaining jobs are retried as usual */
+		}
+	}
+
+cleanup:
+	sqlite3_finalize(stmt);
+	free_batch_jobs(batch_jobs);
+	free(items);
+	free(group);
+}
+
+
+/* big jobs are counted for the whole process, so that many accounts do not upload large files at the same time.
+the threads that skipped a big job are interrupted when a big job ends, so they need not poll for a free slot. */
+typedef struct big_job_waiter_t
+{
+	dc_context_t*            context;
+	int                      thread;
+	struct big_job_waiter_t* next;
+} big_job_waiter_t;
+
+static pthread_mutex_t   s_big_jobs_lock    = PTHREAD_MUTEX_INITIALIZER;
+static int               s_big_jobs_running = 0;
+static big_job_waiter_t* s_big_jobs_waiting = NULL;
+
+
+static int begin_big_job(dc_context_t* context, int thread)
+{
+	int               ok = 0;
+	big_job_waiter_t* waiter = NULL;
+
+	pthread_mutex_lock(&s_big_jobs_lock);
+		if (s_big_jobs_running < DC_JOB_BIG_MAX_RUNNING) {
+			s_big_jobs_running++;
+			ok = 1;
+		}
+		else {
+			for (waiter = s_big_jobs_waiting; waiter; waiter = waiter->next) {
+				if (waiter->context==context && waiter->thread==thread) {
+					break;
+				}
+			}
+			if (waiter==NULL) {
+				if ((waiter=calloc(1, sizeof(big_job_waiter_t)))==NULL) {
+					exit(69);
+				}
+				waiter->context = context;
+				waiter->thread  = thread;
+				waiter->next    = s_big_jobs_waiting;
+				s_big_jobs_waiting = waiter;
+			}
+		}
+	pthread_mutex_unlock(&s_big_jobs_lock);
+	return ok;
+}
+
+
+static void end_big_job(void)
+{
+	big_job_waiter_t* waiter = NULL;
+
+	pthread_mutex_lock(&s_big_jobs_lock);
+		s_big_jobs_running--;
+
+		/* the lock is held while interrupting, so that dc_job_forget_context() cannot return before */
+		while ((waiter=s_big_jobs_waiting)!=NULL) {
+			s_big_jobs_waiting = waiter->next;
+			if (waiter->thread==DC_IMAP_THREAD) {
+				dc_interrupt_imap_idle(waiter->context);
+			}
+			else {
+				dc_interrupt_smtp_idle(waiter->context);
+			}
+			free(waiter);
+		}
+	pthread_mutex_unlock(&s_big_jobs_lock);
+}
+
+
+void dc_job_forget_context(dc_context_t* context)
+{
+	big_job_waiter_t** link = &s_big_jobs_waiting;
+	big_job_waiter_t*  waiter = NULL;
+
+	pthread_mutex_lock(&s_big_jobs_lock);
+		while ((waiter=*link)!=NULL) {
+			if (waiter->context==context) {
+				*link = waiter->next;
+				free(waiter);
+			}
+			else {
+				link = &waiter->next;
+			}
+		}
+	pthread_mutex_unlock(&s_big_jobs_lock);
+}
+
+
+sqlite3_stmt* dc_job_prepare_due(dc_context_t* context, int thread, time_t now)
+{
+	// big jobs are done after all small jobs, so that eg. markseen-jobs do not wait for a large upload
+	sqlite3_stmt* stmt = dc_sqlite3_prepare(context->sql,
+		"SELECT id, action, foreign_id, param, bytes, added_timestamp FROM jobs WHERE thread=? AND desired_timestamp<=? ORDER BY bytes>?, action DESC, added_timestamp;");
+	sqlite3_bind_int64(stmt, 1, thread);
+	sqlite3_bind_int64(stmt, 2, now);
+	sqlite3_bind_int  (stmt, 3, DC_JOB_BIG_BYTES);
+	return stmt;
+}
+
+
+static void job_finished(dc_context_t* context, const dc_job_t* job, int failed)
+{
+	pthread_mutex_lock(&context->jobstats_critical);
+		if (failed) {
+			context->jobs_failed++;
+		}
+		else {
+			context->jobs_done++;
+			context->jobs_latency_sec += (double)(time(NULL)-job->added_timestamp);
+		}
+	pthread_mutex_unlock(&context->jobstats_critical);
+}
+
+
 static void dc_job_perform(dc_context_t* context, int thread)
 {
 	sqlite3_stmt* select_stmt = NULL;
 	dc_job_t      job;
+	dc_hash_t     batched_job_ids;
+	int           batch_done = 0;
+	int           is_big = 0;
+	int           select_again = 0;
 	#define       THREAD_STR (thread==DC_IMAP_THREAD? "IMAP" : "SMTP")
 	#define       IS_EXCLUSIVE_JOB (DC_JOB_CONFIGURE_IMAP==job.action || DC_JOB_IMEX_IMAP==job.action)
-    
-    static int   last_online_state=0; // cs  0 = not connected
-    
+
 	memset(&job, 0, sizeof(dc_job_t));
 	job.param = dc_param_new();
+	dc_hash_init(&batched_job_ids, DC_HASH_INT, 0);
 
 	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
 		goto cleanup;
 	}
 
-	select_stmt = dc_sqlite3_prepare(context->sql,
-		"SELECT id, action, foreign_id, param FROM jobs WHERE thread=? AND desired_timestamp<=? ORDER BY action DESC, added_timestamp;");
-	sqlite3_bind_int64(select_stmt, 1, thread);
-	sqlite3_bind_int64(select_stmt, 2, time(NULL));
-	while (sqlite3_step(select_stmt)==SQLITE_ROW)
+	do
 	{
-		job.job_id                          = sqlite3_column_int (select_stmt, 0);
-		job.action                          = sqlite3_column_int (select_stmt, 1);
-		job.foreign_id                      = sqlite3_column_int (select_stmt, 2);
-		dc_param_set_packed(job.param, (char*)sqlite3_column_text(select_stmt, 3));
-
-		dc_log_info(context, 0, "%s-job #%i, action %i started...", THREAD_STR, (int)job.job_id, (int)job.action);
-
-		// some configuration jobs are "exclusive":
-		// - they are always executed in the imap-thread and the smtp-thread is suspended during execution
-		// - they may change the database handle change the database handle; we do not keep old pointers therefore
-		// - they can be re-executed one time AT_ONCE, but they are not save in the database for later execution
-		if (IS_EXCLUSIVE_JOB) {
-			dc_job_kill_actions(context, job.action, 0);
-			sqlite3_finalize(select_stmt);
-			select_stmt = NULL;
-			dc_suspend_smtp_thread(context, 1);
-		}
+		select_again = 0;
 
-		for (int tries = 0; tries <= 1; tries++)
+		select_stmt = dc_job_prepare_due(context, thread, time(NULL));
+		while (sqlite3_step(select_stmt)==SQLITE_ROW)
 		{
-			job.try_again = DC_DONT_TRY_AGAIN; // this can be modified by a job using dc_job_try_again_later()
-
-			switch (job.action) {
-				case DC_JOB_SEND_MSG_TO_SMTP:     dc_job_do_DC_JOB_SEND_MSG_TO_SMTP     (context, &job); break;
-				case DC_JOB_SEND_MSG_TO_IMAP:     dc_job_do_DC_JOB_SEND_MSG_TO_IMAP     (context, &job); break;
-				case DC_JOB_DELETE_MSG_ON_IMAP:   dc_job_do_DC_JOB_DELETE_MSG_ON_IMAP   (context, &job); break;
-				case DC_JOB_MARKSEEN_MSG_ON_IMAP: dc_job_do_DC_JOB_MARKSEEN_MSG_ON_IMAP (context, &job); break;
-				case DC_JOB_MARKSEEN_MDN_ON_IMAP: dc_job_do_DC_JOB_MARKSEEN_MDN_ON_IMAP (context, &job); break;
-				case DC_JOB_SEND_MDN:             dc_job_do_DC_JOB_SEND_MDN             (context, &job); break;
-				case DC_JOB_CONFIGURE_IMAP:       dc_job_do_DC_JOB_CONFIGURE_IMAP       (context, &job); break;
-				case DC_JOB_IMEX_IMAP:            dc_job_do_DC_JOB_IMEX_IMAP            (context, &job); break;
+			job.job_id                          = sqlite3_column_int (select_stmt, 0);
+			job.action                          = sqlite3_column_int (select_stmt, 1);
+			job.foreign_id                      = sqlite3_column_int (select_stmt, 2);
+			dc_param_set_packed(job.param, (char*)sqlite3_column_text(select_stmt, 3));
+			job.bytes                           = (size_t)sqlite3_column_int64(select_stmt, 4);
+			job.added_timestamp                 = (time_t)sqlite3_column_int64(select_stmt, 5);
+
+			if (thread==DC_IMAP_THREAD && IS_BATCH_JOB(job.action)) {
+				if (!batch_done) {
+					perform_imap_batch(context, &batched_job_ids);
+					batch_done = 1;
+				}
+				if (dc_hash_find(&batched_job_ids, NULL, job.job_id)) {
+					continue;
+				}
 			}
 
-			if (job.try_again!=DC_AT_ONCE) {
-				break;
+			is_big = (job.bytes > DC_JOB_BIG_BYTES);
+			if (is_big && !begin_big_job(context, thread)) {
+				// the job is left unchanged, end_big_job() interrupts idle then
+				dc_log_info(context, 0, "%s-job #%i skipped as other big jobs are running.", THREAD_STR, (int)job.job_id);
+				continue;
 			}
-		}
 
-		if (IS_EXCLUSIVE_JOB) {
-			dc_suspend_smtp_thread(context, 0);
-			goto cleanup;
-		}
-		else if (job.try_again==DC_INCREATION_POLL)
-		{
-			// just try over next loop unconditionally, the ui typically interrupts idle when the file (video) is ready
-			dc_log_info(context, 0, "%s-job #%i not yet ready and will be delayed.", THREAD_STR, (int)job.job_id);
-		}
-		else if (job.try_again==DC_AT_ONCE || job.try_again==DC_STANDARD_DELAY)
-		{
-			// Define the number of job-retries, each retry may result in 2 tries (for fast network-failure-recover).
-			// The first job-retries are done asap, the last retry is delayed about a minute.
-			// Network errors do not count as failed tries.
-			#define JOB_RETRIES 5   // set from 3 to 5 (20181007cs)
-
-			int is_online = dc_is_online(context)? 1 : 0;
-			
-			// 20181015cs: catch unstabel online state
-			// int tries_while_online = dc_param_get_int(job.param, DC_PARAM_TIMES, 0) + is_online;
-			int tries_while_online = dc_param_get_int(job.param, DC_PARAM_TIMES, 0);
-			
-			// only if two times consecutively state is "online" increase value,
-			// otherwise decrease (unstable state)
-			// means: if state is changing several times on and off
-			if (last_online_state && is_online) {
-				tries_while_online++;
-			} else {
-				if (tries_while_online > 0) {
-					tries_while_online--;
-					dc_log_info(context, 0, "%s-job #%i online state unstable try decreased, now #%i", THREAD_STR, (int)job.job_id, tries_while_online);
-				}
+			dc_log_info(context, 0, "%s-job #%i, action %i started...", THREAD_STR, (int)job.job_id, (int)job.action);
+
+			// some configuration jobs are "exclusive":
+			// - they are always executed in the imap-thread and the smtp-thread is suspended during execution
+			// - they may change the database handle change the database handle; we do not keep old pointers therefore
+			// - they can be re-executed one time AT_ONCE, but they are not save in the database for later execution
+			if (IS_EXCLUSIVE_JOB) {
+				dc_job_kill_actions(context, job.action, 0);
+				sqlite3_finalize(select_stmt);
+				select_stmt = NULL;
+				dc_suspend_smtp_thread(context, 1);
 			}
-			last_online_state == is_online;
-			// 20181015cs end
 
-			if( tries_while_online < JOB_RETRIES ) {
-				dc_param_set_int(job.param, DC_PARAM_TIMES, tries_while_online);
-				dc_job_update(context, &job);
-				dc_log_info(context, 0, "%s-job #%i not succeeded on try #%i.", THREAD_STR, (int)job.job_id, tries_while_online);
+			for (int tries = 0; tries <= 1; tries++)
+			{
+				job.try_again = DC_DONT_TRY_AGAIN; // this can be modified by a job using dc_job_try_again_later()
+
+				switch (job.action) {
+					case DC_JOB_SEND_MSG_TO_SMTP:     dc_job_do_DC_JOB_SEND_MSG_TO_SMTP     (context, &job); break;
+					case DC_JOB_SEND_MSG_TO_IMAP:     dc_job_do_DC_JOB_SEND_MSG_TO_IMAP     (context, &job); break;
+					case DC_JOB_DELETE_MSG_ON_IMAP:   dc_job_do_DC_JOB_DELETE_MSG_ON_IMAP   (context, &job); break;
+					case DC_JOB_MARKSEEN_MSG_ON_IMAP: dc_job_do_DC_JOB_MARKSEEN_MSG_ON_IMAP (context, &job); break;
+					case DC_JOB_MARKSEEN_MDN_ON_IMAP: dc_job_do_DC_JOB_MARKSEEN_MDN_ON_IMAP (context, &job); break;
+					case DC_JOB_SEND_MDN:             dc_job_do_DC_JOB_SEND_MDN             (context, &job); break;
+					case DC_JOB_CONFIGURE_IMAP:       dc_job_do_DC_JOB_CONFIGURE_IMAP       (context, &job); break;
+					case DC_JOB_IMEX_IMAP:            dc_job_do_DC_JOB_IMEX_IMAP            (context, &job); break;
+				}
 
-				if (thread==DC_SMTP_THREAD && is_online && tries_while_online<(JOB_RETRIES-1)) {
-					pthread_mutex_lock(&context->smtpidle_condmutex);
-						context->perform_smtp_jobs_needed = DC_JOBS_NEEDED_AVOID_DOS;
-					pthread_mutex_unlock(&context->smtpidle_condmutex);
+				if (job.try_again!=DC_AT_ONCE) {
+					break;
 				}
 			}
-			else {
-				if (job.action==DC_JOB_SEND_MSG_TO_SMTP) { // in all other cases, the messages is already sent
-					dc_set_msg_failed(context, job.foreign_id, job.pending_error);
+
+			if (is_big) {
+				end_big_job();
+			}
+
+			if (IS_EXCLUSIVE_JOB) {
+				dc_suspend_smtp_thread(context, 0);
+				goto cleanup;
+			}
+			else if (job.try_again==DC_INCREATION_POLL)
+			{
+				// just try over next loop unconditionally, the ui typically interrupts idle when the file (video) is ready
+				dc_log_info(context, 0, "%s-job #%i not yet ready and will be delayed.", THREAD_STR, (int)job.job_id);
+			}
+			else if (job.try_again==DC_AT_ONCE || job.try_again==DC_STANDARD_DELAY)
+			{
+				// each retry may result in 2 tries (for fast network-failure-recover).
+				// network errors do not count as failed tries, the job is tried again the next loop then;
+				// other failures delay the job exponentially, see DC_JOB_BACKOFF_SEC.
+				int is_online = dc_is_online(context)? 1 : 0;
+				int tries_while_online = dc_param_get_int(job.param, DC_PARAM_TIMES, 0) + is_online;
+
+				if (tries_while_online < DC_JOB_RETRIES) {
+					time_t desired_timestamp = is_online? time(NULL)+dc_job_get_backoff_seconds(tries_while_online) : 0;
+					dc_param_set_int(job.param, DC_PARAM_TIMES, tries_while_online);
+					dc_job_update(context, &job, desired_timestamp);
+					dc_log_info(context, 0, "%s-job #%i not succeeded on try #%i, trying again in %i seconds.", THREAD_STR, (int)job.job_id, tries_while_online,
+						desired_timestamp? (int)(desired_timestamp-time(NULL)) : 0);
+
+					pthread_mutex_lock(&context->jobstats_critical);
+						context->jobs_retried++;
+					pthread_mutex_unlock(&context->jobstats_critical);
+				}
+				else {
+					if (job.action==DC_JOB_SEND_MSG_TO_SMTP) { // in all other cases, the messages is already sent
+						dc_set_msg_failed(context, job.foreign_id, job.pending_error);
+					}
+					dc_job_delete(context, &job);
+					job_finished(context, &job, 1);
 				}
+			}
+			else
+			{
 				dc_job_delete(context, &job);
+				job_finished(context, &job, 0);
+
+				if (is_big) {
+					select_again = 1; // small jobs added while the big one was running go first
+					break;
+				}
 			}
 		}
-		else
-		{
-			dc_job_delete(context, &job);
-		}
+
+		sqlite3_finalize(select_stmt);
+		select_stmt = NULL;
 	}
+	while (select_again);
 
 cleanup:
 	dc_param_unref(job.param);
 	free(job.pending_error);
+	dc_hash_clear(&batched_job_ids);
 	sqlite3_finalize(select_stmt);
 }
 
@@ -702,6 +1190,8 @@ void dc_perform_imap_jobs(dc_context_t* context)
 		context->perform_imap_jobs_needed = 0;
 	pthread_mutex_unlock(&context->imapidle_condmutex);
 
+	dc_imap_idle_done(context->imap); /* in case the caller forgot to call dc_perform_imap_idle_done() */
+
 	dc_job_perform(context, DC_IMAP_THREAD);
 
 	dc_log_info(context, 0, "IMAP-jobs ended.");
@@ -723,6 +1213,8 @@ void dc_perform_imap_fetch(dc_context_t* context)
 {
 	clock_t start = clock();
 
+	dc_imap_idle_done(context->imap);
+
 	if (!connect_to_imap(context, NULL)) {
 		return;
 	}
@@ -739,6 +1231,18 @@ void dc_perform_imap_fetch(dc_context_t* context)
 	}
 
 	dc_log_info(context, 0, "IMAP-fetch done in %.0f ms.", (double)(clock()-start)*1000.0/CLOCKS_PER_SEC);
+
+	/* the thread is going to idle, a good moment to fill some summaries of messages from before they were stored on insert
+	and to move the written data from the WAL to the database */
+	dc_msg_backfill_summaries(context, 200);
+	dc_sqlite3_checkpoint(context->sql);
+}
+
+
+/* IDLE is kept open for a long time; only failed jobs need to be tried again earlier */
+static int get_idle_seconds(dc_context_t* context)
+{
+	return dc_job_get_wait_seconds(context, DC_IMAP_THREAD, DC_IDLE_KEEPALIVE_SECONDS);
 }
 
 
@@ -769,12 +1273,109 @@ void dc_perform_imap_idle(dc_context_t* context)
 
 	dc_log_info(context, 0, "IMAP-IDLE started...");
 
-	dc_imap_idle(context->imap);
+	dc_imap_idle(context->imap, get_idle_seconds(context));
 
 	dc_log_info(context, 0, "IMAP-IDLE ended.");
 }
 
 
+/**
+ * Start waiting for messages or jobs without blocking.
+ * This function is an alternative to dc_perform_imap_idle() for programs with an event loop
+ * that handle many contexts without a thread for each of them.
+ *
+ * The event loop should wait until the returned socket or the descriptor returned by dc_get_imap_interrupt_fd()
+ * gets readable or until the returned timeout is reached.  After that, dc_perform_imap_idle_done()
+ * must be called and the loop continues with dc_perform_imap_jobs() and dc_perform_imap_fetch().
+ *
+ * Example:
+ *
+ *     int timeout = 0;
+ *     int fd = dc_perform_imap_idle_start(context, &timeout);
+ *     // add fd (if not -1) and dc_get_imap_interrupt_fd(context) to the loop;
+ *     // when one is readable or after the timeout:
+ *     dc_perform_imap_idle_done(context);
+ *     dc_perform_imap_jobs(context);
+ *     dc_perform_imap_fetch(context);
+ *     // ... and start over
+ *
+ * @memberof dc_context_t
+ * @param context The context as created by dc_context_new().
+ * @param[out] ret_timeout_seconds Seconds after which dc_perform_imap_idle_done() should be called at the latest.
+ *     IDLE is kept alive for some minutes; if jobs are waiting to be tried again, the timeout is shorter.
+ *     May be 0 if there are jobs to do at once.
+ * @return The IMAP socket to wait for.
+ *     -1 if IDLE is not possible, eg. because of a missing network; only the interrupt-fd and the timeout should be used in this case.
+ */
+int dc_perform_imap_idle_start(dc_context_t* context, int* ret_timeout_seconds)
+{
+	int fd = -1;
+
+	if (ret_timeout_seconds) {
+		*ret_timeout_seconds = DC_IDLE_RETRY_SECONDS;
+	}
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
+		return -1;
+	}
+
+	connect_to_imap(context, NULL);
+
+	pthread_mutex_lock(&context->imapidle_condmutex);
+		if (context->perform_imap_jobs_needed) {
+			pthread_mutex_unlock(&context->imapidle_condmutex);
+			if (ret_timeout_seconds) {
+				*ret_timeout_seconds = 0;
+			}
+			return -1;
+		}
+	pthread_mutex_unlock(&context->imapidle_condmutex);
+
+	if ((fd=dc_imap_idle_start(context->imap))!=-1 && ret_timeout_seconds) {
+		*ret_timeout_seconds = get_idle_seconds(context);
+	}
+
+	return fd;
+}
+
+
+/**
+ * End waiting for messages or jobs started by dc_perform_imap_idle_start().
+ * If IDLE was not started, the function only resets the descriptor returned by dc_get_imap_interrupt_fd().
+ *
+ * @memberof dc_context_t
+ * @param context The context as created by dc_context_new().
+ * @return None.
+ */
+void dc_perform_imap_idle_done(dc_context_t* context)
+{
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
+		return;
+	}
+
+	dc_imap_idle_done(context->imap);
+}
+
+
+/**
+ * Get a descriptor an event loop can wait for to get informed about dc_interrupt_imap_idle().
+ * The descriptor gets readable when dc_interrupt_imap_idle() is called
+ * and is reset by dc_perform_imap_idle_done().
+ *
+ * @memberof dc_context_t
+ * @param context The context as created by dc_context_new().
+ * @return The file descriptor, must not be closed by the caller. -1 on errors.
+ */
+int dc_get_imap_interrupt_fd(dc_context_t* context)
+{
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
+		return -1;
+	}
+
+	return dc_imap_get_interrupt_fd(context->imap);
+}
+
+
 /**
  * Interrupt waiting for imap-jobs.
  * If dc_perform_imap_jobs(), dc_perform_imap_fetch() and dc_perform_imap_idle() are called in a loop,
@@ -830,6 +1431,8 @@ void dc_interrupt_imap_idle(dc_context_t* context)
 	pthread_mutex_unlock(&context->imapidle_condmutex);
 
 	dc_imap_interrupt_idle(context->imap);
+
+	dc_scheduler_interrupt(context->scheduler, context, DC_IMAP_THREAD);
 }
 
 
@@ -876,6 +1479,8 @@ void dc_perform_smtp_jobs(dc_context_t* context)
  */
 void dc_perform_smtp_idle(dc_context_t* context)
 {
+	int wait_seconds = 0;
+
 	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
 		dc_log_warning(context, 0, "Cannot perform SMTP-idle: Bad parameters.");
 		return;
@@ -883,6 +1488,8 @@ void dc_perform_smtp_idle(dc_context_t* context)
 
 	dc_log_info(context, 0, "SMTP-idle started...");
 
+	wait_seconds = dc_job_get_wait_seconds(context, DC_SMTP_THREAD, DC_SMTP_IDLE_SEC); /* failed jobs may be due earlier */
+
 	pthread_mutex_lock(&context->smtpidle_condmutex);
 
 		if (context->perform_smtp_jobs_needed==DC_JOBS_NEEDED_AT_ONCE)
@@ -897,7 +1504,7 @@ void dc_perform_smtp_idle(dc_context_t* context)
 					int r = 0;
 					struct timespec wakeup_at;
 					memset(&wakeup_at, 0, sizeof(wakeup_at));
-					wakeup_at.tv_sec  = time(NULL) + ((context->perform_smtp_jobs_needed==DC_JOBS_NEEDED_AVOID_DOS)? 2 : DC_SMTP_IDLE_SEC);
+					wakeup_at.tv_sec  = time(NULL) + wait_seconds;
 					while (context->smtpidle_condflag==0 && r==0) {
 						r = pthread_cond_timedwait(&context->smtpidle_cond, &context->smtpidle_condmutex, &wakeup_at); // unlock mutex -> wait -> lock mutex
 					}
@@ -969,4 +1576,6 @@ void dc_interrupt_smtp_idle(dc_context_t* context)
 		pthread_cond_signal(&context->smtpidle_cond);
 
 	pthread_mutex_unlock(&context->smtpidle_condmutex);
+
+	dc_scheduler_interrupt(context->scheduler, context, DC_SMTP_THREAD);
 }
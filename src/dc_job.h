@@ -26,6 +26,9 @@ extern "C" {
 #endif
 
 
+#include "dc_imap.h"
+
+
 // thread IDs
 #define DC_IMAP_THREAD             100
 #define DC_SMTP_THREAD            5000
@@ -58,6 +61,23 @@ extern "C" {
 #define DC_SMTP_IDLE_SEC          60
 
 
+// failed jobs are tried again after DC_JOB_BACKOFF_SEC, 2*DC_JOB_BACKOFF_SEC, 4*DC_JOB_BACKOFF_SEC ...
+// seconds, at most DC_JOB_BACKOFF_MAX_SEC (+/- 25% jitter, so that the jobs of many accounts do not hit the servers in lockstep).
+// with the values below, this is 10, 20, 40, 80, 160, 320, 600 and 600 seconds, so a job fails finally after about 30 minutes.
+// tries are only counted while online, offline jobs are tried again the next loop.
+#define DC_JOB_RETRIES             9
+#define DC_JOB_BACKOFF_SEC        10
+#define DC_JOB_BACKOFF_MAX_SEC   600
+#define DC_JOB_OFFLINE_RETRY_SEC  60    // at the latest, the UI typically interrupts idle when the network is back
+
+
+// jobs handling more bytes are "big": they are performed after all small jobs of a thread
+// and only DC_JOB_BIG_MAX_RUNNING of them run at the same time in the whole process.
+// other big jobs are skipped and their threads are interrupted when a running big job ends.
+#define DC_JOB_BIG_BYTES        (256*1024)
+#define DC_JOB_BIG_MAX_RUNNING     1
+
+
 /**
  * Library-internal.
  */
@@ -70,17 +90,40 @@ typedef struct dc_job_t
 	uint32_t    foreign_id;
 	dc_param_t* param;
 	int         try_again;
+	char*       pending_error;  /* the error used for dc_set_msg_failed() if the job finally fails */
+	size_t      bytes;          /* estimated size of the data handled by the job, see DC_JOB_BIG_BYTES */
+	time_t      added_timestamp;
 } dc_job_t;
 
 
 void     dc_job_add                   (dc_context_t*, int action, int foreign_id, const char* param, int delay);
 void     dc_job_kill_actions          (dc_context_t*, int action1, int action2); /* delete all pending jobs with the given actions */
+void     dc_job_kill_foreign_id       (dc_context_t*, uint32_t msg_id); /* delete pending jobs sending or marking the given message; deleting it on the server is kept */
+int      dc_job_get_wait_seconds      (dc_context_t*, int thread, int max_seconds); /* seconds until the next job of the thread is due, at most max_seconds */
+char*    dc_job_get_stats             (dc_context_t*); /* queue depth and latency, one line for dc_get_info() */
+sqlite3_stmt* dc_job_prepare_due      (dc_context_t*, int thread, time_t now); /* the jobs due at `now` in the order they are performed */
+int      dc_job_get_backoff_seconds   (int tries); /* the delay after the given number of failed tries, see DC_JOB_BACKOFF_SEC */
+void     dc_job_forget_context        (dc_context_t*); /* called from dc_context_unref(), see DC_JOB_BIG_MAX_RUNNING */
 
 #define  DC_DONT_TRY_AGAIN           0
 #define  DC_AT_ONCE                 -1
 #define  DC_INCREATION_POLL          2 // this value does not increase the number of tries
 #define  DC_STANDARD_DELAY           3
-void     dc_job_try_again_later       (dc_job_t*, int try_again);
+void     dc_job_try_again_later       (dc_job_t*, int try_again, const char* pending_error);
+
+
+// markseen- and delete-jobs done for several messages of a folder at once, see dc_imap_markseen_msgs()
+typedef struct dc_batch_job_t
+{
+	uint32_t             job_id;
+	int                  action;
+	dc_msg_t*            msg;           /* NULL for DC_JOB_MARKSEEN_MDN_ON_IMAP */
+	char*                server_folder;
+	dc_imap_batch_item_t item;
+	int                  handled;
+} dc_batch_job_t;
+
+int      dc_job_group_batch           (carray* batch_jobs, int first_index, dc_batch_job_t** ret_group);
 
 
 // the other dc_job_do_DC_JOB_*() functions are declared static in the c-file
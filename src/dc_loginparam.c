@@ -52,6 +52,27 @@ void dc_loginparam_unref(dc_loginparam_t* loginparam)
 }
 
 
+dc_loginparam_t* dc_loginparam_dup(const dc_loginparam_t* src)
+{
+	dc_loginparam_t* loginparam = dc_loginparam_new();
+
+	if (src) {
+		loginparam->addr         = dc_strdup_keep_null(src->addr);
+		loginparam->mail_server  = dc_strdup_keep_null(src->mail_server);
+		loginparam->mail_port    =                     src->mail_port;
+		loginparam->mail_user    = dc_strdup_keep_null(src->mail_user);
+		loginparam->mail_pw      = dc_strdup_keep_null(src->mail_pw);
+		loginparam->send_server  = dc_strdup_keep_null(src->send_server);
+		loginparam->send_port    =                     src->send_port;
+		loginparam->send_user    = dc_strdup_keep_null(src->send_user);
+		loginparam->send_pw      = dc_strdup_keep_null(src->send_pw);
+		loginparam->server_flags =                     src->server_flags;
+	}
+
+	return loginparam;
+}
+
+
 void dc_loginparam_empty(dc_loginparam_t* loginparam)
 {
 	if (loginparam == NULL) {
@@ -71,6 +71,7 @@ typedef struct dc_loginparam_t
 
 dc_loginparam_t* dc_loginparam_new          ();
 void             dc_loginparam_unref        (dc_loginparam_t*);
+dc_loginparam_t* dc_loginparam_dup          (const dc_loginparam_t*);
 void             dc_loginparam_empty        (dc_loginparam_t*); /* clears all data and frees its memory. All pointers are NULL after this function is called. */
 void             dc_loginparam_read         (dc_loginparam_t*, dc_sqlite3_t*, const char* prefix);
 void             dc_loginparam_write        (const dc_loginparam_t*, dc_sqlite3_t*, const char* prefix);
@@ -229,7 +229,7 @@ void dc_lot_fill(dc_lot_t* lot, const dc_msg_t* msg, const dc_chat_t* chat, cons
 		}
 	}
 
-	lot->text2     = dc_msg_get_summarytext_by_raw(msg->type, msg->text, msg->param, DC_SUMMARY_CHARACTERS, context);
+	lot->text2     = dc_msg_get_summarytext(msg, DC_SUMMARY_CHARACTERS); /* uses the summary stored on insert, if possible */
 	lot->timestamp = dc_msg_get_timestamp(msg);
 	lot->state     = msg->state;
 }
@@ -0,0 +1,561 @@
+/*******************************************************************************
+ *
+ *                              Delta Chat Core
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ ******************************************************************************/
+
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "dc_context.h"
+#include "dc_mediaprobe.h"
+
+
+/*******************************************************************************
+ * Reading
+ ******************************************************************************/
+
+
+typedef struct probe_src_t
+{
+	const unsigned char* buf;     /* set for dc_mediaprobe_buf() */
+	int                  fd;      /* set for dc_mediaprobe_file() */
+	uint64_t             bytes;   /* size of the buffer or file */
+	int                  budget;  /* number of reads left, protects against files with tons of tiny boxes */
+	#define              PROBE_MAX_READS 4096
+} probe_src_t;
+
+
+/* read exactly `bytes` bytes at `offset`, fails if the data is out of bounds */
+static int src_read(probe_src_t* src, uint64_t offset, void* dest, size_t bytes)
+{
+	if (offset > src->bytes || bytes > src->bytes-offset || src->budget-- <= 0) {
+		return 0;
+	}
+
+	if (src->buf) {
+		memcpy(dest, src->buf+offset, bytes);
+		return 1;
+	}
+
+	while (bytes > 0) {
+		ssize_t r = pread(src->fd, dest, bytes, (off_t)offset);
+		if (r < 0 && errno==EINTR) {
+			continue;
+		}
+		if (r <= 0) {
+			return 0;
+		}
+		dest    = (unsigned char*)dest + r;
+		bytes  -= r;
+		offset += r;
+	}
+
+	return 1;
+}
+
+
+#define BE16(p) (((uint32_t)(p)[0]<<8) | (uint32_t)(p)[1])
+#define BE32(p) (((uint32_t)(p)[0]<<24) | ((uint32_t)(p)[1]<<16) | ((uint32_t)(p)[2]<<8) | (uint32_t)(p)[3])
+#define BE64(p) (((uint64_t)BE32(p)<<32) | (uint64_t)BE32((p)+4))
+#define LE16(p) ((uint32_t)(p)[0] | ((uint32_t)(p)[1]<<8))
+#define LE24(p) ((uint32_t)(p)[0] | ((uint32_t)(p)[1]<<8) | ((uint32_t)(p)[2]<<16))
+#define LE32(p) ((uint32_t)(p)[0] | ((uint32_t)(p)[1]<<8) | ((uint32_t)(p)[2]<<16) | ((uint32_t)(p)[3]<<24))
+
+
+static uint32_t to_ms(uint64_t duration, uint64_t units_per_second)
+{
+	uint64_t ms = 0;
+
+	if (units_per_second==0) {
+		return 0;
+	}
+
+	/* split the calculation to avoid overflows */
+	ms = (duration/units_per_second)*1000 + ((duration%units_per_second)*1000)/units_per_second;
+	return ms > 0x7FFFFFFF? 0 : (uint32_t)ms; /* DC_PARAM_DURATION is stored as an int */
+}
+
+
+/*******************************************************************************
+ * Images
+ ******************************************************************************/
+
+
+static int probe_jpeg(probe_src_t* src, dc_mediaprobe_t* ret)
+{
+	/* the dimensions are in the first SOFn segment, segments before may be large (EXIF thumbnails), so we jump from one segment header to the next */
+	uint64_t      pos = 2;
+	unsigned char m[9];
+
+	while (src_read(src, pos, m, 4))
+	{
+		if (m[0]!=0xFF) {
+			return 0;
+		}
+
+		if (m[1]==0xFF) {
+			pos++; /* fill byte */
+			continue;
+		}
+
+		if ((m[1]>=0xC0 && m[1]<=0xCF) && m[1]!=0xC4 && m[1]!=0xC8 && m[1]!=0xCC) {
+			if (!src_read(src, pos, m, 9)) {
+				return 0;
+			}
+			ret->height = BE16(&m[5]); /* sic! height is first */
+			ret->width  = BE16(&m[7]);
+			return 1;
+		}
+
+		if (m[1]==0xD9 || m[1]==0xDA) {
+			return 0; /* end of image or start of scan, there was no SOFn */
+		}
+
+		if ((m[1]>=0xD0 && m[1]<=0xD7) || m[1]==0x01) {
+			pos += 2; /* markers without length */
+			continue;
+		}
+
+		if (BE16(&m[2]) < 2) {
+			return 0;
+		}
+		pos += 2+BE16(&m[2]);
+	}
+
+	return 0;
+}
+
+
+static int probe_webp(const unsigned char* h, size_t h_bytes, dc_mediaprobe_t* ret)
+{
+	if (h_bytes < 30) {
+		return 0;
+	}
+
+	if (memcmp(&h[12], "VP8 ", 4)==0) {
+		/* lossy: a keyframe header with a start code, followed by 14-bit dimensions */
+		if (h[23]!=0x9D || h[24]!=0x01 || h[25]!=0x2A) {
+			return 0;
+		}
+		ret->width  = LE16(&h[26]) & 0x3FFF;
+		ret->height = LE16(&h[28]) & 0x3FFF;
+		return 1;
+	}
+	else if (memcmp(&h[12], "VP8L", 4)==0) {
+		/* lossless: a signature byte, followed by the dimensions minus one as 14-bit values */
+		if (h[20]!=0x2F) {
+			return 0;
+		}
+		ret->width  = (LE32(&h[21]) & 0x3FFF) + 1;
+		ret->height = ((LE32(&h[21])>>14) & 0x3FFF) + 1;
+		return 1;
+	}
+	else if (memcmp(&h[12], "VP8X", 4)==0) {
+		/* extended, eg. for animations: the canvas size minus one as 24-bit values */
+		ret->width  = LE24(&h[24]) + 1;
+		ret->height = LE24(&h[27]) + 1;
+		return 1;
+	}
+
+	return 0;
+}
+
+
+static int probe_bmp(const unsigned char* h, size_t h_bytes, dc_mediaprobe_t* ret)
+{
+	int32_t w = 0, hh = 0;
+
+	if (h_bytes < 26) {
+		return 0;
+	}
+
+	if (LE32(&h[14])==12) {
+		w  = LE16(&h[18]); /* OS/2 BITMAPCOREHEADER */
+		hh = LE16(&h[20]);
+	}
+	else if (LE32(&h[14])>=40) {
+		w  = (int32_t)LE32(&h[18]);
+		hh = (int32_t)LE32(&h[22]);
+		if (hh < 0 && hh!=INT32_MIN) {
+			hh = -hh; /* top-down bitmap */
+		}
+	}
+
+	if (w<=0 || hh<=0) {
+		return 0;
+	}
+
+	ret->width  = w;
+	ret->height = hh;
+	return 1;
+}
+
+
+/*******************************************************************************
+ * MP4 and QuickTime
+ ******************************************************************************/
+
+
+static void mp4_walk(probe_src_t* src, uint64_t pos, uint64_t end, int depth, dc_mediaprobe_t* ret)
+{
+	unsigned char b[16];
+	uint64_t      box_bytes = 0, hdr_bytes = 0;
+
+	while (pos+8 <= end && depth < 8 && src_read(src, pos, b, 8))
+	{
+		box_bytes = BE32(b);
+		hdr_bytes = 8;
+		if (box_bytes==1) {
+			if (!src_read(src, pos+8, b+8, 8)) {
+				return;
+			}
+			box_bytes = BE64(b+8);
+			hdr_bytes = 16;
+		}
+		else if (box_bytes==0) {
+			box_bytes = end-pos; /* the box extends to the end */
+		}
+
+		if (box_bytes < hdr_bytes || box_bytes > end-pos) {
+			return;
+		}
+
+		if (memcmp(&b[4], "moov", 4)==0 || memcmp(&b[4], "trak", 4)==0) {
+			mp4_walk(src, pos+hdr_bytes, pos+box_bytes, depth+1, ret);
+		}
+		else if (memcmp(&b[4], "mvhd", 4)==0) {
+			unsigned char v[32];
+			if (src_read(src, pos+hdr_bytes, v, 1)) {
+				if (v[0]==0 && src_read(src, pos+hdr_bytes, v, 20)) {
+					ret->duration_ms = to_ms(BE32(&v[16]), BE32(&v[12]));
+				}
+				else if (v[0]==1 && src_read(src, pos+hdr_bytes, v, 32)) {
+					ret->duration_ms = to_ms(BE64(&v[24]), BE32(&v[20]));
+				}
+			}
+		}
+		else if (memcmp(&b[4], "tkhd", 4)==0 && ret->width==0) {
+			/* the first track with dimensions is the video track; width and height are 16.16 fixed point values at the end of the box */
+			unsigned char v[8];
+			uint64_t      wh_offset = 0;
+			if (src_read(src, pos+hdr_bytes, v, 1)) {
+				wh_offset = v[0]==1? 88 : 76;
+				if (src_read(src, pos+hdr_bytes+wh_offset, v, 8)) {
+					ret->width  = BE32(&v[0])>>16;
+					ret->height = BE32(&v[4])>>16;
+					if (ret->width==0 || ret->height==0) {
+						ret->width = ret->height = 0; /* eg. an audio track */
+					}
+				}
+			}
+		}
+
+		pos += box_bytes;
+	}
+}
+
+
+/*******************************************************************************
+ * WebM and Matroska
+ ******************************************************************************/
+
+
+#define EBML_UNKNOWN_SIZE UINT64_MAX
+
+
+/* read a variable-length integer; for IDs, the length marker is kept */
+static int ebml_read_vint(probe_src_t* src, uint64_t* pos, int is_id, uint64_t* ret_value)
+{
+	unsigned char b[8];
+	int           len = 1, i = 0;
+	uint64_t      value = 0, all_ones = 0;
+
+	if (!src_read(src, *pos, b, 1) || b[0]==0) {
+		return 0;
+	}
+
+	while (!(b[0] & (0x80>>(len-1)))) {
+		len++;
+	}
+
+	if (len > (is_id? 4 : 8) || !src_read(src, *pos, b, len)) {
+		return 0;
+	}
+
+	value = is_id? b[0] : (b[0] & (0xFF>>len));
+	all_ones = (0xFF>>len);
+	for (i = 1; i < len; i++) {
+		value = (value<<8) | b[i];
+		all_ones = (all_ones<<8) | 0xFF;
+	}
+
+	if (!is_id && value==all_ones) {
+		value = EBML_UNKNOWN_SIZE;
+	}
+
+	*pos += len;
+	*ret_value = value;
+	return 1;
+}
+
+
+static uint64_t ebml_read_uint(probe_src_t* src, uint64_t pos, uint64_t bytes)
+{
+	unsigned char b[8];
+	uint64_t      value = 0;
+	int           i;
+
+	if (bytes > 8 || !src_read(src, pos, b, bytes)) {
+		return 0;
+	}
+
+	for (i = 0; i < (int)bytes; i++) {
+		value = (value<<8) | b[i];
+	}
+	return value;
+}
+
+
+static double ebml_read_float(probe_src_t* src, uint64_t pos, uint64_t bytes)
+{
+	union { uint32_t i; float  f; } v4;
+	union { uint64_t i; double f; } v8;
+
+	if (bytes==4) {
+		v4.i = (uint32_t)ebml_read_uint(src, pos, 4);
+		return v4.f;
+	}
+	else if (bytes==8) {
+		v8.i = ebml_read_uint(src, pos, 8);
+		return v8.f;
+	}
+	return 0;
+}
+
+
+static void ebml_walk(probe_src_t* src, uint64_t pos, uint64_t end, int depth, dc_mediaprobe_t* ret, uint64_t* timecode_scale, double* duration)
+{
+	uint64_t id = 0, bytes = 0;
+
+	while (pos < end && depth < 8
+	    && ebml_read_vint(src, &pos, 1, &id)
+	    && ebml_read_vint(src, &pos, 0, &bytes))
+	{
+		if (pos > end) {
+			return;
+		}
+
+		if (bytes==EBML_UNKNOWN_SIZE) {
+			if (id!=0x18538067) {
+				return; /* only the segment is expected to have an unknown size, clusters are not needed */
+			}
+			bytes = end-pos;
+		}
+
+		if (bytes > end-pos) {
+			return;
+		}
+
+		switch (id)
+		{
+			case 0x18538067: /* Segment */
+			case 0x1549A966: /* Info */
+			case 0x1654AE6B: /* Tracks */
+			case 0xAE:       /* TrackEntry */
+			case 0xE0:       /* Video */
+				ebml_walk(src, pos, pos+bytes, depth+1, ret, timecode_scale, duration);
+				break;
+
+			case 0x2AD7B1:   /* TimecodeScale, in nanoseconds */
+				*timecode_scale = ebml_read_uint(src, pos, bytes);
+				break;
+
+			case 0x4489:     /* Duration, in TimecodeScale units */
+				*duration = ebml_read_float(src, pos, bytes);
+				break;
+
+			case 0xB0:       /* PixelWidth */
+				if (ret->width==0) { ret->width = (uint32_t)ebml_read_uint(src, pos, bytes); }
+				break;
+
+			case 0xBA:       /* PixelHeight */
+				if (ret->height==0) { ret->height = (uint32_t)ebml_read_uint(src, pos, bytes); }
+				break;
+
+			case 0x1F43B675: /* Cluster, the media data starts, everything needed comes before */
+				return;
+		}
+
+		pos += bytes;
+	}
+}
+
+
+static void probe_webm(probe_src_t* src, dc_mediaprobe_t* ret)
+{
+	uint64_t timecode_scale = 1000000; /* default: milliseconds */
+	double   duration = 0;
+	double   duration_ms = 0;
+
+	ebml_walk(src, 0, src->bytes, 0, ret, &timecode_scale, &duration);
+
+	duration_ms = duration * (double)timecode_scale / 1000000.0;
+	if (duration_ms > 0 && duration_ms < 0x7FFFFFFF) {
+		ret->duration_ms = (uint32_t)duration_ms;
+	}
+}
+
+
+/*******************************************************************************
+ * Main interface
+ ******************************************************************************/
+
+
+static int probe(probe_src_t* src, dc_mediaprobe_t* ret)
+{
+	#define       HEADER_BYTES 32
+	unsigned char h[HEADER_BYTES];
+	size_t        h_bytes = src->bytes < HEADER_BYTES? (size_t)src->bytes : HEADER_BYTES;
+
+	memset(ret, 0, sizeof(dc_mediaprobe_t));
+
+	if (h_bytes < 10 || !src_read(src, 0, h, h_bytes)) {
+		return 0;
+	}
+
+	if (h[0]==0xFF && h[1]==0xD8 && h[2]==0xFF)
+	{
+		ret->format = DC_MEDIAPROBE_JPEG;
+		probe_jpeg(src, ret);
+	}
+	else if (h_bytes >= 24 && memcmp(h, "\x89PNG\r\n\x1A\n", 8)==0 && BE32(&h[8])==13 && memcmp(&h[12], "IHDR", 4)==0)
+	{
+		/* the first chunk is by definition the IHDR chunk, which gives the dimensions */
+		ret->format = DC_MEDIAPROBE_PNG;
+		ret->width  = BE32(&h[16]);
+		ret->height = BE32(&h[20]);
+	}
+	else if (memcmp(h, "GIF87a", 6)==0 || memcmp(h, "GIF89a", 6)==0)
+	{
+		ret->format = DC_MEDIAPROBE_GIF;
+		ret->width  = LE16(&h[6]);
+		ret->height = LE16(&h[8]);
+	}
+	else if (h_bytes >= 16 && memcmp(h, "RIFF", 4)==0 && memcmp(&h[8], "WEBP", 4)==0)
+	{
+		ret->format = DC_MEDIAPROBE_WEBP;
+		probe_webp(h, h_bytes, ret);
+	}
+	else if (h[0]=='B' && h[1]=='M')
+	{
+		ret->format = DC_MEDIAPROBE_BMP;
+		probe_bmp(h, h_bytes, ret);
+	}
+	else if (h_bytes >= 12 && (memcmp(&h[4], "ftyp", 4)==0 || memcmp(&h[4], "moov", 4)==0 || memcmp(&h[4], "mdat", 4)==0 || memcmp(&h[4], "wide", 4)==0))
+	{
+		ret->format = DC_MEDIAPROBE_MP4;
+		mp4_walk(src, 0, src->bytes, 0, ret);
+	}
+	else if (BE32(h)==0x1A45DFA3)
+	{
+		ret->format = DC_MEDIAPROBE_WEBM;
+		probe_webm(src, ret);
+	}
+
+	if (ret->width > 0x7FFFFFFF || ret->height > 0x7FFFFFFF || ret->width==0 || ret->height==0) {
+		ret->width  = 0; /* DC_PARAM_WIDTH and DC_PARAM_HEIGHT are stored as int */
+		ret->height = 0;
+	}
+
+	return (ret->format!=DC_MEDIAPROBE_UNKNOWN && (ret->width || ret->duration_ms));
+}
+
+
+/**
+ * Find out the dimensions and the duration of an image or a video in memory.
+ * See dc_mediaprobe_file() for details.
+ *
+ * @private @memberof dc_mediaprobe_t
+ * @param buf The image or video data, must not be null-terminated.
+ * @param buf_bytes The number of bytes in buf.
+ * @param[out] ret The found values are written here.
+ * @return 1=the format is known and the width and height or the duration are found, 0=nothing found.
+ */
+int dc_mediaprobe_buf(const void* buf, size_t buf_bytes, dc_mediaprobe_t* ret)
+{
+	probe_src_t src;
+
+	if (buf==NULL || ret==NULL) {
+		return 0;
+	}
+
+	memset(&src, 0, sizeof(probe_src_t));
+	src.buf    = buf;
+	src.fd     = -1;
+	src.bytes  = buf_bytes;
+	src.budget = PROBE_MAX_READS;
+
+	return probe(&src, ret);
+}
+
+
+/**
+ * Find out the dimensions and the duration of an image or a video file.
+ * Supported are JPEG, PNG, GIF, WebP and BMP images, MP4/QuickTime and
+ * WebM/Matroska videos.  Only the needed header bytes are read from the file,
+ * all offsets and lengths found in the file are checked against the file size.
+ *
+ * @private @memberof dc_mediaprobe_t
+ * @param pathNfilename The file to probe.
+ * @param[out] ret The found values are written here.
+ * @return 1=the format is known and the width and height or the duration are found, 0=nothing found.
+ */
+int dc_mediaprobe_file(const char* pathNfilename, dc_mediaprobe_t* ret)
+{
+	int         success = 0;
+	probe_src_t src;
+	struct stat st;
+
+	memset(&src, 0, sizeof(probe_src_t));
+	src.fd = -1;
+
+	if (pathNfilename==NULL || ret==NULL) {
+		goto cleanup;
+	}
+
+	memset(ret, 0, sizeof(dc_mediaprobe_t));
+
+	if ((src.fd=open(pathNfilename, O_RDONLY))<0
+	 || fstat(src.fd, &st)!=0 || !S_ISREG(st.st_mode)) {
+		goto cleanup;
+	}
+
+	src.bytes  = (uint64_t)st.st_size;
+	src.budget = PROBE_MAX_READS;
+
+	success = probe(&src, ret);
+
+cleanup:
+	if (src.fd>=0) {
+		close(src.fd);
+	}
+	return success;
+}
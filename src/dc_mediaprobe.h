@@ -0,0 +1,63 @@
+/*******************************************************************************
+ *
+ *                              Delta Chat Core
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ ******************************************************************************/
+
+
+
+#ifndef __DC_MEDIAPROBE_H__
+#define __DC_MEDIAPROBE_H__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * Library-internal.
+ *
+ * Dimensions and duration of an image or a video as found by
+ * dc_mediaprobe_buf() or dc_mediaprobe_file().
+ * Only the headers are read, for files, the needed bytes are read using pread(),
+ * so probing a large video does not load the video into memory.
+ */
+typedef struct dc_mediaprobe_t
+{
+	/** @privatesection */
+	#define  DC_MEDIAPROBE_UNKNOWN 0
+	#define  DC_MEDIAPROBE_JPEG    1
+	#define  DC_MEDIAPROBE_PNG     2
+	#define  DC_MEDIAPROBE_GIF     3
+	#define  DC_MEDIAPROBE_WEBP    4
+	#define  DC_MEDIAPROBE_BMP     5
+	#define  DC_MEDIAPROBE_MP4     6  /* also used for QuickTime files */
+	#define  DC_MEDIAPROBE_WEBM    7  /* also used for Matroska files */
+	int      format;
+	uint32_t width;       /* 0 if unknown */
+	uint32_t height;      /* 0 if unknown */
+	uint32_t duration_ms; /* 0 if unknown or if the format has no duration */
+} dc_mediaprobe_t;
+
+
+int dc_mediaprobe_buf  (const void* buf, size_t buf_bytes, dc_mediaprobe_t* ret);
+int dc_mediaprobe_file (const char* pathNfilename, dc_mediaprobe_t* ret);
+
+
+#ifdef __cplusplus
+} /* /extern "C" */
+#endif
+#endif /* __DC_MEDIAPROBE_H__ */
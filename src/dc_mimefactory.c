@@ -85,6 +85,9 @@ void dc_mimefactory_empty(dc_mimefactory_t* factory)
 	factory->out_encrypted = 0;
 	factory->loaded = DC_MF_NOTHING_LOADED;
 
+	free(factory->error);
+	factory->error = NULL;
+
 	factory->timestamp = 0;
 }
 
@@ -459,6 +462,13 @@ static char* get_subject(const dc_chat_t* chat, const dc_msg_t* msg, int afwd_em
 }
 
 
+static void set_error(dc_mimefactory_t* factory, const char* text)
+{
+	free(factory->error);
+	factory->error = dc_strdup(text);
+}
+
+
 int dc_mimefactory_render(dc_mimefactory_t* factory)
 {
 	if (factory==NULL
@@ -701,6 +711,7 @@ int dc_mimefactory_render(dc_mimefactory_t* factory)
 		}
 
 		if (parts==0) {
+			set_error(factory, "Empty message.");
 			goto cleanup;
 		}
 
@@ -767,6 +778,7 @@ int dc_mimefactory_render(dc_mimefactory_t* factory)
 	}
 	else
 	{
+		set_error(factory, "No message loaded.");
 		goto cleanup;
 	}
 
@@ -72,6 +72,7 @@ typedef struct dc_mimefactory_t {
 	/* out: after a successfull dc_mimefactory_render(), here's the data */
 	MMAPString*   out;
 	int           out_encrypted;
+	char*         error;        /* set if dc_mimefactory_render() fails */
 
 	/* private */
 	dc_context_t* context;
@@ -26,6 +26,8 @@
 #include "dc_uudecode.h"
 #include "dc_pgp.h"
 #include "dc_simplify.h"
+#include "dc_arena.h"
+#include "dc_mediaprobe.h"
 
 
 /*******************************************************************************
@@ -778,16 +780,15 @@ static int mailmime_get_mime_type(struct mailmime* mime, int* msg_type)
  ******************************************************************************/
 
 
-static dc_mimepart_t* dc_mimepart_new(void)
+static dc_mimepart_t* dc_mimepart_new(dc_mimeparser_t* mimeparser)
 {
-	dc_mimepart_t* mimepart = NULL;
-
-	if ((mimepart=calloc(1, sizeof(dc_mimepart_t)))==NULL) {
-		exit(33);
-	}
+	/* the part, its dc_mimepart_t::msg and the dc_param_t object live in the parser's arena and are freed by dc_mimeparser_empty();
+	only the packed parameters are allocated as usual as dc_param_set() replaces them */
+	dc_mimepart_t* mimepart = (dc_mimepart_t*)dc_arena_alloc(mimeparser->arena, sizeof(dc_mimepart_t));
 
 	mimepart->type    = DC_MSG_UNDEFINED;
-	mimepart->param   = dc_param_new();
+	mimepart->param   = (dc_param_t*)dc_arena_alloc(mimeparser->arena, sizeof(dc_param_t));
+	mimepart->param->packed = dc_strdup(NULL);
 
 	return mimepart;
 }
@@ -799,18 +800,12 @@ static void dc_mimepart_unref(dc_mimepart_t* mimepart)
 		return;
 	}
 
-	if (mimepart->msg) {
-		free(mimepart->msg);
-		mimepart->msg = NULL;
-	}
+	mimepart->msg = NULL;
 
-	if (mimepart->msg_raw) {
-		free(mimepart->msg_raw);
-		mimepart->msg_raw = NULL;
+	if (mimepart->param) {
+		free(mimepart->param->packed);
+		mimepart->param = NULL;
 	}
-
-	dc_param_unref(mimepart->param);
-	free(mimepart);
 }
 
 
@@ -841,10 +836,11 @@ dc_mimeparser_t* dc_mimeparser_new(const char* blobdir, dc_context_t* context)
 	mimeparser->parts   = carray_new(16);
 	mimeparser->blobdir = blobdir; /* no need to copy the string at the moment */
 	mimeparser->reports = carray_new(16);
+	mimeparser->transfer_decoding_buffers = carray_new(16);
+	mimeparser->charset_buffers = carray_new(16);
+	mimeparser->arena = dc_arena_new();
 	mimeparser->e2ee_helper = calloc(1, sizeof(dc_e2ee_helper_t));
 
-	dc_hash_init(&mimeparser->header, DC_HASH_STRING, 0/* do not copy key */);
-
 	return mimeparser;
 }
 
@@ -869,6 +865,9 @@ void dc_mimeparser_unref(dc_mimeparser_t* mimeparser)
 	dc_mimeparser_empty(mimeparser);
 	if (mimeparser->parts)   { carray_free(mimeparser->parts); }
 	if (mimeparser->reports) { carray_free(mimeparser->reports); }
+	if (mimeparser->transfer_decoding_buffers) { carray_free(mimeparser->transfer_decoding_buffers); }
+	if (mimeparser->charset_buffers) { carray_free(mimeparser->charset_buffers); }
+	dc_arena_unref(mimeparser->arena);
 	free(mimeparser->e2ee_helper);
 	free(mimeparser);
 }
@@ -905,7 +904,7 @@ void dc_mimeparser_empty(dc_mimeparser_t* mimeparser)
 	}
 
 	mimeparser->header_root  = NULL; /* a pointer somewhere to the MIME data, must NOT be freed */
-	dc_hash_clear(&mimeparser->header);
+	memset(mimeparser->headers, 0, sizeof(mimeparser->headers));
 
 	if (mimeparser->header_protected) {
 		mailimf_fields_free(mimeparser->header_protected); /* allocated as needed, MUST be freed */
@@ -915,8 +914,7 @@ void dc_mimeparser_empty(dc_mimeparser_t* mimeparser)
 	mimeparser->is_send_by_messenger  = 0;
 	mimeparser->is_system_message = 0;
 
-	free(mimeparser->subject);
-	mimeparser->subject = NULL;
+	mimeparser->subject = NULL; /* freed with the arena */
 
 	if (mimeparser->mimeroot)
 	{
@@ -930,9 +928,109 @@ void dc_mimeparser_empty(dc_mimeparser_t* mimeparser)
 		carray_set_size(mimeparser->reports, 0);
 	}
 
+	/* the buffers are referenced by the parts, so free them only after the parts are gone */
+	if (mimeparser->transfer_decoding_buffers)
+	{
+		int i, cnt = carray_count(mimeparser->transfer_decoding_buffers);
+		for (i = 0; i < cnt; i++) {
+			mmap_string_unref((char*)carray_get(mimeparser->transfer_decoding_buffers, i));
+		}
+		carray_set_size(mimeparser->transfer_decoding_buffers, 0);
+	}
+
+	if (mimeparser->charset_buffers)
+	{
+		int i, cnt = carray_count(mimeparser->charset_buffers);
+		for (i = 0; i < cnt; i++) {
+			charconv_buffer_free((char*)carray_get(mimeparser->charset_buffers, i));
+		}
+		carray_set_size(mimeparser->charset_buffers, 0);
+	}
+
 	mimeparser->decrypting_failed = 0;
 
 	dc_e2ee_thanks(mimeparser->e2ee_helper);
+	memset(mimeparser->e2ee_helper, 0, sizeof(dc_e2ee_helper_t)); /* the parser may be reused, see dc_mimeparser_release() */
+
+	dc_arena_reset(mimeparser->arena); /* frees the parts and other per-message data at once */
+}
+
+
+/**
+ * Get an empty MIME-parser object for the given context.
+ * If possible, a parser released by dc_mimeparser_release() is reused,
+ * so that its arena and arrays need not be allocated again.
+ *
+ * @private @memberof dc_mimeparser_t
+ * @param context The context the parser is used for; its blobdir is used for attachments.
+ * @return The MIME-parser object, must be given to dc_mimeparser_release() or to dc_mimeparser_unref().
+ */
+dc_mimeparser_t* dc_mimeparser_new_pooled(dc_context_t* context)
+{
+	dc_mimeparser_t* mimeparser = NULL;
+
+	pthread_mutex_lock(&context->mimeparser_pool_critical);
+		if (context->mimeparser_pool_cnt > 0) {
+			context->mimeparser_pool_cnt--;
+			mimeparser = context->mimeparser_pool[context->mimeparser_pool_cnt];
+		}
+	pthread_mutex_unlock(&context->mimeparser_pool_critical);
+
+	if (mimeparser==NULL) {
+		mimeparser = dc_mimeparser_new(context->blobdir, context);
+	}
+
+	return mimeparser;
+}
+
+
+/**
+ * Empty a MIME-parser object and keep it for the next message of its context,
+ * see dc_mimeparser_new_pooled().  If enough parsers are kept, the parser is freed.
+ *
+ * @private @memberof dc_mimeparser_t
+ * @param mimeparser The MIME-parser object. If NULL is given, nothing is done.
+ * @return None.
+ */
+void dc_mimeparser_release(dc_mimeparser_t* mimeparser)
+{
+	dc_context_t* context = NULL;
+
+	if (mimeparser==NULL) {
+		return;
+	}
+
+	dc_mimeparser_empty(mimeparser);
+
+	context = mimeparser->context;
+	pthread_mutex_lock(&context->mimeparser_pool_critical);
+		if (context->mimeparser_pool_cnt < DC_MIMEPARSER_POOL_MAX) {
+			context->mimeparser_pool[context->mimeparser_pool_cnt] = mimeparser;
+			context->mimeparser_pool_cnt++;
+			mimeparser = NULL;
+		}
+	pthread_mutex_unlock(&context->mimeparser_pool_critical);
+
+	dc_mimeparser_unref(mimeparser);
+}
+
+
+/**
+ * Free all MIME-parser objects kept for reuse, called by dc_context_unref().
+ *
+ * @private @memberof dc_mimeparser_t
+ * @param context The context object.
+ * @return None.
+ */
+void dc_mimeparser_free_pool(dc_context_t* context)
+{
+	pthread_mutex_lock(&context->mimeparser_pool_critical);
+		while (context->mimeparser_pool_cnt > 0) {
+			context->mimeparser_pool_cnt--;
+			dc_mimeparser_unref(context->mimeparser_pool[context->mimeparser_pool_cnt]);
+			context->mimeparser_pool[context->mimeparser_pool_cnt] = NULL;
+		}
+	pthread_mutex_unlock(&context->mimeparser_pool_critical);
 }
 
 
@@ -956,33 +1054,48 @@ static void do_add_single_file_part(dc_mimeparser_t* parser, int msg_type, int m
 	dc_mimepart_t* part = NULL;
 	char*          pathNfilename = NULL;
 
-	/* create a free file name to use */
-	if ((pathNfilename=dc_get_fine_pathNfilename(parser->blobdir, desired_filename))==NULL) {
-		goto cleanup;
-	}
+	/* create a free file name to use and copy data to file;
+	as messages may be parsed in parallel, no other parser must pick the same name in between */
+	pthread_mutex_lock(&parser->context->blobdir_critical);
+		if ((pathNfilename=dc_get_fine_pathNfilename(parser->blobdir, desired_filename))!=NULL
+		 && dc_write_file(pathNfilename, decoded_data, decoded_data_bytes, parser->context)==0) {
+			free(pathNfilename);
+			pathNfilename = NULL;
+		}
+	pthread_mutex_unlock(&parser->context->blobdir_critical);
 
-	/* copy data to file */
-	if (dc_write_file(pathNfilename, decoded_data, decoded_data_bytes, parser->context)==0) {
+	if (pathNfilename==NULL) {
 		goto cleanup;
 	}
 
-	part = dc_mimepart_new();
+	part = dc_mimepart_new(parser);
 	part->type  = msg_type;
 	part->int_mimetype = mime_type;
 	part->bytes = decoded_data_bytes;
 	dc_param_set(part->param, DC_PARAM_FILE, pathNfilename);
 	if (DC_MSG_MAKE_FILENAME_SEARCHABLE(msg_type)) {
-		part->msg = dc_get_filename(pathNfilename);
+		const char* filename = strrchr(pathNfilename, '/'); /* created by dc_get_fine_pathNfilename(), so there is always a slash */
+		filename = filename? filename+1 : pathNfilename;
+		part->msg = dc_arena_strndup(parser->arena, filename, strlen(filename));
 	}
 	else if (DC_MSG_MAKE_SUFFIX_SEARCHABLE(msg_type)) {
-		part->msg = dc_get_filesuffix_lc(pathNfilename);
+		const char* suffix = strrchr(pathNfilename, '.');
+		if (suffix) {
+			part->msg = dc_arena_strndup(parser->arena, suffix+1, strlen(suffix+1));
+			dc_strlower_in_place(part->msg);
+		}
 	}
 
-	if (mime_type==DC_MIMETYPE_IMAGE) {
-		uint32_t w = 0, h = 0;
-		if (dc_get_filemeta(decoded_data, decoded_data_bytes, &w, &h)) {
-			dc_param_set_int(part->param, DC_PARAM_WIDTH, w);
-			dc_param_set_int(part->param, DC_PARAM_HEIGHT, h);
+	if (mime_type==DC_MIMETYPE_IMAGE || mime_type==DC_MIMETYPE_VIDEO) {
+		dc_mediaprobe_t probe;
+		if (dc_mediaprobe_buf(decoded_data, decoded_data_bytes, &probe)) {
+			if (probe.width && probe.height) {
+				dc_param_set_int(part->param, DC_PARAM_WIDTH, probe.width);
+				dc_param_set_int(part->param, DC_PARAM_HEIGHT, probe.height);
+			}
+			if (mime_type==DC_MIMETYPE_VIDEO && probe.duration_ms) {
+				dc_param_set_int(part->param, DC_PARAM_DURATION, probe.duration_ms);
+			}
 		}
 	}
 
@@ -1053,6 +1166,7 @@ static int dc_mimeparser_add_single_part_if_known(dc_mimeparser_t* mimeparser, s
 					if (simplifier==NULL) {
 						goto cleanup;
 					}
+					simplifier->html_max_bytes = DC_MAX_GET_TEXT_LEN*4; /* the text is truncated to DC_MAX_GET_TEXT_LEN characters on display anyway, so do not convert huge newsletters completely; the limit is larger as the converted HTML still contains lots of whitespace */
 				}
 
 				const char* charset = mailmime_content_charset_get(mime->mm_content_type); /* get from `Content-Type: text/...; charset=utf-8`; must not be free()'d */
@@ -1104,13 +1218,23 @@ static int dc_mimeparser_add_single_part_if_known(dc_mimeparser_t* mimeparser, s
 				txt = NULL;
 				if (simplified_txt && simplified_txt[0])
 				{
-					part = dc_mimepart_new();
+					part = dc_mimepart_new(mimeparser);
 					part->type = DC_MSG_TEXT;
 					part->int_mimetype = mime_type;
-					part->msg = simplified_txt;
-					part->msg_raw = strndup(decoded_data, decoded_data_bytes);
+					part->msg = dc_arena_adopt(mimeparser->arena, simplified_txt);
+					part->msg_raw = decoded_data; /* no copy, instead, the decoding buffer is kept alive by the parser */
+					part->msg_raw_bytes = decoded_data_bytes;
 					do_add_single_part(mimeparser, part);
 					part = NULL;
+
+					if (decoded_data==charset_buffer) {
+						carray_add(mimeparser->charset_buffers, charset_buffer, NULL);
+						charset_buffer = NULL;
+					}
+					else if (decoded_data==transfer_decoding_buffer) {
+						carray_add(mimeparser->transfer_decoding_buffers, transfer_decoding_buffer, NULL);
+						transfer_decoding_buffer = NULL;
+					}
 				}
 				else
 				{
@@ -1298,11 +1422,11 @@ static int dc_mimeparser_parse_mime_recursive(dc_mimeparser_t* mimeparser, struc
 
 				case DC_MIMETYPE_MP_NOT_DECRYPTABLE:
 					{
-						dc_mimepart_t* part = dc_mimepart_new();
+						dc_mimepart_t* part = dc_mimepart_new(mimeparser);
 						part->type = DC_MSG_TEXT;
 
 						char* msg_body = dc_stock_str(mimeparser->context, DC_STR_CANTDECRYPT_MSG_BODY);
-						part->msg = dc_mprintf(DC_EDITORIAL_OPEN "%s" DC_EDITORIAL_CLOSE, msg_body);
+						part->msg = dc_arena_mprintf(mimeparser->arena, DC_EDITORIAL_OPEN "%s" DC_EDITORIAL_CLOSE, msg_body);
 						free(msg_body);
 
 						carray_add(mimeparser->parts, (void*)part, NULL);
@@ -1396,7 +1520,157 @@ static int dc_mimeparser_parse_mime_recursive(dc_mimeparser_t* mimeparser, struc
 }
 
 
-static void hash_header(dc_hash_t* out, const struct mailimf_fields* in, dc_context_t* context)
+static const char* s_header_names[DC_HEADER_CNT] = {
+	"Return-Path",
+	"Date",
+	"From",
+	"Sender",
+	"Reply-To",
+	"To",
+	"Cc",
+	"Bcc",
+	"Message-ID",
+	"In-Reply-To",
+	"References",
+	"Subject",
+	"Chat-Version",
+	"X-MrMsg",
+	"Autocrypt-Setup-Message",
+	"Chat-Voice-Message",
+	"X-MrVoiceMessage",
+	"Chat-Duration",
+	"X-MrDurationMs",
+	"Chat-Group-Image",
+	"Chat-Disposition-Notification-To",
+	"List-Id",
+	"Precedence",
+	"Chat-Predecessor",
+	"X-MrPredecessor",
+	"Chat-Group-ID",
+	"X-MrGrpId",
+	"Chat-Group-Name",
+	"X-MrGrpName",
+	"Chat-Group-Member-Removed",
+	"X-MrRemoveFromGrp",
+	"Chat-Group-Member-Added",
+	"X-MrAddToGrp",
+	"Chat-Group-Name-Changed",
+	"X-MrGrpNameChanged",
+	"Chat-Verified",
+	"Secure-Join",
+	"Secure-Join-Invitenumber",
+	"Secure-Join-Fingerprint",
+	"Secure-Join-Auth",
+	"Secure-Join-Group",
+};
+
+
+/**
+ * Get the id of a header name.
+ *
+ * The switch is generated from s_header_names; the length selects at most
+ * a few candidates that are compared then, so no hash is needed.
+ *
+ * @private @memberof dc_mimeparser_t
+ * @param name The name of the header, case does not matter.
+ * @return One of the DC_HEADER_* constants or -1 if the header is not used by the core.
+ */
+int dc_mimeparser_header_id(const char* name)
+{
+	if (name==NULL) {
+		return -1;
+	}
+
+	switch (strlen(name))
+	{
+		case 2:
+			if (strcasecmp(name, "To")==0) { return DC_HEADER_TO; }
+			if (strcasecmp(name, "Cc")==0) { return DC_HEADER_CC; }
+			break;
+		case 3:
+			if (strcasecmp(name, "Bcc")==0) { return DC_HEADER_BCC; }
+			break;
+		case 4:
+			if (strcasecmp(name, "Date")==0) { return DC_HEADER_DATE; }
+			if (strcasecmp(name, "From")==0) { return DC_HEADER_FROM; }
+			break;
+		case 6:
+			if (strcasecmp(name, "Sender")==0) { return DC_HEADER_SENDER; }
+			break;
+		case 7:
+			if (strcasecmp(name, "Subject")==0) { return DC_HEADER_SUBJECT; }
+			if (strcasecmp(name, "X-MrMsg")==0) { return DC_HEADER_X_MRMSG; }
+			if (strcasecmp(name, "List-Id")==0) { return DC_HEADER_LIST_ID; }
+			break;
+		case 8:
+			if (strcasecmp(name, "Reply-To")==0) { return DC_HEADER_REPLY_TO; }
+			break;
+		case 9:
+			if (strcasecmp(name, "X-MrGrpId")==0) { return DC_HEADER_X_MRGRPID; }
+			break;
+		case 10:
+			if (strcasecmp(name, "Message-ID")==0) { return DC_HEADER_MESSAGE_ID; }
+			if (strcasecmp(name, "References")==0) { return DC_HEADER_REFERENCES; }
+			if (strcasecmp(name, "Precedence")==0) { return DC_HEADER_PRECEDENCE; }
+			break;
+		case 11:
+			if (strcasecmp(name, "Return-Path")==0) { return DC_HEADER_RETURN_PATH; }
+			if (strcasecmp(name, "In-Reply-To")==0) { return DC_HEADER_IN_REPLY_TO; }
+			if (strcasecmp(name, "X-MrGrpName")==0) { return DC_HEADER_X_MRGRPNAME; }
+			if (strcasecmp(name, "Secure-Join")==0) { return DC_HEADER_SECURE_JOIN; }
+			break;
+		case 12:
+			if (strcasecmp(name, "Chat-Version")==0) { return DC_HEADER_CHAT_VERSION; }
+			if (strcasecmp(name, "X-MrAddToGrp")==0) { return DC_HEADER_X_MRADDTOGRP; }
+			break;
+		case 13:
+			if (strcasecmp(name, "Chat-Duration")==0) { return DC_HEADER_CHAT_DURATION; }
+			if (strcasecmp(name, "Chat-Group-ID")==0) { return DC_HEADER_CHAT_GROUP_ID; }
+			if (strcasecmp(name, "Chat-Verified")==0) { return DC_HEADER_CHAT_VERIFIED; }
+			break;
+		case 14:
+			if (strcasecmp(name, "X-MrDurationMs")==0) { return DC_HEADER_X_MRDURATIONMS; }
+			break;
+		case 15:
+			if (strcasecmp(name, "X-MrPredecessor")==0) { return DC_HEADER_X_MRPREDECESSOR; }
+			if (strcasecmp(name, "Chat-Group-Name")==0) { return DC_HEADER_CHAT_GROUP_NAME; }
+			break;
+		case 16:
+			if (strcasecmp(name, "X-MrVoiceMessage")==0) { return DC_HEADER_X_MRVOICEMESSAGE; }
+			if (strcasecmp(name, "Chat-Group-Image")==0) { return DC_HEADER_CHAT_GROUP_IMAGE; }
+			if (strcasecmp(name, "Chat-Predecessor")==0) { return DC_HEADER_CHAT_PREDECESSOR; }
+			if (strcasecmp(name, "Secure-Join-Auth")==0) { return DC_HEADER_SECURE_JOIN_AUTH; }
+			break;
+		case 17:
+			if (strcasecmp(name, "X-MrRemoveFromGrp")==0) { return DC_HEADER_X_MRREMOVEFROMGRP; }
+			if (strcasecmp(name, "Secure-Join-Group")==0) { return DC_HEADER_SECURE_JOIN_GROUP; }
+			break;
+		case 18:
+			if (strcasecmp(name, "Chat-Voice-Message")==0) { return DC_HEADER_CHAT_VOICE_MESSAGE; }
+			if (strcasecmp(name, "X-MrGrpNameChanged")==0) { return DC_HEADER_X_MRGRPNAMECHANGED; }
+			break;
+		case 23:
+			if (strcasecmp(name, "Autocrypt-Setup-Message")==0) { return DC_HEADER_AUTOCRYPT_SETUP_MESSAGE; }
+			if (strcasecmp(name, "Chat-Group-Member-Added")==0) { return DC_HEADER_CHAT_GROUP_MEMBER_ADDED; }
+			if (strcasecmp(name, "Chat-Group-Name-Changed")==0) { return DC_HEADER_CHAT_GROUP_NAME_CHANGED; }
+			if (strcasecmp(name, "Secure-Join-Fingerprint")==0) { return DC_HEADER_SECURE_JOIN_FINGERPRINT; }
+			break;
+		case 24:
+			if (strcasecmp(name, "Secure-Join-Invitenumber")==0) { return DC_HEADER_SECURE_JOIN_INVITENUMBER; }
+			break;
+		case 25:
+			if (strcasecmp(name, "Chat-Group-Member-Removed")==0) { return DC_HEADER_CHAT_GROUP_MEMBER_REMOVED; }
+			break;
+		case 32:
+			if (strcasecmp(name, "Chat-Disposition-Notification-To")==0) { return DC_HEADER_CHAT_DISPOSITION_NOTIFICATION_TO; }
+			break;
+	}
+
+	return -1;
+}
+
+
+static void fill_headers(dc_mimeparser_t* mimeparser, const struct mailimf_fields* in)
 {
 	if (NULL==in) {
 		return;
@@ -1405,49 +1679,36 @@ static void hash_header(dc_hash_t* out, const struct mailimf_fields* in, dc_cont
 	for (clistiter* cur1=clist_begin(in->fld_list); cur1!=NULL ; cur1=clist_next(cur1))
 	{
 		struct mailimf_field* field = (struct mailimf_field*)clist_content(cur1);
-		const char *key = NULL;
+		int id = -1;
 		switch (field->fld_type)
 		{
-			case MAILIMF_FIELD_RETURN_PATH: key = "Return-Path"; break;
-			case MAILIMF_FIELD_ORIG_DATE:   key = "Date";        break;
-			case MAILIMF_FIELD_FROM:        key = "From";        break;
-			case MAILIMF_FIELD_SENDER:      key = "Sender";      break;
-			case MAILIMF_FIELD_REPLY_TO:    key = "Reply-To";    break;
-			case MAILIMF_FIELD_TO:          key = "To";          break;
-			case MAILIMF_FIELD_CC:          key = "Cc";          break;
-			case MAILIMF_FIELD_BCC:         key = "Bcc";         break;
-			case MAILIMF_FIELD_MESSAGE_ID:  key = "Message-ID";  break;
-			case MAILIMF_FIELD_IN_REPLY_TO: key = "In-Reply-To"; break;
-			case MAILIMF_FIELD_REFERENCES:  key = "References";  break;
-			case MAILIMF_FIELD_SUBJECT:     key = "Subject";     break;
+			case MAILIMF_FIELD_RETURN_PATH: id = DC_HEADER_RETURN_PATH; break;
+			case MAILIMF_FIELD_ORIG_DATE:   id = DC_HEADER_DATE;        break;
+			case MAILIMF_FIELD_FROM:        id = DC_HEADER_FROM;        break;
+			case MAILIMF_FIELD_SENDER:      id = DC_HEADER_SENDER;      break;
+			case MAILIMF_FIELD_REPLY_TO:    id = DC_HEADER_REPLY_TO;    break;
+			case MAILIMF_FIELD_TO:          id = DC_HEADER_TO;          break;
+			case MAILIMF_FIELD_CC:          id = DC_HEADER_CC;          break;
+			case MAILIMF_FIELD_BCC:         id = DC_HEADER_BCC;         break;
+			case MAILIMF_FIELD_MESSAGE_ID:  id = DC_HEADER_MESSAGE_ID;  break;
+			case MAILIMF_FIELD_IN_REPLY_TO: id = DC_HEADER_IN_REPLY_TO; break;
+			case MAILIMF_FIELD_REFERENCES:  id = DC_HEADER_REFERENCES;  break;
+			case MAILIMF_FIELD_SUBJECT:     id = DC_HEADER_SUBJECT;     break;
 			case MAILIMF_FIELD_OPTIONAL_FIELD:
-				{
-					const struct mailimf_optional_field* optional_field = field->fld_data.fld_optional_field;
-					if (optional_field) {
-						key = optional_field->fld_name;
-					}
+				if (field->fld_data.fld_optional_field) {
+					id = dc_mimeparser_header_id(field->fld_data.fld_optional_field->fld_name);
 				}
 				break;
 		}
 
-		if (key)
+		if (id>=0)
 		{
-			int key_len = strlen(key);
-
-			if (dc_hash_find(out, key, key_len))
+			/* if the header was seen before, do only overwrite known types */
+			if (mimeparser->headers[id]==NULL
+			 || field->fld_type!=MAILIMF_FIELD_OPTIONAL_FIELD
+			 || strncmp(s_header_names[id], "Chat-", 5)==0)
 			{
-				/* key already in hash, do only overwrite known types */
-				if (field->fld_type!=MAILIMF_FIELD_OPTIONAL_FIELD
-				 || (key_len>5 && strncasecmp(key, "Chat-", 5)==0))
-				{
-					//dc_log_info(context, 0, "Protected headers: Overwriting \"%s\".", key);
-					dc_hash_insert(out, key, key_len, field);
-				}
-			}
-			else
-			{
-				/* key not hashed before */
-				dc_hash_insert(out, key, key_len, field);
+				mimeparser->headers[id] = field;
 			}
 		}
 	}
@@ -1499,22 +1760,22 @@ void dc_mimeparser_parse(dc_mimeparser_t* mimeparser, const char* body_not_termi
 	//       may also be handy for extracting binaries from uuencoded text and just add the rest text after the binaries.
 
 	/* setup header */
-	hash_header(&mimeparser->header, mimeparser->header_root, mimeparser->context);
-	hash_header(&mimeparser->header, mimeparser->header_protected, mimeparser->context); /* overwrite the original header with the protected one */
+	fill_headers(mimeparser, mimeparser->header_root);
+	fill_headers(mimeparser, mimeparser->header_protected); /* overwrite the original header with the protected one */
 
 	/* set some basic data */
 	{
-		struct mailimf_field* field = dc_mimeparser_lookup_field(mimeparser, "Subject");
+		struct mailimf_field* field = dc_mimeparser_get_header(mimeparser, DC_HEADER_SUBJECT);
 		if (field && field->fld_type==MAILIMF_FIELD_SUBJECT) {
-			mimeparser->subject = dc_decode_header_words(field->fld_data.fld_subject->sbj_value);
+			mimeparser->subject = dc_arena_adopt(mimeparser->arena, dc_decode_header_words(field->fld_data.fld_subject->sbj_value));
 		}
 	}
 
-	if (dc_mimeparser_lookup_optional_field2(mimeparser, "Chat-Version", "X-MrMsg")) {
+	if (dc_mimeparser_get_optional_header2(mimeparser, DC_HEADER_CHAT_VERSION, DC_HEADER_X_MRMSG)) {
 		mimeparser->is_send_by_messenger = 1;
 	}
 
-	if (dc_mimeparser_lookup_field(mimeparser, "Autocrypt-Setup-Message")) {
+	if (dc_mimeparser_get_header(mimeparser, DC_HEADER_AUTOCRYPT_SETUP_MESSAGE)) {
 		/* Autocrypt-Setup-Message header found - check if there is an application/autocrypt-setup part */
 		int i, has_setup_file = 0;
 		for (i = 0; i < carray_count(mimeparser->parts); i++) {
@@ -1567,9 +1828,7 @@ void dc_mimeparser_parse(dc_mimeparser_t* mimeparser, const char* body_not_termi
 					dc_mimepart_t* part = (dc_mimepart_t*)carray_get(mimeparser->parts, i);
 					if (part->type==DC_MSG_TEXT) {
 						#define DC_NDASH "\xE2\x80\x93"
-						char* new_txt = dc_mprintf("%s " DC_NDASH " %s", subj, part->msg);
-						free(part->msg);
-						part->msg = new_txt;
+						part->msg = dc_arena_mprintf(mimeparser->arena, "%s " DC_NDASH " %s", subj, part->msg);
 						break;
 					}
 				}
@@ -1593,9 +1852,8 @@ void dc_mimeparser_parse(dc_mimeparser_t* mimeparser, const char* body_not_termi
 		and read some additional parameters */
 		dc_mimepart_t* part = (dc_mimepart_t*)carray_get(mimeparser->parts, 0);
 		if (part->type==DC_MSG_AUDIO) {
-			if (dc_mimeparser_lookup_optional_field2(mimeparser, "Chat-Voice-Message", "X-MrVoiceMessage")) {
-				free(part->msg);
-				part->msg = strdup("ogg"); /* DC_MSG_AUDIO adds sets the whole filename which is useless. however, the extension is useful. */
+			if (dc_mimeparser_get_optional_header2(mimeparser, DC_HEADER_CHAT_VOICE_MESSAGE, DC_HEADER_X_MRVOICEMESSAGE)) {
+				part->msg = dc_arena_strndup(mimeparser->arena, "ogg", 3); /* DC_MSG_AUDIO adds sets the whole filename which is useless. however, the extension is useful. */
 				part->type = DC_MSG_VOICE;
 				dc_param_set(part->param, DC_PARAM_AUTHORNAME, NULL); /* remove unneeded information */
 				dc_param_set(part->param, DC_PARAM_TRACKNAME, NULL);
@@ -1603,7 +1861,7 @@ void dc_mimeparser_parse(dc_mimeparser_t* mimeparser, const char* body_not_termi
 		}
 
 		if (part->type==DC_MSG_AUDIO || part->type==DC_MSG_VOICE || part->type==DC_MSG_VIDEO) {
-			const struct mailimf_optional_field* field = dc_mimeparser_lookup_optional_field2(mimeparser, "Chat-Duration", "X-MrDurationMs");
+			const struct mailimf_optional_field* field = dc_mimeparser_get_optional_header2(mimeparser, DC_HEADER_CHAT_DURATION, DC_HEADER_X_MRDURATIONMS);
 			if (field) {
 				int duration_ms = atoi(field->fld_value);
 				if (duration_ms > 0 && duration_ms < 24*60*60*1000) {
@@ -1614,7 +1872,7 @@ void dc_mimeparser_parse(dc_mimeparser_t* mimeparser, const char* body_not_termi
 	}
 
 	/* some special system message? */
-	if (dc_mimeparser_lookup_field(mimeparser, "Chat-Group-Image")
+	if (dc_mimeparser_get_header(mimeparser, DC_HEADER_CHAT_GROUP_IMAGE)
 	 && carray_count(mimeparser->parts)>=1) {
 		dc_mimepart_t* textpart = (dc_mimepart_t*)carray_get(mimeparser->parts, 0);
 		if (textpart->type==DC_MSG_TEXT) {
@@ -1631,7 +1889,7 @@ void dc_mimeparser_parse(dc_mimeparser_t* mimeparser, const char* body_not_termi
 	/* check, if the message asks for a MDN */
 	if (!mimeparser->decrypting_failed)
 	{
-		const struct mailimf_optional_field* dn_field = dc_mimeparser_lookup_optional_field(mimeparser, "Chat-Disposition-Notification-To"); /* we use "Chat-Disposition-Notification-To" as replies to "Disposition-Notification-To" are weired in many cases, are just freetext and/or do not follow any standard. */
+		const struct mailimf_optional_field* dn_field = dc_mimeparser_get_optional_header(mimeparser, DC_HEADER_CHAT_DISPOSITION_NOTIFICATION_TO); /* we use "Chat-Disposition-Notification-To" as replies to "Disposition-Notification-To" are weired in many cases, are just freetext and/or do not follow any standard. */
 		if (dn_field && dc_mimeparser_get_last_nonmeta(mimeparser)/*just check if the mail is not empty*/)
 		{
 			struct mailimf_mailbox_list* mb_list = NULL;
@@ -1641,7 +1899,7 @@ void dc_mimeparser_parse(dc_mimeparser_t* mimeparser, const char* body_not_termi
 				char* dn_to_addr = mailimf_find_first_addr(mb_list);
 				if (dn_to_addr)
 				{
-					struct mailimf_field* from_field = dc_mimeparser_lookup_field(mimeparser, "From"); /* we need From: as this MUST match Disposition-Notification-To: */
+					struct mailimf_field* from_field = dc_mimeparser_get_header(mimeparser, DC_HEADER_FROM); /* we need From: as this MUST match Disposition-Notification-To: */
 					if (from_field && from_field->fld_type==MAILIMF_FIELD_FROM && from_field->fld_data.fld_from)
 					{
 						char* from_addr = mailimf_find_first_addr(from_field->fld_data.fld_from->frm_mb_list);
@@ -1670,9 +1928,9 @@ void dc_mimeparser_parse(dc_mimeparser_t* mimeparser, const char* body_not_termi
 	/* Cleanup - and try to create at least an empty part if there are no parts yet */
 cleanup:
 	if (!dc_mimeparser_has_nonmeta(mimeparser) && carray_count(mimeparser->reports)==0) {
-		dc_mimepart_t* part = dc_mimepart_new();
+		dc_mimepart_t* part = dc_mimepart_new(mimeparser);
 		part->type = DC_MSG_TEXT;
-		part->msg = dc_strdup(mimeparser->subject? mimeparser->subject : "Empty message");
+		part->msg = mimeparser->subject? mimeparser->subject : dc_arena_strndup(mimeparser->arena, "Empty message", 13);
 		carray_add(mimeparser->parts, (void*)part, NULL);
 	}
 }
@@ -1682,6 +1940,7 @@ cleanup:
  * Lookup the given field name.
  *
  * Typical names are `From`, `To`, `Subject` and so on.
+ * For the headers used by the core, dc_mimeparser_get_header() is faster.
  *
  * @private @memberof dc_mimeparser_t
  * @param mimparser The MIME-parser object.
@@ -1692,7 +1951,83 @@ cleanup:
  */
 struct mailimf_field* dc_mimeparser_lookup_field(dc_mimeparser_t* mimeparser, const char* field_name)
 {
-	return (struct mailimf_field*)dc_hash_find_str(&mimeparser->header, field_name);
+	struct mailimf_field* found = NULL;
+	int                   id = dc_mimeparser_header_id(field_name);
+	int                   i = 0;
+
+	if (id>=0) {
+		return mimeparser->headers[id];
+	}
+
+	/* headers not used by the core are not sorted in, search them using the same rules as fill_headers() */
+	for (i = 0; i < 2; i++) {
+		const struct mailimf_fields* in = i==0? mimeparser->header_root : mimeparser->header_protected;
+		if (in) {
+			for (clistiter* cur1=clist_begin(in->fld_list); cur1!=NULL ; cur1=clist_next(cur1)) {
+				struct mailimf_field* field = (struct mailimf_field*)clist_content(cur1);
+				if (field->fld_type==MAILIMF_FIELD_OPTIONAL_FIELD && field->fld_data.fld_optional_field
+				 && field->fld_data.fld_optional_field->fld_name
+				 && strcasecmp(field->fld_data.fld_optional_field->fld_name, field_name)==0
+				 && (found==NULL || strncasecmp(field_name, "Chat-", 5)==0)) {
+					found = field;
+				}
+			}
+		}
+	}
+
+	return found;
+}
+
+
+/**
+ * Get a header by its id.
+ *
+ * This is the fast version of dc_mimeparser_lookup_field() for the headers used by the core.
+ *
+ * @private @memberof dc_mimeparser_t
+ *
+ * @param mimparser The MIME-parser object.
+ * @param header_id One of the DC_HEADER_* constants.
+ *
+ * @return A pointer to a mailimf_field structure. Must not be freed!
+ *     Before accessing the mailimf_field::fld_data, please always have a look at mailimf_field::fld_type!
+ *     If the header is not present, NULL is returned.
+ */
+struct mailimf_field* dc_mimeparser_get_header(dc_mimeparser_t* mimeparser, int header_id)
+{
+	if (header_id<0 || header_id>=DC_HEADER_CNT) {
+		return NULL;
+	}
+	return mimeparser->headers[header_id];
+}
+
+
+/**
+ * Get an optional header by its id.
+ *
+ * In addition to dc_mimeparser_get_header(), this function also checks the mailimf_field::fld_type
+ * for being MAILIMF_FIELD_OPTIONAL_FIELD.
+ *
+ * @private @memberof dc_mimeparser_t
+ */
+struct mailimf_optional_field* dc_mimeparser_get_optional_header(dc_mimeparser_t* mimeparser, int header_id)
+{
+	struct mailimf_field* field = dc_mimeparser_get_header(mimeparser, header_id);
+	if (field && field->fld_type==MAILIMF_FIELD_OPTIONAL_FIELD) {
+		return field->fld_data.fld_optional_field;
+	}
+	return NULL;
+}
+
+
+/*
+ * Get the first header and return, if found.
+ * If not, try to get the second header.
+ */
+struct mailimf_optional_field* dc_mimeparser_get_optional_header2(dc_mimeparser_t* mimeparser, int header_id, int or_header_id)
+{
+	struct mailimf_optional_field* of = dc_mimeparser_get_optional_header(mimeparser, header_id);
+	return of? of : dc_mimeparser_get_optional_header(mimeparser, or_header_id);
 }
 
 
@@ -1712,7 +2047,7 @@ struct mailimf_field* dc_mimeparser_lookup_field(dc_mimeparser_t* mimeparser, co
  */
 struct mailimf_optional_field* dc_mimeparser_lookup_optional_field(dc_mimeparser_t* mimeparser, const char* field_name)
 {
-	struct mailimf_field* field = dc_hash_find_str(&mimeparser->header, field_name);
+	struct mailimf_field* field = dc_mimeparser_lookup_field(mimeparser, field_name);
 	if (field && field->fld_type==MAILIMF_FIELD_OPTIONAL_FIELD) {
 		return field->fld_data.fld_optional_field;
 	}
@@ -1813,11 +2148,11 @@ int dc_mimeparser_is_mailinglist_message(dc_mimeparser_t* mimeparser)
 		return 0;
 	}
 
-	if (dc_mimeparser_lookup_field(mimeparser, "List-Id")!=NULL) {
+	if (dc_mimeparser_get_header(mimeparser, DC_HEADER_LIST_ID)!=NULL) {
 		return 1; /* mailing list identified by the presence of `List-ID` from RFC 2919 */
 	}
 
-	struct mailimf_optional_field* precedence = dc_mimeparser_lookup_optional_field(mimeparser, "Precedence");
+	struct mailimf_optional_field* precedence = dc_mimeparser_get_optional_header(mimeparser, DC_HEADER_PRECEDENCE);
 	if (precedence!=NULL) {
 		if (strcasecmp(precedence->fld_value, "list")==0
 		 || strcasecmp(precedence->fld_value, "bulk")==0) {
@@ -37,6 +37,7 @@ extern "C" {
 
 
 typedef struct dc_e2ee_helper_t dc_e2ee_helper_t;
+typedef struct dc_arena_t dc_arena_t;
 
 
 typedef struct dc_mimepart_t
@@ -45,14 +46,61 @@ typedef struct dc_mimepart_t
 	int                 type; /*one of DC_MSG_* */
 	int                 is_meta; /*meta parts contain eg. profile or group images and are only present if there is at least one "normal" part*/
 	int                 int_mimetype;
-	char*               msg;
-	char*               msg_raw;
+	char*               msg;           /* allocated from the parser's arena, must not be free()'d */
+	const char*         msg_raw;       /* not null-terminated; points into the parsed message or into one of the parser's decoding buffers, must not be free()'d */
+	size_t              msg_raw_bytes;
 	int                 bytes;
 	dc_param_t*          param;
 
 } dc_mimepart_t;
 
 
+/* The headers used by the core are interned to these ids by dc_mimeparser_header_id();
+dc_mimeparser_parse() sorts them into dc_mimeparser_t::headers in one pass over the header fields. */
+#define DC_HEADER_RETURN_PATH                       0
+#define DC_HEADER_DATE                              1
+#define DC_HEADER_FROM                              2
+#define DC_HEADER_SENDER                            3
+#define DC_HEADER_REPLY_TO                          4
+#define DC_HEADER_TO                                5
+#define DC_HEADER_CC                                6
+#define DC_HEADER_BCC                               7
+#define DC_HEADER_MESSAGE_ID                        8
+#define DC_HEADER_IN_REPLY_TO                       9
+#define DC_HEADER_REFERENCES                        10
+#define DC_HEADER_SUBJECT                           11
+#define DC_HEADER_CHAT_VERSION                      12
+#define DC_HEADER_X_MRMSG                           13
+#define DC_HEADER_AUTOCRYPT_SETUP_MESSAGE           14
+#define DC_HEADER_CHAT_VOICE_MESSAGE                15
+#define DC_HEADER_X_MRVOICEMESSAGE                  16
+#define DC_HEADER_CHAT_DURATION                     17
+#define DC_HEADER_X_MRDURATIONMS                    18
+#define DC_HEADER_CHAT_GROUP_IMAGE                  19
+#define DC_HEADER_CHAT_DISPOSITION_NOTIFICATION_TO  20
+#define DC_HEADER_LIST_ID                           21
+#define DC_HEADER_PRECEDENCE                        22
+#define DC_HEADER_CHAT_PREDECESSOR                  23
+#define DC_HEADER_X_MRPREDECESSOR                   24
+#define DC_HEADER_CHAT_GROUP_ID                     25
+#define DC_HEADER_X_MRGRPID                         26
+#define DC_HEADER_CHAT_GROUP_NAME                   27
+#define DC_HEADER_X_MRGRPNAME                       28
+#define DC_HEADER_CHAT_GROUP_MEMBER_REMOVED         29
+#define DC_HEADER_X_MRREMOVEFROMGRP                 30
+#define DC_HEADER_CHAT_GROUP_MEMBER_ADDED           31
+#define DC_HEADER_X_MRADDTOGRP                      32
+#define DC_HEADER_CHAT_GROUP_NAME_CHANGED           33
+#define DC_HEADER_X_MRGRPNAMECHANGED                34
+#define DC_HEADER_CHAT_VERIFIED                     35
+#define DC_HEADER_SECURE_JOIN                       36
+#define DC_HEADER_SECURE_JOIN_INVITENUMBER          37
+#define DC_HEADER_SECURE_JOIN_FINGERPRINT           38
+#define DC_HEADER_SECURE_JOIN_AUTH                  39
+#define DC_HEADER_SECURE_JOIN_GROUP                 40
+#define DC_HEADER_CNT                               41
+
+
 typedef struct dc_mimeparser_t
 {
 	/** @privatesection */
@@ -61,11 +109,11 @@ typedef struct dc_mimeparser_t
 	carray*                parts;             /* array of dc_mimepart_t objects */
 	struct mailmime*       mimeroot;
 
-	dc_hash_t              header;            /* memoryhole-compliant header */
-	struct mailimf_fields* header_root;       /* must NOT be freed, do not use for query, merged into header, a pointer somewhere to the MIME data*/
-	struct mailimf_fields* header_protected;  /* MUST be freed, do not use for query, merged into header  */
+	struct mailimf_field*  headers[DC_HEADER_CNT]; /* memoryhole-compliant header, indexed by DC_HEADER_*, use dc_mimeparser_get_header() */
+	struct mailimf_fields* header_root;       /* must NOT be freed, do not use for query, merged into headers, a pointer somewhere to the MIME data*/
+	struct mailimf_fields* header_protected;  /* MUST be freed, do not use for query, merged into headers  */
 
-	char*                  subject;
+	char*                  subject;           /* allocated from the arena, must not be free()'d */
 	int                    is_send_by_messenger;
 
 	int                    decrypting_failed; /* set, if there are multipart/encrypted parts left after decryption */
@@ -80,6 +128,12 @@ typedef struct dc_mimeparser_t
 
 	carray*                reports;           /* array of mailmime objects */
 
+	/* decoded data referenced by dc_mimepart_t::msg_raw; the raw message itself must be kept valid by the caller as long as the parser is used */
+	carray*                transfer_decoding_buffers; /* mmap_string_unref()'d */
+	carray*                charset_buffers;           /* charconv_buffer_free()'d */
+
+	dc_arena_t*            arena;             /* memory for the parts and other per-message data, reset by dc_mimeparser_empty() */
+
 	int                    is_system_message;
 
 } dc_mimeparser_t;
@@ -88,11 +142,18 @@ typedef struct dc_mimeparser_t
 dc_mimeparser_t*  dc_mimeparser_new                    (const char* blobdir, dc_context_t*);
 void             dc_mimeparser_unref                  (dc_mimeparser_t*);
 void             dc_mimeparser_empty                  (dc_mimeparser_t*);
+dc_mimeparser_t*  dc_mimeparser_new_pooled             (dc_context_t*);
+void             dc_mimeparser_release                (dc_mimeparser_t*);
+void             dc_mimeparser_free_pool              (dc_context_t*);
 
 void             dc_mimeparser_parse                  (dc_mimeparser_t*, const char* body_not_terminated, size_t body_bytes);
 
 
 /* the following functions can be used only after a call to dc_mimeparser_parse() */
+int                            dc_mimeparser_header_id              (const char* field_name);
+struct mailimf_field*          dc_mimeparser_get_header             (dc_mimeparser_t*, int header_id);
+struct mailimf_optional_field* dc_mimeparser_get_optional_header    (dc_mimeparser_t*, int header_id);
+struct mailimf_optional_field* dc_mimeparser_get_optional_header2   (dc_mimeparser_t*, int header_id, int or_header_id);
 struct mailimf_field*          dc_mimeparser_lookup_field           (dc_mimeparser_t*, const char* field_name);
 struct mailimf_optional_field* dc_mimeparser_lookup_optional_field  (dc_mimeparser_t*, const char* field_name);
 struct mailimf_optional_field* dc_mimeparser_lookup_optional_field2 (dc_mimeparser_t*, const char* field_name, const char* or_field_name);
@@ -92,6 +92,9 @@ void dc_msg_empty(dc_msg_t* msg)
 	free(msg->text);
 	msg->text = NULL;
 
+	free(msg->summarytext);
+	msg->summarytext = NULL;
+
 	free(msg->rfc724_mid);
 	msg->rfc724_mid = NULL;
 
@@ -631,6 +634,11 @@ char* dc_msg_get_summarytext(const dc_msg_t* msg, int approx_characters)
 		return dc_strdup(NULL);
 	}
 
+	/* text summaries are stored on insert; media summaries depend on the current language and are always built here */
+	if (approx_characters==DC_SUMMARY_CHARACTERS && msg->summarytext && !DC_MSG_NEEDS_ATTACHMENT(msg->type)) {
+		return dc_strdup(msg->summarytext);
+	}
+
 	return dc_msg_get_summarytext_by_raw(msg->type, msg->text, msg->param, approx_characters, msg->context);
 }
 
@@ -809,7 +817,7 @@ cleanup:
 
 #define DC_MSG_FIELDS " m.id,rfc724_mid,m.server_folder,m.server_uid,m.chat_id, " \
                       " m.from_id,m.to_id,m.timestamp,m.timestamp_sent,m.timestamp_rcvd, m.type,m.state,m.msgrmsg,m.txt, " \
-                      " m.param,m.starred,m.hidden,c.blocked "
+                      " m.param,m.starred,m.hidden,c.blocked,m.txt_summary "
 
 
 static int dc_msg_set_from_stmt(dc_msg_t* msg, sqlite3_stmt* row, int row_offset) /* field order must be DC_MSG_FIELDS */
@@ -837,6 +845,7 @@ static int dc_msg_set_from_stmt(dc_msg_t* msg, sqlite3_stmt* row, int row_offset
 	msg->starred      =                     sqlite3_column_int  (row, row_offset++);
 	msg->hidden       =                     sqlite3_column_int  (row, row_offset++);
 	msg->chat_blocked =                     sqlite3_column_int  (row, row_offset++);
+	msg->summarytext  = dc_strdup_keep_null((char*)sqlite3_column_text (row, row_offset++));
 
 	if (msg->chat_blocked==2) {
 		dc_truncate_n_unwrap_str(msg->text, 256 /* 256 characters is about a half screen on a 5" smartphone display */,
@@ -848,12 +857,45 @@ static int dc_msg_set_from_stmt(dc_msg_t* msg, sqlite3_stmt* row, int row_offset
 
 
 /**
- * Library-internal.
- * Calling this function is not thread-safe, locking is up to the caller.
+ * Copy all fields of a message object to another message object.
  *
  * @private @memberof dc_msg_t
+ * @param dst The message object to overwrite.
+ * @param src The message object to copy.
+ * @return None.
  */
-int dc_msg_load_from_db(dc_msg_t* msg, dc_context_t* context, uint32_t id)
+void dc_msg_set_from_msg(dc_msg_t* dst, const dc_msg_t* src)
+{
+	if (dst==NULL || dst->magic!=DC_MSG_MAGIC || src==NULL || src->magic!=DC_MSG_MAGIC) {
+		return;
+	}
+
+	dc_msg_empty(dst);
+
+	dst->id             = src->id;
+	dst->rfc724_mid     = dc_strdup_keep_null(src->rfc724_mid);
+	dst->server_folder  = dc_strdup_keep_null(src->server_folder);
+	dst->server_uid     = src->server_uid;
+	dst->chat_id        = src->chat_id;
+	dst->from_id        = src->from_id;
+	dst->to_id          = src->to_id;
+	dst->timestamp      = src->timestamp;
+	dst->timestamp_sent = src->timestamp_sent;
+	dst->timestamp_rcvd = src->timestamp_rcvd;
+	dst->type           = src->type;
+	dst->state          = src->state;
+	dst->is_msgrmsg     = src->is_msgrmsg;
+	dst->text           = dc_strdup_keep_null(src->text);
+	dst->summarytext    = dc_strdup_keep_null(src->summarytext);
+	dc_param_set_packed(dst->param, src->param->packed);
+	dst->starred        = src->starred;
+	dst->hidden         = src->hidden;
+	dst->chat_blocked   = src->chat_blocked;
+	dst->context        = src->context;
+}
+
+
+static int load_from_db(dc_msg_t* msg, dc_context_t* context, uint32_t id, int committed_only)
 {
 	int           success = 0;
 	sqlite3_stmt* stmt = NULL;
@@ -862,10 +904,9 @@ int dc_msg_load_from_db(dc_msg_t* msg, dc_context_t* context, uint32_t id)
 		goto cleanup;
 	}
 
-	stmt = dc_sqlite3_prepare(context->sql,
-		"SELECT " DC_MSG_FIELDS
-		" FROM msgs m LEFT JOIN chats c ON c.id=m.chat_id"
-		" WHERE m.id=?;");
+	#define LOAD_MSG_SQL "SELECT " DC_MSG_FIELDS " FROM msgs m LEFT JOIN chats c ON c.id=m.chat_id WHERE m.id=?;"
+	stmt = committed_only? dc_sqlite3_prepare_read(context->sql, LOAD_MSG_SQL)
+	                     : dc_sqlite3_prepare(context->sql, LOAD_MSG_SQL);
 	sqlite3_bind_int(stmt, 1, id);
 
 	if (sqlite3_step(stmt)!=SQLITE_ROW) {
@@ -886,6 +927,18 @@ cleanup:
 }
 
 
+/**
+ * Library-internal.
+ * Calling this function is not thread-safe, locking is up to the caller.
+ *
+ * @private @memberof dc_msg_t
+ */
+int dc_msg_load_from_db(dc_msg_t* msg, dc_context_t* context, uint32_t id)
+{
+	return load_from_db(msg, context, id, 0);
+}
+
+
 /**
  * Guess message type from suffix.
  *
@@ -1030,6 +1083,111 @@ char* dc_msg_get_summarytext_by_raw(int type, const char* text, dc_param_t* para
 }
 
 
+/**
+ * Get the summary text to store in `msgs.txt_summary` on insert.
+ * The result equals dc_msg_get_summarytext_by_raw() for DC_SUMMARY_CHARACTERS
+ * for all types not needing an attachment; for the other types, the summary
+ * depends on the current language and an empty string is returned.
+ *
+ * @private @memberof dc_msg_t
+ * @param type The type of the message, one of the DC_MSG_* constants.
+ * @param text The text of the message, may be NULL.
+ * @return The summary to store, the returned string must be free()'d. Never NULL.
+ */
+char* dc_msg_get_summarytext_to_store(int type, const char* text)
+{
+	char* ret = NULL;
+
+	if (DC_MSG_NEEDS_ATTACHMENT(type) || text==NULL) {
+		return dc_strdup(NULL);
+	}
+
+	ret = dc_strdup(text);
+	dc_truncate_n_unwrap_str(ret, DC_SUMMARY_CHARACTERS, 1/*unwrap*/);
+	return ret;
+}
+
+
+/**
+ * Compute missing summaries of messages inserted before `msgs.txt_summary`
+ * was added.  The rows are processed from the newest to the oldest so that
+ * the chatlist benefits first; the position is kept in the config-key
+ * `summary_backfill_id`, which is set to 0 when done.
+ *
+ * @private @memberof dc_msg_t
+ * @param context The context object.
+ * @param max_cnt Maximum number of messages to update in this call.
+ * @return Number of updated messages.
+ */
+int dc_msg_backfill_summaries(dc_context_t* context, int max_cnt)
+{
+	int           updated_cnt = 0;
+	int           transaction_pending = 0;
+	uint32_t      backfill_id = 0;
+	uint32_t      msg_id = 0;
+	char*         summary = NULL;
+	sqlite3_stmt* select_stmt = NULL;
+	sqlite3_stmt* update_stmt = NULL;
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC || max_cnt<=0) {
+		goto cleanup;
+	}
+
+	backfill_id = (uint32_t)dc_sqlite3_get_config_int(context->sql, "summary_backfill_id", 0);
+	if (backfill_id <= DC_MSG_ID_LAST_SPECIAL+1) {
+		goto cleanup; /* done or nothing to do */
+	}
+
+	dc_sqlite3_begin_transaction(context->sql);
+	transaction_pending = 1;
+
+		select_stmt = dc_sqlite3_prepare(context->sql,
+			"SELECT id, type, txt FROM msgs"
+			" WHERE id<? AND id>" DC_STRINGIFY(DC_MSG_ID_LAST_SPECIAL) " AND txt_summary IS NULL"
+			" ORDER BY id DESC LIMIT ?;");
+		sqlite3_bind_int(select_stmt, 1, backfill_id);
+		sqlite3_bind_int(select_stmt, 2, max_cnt);
+
+		update_stmt = dc_sqlite3_prepare(context->sql,
+			"UPDATE msgs SET txt_summary=? WHERE id=?;");
+
+		while (sqlite3_step(select_stmt)==SQLITE_ROW)
+		{
+			msg_id  = sqlite3_column_int(select_stmt, 0);
+			summary = dc_msg_get_summarytext_to_store(sqlite3_column_int(select_stmt, 1),
+				(const char*)sqlite3_column_text(select_stmt, 2));
+
+			sqlite3_reset(update_stmt);
+			sqlite3_bind_text(update_stmt, 1, summary, -1, SQLITE_STATIC);
+			sqlite3_bind_int (update_stmt, 2, msg_id);
+			if (sqlite3_step(update_stmt)!=SQLITE_DONE) {
+				goto cleanup;
+			}
+
+			dc_msgcache_invalidate(context->msgcache, msg_id);
+
+			free(summary);
+			summary = NULL;
+			backfill_id = msg_id;
+			updated_cnt++;
+		}
+
+		dc_sqlite3_set_config_int(context->sql, "summary_backfill_id", updated_cnt<max_cnt? 0 : backfill_id);
+
+	dc_sqlite3_commit(context->sql);
+	transaction_pending = 0;
+
+	dc_log_info(context, 0, "%i message summaries backfilled.", updated_cnt);
+
+cleanup:
+	if (transaction_pending) { dc_sqlite3_rollback(context->sql); updated_cnt = 0; }
+	sqlite3_finalize(select_stmt);
+	sqlite3_finalize(update_stmt);
+	free(summary);
+	return updated_cnt;
+}
+
+
 /**
  * Check if a message is still in creation.  The user can mark files as being
  * in creation by simply creating a file `<filename>.increation`. If
@@ -1082,6 +1240,9 @@ void dc_msg_save_param_to_disk(dc_msg_t* msg)
 	sqlite3_bind_int (stmt, 2, msg->id);
 	sqlite3_step(stmt);
 	sqlite3_finalize(stmt);
+
+	dc_msgcache_invalidate(msg->context->msgcache, msg->id);
+	dc_changelog_add(msg->context->changelog, DC_CHANGE_MSG_UPDATED, msg->id);
 }
 
 
@@ -1144,6 +1305,8 @@ void dc_update_msg_chat_id(dc_context_t* context, uint32_t msg_id, uint32_t chat
 	sqlite3_bind_int(stmt, 2, msg_id);
 	sqlite3_step(stmt);
 	sqlite3_finalize(stmt);
+
+	dc_msgcache_invalidate(context->msgcache, msg_id);
 }
 
 
@@ -1155,6 +1318,39 @@ void dc_update_msg_state(dc_context_t* context, uint32_t msg_id, int state)
 	sqlite3_bind_int(stmt, 2, msg_id);
 	sqlite3_step(stmt);
 	sqlite3_finalize(stmt);
+
+	dc_msgcache_invalidate(context->msgcache, msg_id);
+	dc_changelog_add(context->changelog, DC_CHANGE_MSG_UPDATED, msg_id);
+}
+
+
+/* mark an outgoing message as not sendable; the error is shown by dc_get_msg_info() */
+void dc_set_msg_failed(dc_context_t* context, uint32_t msg_id, const char* error)
+{
+	dc_msg_t* msg = dc_msg_new();
+
+	if (!dc_msg_load_from_db(msg, context, msg_id)) {
+		goto cleanup;
+	}
+
+	if (DC_STATE_OUT_PENDING==msg->state || DC_STATE_OUT_DELIVERED==msg->state) {
+		msg->state = DC_STATE_OUT_ERROR;
+	}
+
+	if (error) {
+		dc_param_set(msg->param, DC_PARAM_ERROR, error);
+		dc_log_error(context, 0, "%s", error);
+	}
+
+	dc_sqlite3_begin_transaction(context->sql);
+		dc_update_msg_state(context, msg_id, msg->state);
+		dc_msg_save_param_to_disk(msg);
+	dc_sqlite3_commit(context->sql);
+
+	context->cb(context, DC_EVENT_MSG_FAILED, msg->chat_id, msg_id);
+
+cleanup:
+	dc_msg_unref(msg);
 }
 
 
@@ -1268,6 +1464,151 @@ void dc_update_server_uid(dc_context_t* context, const char* rfc724_mid, const c
 	sqlite3_bind_text(stmt, 3, rfc724_mid, -1, SQLITE_STATIC);
 	sqlite3_step(stmt);
 	sqlite3_finalize(stmt);
+
+	/* keep the index of message locations up to date; the UIDVALIDITY is only kept if the folder has not changed */
+	stmt = dc_sqlite3_prepare(context->sql,
+		"INSERT OR REPLACE INTO imap_index (rfc724_mid, folder, uidvalidity, uid) "
+		" VALUES (?, ?, COALESCE((SELECT uidvalidity FROM imap_index WHERE rfc724_mid=? AND folder=?), 0), ?);");
+	sqlite3_bind_text(stmt, 1, rfc724_mid, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, server_folder, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 3, rfc724_mid, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 4, server_folder, -1, SQLITE_STATIC);
+	sqlite3_bind_int (stmt, 5, server_uid);
+	sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
+
+	dc_msgcache_invalidate_rfc724_mid(context->msgcache, rfc724_mid);
+}
+
+
+/**
+ * Look up the location of a message on the server by its Message-ID.
+ * The index is filled by dc_set_imap_location() while fetching
+ * and by dc_update_server_uid(); it may contain messages not in the msgs-table
+ * and may be outdated, so the caller should verify the location.
+ *
+ * @private @memberof dc_context_t
+ * @param context The context object.
+ * @param rfc724_mid The Message-ID to look up.
+ * @param[out] ret_folder The folder; must be free()'d. Set to NULL if the message is not in the index.
+ * @param[out] ret_uidvalidity The UIDVALIDITY of the folder, 0 if unknown.
+ * @param[out] ret_uid The UID in the folder.
+ * @return 1=location found, 0=not in the index.
+ */
+int dc_get_imap_location(dc_context_t* context, const char* rfc724_mid, char** ret_folder, uint32_t* ret_uidvalidity, uint32_t* ret_uid)
+{
+	int           found = 0;
+	sqlite3_stmt* stmt = NULL;
+
+	*ret_folder = NULL;
+	*ret_uidvalidity = 0;
+	*ret_uid = 0;
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC || rfc724_mid==NULL) {
+		goto cleanup;
+	}
+
+	stmt = dc_sqlite3_prepare(context->sql,
+		"SELECT folder, uidvalidity, uid FROM imap_index WHERE rfc724_mid=?;");
+	sqlite3_bind_text(stmt, 1, rfc724_mid, -1, SQLITE_STATIC);
+	if (sqlite3_step(stmt)==SQLITE_ROW) {
+		*ret_folder      = dc_strdup((const char*)sqlite3_column_text(stmt, 0));
+		*ret_uidvalidity = (uint32_t)sqlite3_column_int64(stmt, 1);
+		*ret_uid         = (uint32_t)sqlite3_column_int64(stmt, 2);
+		found = (*ret_folder)[0] && *ret_uid;
+	}
+
+cleanup:
+	sqlite3_finalize(stmt);
+	return found;
+}
+
+
+/**
+ * Add or update the location of a message in the index of message locations,
+ * see dc_get_imap_location().
+ *
+ * @private @memberof dc_context_t
+ * @param context The context object.
+ * @param rfc724_mid The Message-ID.
+ * @param folder The folder the message is in; NULL removes the message from the index.
+ * @param uidvalidity The UIDVALIDITY of the folder, 0 if unknown.
+ * @param uid The UID in the folder.
+ * @return None.
+ */
+void dc_set_imap_location(dc_context_t* context, const char* rfc724_mid, const char* folder, uint32_t uidvalidity, uint32_t uid)
+{
+	sqlite3_stmt* stmt = NULL;
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC || rfc724_mid==NULL) {
+		return;
+	}
+
+	if (folder) {
+		stmt = dc_sqlite3_prepare(context->sql,
+			"INSERT OR REPLACE INTO imap_index (rfc724_mid, folder, uidvalidity, uid) VALUES (?, ?, ?, ?);");
+		sqlite3_bind_text (stmt, 1, rfc724_mid, -1, SQLITE_STATIC);
+		sqlite3_bind_text (stmt, 2, folder, -1, SQLITE_STATIC);
+		sqlite3_bind_int64(stmt, 3, uidvalidity);
+		sqlite3_bind_int64(stmt, 4, uid);
+	}
+	else {
+		stmt = dc_sqlite3_prepare(context->sql,
+			"DELETE FROM imap_index WHERE rfc724_mid=?;");
+		sqlite3_bind_text(stmt, 1, rfc724_mid, -1, SQLITE_STATIC);
+	}
+	sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
+}
+
+
+/**
+ * Add the locations of several messages of a folder to the index of message
+ * locations in one transaction, see dc_set_imap_location().
+ *
+ * @private @memberof dc_context_t
+ * @param context The context object.
+ * @param folder The folder the messages are in.
+ * @param uidvalidity The UIDVALIDITY of the folder.
+ * @param replace 1=remove all other locations in the folder, eg. messages
+ *     deleted or moved by other MUAs; the messages must be all messages of the folder then.
+ * @param rfc724_mids The Message-IDs.
+ * @param uids The UIDs, in the same order as rfc724_mids.
+ * @param cnt The number of messages.
+ * @return None.
+ */
+void dc_set_imap_locations(dc_context_t* context, const char* folder, uint32_t uidvalidity, int replace, char** rfc724_mids, const uint32_t* uids, int cnt)
+{
+	sqlite3_stmt* stmt = NULL;
+	int           i = 0;
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC || folder==NULL || (cnt>0 && (rfc724_mids==NULL || uids==NULL))) {
+		return;
+	}
+
+	dc_sqlite3_begin_transaction(context->sql);
+
+		if (replace) {
+			stmt = dc_sqlite3_prepare(context->sql,
+				"DELETE FROM imap_index WHERE folder=?;");
+			sqlite3_bind_text(stmt, 1, folder, -1, SQLITE_STATIC);
+			sqlite3_step(stmt);
+			sqlite3_finalize(stmt);
+		}
+
+		stmt = dc_sqlite3_prepare(context->sql,
+			"INSERT OR REPLACE INTO imap_index (rfc724_mid, folder, uidvalidity, uid) VALUES (?, ?, ?, ?);");
+		for (i = 0; i < cnt; i++) {
+			sqlite3_reset(stmt);
+			sqlite3_bind_text (stmt, 1, rfc724_mids[i], -1, SQLITE_STATIC);
+			sqlite3_bind_text (stmt, 2, folder, -1, SQLITE_STATIC);
+			sqlite3_bind_int64(stmt, 3, uidvalidity);
+			sqlite3_bind_int64(stmt, 4, uids[i]);
+			sqlite3_step(stmt);
+		}
+		sqlite3_finalize(stmt);
+
+	dc_sqlite3_commit(context->sql);
 }
 
 
@@ -1275,6 +1616,7 @@ void dc_update_server_uid(dc_context_t* context, const char* rfc724_mid, const c
  * Get a single message object of the type dc_msg_t.
  * For a list of messages in a chat, see dc_get_chat_msgs()
  * For a list or chats, see dc_get_chatlist()
+ * To load several messages at once, use dc_get_msgs().
  *
  * @memberof dc_context_t
  * @param context The context as created by dc_context_new().
@@ -1283,17 +1625,27 @@ void dc_update_server_uid(dc_context_t* context, const char* rfc724_mid, const c
  */
 dc_msg_t* dc_get_msg(dc_context_t* context, uint32_t msg_id)
 {
-	int success = 0;
+	int       success = 0;
 	dc_msg_t* obj = dc_msg_new();
+	uint32_t  generation = 0;
 
 	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC) {
 		goto cleanup;
 	}
 
-	if (!dc_msg_load_from_db(obj, context, msg_id)) {
+	if (dc_msgcache_get(context->msgcache, msg_id, obj)) {
+		success = 1;
 		goto cleanup;
 	}
 
+	generation = dc_msgcache_get_generation(context->msgcache);
+
+	if (!load_from_db(obj, context, msg_id, 1)) { /* the UI does not need to wait for a transaction */
+		goto cleanup;
+	}
+
+	dc_msgcache_put(context->msgcache, obj, generation);
+
 	success = 1;
 
 cleanup:
@@ -1307,6 +1659,127 @@ cleanup:
 }
 
 
+/**
+ * Get several message objects at once.
+ * This is faster than calling dc_get_msg() for each message,
+ * eg. when the UI shows the messages of a chat: the messages found in the
+ * cache of recently used messages are just copied and all other messages
+ * are loaded using a single database query.
+ *
+ * @memberof dc_context_t
+ * @param context The context as created by dc_context_new().
+ * @param msg_ids An array of uint32_t message IDs to load.  Special IDs as
+ *     DC_MSG_ID_DAYMARKER are allowed, for these, NULL is returned.
+ * @param msg_cnt The number of IDs in msg_ids.
+ * @param[out] ret_msgs An array of msg_cnt pointers that is filled with the message objects,
+ *     in the same order as msg_ids.  Messages that cannot be loaded are set to NULL.
+ *     When done, each message object must be freed using dc_msg_unref().
+ * @return The number of message objects returned, 0 on errors.
+ */
+int dc_get_msgs(dc_context_t* context, const uint32_t* msg_ids, int msg_cnt, dc_msg_t** ret_msgs)
+{
+	#define       MAX_IDS_PER_QUERY 500 /* less than SQLITE_MAX_VARIABLE_NUMBER */
+	int           ret_cnt = 0;
+	int           i = 0, j = 0, k = 0, ids_in_query = 0;
+	uint32_t      generation = 0;
+	dc_strbuilder_t query;
+	sqlite3_stmt* stmt = NULL;
+	dc_msg_t*     msg = NULL;
+	dc_msg_t*     first = NULL;
+
+	dc_strbuilder_init(&query, 0);
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC || msg_ids==NULL || msg_cnt<=0 || ret_msgs==NULL) {
+		goto cleanup;
+	}
+
+	/* first, take what is in the cache */
+	for (i = 0; i < msg_cnt; i++) {
+		ret_msgs[i] = NULL;
+		if (msg_ids[i] > DC_MSG_ID_LAST_SPECIAL) {
+			msg = dc_msg_new();
+			if (dc_msgcache_get(context->msgcache, msg_ids[i], msg)) {
+				ret_msgs[i] = msg;
+				ret_cnt++;
+			}
+			else {
+				dc_msg_unref(msg);
+			}
+			msg = NULL;
+		}
+	}
+
+	/* then, load the other messages in chunks of up to MAX_IDS_PER_QUERY IDs */
+	generation = dc_msgcache_get_generation(context->msgcache);
+	for (i = 0; i < msg_cnt; i = j)
+	{
+		dc_strbuilder_empty(&query);
+		dc_strbuilder_cat(&query,
+			"SELECT " DC_MSG_FIELDS
+			" FROM msgs m LEFT JOIN chats c ON c.id=m.chat_id"
+			" WHERE m.id IN (");
+		for (j = i, ids_in_query = 0; j < msg_cnt && ids_in_query < MAX_IDS_PER_QUERY; j++) {
+			if (ret_msgs[j]==NULL && msg_ids[j] > DC_MSG_ID_LAST_SPECIAL) {
+				dc_strbuilder_cat(&query, ids_in_query? ",?" : "?");
+				ids_in_query++;
+			}
+		}
+		dc_strbuilder_cat(&query, ");");
+
+		if (ids_in_query==0) {
+			continue;
+		}
+
+		stmt = dc_sqlite3_prepare_read(context->sql, query.buf);
+		if (stmt==NULL) {
+			goto cleanup;
+		}
+
+		for (k = i, ids_in_query = 0; k < j; k++) {
+			if (ret_msgs[k]==NULL && msg_ids[k] > DC_MSG_ID_LAST_SPECIAL) {
+				sqlite3_bind_int(stmt, ++ids_in_query, msg_ids[k]);
+			}
+		}
+
+		while (sqlite3_step(stmt)==SQLITE_ROW)
+		{
+			msg = dc_msg_new();
+			dc_msg_set_from_stmt(msg, stmt, 0);
+			msg->context = context;
+			dc_msgcache_put(context->msgcache, msg, generation);
+
+			/* an ID may be requested several times, the first slot gets the object, the others get copies */
+			first = NULL;
+			for (k = i; k < j; k++) {
+				if (ret_msgs[k]==NULL && msg_ids[k]==msg->id) {
+					if (first==NULL) {
+						ret_msgs[k] = first = msg;
+					}
+					else {
+						ret_msgs[k] = dc_msg_new();
+						dc_msg_set_from_msg(ret_msgs[k], first);
+					}
+					ret_cnt++;
+				}
+			}
+
+			if (first==NULL) {
+				dc_msg_unref(msg);
+			}
+			msg = NULL;
+		}
+
+		sqlite3_finalize(stmt);
+		stmt = NULL;
+	}
+
+cleanup:
+	sqlite3_finalize(stmt);
+	free(query.buf);
+	return ret_cnt;
+}
+
+
 /**
  * Get an informational text for a single message. the text is multiline and may
  * contain eg. the raw text of the message.
@@ -1431,6 +1904,11 @@ char* dc_get_msg_info(dc_context_t* context, uint32_t msg_id)
 	}
 	dc_strbuilder_cat(&ret, "\n");
 
+	if ((p=dc_param_get(msg->param, DC_PARAM_ERROR, NULL))!=NULL) {
+		dc_strbuilder_catf(&ret, "Error: %s\n", p);
+		free(p);
+	}
+
 	/* add sender (only for info messages as the avatar may not be shown for them) */
 	if (dc_msg_is_info(msg)) {
 		dc_strbuilder_cat(&ret, "Sender: ");
@@ -1530,6 +2008,8 @@ void dc_star_msgs(dc_context_t* context, const uint32_t* msg_ids, int msg_cnt, i
 			sqlite3_bind_int(stmt, 1, star);
 			sqlite3_bind_int(stmt, 2, msg_ids[i]);
 			sqlite3_step(stmt);
+			dc_msgcache_invalidate(context->msgcache, msg_ids[i]);
+			dc_changelog_add(context->changelog, DC_CHANGE_MSG_UPDATED, msg_ids[i]);
 		}
 		sqlite3_finalize(stmt);
 
@@ -1558,13 +2038,26 @@ void dc_delete_msgs(dc_context_t* context, const uint32_t* msg_ids, int msg_cnt)
 		return;
 	}
 
+	sqlite3_stmt* stmt = NULL;
+
 	dc_sqlite3_begin_transaction(context->sql);
 
+		stmt = dc_sqlite3_prepare(context->sql,
+			"SELECT chat_id FROM msgs WHERE id=?;");
 		for (int i = 0; i < msg_cnt; i++)
 		{
+			sqlite3_reset(stmt);
+			sqlite3_bind_int(stmt, 1, msg_ids[i]);
+			if (sqlite3_step(stmt)==SQLITE_ROW) {
+				dc_changelog_add(context->changelog, DC_CHANGE_CHAT, sqlite3_column_int(stmt, 0));
+			}
+
 			dc_update_msg_chat_id(context, msg_ids[i], DC_CHAT_ID_TRASH);
+			dc_job_kill_foreign_id(context, msg_ids[i]); /* eg. a message deleted before it is sent is not sent at all */
 			dc_job_add(context, DC_JOB_DELETE_MSG_ON_IMAP, msg_ids[i], NULL, 0);
+			dc_changelog_add(context->changelog, DC_CHANGE_MSG_DELETED, msg_ids[i]);
 		}
+		sqlite3_finalize(stmt);
 
 	dc_sqlite3_commit(context->sql);
 }
@@ -1604,7 +2097,7 @@ void dc_markseen_msgs(dc_context_t* context, const uint32_t* msg_ids, int msg_cn
 	transaction_pending = 1;
 
 		stmt = dc_sqlite3_prepare(context->sql,
-			"SELECT m.state, c.blocked "
+			"SELECT m.state, c.blocked, m.chat_id "
 			" FROM msgs m "
 			" LEFT JOIN chats c ON c.id=m.chat_id "
 			" WHERE m.id=? AND m.chat_id>" DC_STRINGIFY(DC_CHAT_ID_LAST_SPECIAL));
@@ -1623,6 +2116,7 @@ void dc_markseen_msgs(dc_context_t* context, const uint32_t* msg_ids, int msg_cn
 					dc_update_msg_state(context, msg_ids[i], DC_STATE_IN_SEEN);
 					dc_log_info(context, 0, "Seen message #%i.", msg_ids[i]);
 					dc_job_add(context, DC_JOB_MARKSEEN_MSG_ON_IMAP, msg_ids[i], NULL, 0); /* results in a call to dc_markseen_msg_on_imap() */
+					dc_changelog_add(context->changelog, DC_CHANGE_CHAT, sqlite3_column_int(stmt, 2));
 					send_event = 1;
 				}
 			}
@@ -1631,6 +2125,7 @@ void dc_markseen_msgs(dc_context_t* context, const uint32_t* msg_ids, int msg_cn
 				/* message may be in contact requests, mark as NOTICED, this does not force IMAP updated nor send MDNs */
 				if (curr_state==DC_STATE_IN_FRESH) {
 					dc_update_msg_state(context, msg_ids[i], DC_STATE_IN_NOTICED);
+					dc_changelog_add(context->changelog, DC_CHANGE_CHAT, sqlite3_column_int(stmt, 2));
 					send_event = 1;
 				}
 			}
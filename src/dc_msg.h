@@ -76,6 +76,7 @@ struct _dc_msg
 	time_t          timestamp_rcvd;         /**< Unix time the message was recveived. 0 if unset. */
 
 	char*           text;                   /**< Message text.  NULL if unset.  It is recommended to use dc_msg_set_text() and dc_msg_get_text() to access this field. */
+	char*           summarytext;            /**< Summary precomputed on insert for DC_SUMMARY_CHARACTERS, see dc_msg_get_summarytext_to_store(). NULL if not yet computed. */
 
 	dc_context_t*   context;                /**< may be NULL, set on loading from database and on sending */
 	char*           rfc724_mid;             /**< The RFC-742 Message-ID */
@@ -89,8 +90,11 @@ struct _dc_msg
 
 
 int             dc_msg_load_from_db                   (dc_msg_t*, dc_context_t*, uint32_t id);
+void            dc_msg_set_from_msg                   (dc_msg_t*, const dc_msg_t*);
 int             dc_msg_is_increation                  (const dc_msg_t*);
 char*           dc_msg_get_summarytext_by_raw         (int type, const char* text, dc_param_t*, int approx_bytes, dc_context_t*); /* the returned value must be free()'d */
+char*           dc_msg_get_summarytext_to_store       (int type, const char* text); /* the returned value must be free()'d */
+int             dc_msg_backfill_summaries             (dc_context_t*, int max_cnt);
 void            dc_msg_save_param_to_disk             (dc_msg_t*);
 void            dc_msg_guess_msgtype_from_suffix      (const char* pathNfilename, int* ret_msgtype, char** ret_mime);
 void            dc_msg_get_authorNtitle_from_filename (const char* pathNfilename, char** ret_author, char** ret_title);
@@ -110,12 +114,16 @@ The value is also used for CC:-summaries */
 // Context functions to work with messages
 void            dc_update_msg_chat_id                      (dc_context_t*, uint32_t msg_id, uint32_t chat_id);
 void            dc_update_msg_state                        (dc_context_t*, uint32_t msg_id, int state);
+void            dc_set_msg_failed                          (dc_context_t*, uint32_t msg_id, const char* error);
 int             dc_mdn_from_ext                            (dc_context_t*, uint32_t from_id, const char* rfc724_mid, time_t, uint32_t* ret_chat_id, uint32_t* ret_msg_id); /* returns 1 if an event should be send */
 size_t          dc_get_real_msg_cnt                        (dc_context_t*); /* the number of messages assigned to real chat (!=deaddrop, !=trash) */
 size_t          dc_get_deaddrop_msg_cnt                    (dc_context_t*);
 int             dc_rfc724_mid_cnt                          (dc_context_t*, const char* rfc724_mid);
 uint32_t        dc_rfc724_mid_exists                       (dc_context_t*, const char* rfc724_mid, char** ret_server_folder, uint32_t* ret_server_uid);
 void            dc_update_server_uid                       (dc_context_t*, const char* rfc724_mid, const char* server_folder, uint32_t server_uid);
+int             dc_get_imap_location                       (dc_context_t*, const char* rfc724_mid, char** ret_folder, uint32_t* ret_uidvalidity, uint32_t* ret_uid);
+void            dc_set_imap_location                       (dc_context_t*, const char* rfc724_mid, const char* folder, uint32_t uidvalidity, uint32_t uid);
+void            dc_set_imap_locations                      (dc_context_t*, const char* folder, uint32_t uidvalidity, int replace, char** rfc724_mids, const uint32_t* uids, int cnt);
 
 
 #ifdef __cplusplus
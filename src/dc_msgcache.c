@@ -0,0 +1,361 @@
+/*******************************************************************************
+ *
+ *                              Delta Chat Core
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ ******************************************************************************/
+
+
+
+#include "dc_context.h"
+#include "dc_msgcache.h"
+
+
+struct dc_msgcache_entry_t
+{
+	dc_msgcache_entry_t* newer;
+	dc_msgcache_entry_t* older;
+	dc_msg_t*            msg;
+};
+
+
+static void unlink_entry(dc_msgcache_t* cache, dc_msgcache_entry_t* entry)
+{
+	if (entry->newer) { entry->newer->older = entry->older; } else { cache->newest = entry->older; }
+	if (entry->older) { entry->older->newer = entry->newer; } else { cache->oldest = entry->newer; }
+	entry->newer = NULL;
+	entry->older = NULL;
+}
+
+
+static void link_newest(dc_msgcache_t* cache, dc_msgcache_entry_t* entry)
+{
+	entry->newer = NULL;
+	entry->older = cache->newest;
+	if (cache->newest) { cache->newest->newer = entry; } else { cache->oldest = entry; }
+	cache->newest = entry;
+}
+
+
+static void next_generation(dc_msgcache_t* cache)
+{
+	cache->generation++;
+	if (cache->generation==0) {
+		cache->generation = 1; /* 0 is returned by dc_msgcache_get_generation() if the cache must not be used */
+	}
+}
+
+
+static void remove_entry(dc_msgcache_t* cache, dc_msgcache_entry_t* entry)
+{
+	dc_hash_insert(&cache->entries, NULL, entry->msg->id, NULL);
+	unlink_entry(cache, entry);
+	dc_msg_unref(entry->msg);
+	free(entry);
+}
+
+
+/**
+ * Create a new message cache.
+ *
+ * @private @memberof dc_msgcache_t
+ * @param context The context the cached messages belong to.
+ * @return The cache object, must be freed using dc_msgcache_unref().
+ */
+dc_msgcache_t* dc_msgcache_new(dc_context_t* context)
+{
+	dc_msgcache_t* cache = NULL;
+
+	if ((cache=calloc(1, sizeof(dc_msgcache_t)))==NULL) {
+		exit(58); /* cannot allocate little memory, unrecoverable error */
+	}
+
+	cache->context    = context;
+	cache->generation = 1;
+	pthread_mutex_init(&cache->critical, NULL);
+	dc_hash_init(&cache->entries, DC_HASH_INT, 0);
+
+	return cache;
+}
+
+
+/**
+ * Free a message cache and all snapshots in it.
+ *
+ * @private @memberof dc_msgcache_t
+ * @param cache The cache object as created by dc_msgcache_new().
+ * @return None.
+ */
+void dc_msgcache_unref(dc_msgcache_t* cache)
+{
+	if (cache==NULL) {
+		return;
+	}
+
+	dc_msgcache_clear(cache);
+	dc_hash_clear(&cache->entries);
+	pthread_mutex_destroy(&cache->critical);
+	free(cache);
+}
+
+
+/**
+ * Get the current generation of the cache.
+ * The returned value must be passed to dc_msgcache_put() for messages loaded
+ * after this call.
+ *
+ * @private @memberof dc_msgcache_t
+ * @param cache The cache object.
+ * @return The generation, 0 if the cache must not be used now,
+ *     eg. because a transaction is open.
+ */
+uint32_t dc_msgcache_get_generation(dc_msgcache_t* cache)
+{
+	uint32_t generation = 0;
+
+	if (cache==NULL) {
+		return 0;
+	}
+
+	pthread_mutex_lock(&cache->critical);
+		if (cache->writing==0) {
+			generation = cache->generation;
+		}
+	pthread_mutex_unlock(&cache->critical);
+
+	return generation;
+}
+
+
+/**
+ * Copy a message from the cache to the given message object.
+ * On success, the message is marked as the most recently used one.
+ *
+ * @private @memberof dc_msgcache_t
+ * @param cache The cache object.
+ * @param msg_id The ID of the message to get.
+ * @param ret_msg The message object to fill.  Not modified if the message is not in the cache.
+ * @return 1=the message was copied to ret_msg, 0=the message is not in the cache.
+ */
+int dc_msgcache_get(dc_msgcache_t* cache, uint32_t msg_id, dc_msg_t* ret_msg)
+{
+	int                  found = 0;
+	dc_msgcache_entry_t* entry = NULL;
+
+	if (cache==NULL || ret_msg==NULL) {
+		return 0;
+	}
+
+	pthread_mutex_lock(&cache->critical);
+
+		if ((entry=dc_hash_find(&cache->entries, NULL, msg_id))!=NULL) {
+			unlink_entry(cache, entry);
+			link_newest(cache, entry);
+			dc_msg_set_from_msg(ret_msg, entry->msg);
+			cache->hits++;
+			found = 1;
+		}
+		else {
+			cache->misses++;
+		}
+
+	pthread_mutex_unlock(&cache->critical);
+
+	return found;
+}
+
+
+/**
+ * Add a snapshot of a message loaded from the database to the cache.
+ * If the cache is full, the least recently used message is dropped.
+ *
+ * @private @memberof dc_msgcache_t
+ * @param cache The cache object.
+ * @param msg The message to add, a copy is made.
+ * @param generation The value returned by dc_msgcache_get_generation() before the message was loaded.
+ *     If the cache was invalidated in the meantime or if a transaction is open,
+ *     the message is not added.
+ * @return None.
+ */
+void dc_msgcache_put(dc_msgcache_t* cache, const dc_msg_t* msg, uint32_t generation)
+{
+	dc_msgcache_entry_t* entry = NULL;
+
+	if (cache==NULL || msg==NULL || msg->id==0 || generation==0) {
+		return;
+	}
+
+	pthread_mutex_lock(&cache->critical);
+
+		if (generation!=cache->generation || cache->writing) {
+			goto cleanup;
+		}
+
+		if ((entry=dc_hash_find(&cache->entries, NULL, msg->id))!=NULL) {
+			remove_entry(cache, entry);
+			entry = NULL;
+		}
+
+		while (dc_hash_cnt(&cache->entries) >= DC_MSGCACHE_MAX && cache->oldest) {
+			remove_entry(cache, cache->oldest);
+		}
+
+		if ((entry=calloc(1, sizeof(dc_msgcache_entry_t)))==NULL) {
+			exit(59); /* cannot allocate little memory, unrecoverable error */
+		}
+		entry->msg = dc_msg_new();
+		dc_msg_set_from_msg(entry->msg, msg);
+		link_newest(cache, entry);
+		dc_hash_insert(&cache->entries, NULL, msg->id, entry);
+
+cleanup:
+	pthread_mutex_unlock(&cache->critical);
+}
+
+
+/**
+ * Drop a message from the cache.
+ * Must be called after the message is modified in the database.
+ *
+ * @private @memberof dc_msgcache_t
+ * @param cache The cache object.
+ * @param msg_id The ID of the modified message.
+ * @return None.
+ */
+void dc_msgcache_invalidate(dc_msgcache_t* cache, uint32_t msg_id)
+{
+	dc_msgcache_entry_t* entry = NULL;
+
+	if (cache==NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&cache->critical);
+
+		next_generation(cache);
+
+		if ((entry=dc_hash_find(&cache->entries, NULL, msg_id))!=NULL) {
+			remove_entry(cache, entry);
+		}
+
+	pthread_mutex_unlock(&cache->critical);
+}
+
+
+/**
+ * Drop all messages with the given Message-ID from the cache.
+ * As there are at most DC_MSGCACHE_MAX entries, the cache is just scanned.
+ *
+ * @private @memberof dc_msgcache_t
+ * @param cache The cache object.
+ * @param rfc724_mid The Message-ID of the modified messages.
+ * @return None.
+ */
+void dc_msgcache_invalidate_rfc724_mid(dc_msgcache_t* cache, const char* rfc724_mid)
+{
+	dc_msgcache_entry_t* entry = NULL;
+	dc_msgcache_entry_t* older = NULL;
+
+	if (cache==NULL || rfc724_mid==NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&cache->critical);
+
+		next_generation(cache);
+
+		for (entry = cache->newest; entry; entry = older) {
+			older = entry->older;
+			if (entry->msg->rfc724_mid && strcmp(entry->msg->rfc724_mid, rfc724_mid)==0) {
+				remove_entry(cache, entry);
+			}
+		}
+
+	pthread_mutex_unlock(&cache->critical);
+}
+
+
+/**
+ * Drop all messages from the cache.
+ * Used after modifications that affect an unknown number of messages,
+ * eg. when all messages of a chat are marked as noticed.
+ *
+ * @private @memberof dc_msgcache_t
+ * @param cache The cache object.
+ * @return None.
+ */
+void dc_msgcache_clear(dc_msgcache_t* cache)
+{
+	if (cache==NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&cache->critical);
+
+		next_generation(cache);
+
+		while (cache->oldest) {
+			remove_entry(cache, cache->oldest);
+		}
+
+	pthread_mutex_unlock(&cache->critical);
+}
+
+
+/**
+ * Tell the cache that a transaction is opened.  Until the transaction is
+ * committed or rolled back, the read-only connections may return data that
+ * are already invalidated, so nothing is added to the cache meanwhile.
+ *
+ * @private @memberof dc_msgcache_t
+ * @param cache The cache object.
+ * @return None.
+ */
+void dc_msgcache_begin_write(dc_msgcache_t* cache)
+{
+	if (cache==NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&cache->critical);
+		cache->writing++;
+	pthread_mutex_unlock(&cache->critical);
+}
+
+
+/**
+ * Tell the cache that a transaction opened by dc_msgcache_begin_write()
+ * is committed or rolled back.  Messages loaded before are not added
+ * to the cache, as they may have been loaded before the invalidations
+ * done in the transaction got visible.
+ *
+ * @private @memberof dc_msgcache_t
+ * @param cache The cache object.
+ * @return None.
+ */
+void dc_msgcache_end_write(dc_msgcache_t* cache)
+{
+	if (cache==NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&cache->critical);
+		if (cache->writing > 0) {
+			cache->writing--;
+		}
+		next_generation(cache);
+	pthread_mutex_unlock(&cache->critical);
+}
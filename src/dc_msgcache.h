@@ -0,0 +1,92 @@
+/*******************************************************************************
+ *
+ *                              Delta Chat Core
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ ******************************************************************************/
+
+
+
+#ifndef __DC_MSGCACHE_H__
+#define __DC_MSGCACHE_H__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "dc_hash.h"
+
+
+typedef struct dc_msgcache_entry_t dc_msgcache_entry_t;
+
+
+/**
+ * Library-internal.
+ *
+ * The message cache keeps snapshots of the recently loaded messages so that
+ * dc_get_msg() and dc_get_msgs() do not need to query the database again
+ * when the UI scrolls back and forth.
+ *
+ * The snapshots are never handed out directly, dc_msgcache_get() copies them
+ * to the caller's object.  Every function that modifies a message in the
+ * database must call dc_msgcache_invalidate() _after_ the modification.
+ * To avoid that a snapshot loaded before the modification is added afterwards,
+ * get the generation by dc_msgcache_get_generation() before loading and
+ * pass it to dc_msgcache_put(); the snapshot is only added if there was no
+ * invalidation and no transaction in between.  As the messages are loaded
+ * from the read-only connections, they do not see the changes of an open
+ * transaction; dc_sqlite3_begin_transaction() and dc_sqlite3_commit() therefore
+ * tell the cache about transactions by dc_msgcache_begin_write() and dc_msgcache_end_write().
+ *
+ * All functions are thread-safe.
+ */
+typedef struct dc_msgcache_t
+{
+	/** @privatesection */
+	#define              DC_MSGCACHE_MAX 500
+	dc_context_t*        context;
+	pthread_mutex_t      critical;
+	dc_hash_t            entries;    /* message ID -> dc_msgcache_entry_t */
+	dc_msgcache_entry_t* newest;     /* list of all entries, the most recently used first */
+	dc_msgcache_entry_t* oldest;
+	uint32_t             generation; /* incremented on each invalidation */
+	int                  writing;    /* number of open transactions, nothing is added to the cache meanwhile */
+
+	/* instrumentation */
+	size_t               hits;
+	size_t               misses;
+} dc_msgcache_t;
+
+
+dc_msgcache_t* dc_msgcache_new                   (dc_context_t*);
+void           dc_msgcache_unref                 (dc_msgcache_t*);
+
+uint32_t       dc_msgcache_get_generation        (dc_msgcache_t*);
+int            dc_msgcache_get                   (dc_msgcache_t*, uint32_t msg_id, dc_msg_t* ret_msg); /* returns 1 if the message was found in the cache */
+void           dc_msgcache_put                   (dc_msgcache_t*, const dc_msg_t*, uint32_t generation);
+
+void           dc_msgcache_invalidate            (dc_msgcache_t*, uint32_t msg_id);
+void           dc_msgcache_invalidate_rfc724_mid (dc_msgcache_t*, const char* rfc724_mid);
+void           dc_msgcache_clear                 (dc_msgcache_t*);
+
+void           dc_msgcache_begin_write           (dc_msgcache_t*);
+void           dc_msgcache_end_write             (dc_msgcache_t*);
+
+
+#ifdef __cplusplus
+} /* /extern "C" */
+#endif
+#endif /* __DC_MSGCACHE_H__ */
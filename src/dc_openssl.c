@@ -32,6 +32,8 @@ static int              s_init_not_required = 0;
 static int              s_init_counter      = 0;
 static pthread_mutex_t* s_mutex_buf         = NULL;
 
+static void free_tls_sessions(void);
+
 
 /**
  * Skip OpenSSL initialisation.
@@ -169,7 +171,158 @@ void dc_openssl_exit(void)
 				free(s_mutex_buf);
 				s_mutex_buf = NULL;
 			}
+
+			if (s_init_counter==0) {
+				free_tls_sessions();
+			}
 		}
 
 	pthread_mutex_unlock(&s_init_lock);
 }
+
+
+/*******************************************************************************
+ * TLS session cache
+ ******************************************************************************/
+
+
+/* TLS sessions are cached per host and port so that reconnects can resume
+the session, which saves a round trip and the key exchange.
+libEtPan creates a new SSL_CTX for every connection and allows to modify it
+before the connection is made; there we add callbacks that store new sessions
+and that set a cached session when the handshake starts. */
+
+
+static pthread_mutex_t s_session_lock      = PTHREAD_MUTEX_INITIALIZER;
+static dc_hash_t       s_sessions;                 /* "host:port" -> SSL_SESSION* */
+static int             s_sessions_initialized = 0;
+static int             s_session_key_index = -1;   /* SSL_CTX ex_data index of the "host:port" string */
+
+
+static void free_session_key(void* parent, void* ptr, CRYPTO_EX_DATA* ad, int idx, long argl, void* argp)
+{
+	free(ptr);
+}
+
+
+static const char* get_session_key(const SSL* ssl)
+{
+	return (const char*)SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), s_session_key_index);
+}
+
+
+static int new_session_cb(SSL* ssl, SSL_SESSION* session)
+{
+	const char*  key = get_session_key(ssl);
+	SSL_SESSION* old_session = NULL;
+
+	if (key==NULL) {
+		return 0;
+	}
+
+	pthread_mutex_lock(&s_session_lock);
+		if ((old_session=dc_hash_find_str(&s_sessions, key))!=NULL) {
+			SSL_SESSION_free(old_session);
+		}
+		dc_hash_insert(&s_sessions, key, strlen(key), session);
+	pthread_mutex_unlock(&s_session_lock);
+
+	return 1; /* we keep the reference to the session */
+}
+
+
+static void info_cb(const SSL* ssl, int where, int ret)
+{
+	const char*  key = NULL;
+	SSL_SESSION* session = NULL;
+
+	if ((where&SSL_CB_HANDSHAKE_START)==0 || SSL_get_session(ssl)!=NULL /*renegotiation*/
+	 || (key=get_session_key(ssl))==NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&s_session_lock);
+		if ((session=dc_hash_find_str(&s_sessions, key))!=NULL) {
+			SSL_set_session((SSL*)ssl, session); /* takes its own reference */
+		}
+	pthread_mutex_unlock(&s_session_lock);
+}
+
+
+/**
+ * Callback to pass to libEtPan's mailimap_ssl_connect_with_callback() and similar functions
+ * to resume cached TLS sessions and to cache new ones.
+ *
+ * @private @memberof dc_context_t
+ * @param ssl_context The SSL context as given by libEtPan.
+ * @param host "host:port" as used to identify the session;
+ *     the string is copied and needs to be valid only during the call.
+ * @return None.
+ */
+void dc_openssl_tls_session_cb(struct mailstream_ssl_context* ssl_context, void* host)
+{
+	SSL_CTX* ctx = (SSL_CTX*)mailstream_ssl_get_openssl_ssl_ctx(ssl_context);
+
+	if (ctx==NULL || host==NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&s_session_lock);
+		if (!s_sessions_initialized) {
+			dc_hash_init(&s_sessions, DC_HASH_STRING, 1/*copy key*/);
+			s_sessions_initialized = 1;
+		}
+		if (s_session_key_index < 0) {
+			s_session_key_index = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, free_session_key);
+		}
+	pthread_mutex_unlock(&s_session_lock);
+
+	if (s_session_key_index < 0) {
+		return;
+	}
+
+	SSL_CTX_set_ex_data(ctx, s_session_key_index, dc_strdup((const char*)host));
+	SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT|SSL_SESS_CACHE_NO_INTERNAL_STORE);
+	SSL_CTX_sess_set_new_cb(ctx, new_session_cb);
+	SSL_CTX_set_info_callback(ctx, info_cb);
+}
+
+
+/**
+ * Remove a cached TLS session, eg. if a connection using it has failed.
+ *
+ * @private @memberof dc_context_t
+ * @param host "host:port" as given to dc_openssl_tls_session_cb().
+ * @return None.
+ */
+void dc_openssl_forget_tls_session(const char* host)
+{
+	SSL_SESSION* session = NULL;
+
+	if (host==NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&s_session_lock);
+		if (s_sessions_initialized && (session=dc_hash_find_str(&s_sessions, host))!=NULL) {
+			SSL_SESSION_free(session);
+			dc_hash_insert(&s_sessions, host, strlen(host), NULL);
+		}
+	pthread_mutex_unlock(&s_session_lock);
+}
+
+
+static void free_tls_sessions(void)
+{
+	dc_hashelem_t* elem = NULL;
+
+	pthread_mutex_lock(&s_session_lock);
+		if (s_sessions_initialized) {
+			for (elem = dc_hash_first(&s_sessions); elem; elem = dc_hash_next(elem)) {
+				SSL_SESSION_free((SSL_SESSION*)dc_hash_data(elem));
+			}
+			dc_hash_clear(&s_sessions);
+			s_sessions_initialized = 0;
+		}
+	pthread_mutex_unlock(&s_session_lock);
+}
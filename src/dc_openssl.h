@@ -33,6 +33,10 @@ extern "C" {
 void dc_openssl_init(void);
 void dc_openssl_exit(void);
 
+struct mailstream_ssl_context;
+void dc_openssl_tls_session_cb     (struct mailstream_ssl_context*, void* host);
+void dc_openssl_forget_tls_session (const char* host);
+
 
 #ifdef __cplusplus
 } /* /extern "C" */
@@ -0,0 +1,290 @@
+/*******************************************************************************
+ *
+ *                              Delta Chat Core
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ ******************************************************************************/
+
+
+
+/* Run several probes at the same time and take the best result.
+
+The probes are ordered by priority; the best result is the one of the first
+probe that succeeds while all probes before it have failed or timed out.
+So, a fast probe with a low priority does not win against a slower one with
+a higher priority, however, we do not have to wait for the slower ones
+if the faster one has the higher priority.
+
+When the best result is found, the remaining probes are cancelled:
+the blocking calls they are in cannot be interrupted, however, they should
+not use the context any longer, see dc_probe_is_cancelled().  As the probes
+get the context, dc_probes_unref() waits until all probe threads have returned. */
+
+
+#include <time.h>
+#include "dc_context.h"
+#include "dc_probe.h"
+
+
+struct dc_probes_t
+{
+	dc_context_t*   context;
+	dc_probe_free_t free_result;
+	dc_probe_free_t free_arg;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t  cond;       /* signalled when a probe is done */
+	int             cancelled;
+
+	int             probes_cnt;
+	dc_probe_t      probes[DC_PROBES_MAX];
+};
+
+
+static double now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (double)ts.tv_sec*1000.0 + (double)ts.tv_nsec/1000000.0;
+}
+
+
+static void* probe_thread_entry_point(void* entry_arg)
+{
+	dc_probe_t*  probe = (dc_probe_t*)entry_arg;
+	dc_probes_t* probes = probe->probes;
+	void*        result = probe->func(probe);
+
+	pthread_mutex_lock(&probes->mutex);
+		if (probes->cancelled && result && probes->free_result) {
+			probes->free_result(result);
+			result = NULL;
+		}
+		probe->result = result;
+		probe->state = DC_PROBE_DONE;
+		pthread_cond_broadcast(&probes->cond);
+	pthread_mutex_unlock(&probes->mutex);
+
+	return NULL;
+}
+
+
+/**
+ * Create an object to run probes in parallel.
+ *
+ * @private @memberof dc_probes_t
+ * @param context The context, used for logging and to check for dc_stop_ongoing_process().
+ * @param free_result Function to free results that are not returned by dc_probes_get_best(); may be NULL.
+ * @param free_arg Function to free the arguments given to dc_probes_add(); may be NULL.
+ * @return The probes object, must be freed using dc_probes_unref().
+ */
+dc_probes_t* dc_probes_new(dc_context_t* context, dc_probe_free_t free_result, dc_probe_free_t free_arg)
+{
+	dc_probes_t* probes = NULL;
+
+	if ((probes=calloc(1, sizeof(dc_probes_t)))==NULL) {
+		exit(65);
+	}
+
+	probes->context     = context;
+	probes->free_result = free_result;
+	probes->free_arg    = free_arg;
+	pthread_mutex_init(&probes->mutex, NULL);
+	pthread_cond_init(&probes->cond, NULL);
+
+	return probes;
+}
+
+
+/**
+ * Free a probes object.
+ * Probes still running are cancelled and the function waits until they return,
+ * so that no probe uses the context afterwards.
+ *
+ * @private @memberof dc_probes_t
+ * @param probes The probes object as created by dc_probes_new().
+ * @return None.
+ */
+void dc_probes_unref(dc_probes_t* probes)
+{
+	int i;
+
+	if (probes==NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&probes->mutex);
+		probes->cancelled = 1;
+	pthread_mutex_unlock(&probes->mutex);
+
+	for (i = 0; i < probes->probes_cnt; i++) {
+		if (probes->probes[i].thread_started) {
+			pthread_join(probes->probes[i].thread, NULL);
+		}
+		if (probes->probes[i].result && probes->free_result) {
+			probes->free_result(probes->probes[i].result);
+		}
+		if (probes->probes[i].arg && probes->free_arg) {
+			probes->free_arg(probes->probes[i].arg);
+		}
+	}
+
+	pthread_cond_destroy(&probes->cond);
+	pthread_mutex_destroy(&probes->mutex);
+	free(probes);
+}
+
+
+/**
+ * Start a probe in a separate thread.
+ *
+ * @private @memberof dc_probes_t
+ * @param probes The probes object as created by dc_probes_new().
+ * @param func The function to call in the thread.
+ *     The function gets a dc_probe_t object with the argument
+ *     and returns a result or NULL on failure.
+ * @param arg The argument for the function; the probes object takes the ownership.
+ * @param timeout_ms If the probe is not done within this time, it is handled as failed.
+ * @return 1=probe started, 0=error; the argument is freed in this case.
+ */
+int dc_probes_add(dc_probes_t* probes, dc_probe_func_t func, void* arg, int timeout_ms)
+{
+	dc_probe_t* probe = NULL;
+
+	if (probes==NULL || func==NULL || probes->probes_cnt>=DC_PROBES_MAX || probes->cancelled) {
+		if (probes && probes->free_arg && arg) {
+			probes->free_arg(arg);
+		}
+		return 0;
+	}
+
+	pthread_mutex_lock(&probes->mutex);
+		probe = &probes->probes[probes->probes_cnt++];
+		probe->probes      = probes;
+		probe->context     = probes->context;
+		probe->arg         = arg;
+		probe->func        = func;
+		probe->deadline_ms = now_ms() + timeout_ms;
+		probe->state       = DC_PROBE_RUNNING;
+	pthread_mutex_unlock(&probes->mutex);
+
+	if (pthread_create(&probe->thread, NULL, probe_thread_entry_point, probe)!=0) {
+		dc_log_warning(probes->context, 0, "Cannot start probe thread.");
+		pthread_mutex_lock(&probes->mutex);
+			probe->state = DC_PROBE_DONE;
+		pthread_mutex_unlock(&probes->mutex);
+		return 0;
+	}
+	probe->thread_started = 1; /* joined by dc_probes_unref() */
+
+	return 1;
+}
+
+
+/**
+ * Wait for the best result, see the top of this file.
+ * Afterwards, all other probes are cancelled and no more probes can be added.
+ *
+ * @private @memberof dc_probes_t
+ * @param probes The probes object as created by dc_probes_new().
+ * @param[out] ret_index If not NULL, the index of the best probe in the order of dc_probes_add() is returned here, -1 if there is no result.
+ * @return The result of the best probe, the caller takes the ownership.
+ *     NULL if all probes have failed or timed out or if dc_stop_ongoing_process() was called.
+ */
+void* dc_probes_get_best(dc_probes_t* probes, int* ret_index)
+{
+	int             i, best = -1;
+	double          now = 0, wait_until = 0;
+	void*           result = NULL;
+	struct timespec ts;
+
+	if (ret_index) {
+		*ret_index = -1;
+	}
+
+	if (probes==NULL) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&probes->mutex);
+
+		while (1)
+		{
+			now = now_ms();
+			wait_until = 0;
+			for (i = 0; i < probes->probes_cnt; i++) {
+				dc_probe_t* probe = &probes->probes[i];
+				if (probe->state==DC_PROBE_DONE) {
+					if (probe->result) {
+						best = i;
+						break;
+					}
+				}
+				else if (now < probe->deadline_ms) {
+					wait_until = probe->deadline_ms; /* wait for the probe with the highest priority still running */
+					break;
+				}
+			}
+
+			if (best>=0 || wait_until==0 || probes->context->shall_stop_ongoing) {
+				break;
+			}
+
+			if (wait_until > now+200) {
+				wait_until = now+200; /* check for dc_stop_ongoing_process() from time to time */
+			}
+			ts.tv_sec  = (time_t)(wait_until/1000.0);
+			ts.tv_nsec = (long)((wait_until-(double)ts.tv_sec*1000.0)*1000000.0);
+			pthread_cond_timedwait(&probes->cond, &probes->mutex, &ts);
+		}
+
+		if (best>=0) {
+			result = probes->probes[best].result;
+			probes->probes[best].result = NULL;
+			if (ret_index) {
+				*ret_index = best;
+			}
+		}
+
+		probes->cancelled = 1;
+
+	pthread_mutex_unlock(&probes->mutex);
+
+	return result;
+}
+
+
+/**
+ * Check if a probe is no longer needed.
+ * Probes should check this before each use of the context and after each
+ * blocking call and return as soon as possible in this case.
+ *
+ * @private @memberof dc_probe_t
+ * @param probe The probe object as given to the probe function.
+ * @return 1=the probe is cancelled, 0=the result is still needed.
+ */
+int dc_probe_is_cancelled(dc_probe_t* probe)
+{
+	int cancelled = 1;
+
+	if (probe && probe->probes) {
+		pthread_mutex_lock(&probe->probes->mutex);
+			cancelled = probe->probes->cancelled;
+		pthread_mutex_unlock(&probe->probes->mutex);
+	}
+
+	return cancelled;
+}
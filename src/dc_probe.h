@@ -0,0 +1,76 @@
+/*******************************************************************************
+ *
+ *                              Delta Chat Core
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ ******************************************************************************/
+
+
+
+#ifndef __DC_PROBE_H__
+#define __DC_PROBE_H__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct dc_probes_t dc_probes_t;
+typedef struct dc_probe_t dc_probe_t;
+
+
+/**
+ * Library-internal.
+ *
+ * A probe is a function that tries out something that may block for a while,
+ * eg. a HTTP request or a connection attempt, and returns a result or NULL.
+ * Several probes are run at the same time, each in its own thread.
+ */
+typedef void* (*dc_probe_func_t) (dc_probe_t*);
+typedef void  (*dc_probe_free_t) (void*);
+
+
+struct dc_probe_t
+{
+	/** @privatesection */
+	dc_probes_t*    probes;
+	dc_context_t*   context;      /* valid until dc_probes_unref() has joined the probe threads, however, cancelled probes should not use it any more */
+	void*           arg;          /* owned by the probe, freed using the free_arg function given to dc_probes_new() */
+
+	dc_probe_func_t func;
+	double          deadline_ms;
+	#define         DC_PROBE_RUNNING 0
+	#define         DC_PROBE_DONE    1
+	int             state;
+	void*           result;
+	pthread_t       thread;
+	int             thread_started;
+};
+
+
+dc_probes_t* dc_probes_new          (dc_context_t*, dc_probe_free_t free_result, dc_probe_free_t free_arg);
+void         dc_probes_unref        (dc_probes_t*);
+
+#define      DC_PROBES_MAX          16
+int          dc_probes_add          (dc_probes_t*, dc_probe_func_t, void* arg, int timeout_ms); /* probes added first have a higher priority */
+void*        dc_probes_get_best     (dc_probes_t*, int* ret_index);
+
+int          dc_probe_is_cancelled  (dc_probe_t*);
+
+
+#ifdef __cplusplus
+} /* /extern "C" */
+#endif
+#endif /* __DC_PROBE_H__ */
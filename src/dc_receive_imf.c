@@ -24,6 +24,7 @@
 #include <netpgp-extra.h>
 #include "dc_context.h"
 #include "dc_mimeparser.h"
+#include "dc_arena.h"
 #include "dc_mimefactory.h"
 #include "dc_imap.h"
 #include "dc_job.h"
@@ -164,7 +165,7 @@ static int dc_is_reply_to_known_message(dc_context_t* context, dc_mimeparser_t*
 	`In-Reply-To`/`References:` (to support non-Delta-Clients) or from `Chat-Predecessor:` (Delta clients, see comment in dc_chat.c) */
 
 	struct mailimf_optional_field* optional_field = NULL;
-	if ((optional_field=dc_mimeparser_lookup_optional_field2(mime_parser, "Chat-Predecessor", "X-MrPredecessor"))!=NULL)
+	if ((optional_field=dc_mimeparser_get_optional_header2(mime_parser, DC_HEADER_CHAT_PREDECESSOR, DC_HEADER_X_MRPREDECESSOR))!=NULL)
 	{
 		if (is_known_rfc724_mid(context, optional_field->fld_value)) {
 			return 1;
@@ -172,7 +173,7 @@ static int dc_is_reply_to_known_message(dc_context_t* context, dc_mimeparser_t*
 	}
 
 	struct mailimf_field* field = NULL;
-	if ((field=dc_mimeparser_lookup_field(mime_parser, "In-Reply-To"))!=NULL
+	if ((field=dc_mimeparser_get_header(mime_parser, DC_HEADER_IN_REPLY_TO))!=NULL
 	 && field->fld_type==MAILIMF_FIELD_IN_REPLY_TO)
 	{
 		struct mailimf_in_reply_to* fld_in_reply_to = field->fld_data.fld_in_reply_to;
@@ -183,7 +184,7 @@ static int dc_is_reply_to_known_message(dc_context_t* context, dc_mimeparser_t*
 		}
 	}
 
-	if ((field=dc_mimeparser_lookup_field(mime_parser, "References"))!=NULL
+	if ((field=dc_mimeparser_get_header(mime_parser, DC_HEADER_REFERENCES))!=NULL
 	 && field->fld_type==MAILIMF_FIELD_REFERENCES)
 	{
 		struct mailimf_references* fld_references = field->fld_data.fld_references;
@@ -246,7 +247,7 @@ static int dc_is_reply_to_messenger_message(dc_context_t* context, dc_mimeparser
 	- no check for the Chat-* headers (function is only called if it is no messenger message itself) */
 
 	struct mailimf_field* field = NULL;
-	if ((field=dc_mimeparser_lookup_field(mime_parser, "In-Reply-To"))!=NULL
+	if ((field=dc_mimeparser_get_header(mime_parser, DC_HEADER_IN_REPLY_TO))!=NULL
 	 && field->fld_type==MAILIMF_FIELD_IN_REPLY_TO)
 	{
 		struct mailimf_in_reply_to* fld_in_reply_to = field->fld_data.fld_in_reply_to;
@@ -257,7 +258,7 @@ static int dc_is_reply_to_messenger_message(dc_context_t* context, dc_mimeparser
 		}
 	}
 
-	if ((field=dc_mimeparser_lookup_field(mime_parser, "References"))!=NULL
+	if ((field=dc_mimeparser_get_header(mime_parser, DC_HEADER_REFERENCES))!=NULL
 	 && field->fld_type==MAILIMF_FIELD_REFERENCES)
 	{
 		struct mailimf_references* fld_references = field->fld_data.fld_references;
@@ -570,6 +571,7 @@ static void create_or_lookup_adhoc_group(dc_context_t* context, dc_mimeparser_t*
 		dc_add_to_chat_contacts_table(context, chat_id, dc_array_get_id(member_ids, i));
 	}
 
+	dc_changelog_add(context->changelog, DC_CHANGE_CHAT, chat_id);
 	context->cb(context, DC_EVENT_CHAT_MODIFIED, chat_id, 0);
 
 cleanup:
@@ -706,13 +708,13 @@ static void create_or_lookup_group(dc_context_t* context, dc_mimeparser_t* mime_
 		struct mailimf_field*          field = NULL;
 		struct mailimf_optional_field* optional_field = NULL;
 
-		if ((optional_field=dc_mimeparser_lookup_optional_field2(mime_parser, "Chat-Group-ID", "X-MrGrpId"))!=NULL) {
+		if ((optional_field=dc_mimeparser_get_optional_header2(mime_parser, DC_HEADER_CHAT_GROUP_ID, DC_HEADER_X_MRGRPID))!=NULL) {
 			grpid = dc_strdup(optional_field->fld_value);
 		}
 
 		if (grpid==NULL)
 		{
-			if ((field=dc_mimeparser_lookup_field(mime_parser, "Message-ID"))!=NULL && field->fld_type==MAILIMF_FIELD_MESSAGE_ID) {
+			if ((field=dc_mimeparser_get_header(mime_parser, DC_HEADER_MESSAGE_ID))!=NULL && field->fld_type==MAILIMF_FIELD_MESSAGE_ID) {
 				struct mailimf_message_id* fld_message_id = field->fld_data.fld_message_id;
 				if (fld_message_id) {
 					grpid = dc_extract_grpid_from_rfc724_mid(fld_message_id->mid_value);
@@ -721,7 +723,7 @@ static void create_or_lookup_group(dc_context_t* context, dc_mimeparser_t* mime_
 
 			if (grpid==NULL)
 			{
-				if ((field=dc_mimeparser_lookup_field(mime_parser, "In-Reply-To"))!=NULL && field->fld_type==MAILIMF_FIELD_IN_REPLY_TO) {
+				if ((field=dc_mimeparser_get_header(mime_parser, DC_HEADER_IN_REPLY_TO))!=NULL && field->fld_type==MAILIMF_FIELD_IN_REPLY_TO) {
 					struct mailimf_in_reply_to* fld_in_reply_to = field->fld_data.fld_in_reply_to;
 					if (fld_in_reply_to) {
 						grpid = dc_extract_grpid_from_rfc724_mid_list(fld_in_reply_to->mid_list);
@@ -730,7 +732,7 @@ static void create_or_lookup_group(dc_context_t* context, dc_mimeparser_t* mime_
 
 				if (grpid==NULL)
 				{
-					if ((field=dc_mimeparser_lookup_field(mime_parser, "References"))!=NULL && field->fld_type==MAILIMF_FIELD_REFERENCES) {
+					if ((field=dc_mimeparser_get_header(mime_parser, DC_HEADER_REFERENCES))!=NULL && field->fld_type==MAILIMF_FIELD_REFERENCES) {
 						struct mailimf_references* fld_references = field->fld_data.fld_references;
 						if (fld_references) {
 							grpid = dc_extract_grpid_from_rfc724_mid_list(fld_references->mid_list);
@@ -746,23 +748,23 @@ static void create_or_lookup_group(dc_context_t* context, dc_mimeparser_t* mime_
 			}
 		}
 
-		if ((optional_field=dc_mimeparser_lookup_optional_field2(mime_parser, "Chat-Group-Name", "X-MrGrpName"))!=NULL) {
+		if ((optional_field=dc_mimeparser_get_optional_header2(mime_parser, DC_HEADER_CHAT_GROUP_NAME, DC_HEADER_X_MRGRPNAME))!=NULL) {
 			grpname = dc_decode_header_words(optional_field->fld_value); /* this is no changed groupname message */
 		}
 
-		if ((optional_field=dc_mimeparser_lookup_optional_field2(mime_parser, "Chat-Group-Member-Removed", "X-MrRemoveFromGrp"))!=NULL) {
+		if ((optional_field=dc_mimeparser_get_optional_header2(mime_parser, DC_HEADER_CHAT_GROUP_MEMBER_REMOVED, DC_HEADER_X_MRREMOVEFROMGRP))!=NULL) {
 			X_MrRemoveFromGrp = optional_field->fld_value;
 			mime_parser->is_system_message = DC_CMD_MEMBER_REMOVED_FROM_GROUP;
 		}
-		else if ((optional_field=dc_mimeparser_lookup_optional_field2(mime_parser, "Chat-Group-Member-Added", "X-MrAddToGrp"))!=NULL) {
+		else if ((optional_field=dc_mimeparser_get_optional_header2(mime_parser, DC_HEADER_CHAT_GROUP_MEMBER_ADDED, DC_HEADER_X_MRADDTOGRP))!=NULL) {
 			X_MrAddToGrp = optional_field->fld_value;
 			mime_parser->is_system_message = DC_CMD_MEMBER_ADDED_TO_GROUP;
 		}
-		else if ((optional_field=dc_mimeparser_lookup_optional_field2(mime_parser, "Chat-Group-Name-Changed", "X-MrGrpNameChanged"))!=NULL) {
+		else if ((optional_field=dc_mimeparser_get_optional_header2(mime_parser, DC_HEADER_CHAT_GROUP_NAME_CHANGED, DC_HEADER_X_MRGRPNAMECHANGED))!=NULL) {
 			X_MrGrpNameChanged = 1;
 			mime_parser->is_system_message = DC_CMD_GROUPNAME_CHANGED;
 		}
-		else if ((optional_field=dc_mimeparser_lookup_optional_field(mime_parser, "Chat-Group-Image"))!=NULL) {
+		else if ((optional_field=dc_mimeparser_get_optional_header(mime_parser, DC_HEADER_CHAT_GROUP_IMAGE))!=NULL) {
 			X_MrGrpImageChanged = 1;
 			mime_parser->is_system_message = DC_CMD_GROUPIMAGE_CHANGED;
 		}
@@ -803,7 +805,7 @@ static void create_or_lookup_group(dc_context_t* context, dc_mimeparser_t* mime_
 	)
 	{
 		int create_verified = 0;
-		if (dc_mimeparser_lookup_field(mime_parser, "Chat-Verified")) {
+		if (dc_mimeparser_get_header(mime_parser, DC_HEADER_CHAT_VERIFIED)) {
 			if (check_verified_properties(context, mime_parser, from_id, to_ids)) {
 				create_verified = 1;
 			}
@@ -839,6 +841,7 @@ static void create_or_lookup_group(dc_context_t* context, dc_mimeparser_t* mime_
 		sqlite3_bind_int (stmt, 2, chat_id);
 		sqlite3_step(stmt);
 		sqlite3_finalize(stmt);
+		dc_changelog_add(context->changelog, DC_CHANGE_CHAT, chat_id);
 		context->cb(context, DC_EVENT_CHAT_MODIFIED, chat_id, 0);
 	}
 
@@ -908,6 +911,7 @@ static void create_or_lookup_group(dc_context_t* context, dc_mimeparser_t* mime_
 	}
 
 	if (send_EVENT_CHAT_MODIFIED) {
+		dc_changelog_add(context->changelog, DC_CHANGE_CHAT, chat_id);
 		context->cb(context, DC_EVENT_CHAT_MODIFIED, chat_id, 0);
 	}
 
@@ -936,10 +940,61 @@ cleanup:
  ******************************************************************************/
 
 
+/**
+ * Parse and decrypt a message without adding it to the database.
+ * This is the expensive part of receiving a message and it does not depend on
+ * other messages, so dc_imap_t calls this function from several worker threads
+ * while the next messages are downloaded.
+ * The returned parser must be handed over to dc_receive_imf_parsed() together with
+ * the same raw data, which must be kept valid until then.
+ *
+ * @private @memberof dc_context_t
+ */
+dc_mimeparser_t* dc_receive_imf_parse(dc_context_t* context, const char* imf_raw_not_terminated, size_t imf_raw_bytes)
+{
+	dc_mimeparser_t* mime_parser = NULL;
+
+	if (context==NULL || context->magic!=DC_CONTEXT_MAGIC || imf_raw_not_terminated==NULL) {
+		return NULL;
+	}
+
+	/* parse the imf to mailimf_message {
+	        mailimf_fields* msg_fields {
+	          clist* fld_list; // list of mailimf_field
+	        }
+	        mailimf_body* msg_body { //!=NULL
+                const char * bd_text; //!=NULL
+                size_t bd_size;
+	        }
+	   };
+	normally, this is done by mailimf_message_parse(), however, as we also need the MIME data,
+	we use mailmime_parse() through dc_mimeparser (both call mailimf_struct_multiple_parse() somewhen, I did not found out anything
+	that speaks against this approach yet) */
+	mime_parser = dc_mimeparser_new_pooled(context);
+	dc_mimeparser_parse(mime_parser, imf_raw_not_terminated, imf_raw_bytes);
+
+	return mime_parser;
+}
+
+
 void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, size_t imf_raw_bytes,
                            const char* server_folder, uint32_t server_uid, uint32_t flags)
 {
-	/* the function returns the number of created messages in the database */
+	dc_receive_imf_parsed(context, NULL, imf_raw_not_terminated, imf_raw_bytes, server_folder, server_uid, flags);
+}
+
+
+/**
+ * Add a message parsed by dc_receive_imf_parse() to the database.
+ * Messages must be added one after another in the order they were received,
+ * this is typically done by the IMAP-thread only.
+ * If NULL is given as the parser, the message is parsed here.
+ *
+ * @private @memberof dc_context_t
+ */
+void dc_receive_imf_parsed(dc_context_t* context, dc_mimeparser_t* mime_parser, const char* imf_raw_not_terminated, size_t imf_raw_bytes,
+                           const char* server_folder, uint32_t server_uid, uint32_t flags)
+{
 	int              incoming = 1;
 	int              incoming_origin = 0;
 	#define          outgoing (!incoming)
@@ -964,7 +1019,6 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 	time_t           sort_timestamp = DC_INVALID_TIMESTAMP;
 	time_t           sent_timestamp = DC_INVALID_TIMESTAMP;
 	time_t           rcvd_timestamp = DC_INVALID_TIMESTAMP;
-	dc_mimeparser_t* mime_parser = dc_mimeparser_new(context->blobdir, context);
 	int              transaction_pending = 0;
 	const struct mailimf_field* field;
 
@@ -973,30 +1027,23 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 
 	carray*          rr_event_to_send = carray_new(16);
 
-	char*            txt_raw = NULL;
+	char*            txt_raw = NULL; /* allocated from the parser's arena, must not be free()'d */
+	char*            txt_summary = NULL;
 
 	dc_log_info(context, 0, "Receiving message %s/%lu...", server_folder? server_folder:"?", server_uid);
 
+	if (mime_parser==NULL) {
+		mime_parser = dc_receive_imf_parse(context, imf_raw_not_terminated, imf_raw_bytes);
+	}
+
 	to_ids = dc_array_new(context, 16);
 	if (to_ids==NULL || created_db_entries==NULL || rr_event_to_send==NULL || mime_parser==NULL) {
 		dc_log_info(context, 0, "Bad param.");
 		goto cleanup;
 	}
 
-	/* parse the imf to mailimf_message {
-	        mailimf_fields* msg_fields {
-	          clist* fld_list; // list of mailimf_field
-	        }
-	        mailimf_body* msg_body { //!=NULL
-                const char * bd_text; //!=NULL
-                size_t bd_size;
-	        }
-	   };
-	normally, this is done by mailimf_message_parse(), however, as we also need the MIME data,
-	we use mailmime_parse() through dc_mimeparser (both call mailimf_struct_multiple_parse() somewhen, I did not found out anything
-	that speaks against this approach yet) */
-	dc_mimeparser_parse(mime_parser, imf_raw_not_terminated, imf_raw_bytes);
-	if (dc_hash_cnt(&mime_parser->header)==0) {
+	if ((mime_parser->header_root==NULL || clist_count(mime_parser->header_root->fld_list)==0)
+	 && (mime_parser->header_protected==NULL || clist_count(mime_parser->header_protected->fld_list)==0)) {
 		dc_log_info(context, 0, "No header.");
 		goto cleanup; /* Error - even adding an empty record won't help as we do not know the message ID */
 	}
@@ -1006,12 +1053,12 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 	as it may even be confusing when _own_ messages sent from other devices with other e-mail-adresses appear as being sent from SELF
 	we disabled this check for now */
 	#if 0
-	if (!dc_mimeparser_lookup_field(mime_parser, "Return-Path")) {
+	if (!dc_mimeparser_get_header(mime_parser, DC_HEADER_RETURN_PATH)) {
 		incoming = 0;
 	}
 	#endif
 
-	if ((field=dc_mimeparser_lookup_field(mime_parser, "Date"))!=NULL && field->fld_type==MAILIMF_FIELD_ORIG_DATE) {
+	if ((field=dc_mimeparser_get_header(mime_parser, DC_HEADER_DATE))!=NULL && field->fld_type==MAILIMF_FIELD_ORIG_DATE) {
 		struct mailimf_orig_date* orig_date = field->fld_data.fld_orig_date;
 		if (orig_date) {
 			sent_timestamp = dc_timestamp_from_date(orig_date->dt_date_time); // is not yet checked against bad times! we do this later if we have the database information.
@@ -1023,7 +1070,7 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 
 		/* get From: and check if it is known (for known From:'s we add the other To:/Cc: in the 3rd pass)
 		or if From: is equal to SELF (in this case, it is any outgoing messages, we do not check Return-Path any more as this is unreliable, see issue #150 */
-		if ((field=dc_mimeparser_lookup_field(mime_parser, "From"))!=NULL
+		if ((field=dc_mimeparser_get_header(mime_parser, DC_HEADER_FROM))!=NULL
 		 && field->fld_type==MAILIMF_FIELD_FROM)
 		{
 			struct mailimf_from* fld_from = field->fld_data.fld_from;
@@ -1054,7 +1101,7 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 		}
 
 		/* Make sure, to_ids starts with the first To:-address (Cc: is added in the loop below pass) */
-		if ((field=dc_mimeparser_lookup_field(mime_parser, "To"))!=NULL
+		if ((field=dc_mimeparser_get_header(mime_parser, DC_HEADER_TO))!=NULL
 		 && field->fld_type==MAILIMF_FIELD_TO)
 		{
 			struct mailimf_to* fld_to = field->fld_data.fld_to; /* can be NULL */
@@ -1075,7 +1122,7 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 			/* collect the rest information, CC: is added to the to-list, BCC: is ignored
 			(we should not add BCC to groups as this would split groups. We could add them as "known contacts",
 			however, the benefit is very small and this may leak data that is expected to be hidden) */
-			if ((field=dc_mimeparser_lookup_field(mime_parser, "Cc"))!=NULL && field->fld_type==MAILIMF_FIELD_CC)
+			if ((field=dc_mimeparser_get_header(mime_parser, DC_HEADER_CC))!=NULL && field->fld_type==MAILIMF_FIELD_CC)
 			{
 				struct mailimf_cc* fld_cc = field->fld_data.fld_cc;
 				if (fld_cc) {
@@ -1087,7 +1134,7 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 			/* get Message-ID; if the header is lacking one, generate one based on fields that do never change.
 			(missing Message-IDs may come if the mail was set from this account with another client that relies in the SMTP server to generate one.
 			true eg. for the Webmailer used in all-inkl-KAS) */
-			if ((field=dc_mimeparser_lookup_field(mime_parser, "Message-ID"))!=NULL && field->fld_type==MAILIMF_FIELD_MESSAGE_ID) {
+			if ((field=dc_mimeparser_get_header(mime_parser, DC_HEADER_MESSAGE_ID))!=NULL && field->fld_type==MAILIMF_FIELD_MESSAGE_ID) {
 				struct mailimf_message_id* fld_message_id = field->fld_data.fld_message_id;
 				if (fld_message_id) {
 					rfc724_mid = dc_strdup(fld_message_id->mid_value);
@@ -1130,7 +1177,7 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 
 				// handshake messages must be processed before chats are created (eg. contacs may be marked as verified)
 				assert( chat_id==0);
-				if (dc_mimeparser_lookup_field(mime_parser, "Secure-Join")) {
+				if (dc_mimeparser_get_header(mime_parser, DC_HEADER_SECURE_JOIN)) {
 					dc_sqlite3_commit(context->sql);
 						int handshake = dc_handle_securejoin_handshake(context, mime_parser, from_id);
 						if (handshake & DC_HANDSHAKE_STOP_NORMAL_PROCESSING) {
@@ -1281,8 +1328,8 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 			into only one message; mails sent by other clients may result in several messages (eg. one per attachment)) */
 			icnt = carray_count(mime_parser->parts); /* should be at least one - maybe empty - part */
 			stmt = dc_sqlite3_prepare(context->sql,
-				"INSERT INTO msgs (rfc724_mid,server_folder,server_uid,chat_id,from_id, to_id,timestamp,timestamp_sent,timestamp_rcvd,type, state,msgrmsg,txt,txt_raw,param, bytes,hidden)"
-				" VALUES (?,?,?,?,?, ?,?,?,?,?, ?,?,?,?,?, ?,?);");
+				"INSERT INTO msgs (rfc724_mid,server_folder,server_uid,chat_id,from_id, to_id,timestamp,timestamp_sent,timestamp_rcvd,type, state,msgrmsg,txt,txt_raw,param, bytes,hidden,txt_summary)"
+				" VALUES (?,?,?,?,?, ?,?,?,?,?, ?,?,?,?,?, ?,?,?);");
 			for (i = 0; i < icnt; i++)
 			{
 				dc_mimepart_t* part = (dc_mimepart_t*)carray_get(mime_parser->parts, i);
@@ -1291,13 +1338,16 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 				}
 
 				if (part->type==DC_MSG_TEXT) {
-					txt_raw = dc_mprintf("%s\n\n%s", mime_parser->subject? mime_parser->subject : "", part->msg_raw);
+					txt_raw = dc_arena_mprintf(mime_parser->arena, "%s\n\n%.*s", mime_parser->subject? mime_parser->subject : "", (int)part->msg_raw_bytes, part->msg_raw);
 				}
 
 				if (mime_parser->is_system_message) {
 					dc_param_set_int(part->param, DC_PARAM_CMD, mime_parser->is_system_message);
 				}
 
+				free(txt_summary);
+				txt_summary = dc_msg_get_summarytext_to_store(part->type, part->msg);
+
 				sqlite3_reset(stmt);
 				sqlite3_bind_text (stmt,  1, rfc724_mid, -1, SQLITE_STATIC);
 				sqlite3_bind_text (stmt,  2, server_folder, -1, SQLITE_STATIC);
@@ -1316,12 +1366,12 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 				sqlite3_bind_text (stmt, 15, part->param->packed, -1, SQLITE_STATIC);
 				sqlite3_bind_int  (stmt, 16, part->bytes);
 				sqlite3_bind_int  (stmt, 17, hidden);
+				sqlite3_bind_text (stmt, 18, txt_summary, -1, SQLITE_STATIC);
 				if (sqlite3_step(stmt)!=SQLITE_DONE) {
 					dc_log_info(context, 0, "Cannot write DB.");
 					goto cleanup; /* i/o error - there is nothing more we can do - in other cases, we try to write at least an empty record */
 				}
 
-				free(txt_raw);
 				txt_raw = NULL;
 
 				if (first_dblocal_id==0) {
@@ -1334,6 +1384,18 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 
 			dc_log_info(context, 0, "Message has %i parts and is assigned to chat #%i.", icnt, chat_id);
 
+			if (chat_id!=DC_CHAT_ID_TRASH && first_dblocal_id) {
+				sqlite3_finalize(stmt);
+				stmt = dc_sqlite3_prepare(context->sql,
+					"SELECT id FROM msgs WHERE rfc724_mid=? AND id>=?;"); /* all parts added above */
+				sqlite3_bind_text(stmt, 1, rfc724_mid, -1, SQLITE_STATIC);
+				sqlite3_bind_int (stmt, 2, first_dblocal_id);
+				while (sqlite3_step(stmt)==SQLITE_ROW) {
+					dc_changelog_add(context->changelog, DC_CHANGE_MSG_INSERTED, sqlite3_column_int(stmt, 0));
+				}
+				dc_changelog_add(context->changelog, DC_CHANGE_CHAT, chat_id);
+			}
+
 			/* check event to send */
 			if (chat_id==DC_CHAT_ID_TRASH)
 			{
@@ -1475,8 +1537,9 @@ void dc_receive_imf(dc_context_t* context, const char* imf_raw_not_terminated, s
 cleanup:
 	if (transaction_pending) { dc_sqlite3_rollback(context->sql); }
 
-	dc_mimeparser_unref(mime_parser);
+	dc_mimeparser_release(mime_parser); /* keep the parser for the next message */
 	free(rfc724_mid);
+	free(txt_summary);
 	dc_array_unref(to_ids);
 
 	if (created_db_entries) {
@@ -1497,6 +1560,5 @@ cleanup:
 		carray_free(rr_event_to_send);
 	}
 
-	free(txt_raw);
 	sqlite3_finalize(stmt);
 }
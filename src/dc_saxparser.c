@@ -298,10 +298,17 @@ const char* dc_attr_find(char** attr, const char* key)
 
 void dc_saxparser_init(dc_saxparser_t* saxparser, void* userdata)
 {
-	saxparser->userdata    = userdata;
-	saxparser->starttag_cb = def_starttag_cb;
-	saxparser->endtag_cb   = def_endtag_cb;
-	saxparser->text_cb     = def_text_cb;
+	saxparser->userdata          = userdata;
+	saxparser->starttag_cb       = def_starttag_cb;
+	saxparser->endtag_cb         = def_endtag_cb;
+	saxparser->text_cb           = def_text_cb;
+	saxparser->pending           = NULL;
+	saxparser->pending_bytes     = 0;
+	saxparser->pending_allocated = 0;
+	saxparser->pending_scanned   = 0;
+	saxparser->pending_needs     = 0;
+	saxparser->stopped           = 0;
+	saxparser->ended             = 0;
 }
 
 
@@ -326,31 +333,120 @@ void dc_saxparser_set_text_handler (dc_saxparser_t* saxparser, dc_saxparser_text
 }
 
 
-void dc_saxparser_parse(dc_saxparser_t* saxparser, const char* buf_start__)
+/*******************************************************************************
+ * Parsing
+ ******************************************************************************/
+
+
+static int is_markup_complete(const char* p, char* ret_needs)
 {
-	char  bak = 0;
-	char* buf_start = NULL;
-	char* last_text_start = NULL;
-	char* p = NULL;
+	/* check if the comment, CDATA section, doctype, processing instruction or
+	tag starting at the `<` at p is completely contained in the buffer;
+	if not, ret_needs is set to the character that must follow before the check
+	can succeed - this is the closing quote of an attribute value or the `>`
+	all other markup ends with */
+	*ret_needs = '>';
+	p++;
+	if (strncmp(p, "!--", 3)==0) {
+		return strstr(p, "-->")!=NULL;
+	}
+	else if (strncmp(p, "![CDATA[", 8)==0) {
+		return strstr(p, "]]>")!=NULL;
+	}
+	else if (strncmp(p, "!DOCTYPE", 8)==0) {
+		p += strcspn(p, "[>");
+		if (*p=='[') {
+			return strstr(p, "]>")!=NULL;
+		}
+		return *p=='>';
+	}
+	else if (*p=='?') {
+		return strstr(p, "?>")!=NULL;
+	}
+
+	/* start-tag or end-tag; this follows the scanning done by parse_buf() as
+	eg. a `>` inside a quoted attribute value does not end the tag */
+	p += strspn(p, XML_WS);
+	if (*p!='/')
+	{
+		const char* beg_tag_name = p;
+		p += strcspn(p, XML_WS "/>");
+		if (p != beg_tag_name)
+		{
+			while (isspace(*p)) { p++; }
+			while (*p && *p!='/' && *p!='>')
+			{
+				const char* beg_attr_name = p;
+				if ('='==*beg_attr_name) {
+					p++;
+					continue;
+				}
+
+				p += strcspn(p, XML_WS "=/>");
+				if (p != beg_attr_name)
+				{
+					p += strspn(p, XML_WS);
+					if (*p=='=')
+					{
+						p += strspn(p, XML_WS "=");
+						char quote = *p;
+						if (quote=='"' || quote=='\'')
+						{
+							p++;
+							while (*p && *p != quote) { p++; }
+							if (*p==0) {
+								*ret_needs = quote;
+								return 0; /* unclosed attribute value */
+							}
+							p++;
+						}
+						else
+						{
+							p += strcspn(p, XML_WS "/>");
+						}
+					}
+				}
+
+				while (isspace(*p)) { p++; }
+			}
+		}
+	}
+
+	return strchr(p, '>')!=NULL;
+}
 
+
+static size_t parse_buf(dc_saxparser_t* saxparser, char* buf_start, int is_last)
+{
+	/* parses the null-terminated, writable buffer and returns the number of
+	bytes consumed; if is_last is not set, incomplete markup and text that may
+	be continued are not consumed and should be passed again together with
+	the next data */
+	char   bak = 0;
+	char*  last_text_start = NULL;
+	char*  p = NULL;
+	size_t consumed = (size_t)-1; /* set on success, otherwise, the markup is unclosed */
+
+	#define MAX_ENTITY_BYTES 32 /* longer entities are not decoded anyway, so the text can be passed on */
 	#define MAX_ATTR 100 /* attributes per tag - a fixed border here is a security feature, not a limit */
 	char*   attr[(MAX_ATTR+1)*2]; /* attributes as key/value pairs, +1 for terminating the list */
 	int     free_attr[MAX_ATTR]; /* free the value at attr[i*2+1]? */
 
 	attr[0] = NULL; /* null-terminate list, this also terminates "free_values" */
 
-	if (saxparser==NULL) {
-		return;
-	}
-
-	buf_start = dc_strdup(buf_start__); /* we make a copy as we can easily null-terminate tag names and attributes "in place" */
 	last_text_start = buf_start;
 	p               = buf_start;
-	while (*p)
+	while (*p && !saxparser->stopped)
 	{
 		if (*p=='<')
 		{
 			call_text_cb(saxparser, last_text_start, p - last_text_start, '&'); /* flush pending text */
+			last_text_start = p;
+
+			if (!is_last && !is_markup_complete(p, &saxparser->pending_needs)) {
+				consumed = p - buf_start;
+				goto cleanup; /* wait for more data */
+			}
 
 			p++;
 			if (strncmp(p, "!--", 3)==0)
@@ -556,10 +652,159 @@ void dc_saxparser_parse(dc_saxparser_t* saxparser, const char* buf_start__)
 		}
 	}
 
-	call_text_cb(saxparser, last_text_start, p - last_text_start, '&'); /* flush pending text */
+	saxparser->pending_needs = 0;
+
+	if (!is_last)
+	{
+		/* pass on the text read so far, so that it need not to be scanned again and
+		dc_saxparser_stop() can be called by the text callback; only an entity or a
+		`\r\n` that may be continued by the next data is kept */
+		char* keep = p;
+		if (keep > last_text_start && keep[-1]=='\r') {
+			keep--;
+		}
+		for (char* amp = keep-1; amp >= last_text_start && p-amp <= MAX_ENTITY_BYTES && *amp!=';'; amp--) {
+			if (*amp=='&') {
+				keep = amp;
+				break;
+			}
+		}
+		p = keep;
+	}
+
+	if (!saxparser->stopped) {
+		call_text_cb(saxparser, last_text_start, p - last_text_start, '&'); /* flush pending text */
+	}
+
+	consumed = p - buf_start;
 
 cleanup:
+	if (consumed==(size_t)-1) {
+		saxparser->stopped = 1; /* unclosed markup swallows everything up to the end */
+		consumed = 0;
+	}
 	do_free_attr(attr, free_attr);
-	free(buf_start);
+	return consumed;
+}
+
+
+static void add_pending(dc_saxparser_t* saxparser, const char* chunk, size_t chunk_bytes)
+{
+	const char* nullbyte = NULL;
+
+	if ((nullbyte=memchr(chunk, 0, chunk_bytes))!=NULL) {
+		chunk_bytes = nullbyte - chunk;
+		saxparser->ended = 1; /* ignore everything after the null-byte as dc_saxparser_parse() does */
+	}
+
+	if (saxparser->pending_bytes + chunk_bytes + 1 > saxparser->pending_allocated) {
+		saxparser->pending_allocated = (saxparser->pending_bytes + chunk_bytes + 1) * 2; /* unclosed markup may grow over several chunks */
+		if ((saxparser->pending=realloc(saxparser->pending, saxparser->pending_allocated))==NULL) {
+			exit(55);
+		}
+	}
+
+	memcpy(saxparser->pending + saxparser->pending_bytes, chunk, chunk_bytes); /* we use a copy as we can easily null-terminate tag names and attributes "in place" */
+	saxparser->pending_bytes += chunk_bytes;
+	saxparser->pending[saxparser->pending_bytes] = 0;
+}
+
+
+/**
+ * Parse the next chunk of a document.  Markup that is not complete is
+ * buffered and parsed together with the next chunk, so the tags do not
+ * depend on how the document is split.  Text is passed on as soon as
+ * possible, so a text may be passed to the text callback in several parts.
+ * When all chunks are passed, dc_saxparser_finish() must be called.
+ *
+ * @private @memberof dc_saxparser_t
+ * @param saxparser The parser object.
+ * @param chunk The data, need not to be null-terminated.  Parsing ends at the first null-byte.
+ * @param chunk_bytes The number of bytes in chunk.
+ * @return None.
+ */
+void dc_saxparser_feed(dc_saxparser_t* saxparser, const char* chunk, size_t chunk_bytes)
+{
+	size_t consumed = 0;
+
+	if (saxparser==NULL || saxparser->stopped || saxparser->ended || chunk==NULL) {
+		return;
+	}
+
+	add_pending(saxparser, chunk, chunk_bytes);
+
+	/* unclosed markup cannot be completed before the character it needs arrives,
+	so do not scan it again for every chunk (a stray `<` would make this quadratic) */
+	if (saxparser->pending_needs
+	 && memchr(saxparser->pending + saxparser->pending_scanned, saxparser->pending_needs, saxparser->pending_bytes - saxparser->pending_scanned)==NULL) {
+		saxparser->pending_scanned = saxparser->pending_bytes;
+		return;
+	}
+
+	consumed = parse_buf(saxparser, saxparser->pending, 0);
+	if (consumed > 0) {
+		saxparser->pending_bytes -= consumed;
+		memmove(saxparser->pending, saxparser->pending + consumed, saxparser->pending_bytes + 1);
+	}
+	saxparser->pending_scanned = saxparser->pending_bytes;
+}
+
+
+/**
+ * Parse the data left over from dc_saxparser_feed() and free the buffers.
+ * Unclosed markup is handled the same way as by dc_saxparser_parse().
+ *
+ * @private @memberof dc_saxparser_t
+ * @param saxparser The parser object.
+ * @return None.
+ */
+void dc_saxparser_finish(dc_saxparser_t* saxparser)
+{
+	if (saxparser==NULL) {
+		return;
+	}
+
+	if (saxparser->pending && !saxparser->stopped) {
+		parse_buf(saxparser, saxparser->pending, 1);
+	}
+
+	free(saxparser->pending);
+	saxparser->pending           = NULL;
+	saxparser->pending_bytes     = 0;
+	saxparser->pending_allocated = 0;
+	saxparser->pending_scanned   = 0;
+	saxparser->pending_needs     = 0;
+	saxparser->stopped           = 0;
+	saxparser->ended             = 0;
+}
+
+
+/**
+ * Stop parsing; to be called from within a callback, eg. when the caller
+ * has got all the data it needs.  No more callbacks are issued after the
+ * current one returns, dc_saxparser_finish() must still be called.
+ *
+ * @private @memberof dc_saxparser_t
+ * @param saxparser The parser object.
+ * @return None.
+ */
+void dc_saxparser_stop(dc_saxparser_t* saxparser)
+{
+	if (saxparser==NULL) {
+		return;
+	}
+
+	saxparser->stopped = 1;
+}
+
+
+void dc_saxparser_parse(dc_saxparser_t* saxparser, const char* text)
+{
+	if (saxparser==NULL || text==NULL) {
+		return;
+	}
+
+	add_pending(saxparser, text, strlen(text)); /* parsed at once by dc_saxparser_finish(), so texts are not split */
+	dc_saxparser_finish(saxparser);
 }
 
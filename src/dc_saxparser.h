@@ -38,6 +38,14 @@ typedef struct dc_saxparser_t
 	dc_saxparser_endtag_cb_t   endtag_cb;
 	dc_saxparser_text_cb_t     text_cb;
 	void*                      userdata;
+
+	char*                      pending; /* data not yet parsed by dc_saxparser_feed() */
+	size_t                     pending_bytes;
+	size_t                     pending_allocated;
+	size_t                     pending_scanned; /* bytes of an unclosed markup at the start of pending that were already checked */
+	char                       pending_needs;   /* the character the unclosed markup needs to be completed, 0 if there is no unclosed markup */
+	int                        stopped;
+	int                        ended;
 } dc_saxparser_t;
 
 
@@ -46,6 +54,9 @@ void           dc_saxparser_set_tag_handler  (dc_saxparser_t*, dc_saxparser_star
 void           dc_saxparser_set_text_handler (dc_saxparser_t*, dc_saxparser_text_cb_t);
 
 void           dc_saxparser_parse            (dc_saxparser_t*, const char* text);
+void           dc_saxparser_feed             (dc_saxparser_t*, const char* chunk, size_t chunk_bytes);
+void           dc_saxparser_finish           (dc_saxparser_t*);
+void           dc_saxparser_stop             (dc_saxparser_t*);
 
 const char*    dc_attr_find                  (char** attr, const char* key);
 
@@ -0,0 +1,598 @@
+/*******************************************************************************
+ *
+ *                              Delta Chat Core
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ ******************************************************************************/
+
+
+
+
+/* Run many accounts on a few threads.
+
+Without a scheduler, every context needs an IMAP-thread and an SMTP-thread
+that block most time in dc_perform_imap_idle() or dc_perform_smtp_idle().
+The scheduler uses a fixed number of workers instead; each account has an
+IMAP-task and an SMTP-task that are queued when they get due or when they are
+interrupted, eg. by dc_interrupt_smtp_idle() when a message is sent.
+
+A worker takes the first task from the queue and performs one step of it:
+jobs, fetch and starting IDLE for IMAP, jobs for SMTP.  As tasks are appended
+to the queue, a busy account cannot starve the others.  The number of IMAP-steps
+that may run at the same time is limited by the budget, so that parsing,
+decrypting and database writes leave some workers for sending.
+
+While IMAP-tasks are in IDLE, a single dispatcher thread waits for their
+sockets using poll() and queues the tasks that got data. */
+
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include "dc_context.h"
+#include "dc_job.h"
+#include "dc_imap.h"
+#include "dc_scheduler.h"
+
+
+#define DC_SCHEDULER_MAGIC 0x5c4ed017
+
+
+static double now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (double)ts.tv_sec*1000.0 + (double)ts.tv_nsec/1000000.0;
+}
+
+
+static dc_schedaccount_t* find_account(dc_scheduler_t* scheduler, const dc_context_t* context, int* ret_index)
+{
+	int i, cnt = carray_count(scheduler->accounts);
+	for (i = 0; i < cnt; i++) {
+		dc_schedaccount_t* account = (dc_schedaccount_t*)carray_get(scheduler->accounts, i);
+		if (account->context==context) {
+			if (ret_index) {
+				*ret_index = i;
+			}
+			return account;
+		}
+	}
+	return NULL;
+}
+
+
+static void enqueue(dc_scheduler_t* scheduler, dc_schedtask_t* task)
+{
+	task->state       = DC_SCHEDTASK_QUEUED;
+	task->interrupted = 0;
+	task->queued_ms   = now_ms();
+	task->next        = NULL;
+	if (scheduler->queue_last) {
+		scheduler->queue_last->next = task;
+	}
+	else {
+		scheduler->queue_first = task;
+	}
+	scheduler->queue_last = task;
+}
+
+
+static void unqueue(dc_scheduler_t* scheduler, dc_schedtask_t* task)
+{
+	dc_schedtask_t* prev = NULL;
+	dc_schedtask_t* cur = scheduler->queue_first;
+	while (cur && cur!=task) {
+		prev = cur;
+		cur = cur->next;
+	}
+
+	if (cur==NULL) {
+		return;
+	}
+
+	if (prev) {
+		prev->next = task->next;
+	}
+	else {
+		scheduler->queue_first = task->next;
+	}
+
+	if (scheduler->queue_last==task) {
+		scheduler->queue_last = prev;
+	}
+	task->next = NULL;
+}
+
+
+/* queue all due tasks and return the time the next waiting task gets due */
+static time_t enqueue_due_tasks(dc_scheduler_t* scheduler, time_t now)
+{
+	time_t next_wakeup = now + DC_IDLE_RETRY_SECONDS;
+	int    i, t, cnt = carray_count(scheduler->accounts);
+
+	for (i = 0; i < cnt; i++) {
+		dc_schedaccount_t* account = (dc_schedaccount_t*)carray_get(scheduler->accounts, i);
+		for (t = 0; t <= 1; t++) {
+			dc_schedtask_t* task = t==0? &account->imap : &account->smtp;
+			if (task->state==DC_SCHEDTASK_WAITING) {
+				if (task->interrupted || task->wakeup_at <= now) {
+					enqueue(scheduler, task);
+				}
+				else if (task->wakeup_at < next_wakeup) {
+					next_wakeup = task->wakeup_at;
+				}
+			}
+		}
+	}
+
+	return next_wakeup;
+}
+
+
+/* take the first task from the queue; IMAP-tasks are skipped if the budget is used up */
+static dc_schedtask_t* dequeue(dc_scheduler_t* scheduler)
+{
+	dc_schedtask_t* task = scheduler->queue_first;
+	while (task) {
+		if (task->thread!=DC_IMAP_THREAD || scheduler->budget_used < scheduler->budget) {
+			unqueue(scheduler, task);
+			return task;
+		}
+		task = task->next;
+	}
+	return NULL;
+}
+
+
+static void wakeup_dispatcher(dc_scheduler_t* scheduler)
+{
+	if (write(scheduler->wakeup_fd[1], "w", 1) < 0) {
+		; /* the pipe is full, the dispatcher will wake up anyway */
+	}
+}
+
+
+/* performs one step of a task, must be called without holding the scheduler's mutex.
+returns the time the task should be done again */
+static time_t perform_step(dc_schedtask_t* task, double readable_ms, int* ret_idle_fd)
+{
+	dc_context_t* context = task->account->context;
+	int           jobs_needed = 0;
+	int           timeout = 0;
+
+	*ret_idle_fd = -1;
+
+	if (task->thread==DC_IMAP_THREAD)
+	{
+		dc_imap_idle_readable(context->imap, readable_ms); /* new messages arrived before the task waited in the queue */
+		dc_perform_imap_idle_done(context);
+		dc_perform_imap_jobs(context);
+		dc_perform_imap_fetch(context);
+
+		*ret_idle_fd = dc_perform_imap_idle_start(context, &timeout);
+		return time(NULL) + timeout;
+	}
+	else
+	{
+		// dc_suspend_smtp_thread() waits until the smtp-thread is idle, which is the case as long as no step is running
+		pthread_mutex_lock(&context->smtpidle_condmutex);
+			if (context->smtpidle_suspend) {
+				pthread_mutex_unlock(&context->smtpidle_condmutex);
+				return time(NULL) + DC_SMTP_IDLE_SEC;
+			}
+			context->smtpidle_in_idleing = 0;
+		pthread_mutex_unlock(&context->smtpidle_condmutex);
+
+		dc_perform_smtp_jobs(context);
+
+		pthread_mutex_lock(&context->smtpidle_condmutex);
+			context->smtpidle_in_idleing = 1;
+			jobs_needed = context->perform_smtp_jobs_needed;
+		pthread_mutex_unlock(&context->smtpidle_condmutex);
+
+		return time(NULL) + (jobs_needed==DC_JOBS_NEEDED_AT_ONCE? 0 : dc_job_get_wait_seconds(context, DC_SMTP_THREAD, DC_SMTP_IDLE_SEC));
+	}
+}
+
+
+static void* worker_thread_entry_point(void* entry_arg)
+{
+	dc_scheduler_t* scheduler = (dc_scheduler_t*)entry_arg;
+	dc_schedtask_t* task = NULL;
+	time_t          now = 0, next_wakeup = 0, wakeup_at = 0;
+	int             idle_fd = -1;
+	double          readable_ms = 0;
+	struct timespec ts;
+
+	pthread_mutex_lock(&scheduler->mutex);
+
+		while (!scheduler->shutdown)
+		{
+			now = time(NULL);
+			next_wakeup = enqueue_due_tasks(scheduler, now);
+
+			if ((task=dequeue(scheduler))==NULL) {
+				memset(&ts, 0, sizeof(ts));
+				ts.tv_sec = next_wakeup;
+				pthread_cond_timedwait(&scheduler->cond, &scheduler->mutex, &ts);
+				continue;
+			}
+
+			task->state = DC_SCHEDTASK_RUNNING;
+			readable_ms = task->readable_ms;
+			task->readable_ms = 0;
+			scheduler->steps++;
+			scheduler->queue_ms += now_ms() - task->queued_ms;
+			if (task->thread==DC_IMAP_THREAD) {
+				scheduler->budget_used++;
+			}
+
+			pthread_mutex_unlock(&scheduler->mutex);
+				wakeup_at = perform_step(task, readable_ms, &idle_fd);
+			pthread_mutex_lock(&scheduler->mutex);
+
+			if (task->thread==DC_IMAP_THREAD) {
+				scheduler->budget_used--;
+				wakeup_dispatcher(scheduler);
+			}
+			task->state     = DC_SCHEDTASK_WAITING;
+			task->wakeup_at = wakeup_at;
+			task->idle_fd   = idle_fd;
+			pthread_cond_broadcast(&scheduler->cond); /* wake up dc_scheduler_remove() and workers waiting for the budget */
+		}
+
+	pthread_mutex_unlock(&scheduler->mutex);
+
+	return NULL;
+}
+
+
+static void* dispatcher_thread_entry_point(void* entry_arg)
+{
+	dc_scheduler_t*  scheduler = (dc_scheduler_t*)entry_arg;
+	struct pollfd*   pfds = NULL;
+	dc_schedtask_t** tasks = NULL; /* the task for each entry in pfds, NULL for the wakeup-pipe */
+	int              alloc = 0, cnt = 0, i = 0, woken = 0;
+	uint32_t         gen = 0;
+	char             buf[64];
+
+	pthread_mutex_lock(&scheduler->mutex);
+
+		while (!scheduler->shutdown)
+		{
+			/* collect the sockets of the tasks in IDLE; the interrupt-fd is also readable if data were buffered before IDLE */
+			if (alloc < 1+2*carray_count(scheduler->accounts)) {
+				alloc = 1+2*carray_count(scheduler->accounts)+16;
+				if ((pfds=realloc(pfds, alloc*sizeof(struct pollfd)))==NULL
+				 || (tasks=realloc(tasks, alloc*sizeof(dc_schedtask_t*)))==NULL) {
+					exit(67);
+				}
+			}
+
+			memset(pfds, 0, alloc*sizeof(struct pollfd));
+			pfds[0].fd     = scheduler->wakeup_fd[0];
+			pfds[0].events = POLLIN;
+			tasks[0]       = NULL;
+			cnt = 1;
+			for (i = 0; i < carray_count(scheduler->accounts); i++) {
+				dc_schedaccount_t* account = (dc_schedaccount_t*)carray_get(scheduler->accounts, i);
+				if (account->imap.state==DC_SCHEDTASK_WAITING && account->imap.idle_fd!=-1 && !account->imap.interrupted) {
+					pfds[cnt].fd       = account->imap.idle_fd;
+					pfds[cnt].events   = POLLIN;
+					tasks[cnt++]       = &account->imap;
+					pfds[cnt].fd       = dc_get_imap_interrupt_fd(account->context);
+					pfds[cnt].events   = POLLIN;
+					tasks[cnt++]       = &account->imap;
+				}
+			}
+			gen = scheduler->accounts_gen;
+
+			pthread_mutex_unlock(&scheduler->mutex);
+
+				poll(pfds, cnt, -1);
+				if (pfds[0].revents) {
+					while (read(scheduler->wakeup_fd[0], buf, sizeof(buf)) > 0) {
+						;
+					}
+				}
+
+			pthread_mutex_lock(&scheduler->mutex);
+
+			if (gen!=scheduler->accounts_gen) {
+				continue; /* the tasks may be freed */
+			}
+
+			woken = 0;
+			for (i = 1; i < cnt; i++) {
+				if (pfds[i].revents && tasks[i]->state==DC_SCHEDTASK_WAITING && tasks[i]->idle_fd!=-1) {
+					if (pfds[i].fd==tasks[i]->idle_fd && tasks[i]->readable_ms==0) {
+						tasks[i]->readable_ms = now_ms(); /* the arrival of new messages, the task may wait in the queue for a while */
+					}
+					tasks[i]->interrupted = 1;
+					woken = 1;
+				}
+			}
+
+			if (woken) {
+				pthread_cond_broadcast(&scheduler->cond);
+			}
+		}
+
+	pthread_mutex_unlock(&scheduler->mutex);
+
+	free(pfds);
+	free(tasks);
+	return NULL;
+}
+
+
+/**
+ * Create a scheduler that runs many contexts on a few threads.
+ * This is an alternative to the IMAP- and SMTP-threads each context needs otherwise
+ * and is useful if many accounts are used at the same time.
+ *
+ * Contexts are added using dc_scheduler_add();
+ * dc_perform_imap_jobs(), dc_perform_imap_fetch(), dc_perform_imap_idle(),
+ * dc_perform_smtp_jobs() and dc_perform_smtp_idle() must not be called for these contexts.
+ *
+ * Added contexts wait for new messages using IMAP-IDLE; if this is not possible, they check for new messages every minute.
+ * dc_interrupt_imap_idle() and dc_interrupt_smtp_idle() work as usual.
+ *
+ * @memberof dc_scheduler_t
+ * @param workers The number of threads to create. The threads are created in this function.
+ * @param budget The maximal number of accounts that receive messages at the same time,
+ *     the other workers are left for sending.  0 or a number larger than workers: all workers may receive messages.
+ * @return The scheduler object, must be freed using dc_scheduler_unref().
+ *     NULL on errors.
+ */
+dc_scheduler_t* dc_scheduler_new(int workers, int budget)
+{
+	dc_scheduler_t* scheduler = NULL;
+
+	if (workers<=0) {
+		return NULL;
+	}
+
+	if ((scheduler=calloc(1, sizeof(dc_scheduler_t)))==NULL
+	 || (scheduler->workers=calloc(workers, sizeof(pthread_t)))==NULL
+	 || (scheduler->accounts=carray_new(16))==NULL) {
+		exit(67);
+	}
+
+	scheduler->magic  = DC_SCHEDULER_MAGIC;
+	scheduler->budget = (budget<=0 || budget>workers)? workers : budget;
+	pthread_mutex_init(&scheduler->mutex, NULL);
+	pthread_cond_init(&scheduler->cond, NULL);
+
+	if (pipe(scheduler->wakeup_fd)!=0) {
+		exit(67);
+	}
+	fcntl(scheduler->wakeup_fd[0], F_SETFL, O_NONBLOCK);
+	fcntl(scheduler->wakeup_fd[1], F_SETFL, O_NONBLOCK);
+
+	if (pthread_create(&scheduler->dispatcher, NULL, dispatcher_thread_entry_point, scheduler)!=0) {
+		dc_scheduler_unref(scheduler);
+		return NULL;
+	}
+	scheduler->dispatcher_started = 1;
+
+	for (scheduler->workers_cnt = 0; scheduler->workers_cnt < workers; scheduler->workers_cnt++) {
+		if (pthread_create(&scheduler->workers[scheduler->workers_cnt], NULL, worker_thread_entry_point, scheduler)!=0) {
+			dc_scheduler_unref(scheduler);
+			return NULL;
+		}
+	}
+
+	return scheduler;
+}
+
+
+/**
+ * Free a scheduler object.
+ * The function waits until all workers are done with their current step.
+ * Contexts still added are removed from the scheduler, however, they are not freed.
+ *
+ * @memberof dc_scheduler_t
+ * @param scheduler The scheduler object as created by dc_scheduler_new().
+ * @return None.
+ */
+void dc_scheduler_unref(dc_scheduler_t* scheduler)
+{
+	int i;
+
+	if (scheduler==NULL || scheduler->magic!=DC_SCHEDULER_MAGIC) {
+		return;
+	}
+
+	pthread_mutex_lock(&scheduler->mutex);
+		scheduler->shutdown = 1;
+		pthread_cond_broadcast(&scheduler->cond);
+	pthread_mutex_unlock(&scheduler->mutex);
+
+	for (i = 0; i < scheduler->workers_cnt; i++) {
+		pthread_join(scheduler->workers[i], NULL);
+	}
+
+	if (scheduler->dispatcher_started) {
+		wakeup_dispatcher(scheduler);
+		pthread_join(scheduler->dispatcher, NULL);
+	}
+
+	for (i = 0; i < carray_count(scheduler->accounts); i++) {
+		dc_schedaccount_t* account = (dc_schedaccount_t*)carray_get(scheduler->accounts, i);
+		if (account->imap.idle_fd!=-1) {
+			dc_perform_imap_idle_done(account->context);
+		}
+		account->context->scheduler = NULL;
+		free(account);
+	}
+
+	carray_free(scheduler->accounts);
+	close(scheduler->wakeup_fd[0]);
+	close(scheduler->wakeup_fd[1]);
+	pthread_cond_destroy(&scheduler->cond);
+	pthread_mutex_destroy(&scheduler->mutex);
+	free(scheduler->workers);
+	scheduler->magic = 0;
+	free(scheduler);
+}
+
+
+/**
+ * Add a context to a scheduler.
+ * Jobs are performed and messages are fetched soon after the context is added.
+ *
+ * A context can be added to one scheduler only.
+ * If the context is freed using dc_context_unref(), it is removed from the scheduler before.
+ *
+ * @memberof dc_scheduler_t
+ * @param scheduler The scheduler object as created by dc_scheduler_new().
+ * @param context The context object as created by dc_context_new().
+ * @return 1=context added, 0=error.
+ */
+int dc_scheduler_add(dc_scheduler_t* scheduler, dc_context_t* context)
+{
+	int                success = 0;
+	dc_schedaccount_t* account = NULL;
+
+	if (scheduler==NULL || scheduler->magic!=DC_SCHEDULER_MAGIC
+	 || context==NULL || context->magic!=DC_CONTEXT_MAGIC || context->scheduler) {
+		return 0;
+	}
+
+	if ((account=calloc(1, sizeof(dc_schedaccount_t)))==NULL) {
+		exit(67);
+	}
+	account->context       = context;
+	account->imap.account  = account;
+	account->imap.thread   = DC_IMAP_THREAD;
+	account->imap.idle_fd  = -1;
+	account->smtp.account  = account;
+	account->smtp.thread   = DC_SMTP_THREAD;
+	account->smtp.idle_fd  = -1;
+
+	/* as long as no step is running, the smtp-thread is idle */
+	pthread_mutex_lock(&context->smtpidle_condmutex);
+		context->smtpidle_in_idleing = 1;
+	pthread_mutex_unlock(&context->smtpidle_condmutex);
+
+	pthread_mutex_lock(&scheduler->mutex);
+		if (carray_add(scheduler->accounts, account, NULL)!=0) {
+			exit(67);
+		}
+		context->scheduler = scheduler;
+		pthread_cond_broadcast(&scheduler->cond);
+		success = 1;
+	pthread_mutex_unlock(&scheduler->mutex);
+
+	dc_log_info(context, 0, "Context added to scheduler.");
+
+	return success;
+}
+
+
+/**
+ * Remove a context from a scheduler.
+ * The function waits until steps running for the context are done.
+ * Afterwards, the context can be freed or used with other threads.
+ *
+ * @memberof dc_scheduler_t
+ * @param scheduler The scheduler object as created by dc_scheduler_new().
+ * @param context The context object as given to dc_scheduler_add().
+ * @return None.
+ */
+void dc_scheduler_remove(dc_scheduler_t* scheduler, dc_context_t* context)
+{
+	dc_schedaccount_t* account = NULL;
+	int                index = 0;
+	int                idling = 0;
+
+	if (scheduler==NULL || scheduler->magic!=DC_SCHEDULER_MAGIC || context==NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&scheduler->mutex);
+
+		if ((account=find_account(scheduler, context, &index))!=NULL)
+		{
+			while (account->imap.state==DC_SCHEDTASK_RUNNING || account->smtp.state==DC_SCHEDTASK_RUNNING) {
+				pthread_cond_wait(&scheduler->cond, &scheduler->mutex);
+			}
+
+			unqueue(scheduler, &account->imap);
+			unqueue(scheduler, &account->smtp);
+			carray_delete_slow(scheduler->accounts, index); /* keep the order, this is also the order of the due tasks */
+			scheduler->accounts_gen++;
+			wakeup_dispatcher(scheduler);
+			idling = (account->imap.idle_fd!=-1);
+			context->scheduler = NULL;
+			free(account);
+		}
+
+	pthread_mutex_unlock(&scheduler->mutex);
+
+	if (idling) {
+		dc_perform_imap_idle_done(context); /* the context may be used by other threads now */
+	}
+}
+
+
+/**
+ * Get information about the scheduler.
+ *
+ * @memberof dc_scheduler_t
+ * @param scheduler The scheduler object as created by dc_scheduler_new().
+ * @return String which must be free()'d after usage.  Never returns NULL.
+ */
+char* dc_scheduler_get_info(dc_scheduler_t* scheduler)
+{
+	char* ret = NULL;
+
+	if (scheduler==NULL || scheduler->magic!=DC_SCHEDULER_MAGIC) {
+		return dc_strdup("ErrBadPtr");
+	}
+
+	pthread_mutex_lock(&scheduler->mutex);
+		ret = dc_mprintf("accounts=%i workers=%i budget=%i steps=%llu avg_queue_ms=%.0f",
+			(int)carray_count(scheduler->accounts), scheduler->workers_cnt, scheduler->budget,
+			(unsigned long long)scheduler->steps,
+			scheduler->steps? scheduler->queue_ms/(double)scheduler->steps : 0.0);
+	pthread_mutex_unlock(&scheduler->mutex);
+
+	return ret;
+}
+
+
+/* called by dc_interrupt_imap_idle() and dc_interrupt_smtp_idle() */
+void dc_scheduler_interrupt(dc_scheduler_t* scheduler, dc_context_t* context, int thread)
+{
+	dc_schedaccount_t* account = NULL;
+
+	if (scheduler==NULL || scheduler->magic!=DC_SCHEDULER_MAGIC) {
+		return;
+	}
+
+	pthread_mutex_lock(&scheduler->mutex);
+		if ((account=find_account(scheduler, context, NULL))!=NULL) {
+			dc_schedtask_t* task = thread==DC_IMAP_THREAD? &account->imap : &account->smtp;
+			if (task->state!=DC_SCHEDTASK_QUEUED) {
+				task->interrupted = 1;
+				pthread_cond_broadcast(&scheduler->cond);
+			}
+		}
+	pthread_mutex_unlock(&scheduler->mutex);
+}
@@ -0,0 +1,99 @@
+/*******************************************************************************
+ *
+ *                              Delta Chat Core
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ ******************************************************************************/
+
+
+
+
+#ifndef __DC_SCHEDULER_H__
+#define __DC_SCHEDULER_H__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct dc_schedtask_t dc_schedtask_t;
+typedef struct dc_schedaccount_t dc_schedaccount_t;
+
+
+/* library-private: a task is the IMAP- or the SMTP-part of an account */
+struct dc_schedtask_t
+{
+	dc_schedaccount_t* account;
+	int                thread;       /* DC_IMAP_THREAD or DC_SMTP_THREAD */
+
+	#define            DC_SCHEDTASK_WAITING 0
+	#define            DC_SCHEDTASK_QUEUED  1
+	#define            DC_SCHEDTASK_RUNNING 2
+	int                state;
+	time_t             wakeup_at;    /* when WAITING, the task is queued at this time */
+	int                interrupted;  /* when WAITING, the task is queued at once; when RUNNING, the task is queued again after the step */
+	double             queued_ms;
+	dc_schedtask_t*    next;         /* next task in the run queue */
+	int                idle_fd;      /* when WAITING, the IMAP-socket in IDLE, -1=none, see dc_perform_imap_idle_start() */
+	double             readable_ms;  /* when the dispatcher saw idle_fd getting readable, 0=not yet; passed to dc_imap_idle_readable() */
+};
+
+
+struct dc_schedaccount_t
+{
+	dc_context_t*      context;
+	dc_schedtask_t     imap;
+	dc_schedtask_t     smtp;
+};
+
+
+/** Structure behind dc_scheduler_t */
+struct _dc_scheduler
+{
+	/** @privatesection */
+	uint32_t           magic;
+
+	pthread_mutex_t    mutex;        /* protects everything below */
+	pthread_cond_t     cond;         /* signalled when tasks get due or when a step is done */
+	int                shutdown;
+
+	pthread_t*         workers;
+	int                workers_cnt;
+
+	pthread_t          dispatcher;   /* waits for the IDLE-sockets */
+	int                dispatcher_started;
+	int                wakeup_fd[2]; /* a pipe, written if the dispatcher has to wait for other sockets */
+	uint32_t           accounts_gen; /* changed when accounts are removed */
+
+	int                budget;       /* max. number of IMAP-steps running at the same time */
+	int                budget_used;
+
+	carray*            accounts;     /* dc_schedaccount_t* */
+	dc_schedtask_t*    queue_first;  /* the run queue, tasks are processed in the order they get due */
+	dc_schedtask_t*    queue_last;
+
+	uint64_t           steps;
+	double             queue_ms;     /* sum of the time the tasks waited in the queue */
+};
+
+
+/* library-private */
+void               dc_scheduler_interrupt (dc_scheduler_t*, dc_context_t*, int thread);
+
+
+#ifdef __cplusplus
+} /* /extern "C" */
+#endif
+#endif /* __DC_SCHEDULER_H__ */
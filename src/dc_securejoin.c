@@ -69,6 +69,7 @@ void dc_handle_degrade_event(dc_context_t* context, dc_apeerstate_t* peerstate)
 		char* msg = dc_mprintf("Changed setup for %s", peerstate->addr);
 		dc_add_device_msg(context, contact_chat_id, msg);
 		free(msg);
+		dc_changelog_add(context->changelog, DC_CHANGE_CHAT, contact_chat_id);
 		context->cb(context, DC_EVENT_CHAT_MODIFIED, contact_chat_id, 0);
 	}
 
@@ -206,10 +207,10 @@ cleanup:
 }
 
 
-static const char* lookup_field(dc_mimeparser_t* mimeparser, const char* key)
+static const char* lookup_field(dc_mimeparser_t* mimeparser, int header_id)
 {
 	const char* value = NULL;
-	struct mailimf_field* field = dc_mimeparser_lookup_field(mimeparser, key);
+	struct mailimf_field* field = dc_mimeparser_get_header(mimeparser, header_id);
 	if (field==NULL || field->fld_type!=MAILIMF_FIELD_OPTIONAL_FIELD
 	 || field->fld_data.fld_optional_field==NULL || (value=field->fld_data.fld_optional_field->fld_value)==NULL) {
 		return NULL;
@@ -277,6 +278,7 @@ static void secure_connection_established(dc_context_t* context, uint32_t contac
 	dc_add_device_msg(context, contact_chat_id, msg);
 
 	// in addition to DC_EVENT_MSGS_CHANGED (sent by dc_add_device_msg()), also send DC_EVENT_CHAT_MODIFIED to update all views
+	dc_changelog_add(context->changelog, DC_CHANGE_CHAT, contact_chat_id);
 	context->cb(context, DC_EVENT_CHAT_MODIFIED, contact_chat_id, 0);
 
 	free(msg);
@@ -541,7 +543,7 @@ int dc_handle_securejoin_handshake(dc_context_t* context, dc_mimeparser_t* mimep
 		goto cleanup;
 	}
 
-	if ((step=lookup_field(mimeparser, "Secure-Join"))==NULL) {
+	if ((step=lookup_field(mimeparser, DC_HEADER_SECURE_JOIN))==NULL) {
 		goto cleanup;
 	}
 	dc_log_info(context, 0, ">>>>>>>>>>>>>>>>>>>>>>>>> secure-join message '%s' received", step);
@@ -568,7 +570,7 @@ int dc_handle_securejoin_handshake(dc_context_t* context, dc_mimeparser_t* mimep
 
 		// verify that the `Secure-Join-Invitenumber:`-header matches invitenumber written to the QR code
 		const char* invitenumber = NULL;
-		if ((invitenumber=lookup_field(mimeparser, "Secure-Join-Invitenumber"))==NULL) {
+		if ((invitenumber=lookup_field(mimeparser, DC_HEADER_SECURE_JOIN_INVITENUMBER))==NULL) {
 			dc_log_warning(context, 0, "Secure-join denied (invitenumber missing)."); // do not raise an error, this might just be spam or come from an old request
 			goto cleanup;
 		}
@@ -640,7 +642,7 @@ int dc_handle_securejoin_handshake(dc_context_t* context, dc_mimeparser_t* mimep
 
 		// verify that Secure-Join-Fingerprint:-header matches the fingerprint of Bob
 		const char* fingerprint = NULL;
-		if ((fingerprint=lookup_field(mimeparser, "Secure-Join-Fingerprint"))==NULL) {
+		if ((fingerprint=lookup_field(mimeparser, DC_HEADER_SECURE_JOIN_FINGERPRINT))==NULL) {
 			could_not_establish_secure_connection(context, contact_chat_id, "Fingerprint not provided.");
 			goto cleanup;
 		}
@@ -660,7 +662,7 @@ int dc_handle_securejoin_handshake(dc_context_t* context, dc_mimeparser_t* mimep
 
 		// verify that the `Secure-Join-Auth:`-header matches the secret written to the QR code
 		const char* auth = NULL;
-		if ((auth=lookup_field(mimeparser, "Secure-Join-Auth"))==NULL) {
+		if ((auth=lookup_field(mimeparser, DC_HEADER_SECURE_JOIN_AUTH))==NULL) {
 			could_not_establish_secure_connection(context, contact_chat_id, "Auth not provided.");
 			goto cleanup;
 		}
@@ -685,7 +687,7 @@ int dc_handle_securejoin_handshake(dc_context_t* context, dc_mimeparser_t* mimep
 
 		if (join_vg) {
 			// the vg-member-added message is special: this is a normal Chat-Group-Member-Added message with an additional Secure-Join header
-			grpid = dc_strdup(lookup_field(mimeparser, "Secure-Join-Group"));
+			grpid = dc_strdup(lookup_field(mimeparser, DC_HEADER_SECURE_JOIN_GROUP));
 			int is_verified = 0;
 			uint32_t verified_chat_id = dc_get_chat_id_by_grpid(context, grpid, NULL, &is_verified);
 			if (verified_chat_id==0 || !is_verified) {
@@ -740,7 +742,7 @@ int dc_handle_securejoin_handshake(dc_context_t* context, dc_mimeparser_t* mimep
 		context->cb(context, DC_EVENT_CONTACTS_CHANGED, 0/*no select event*/, 0);
 
 		if (join_vg) {
-			if (!dc_addr_equals_self(context, lookup_field(mimeparser, "Chat-Group-Member-Added"))) {
+			if (!dc_addr_equals_self(context, lookup_field(mimeparser, DC_HEADER_CHAT_GROUP_MEMBER_ADDED))) {
 				dc_log_info(context, 0, "Message belongs to a different handshake (scaled up contact anyway to allow creation of group).");
 				goto cleanup;
 			}
@@ -35,43 +35,62 @@
  ******************************************************************************/
 
 
-static int is_empty_line(const char* buf)
+typedef struct dc_line_t
 {
-	const unsigned char* p1 = (const unsigned char*)buf; /* force unsigned - otherwise the `> ' '` comparison will fail */
-	while (*p1) {
-		if (*p1 > ' ') {
+	const char* buf; /* not null-terminated, points into the text to simplify */
+	size_t      len;
+} dc_line_t;
+
+
+static int line_equals(const dc_line_t* line, const char* str)
+{
+	size_t str_len = strlen(str);
+	return line->len==str_len && memcmp(line->buf, str, str_len)==0;
+}
+
+
+static int line_starts_with(const dc_line_t* line, const char* str)
+{
+	size_t str_len = strlen(str);
+	return line->len>=str_len && memcmp(line->buf, str, str_len)==0;
+}
+
+
+static int is_empty_line(const dc_line_t* line)
+{
+	const unsigned char* p1 = (const unsigned char*)line->buf; /* force unsigned - otherwise the `> ' '` comparison will fail */
+	size_t i;
+	for (i = 0; i < line->len; i++) {
+		if (p1[i] > ' ') {
 			return 0; /* at least one character found - buffer is not empty */
 		}
-		p1++;
 	}
 	return 1; /* buffer is empty or contains only spaces, tabs, lineends etc. */
 }
 
 
-static int is_plain_quote(const char* buf)
+static int is_plain_quote(const dc_line_t* line)
 {
-	if (buf[0]=='>') {
+	if (line->len > 0 && line->buf[0]=='>') {
 		return 1;
 	}
 	return 0;
 }
 
 
-static int is_quoted_headline(const char* buf)
+static int is_quoted_headline(const dc_line_t* line)
 {
 	/* This function may be called for the line _directly_ before a quote.
 	The function checks if the line contains sth. like "On 01.02.2016, xy@z wrote:" in various languages.
 	- Currently, we simply check if the last character is a ':'.
 	- Checking for the existance of an email address may fail (headlines may show the user's name instead of the address) */
 
-	int buf_len = strlen(buf);
-
-	if (buf_len > 80) {
+	if (line->len > 80) {
 		return 0; /* the buffer is too long to be a quoted headline (some mailprograms (eg. "Mail" from Stock Android)
 		          forget to insert a line break between the answer and the quoted headline ...)) */
 	}
 
-	if (buf_len > 0 && buf[buf_len-1]==':') {
+	if (line->len > 0 && line->buf[line->len-1]==':') {
 		return 1; /* the buffer is a quoting headline in the meaning described above) */
 	}
 
@@ -123,49 +142,67 @@ static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify, const char
 	/* we could skip some of this stuff if we know that the mail is from another messenger,
 	however, this adds some additional complexity and seems not to be needed currently */
 
-	/* split the given buffer into lines */
-	carray* lines = dc_split_into_lines(buf_terminated);
-	int     l = 0;
-	int     l_first = 0;
-	int     l_last = carray_count(lines)-1; /* if l_last is -1, there are no lines */
-	char*   line = NULL;
-
-	/* search for the line `-- ` and ignore this and all following lines
+	/* split the given buffer into lines; the lines are not copied but only
+	referenced by offset and length.  While splitting, we search for the line
+	`-- ` and ignore this and all following lines.
 	If the line contains more characters, it is _not_ treated as the footer start mark (hi, Thorsten) */
+	dc_line_t*  lines = NULL;
+	int         lines_allocated = 0;
+	int         l = 0;
+	int         l_first = 0;
+	int         l_last = -1; /* if l_last is -1, there are no lines */
+	dc_line_t*  line = NULL;
+	const char* p1 = buf_terminated;
+	char*       ret = NULL;
+	char*       w = NULL;
+
+	while (1)
 	{
-		int footer_mark = 0;
-		for (l = l_first; l <= l_last; l++)
-		{
-			/* hide standard footer, "-- " - we do not set is_cut_at_end if we find this mark */
-			line = (char*)carray_get(lines, l);
-			if (strcmp(line, "-- ")==0
-			 || strcmp(line, "--  ")==0) { /* quoted-printable may encode `-- ` to `-- =20` which is converted back to `--  ` ... */
-				footer_mark = 1;
-			}
+		const char* line_end = strchr(p1, '\n');
+		int         footer_mark = 0;
 
-			/* also hide some non-standard footers - they got is_cut_at_end set, however  */
-			if (strcmp(line, "--")==0
-			 || strcmp(line, "---")==0
-			 || strcmp(line, "----")==0) {
-				footer_mark = 1;
-				simplify->is_cut_at_end = 1;
+		if (l_last+1 >= lines_allocated) {
+			lines_allocated = lines_allocated? lines_allocated*2 : 64;
+			if ((lines=realloc(lines, lines_allocated*sizeof(dc_line_t)))==NULL) {
+				exit(56);
 			}
+		}
 
-			if (footer_mark) {
-				l_last = l - 1; /* if l_last is -1, there are no lines */
-				break; /* done */
-			}
+		line = &lines[l_last+1];
+		line->buf = p1;
+		line->len = line_end? (size_t)(line_end-p1) : strlen(p1);
+
+		/* hide standard footer, "-- " - we do not set is_cut_at_end if we find this mark */
+		if (line_equals(line, "-- ")
+		 || line_equals(line, "--  ")) { /* quoted-printable may encode `-- ` to `-- =20` which is converted back to `--  ` ... */
+			footer_mark = 1;
+		}
+
+		/* also hide some non-standard footers - they got is_cut_at_end set, however  */
+		if (line_equals(line, "--")
+		 || line_equals(line, "---")
+		 || line_equals(line, "----")) {
+			footer_mark = 1;
+			simplify->is_cut_at_end = 1;
+		}
+
+		if (footer_mark) {
+			break; /* done */
+		}
+
+		l_last++;
+
+		if (line_end==NULL) {
+			break;
 		}
+		p1 = line_end + 1;
 	}
 
 	/* check for "forwarding header" */
 	if ((l_last-l_first+1) >= 3) {
-		char* line0 = (char*)carray_get(lines, l_first);
-		char* line1 = (char*)carray_get(lines, l_first+1);
-		char* line2 = (char*)carray_get(lines, l_first+2);
-		if (strcmp(line0, "---------- Forwarded message ----------")==0 /* do not chage this! sent exactly in this form in dc_chat.c! */
-		 && strncmp(line1, "From: ", 6)==0
-		 && line2[0]==0)
+		if (line_equals(&lines[l_first], "---------- Forwarded message ----------") /* do not chage this! sent exactly in this form in dc_chat.c! */
+		 && line_starts_with(&lines[l_first+1], "From: ")
+		 && lines[l_first+2].len==0)
 		{
             simplify->is_forwarded = 1; /* nothing is cutted, the forward state should displayed explicitly in the ui */
             l_first += 3;
@@ -176,12 +213,12 @@ static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify, const char
 	also loose forwarded messages, however, the user has always the option to show the full mail text. */
 	for (l = l_first; l <= l_last; l++)
 	{
-		line = (char*)carray_get(lines, l);
-		if (strncmp(line, "-----", 5)==0
-		 || strncmp(line, "_____", 5)==0
-		 || strncmp(line, "=====", 5)==0
-		 || strncmp(line, "*****", 5)==0
-		 || strncmp(line, "~~~~~", 5)==0)
+		line = &lines[l];
+		if (line_starts_with(line, "-----")
+		 || line_starts_with(line, "_____")
+		 || line_starts_with(line, "=====")
+		 || line_starts_with(line, "*****")
+		 || line_starts_with(line, "~~~~~"))
 		{
 			l_last = l - 1; /* if l_last is -1, there are no lines */
 			simplify->is_cut_at_end = 1;
@@ -194,7 +231,7 @@ static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify, const char
 		int l_lastQuotedLine = -1;
 
 		for (l = l_last; l >= l_first; l--) {
-			line = (char*)carray_get(lines, l);
+			line = &lines[l];
 			if (is_plain_quote(line)) {
 				l_lastQuotedLine = l;
 			}
@@ -209,14 +246,13 @@ static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify, const char
 			simplify->is_cut_at_end = 1;
 
 			if (l_last > 0) {
-				if (is_empty_line((char*)carray_get(lines, l_last))) { /* allow one empty line between quote and quote headline (eg. mails from Jürgen) */
+				if (is_empty_line(&lines[l_last])) { /* allow one empty line between quote and quote headline (eg. mails from Jürgen) */
 					l_last--;
 				}
 			}
 
 			if (l_last > 0) {
-				line = (char*)carray_get(lines, l_last);
-				if (is_quoted_headline(line)) {
+				if (is_quoted_headline(&lines[l_last])) {
 					l_last--;
 				}
 			}
@@ -229,7 +265,7 @@ static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify, const char
 		int hasQuotedHeadline = 0;
 
 		for (l = l_first; l <= l_last; l++) {
-			line = (char*)carray_get(lines, l);
+			line = &lines[l];
 			if (is_plain_quote(line)) {
 				l_lastQuotedLine = l;
 			}
@@ -250,12 +286,16 @@ static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify, const char
 		}
 	}
 
-	/* re-create buffer from the remaining lines */
-	dc_strbuilder_t ret;
-	dc_strbuilder_init(&ret, strlen(buf_terminated));
+	/* re-create buffer from the remaining lines; the result is never larger than the
+	given buffer plus the ellipses, so we can write the lines without further checks */
+	if ((ret=malloc(strlen(buf_terminated) + 2*strlen(" " DC_EDITORIAL_ELLIPSE) + 1))==NULL) {
+		exit(57);
+	}
+	w = ret;
 
 	if (simplify->is_cut_at_begin) {
-		dc_strbuilder_cat(&ret, DC_EDITORIAL_ELLIPSE " ");
+		strcpy(w, DC_EDITORIAL_ELLIPSE " ");
+		w += strlen(w);
 	}
 
 	int pending_linebreaks = 0; /* we write empty lines only in case and non-empty line follows */
@@ -263,7 +303,7 @@ static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify, const char
 
 	for (l = l_first; l <= l_last; l++)
 	{
-		line = (char*)carray_get(lines, l);
+		line = &lines[l];
 
 		if (is_empty_line(line))
 		{
@@ -275,12 +315,13 @@ static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify, const char
 			{
 				if (pending_linebreaks > 2) { pending_linebreaks = 2; } /* ignore more than one empty line (however, regard normal line ends) */
 				while (pending_linebreaks) {
-					dc_strbuilder_cat(&ret, "\n");
+					*w++ = '\n';
 					pending_linebreaks--;
 				}
 			}
 
-			dc_strbuilder_cat(&ret, line);
+			memcpy(w, line->buf, line->len);
+			w += line->len;
 			content_lines_added++;
 			pending_linebreaks = 1;
 		}
@@ -288,12 +329,15 @@ static char* dc_simplify_simplify_plain_text(dc_simplify_t* simplify, const char
 
 	if (simplify->is_cut_at_end
 	 && (!simplify->is_cut_at_begin || content_lines_added) /* avoid two `[...]` without content */) {
-		dc_strbuilder_cat(&ret, " " DC_EDITORIAL_ELLIPSE);
+		strcpy(w, " " DC_EDITORIAL_ELLIPSE);
+		w += strlen(w);
 	}
 
-	dc_free_splitted_lines(lines);
+	*w = 0;
+
+	free(lines);
 
-	return ret.buf;
+	return ret;
 }
 
 
@@ -316,16 +360,16 @@ char* dc_simplify_simplify(dc_simplify_t* simplify, const char* in_unterminated,
 	simplify->is_cut_at_begin = 0;
 	simplify->is_cut_at_end   = 0;
 
-	out = strndup((char*)in_unterminated, in_bytes); /* strndup() makes sure, the string is null-terminated */
-	if (out==NULL) {
-		return dc_strdup("");
-	}
-
-	/* convert HTML to text, if needed */
 	if (is_html) {
-		if ((temp = dc_dehtml(out)) != NULL) { /* dc_dehtml() returns way too much lineends, however they're removed in the simplification below */
-			free(out);
-			out = temp;
+		/* convert HTML to text, the HTML is read in chunks, so there is no need to copy it before */
+		int truncated = 0;
+		out = dc_dehtml_n(in_unterminated, in_bytes, simplify->html_max_bytes, &truncated); /* dc_dehtml_n() returns way too much lineends, however they're removed in the simplification below */
+		simplify->is_cut_at_end = truncated;
+	}
+	else {
+		out = strndup((char*)in_unterminated, in_bytes); /* strndup() makes sure, the string is null-terminated */
+		if (out==NULL) {
+			return dc_strdup("");
 		}
 	}
 
@@ -34,6 +34,8 @@ typedef struct dc_simplify_t
 	int is_forwarded;
 	int is_cut_at_begin;
 	int is_cut_at_end;
+
+	size_t html_max_bytes; /* if set, HTML is converted only until the text has about this size; the rest is cut and marked by is_cut_at_end */
 } dc_simplify_t;
 
 
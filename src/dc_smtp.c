@@ -24,6 +24,7 @@
 #include "dc_context.h"
 #include "dc_smtp.h"
 #include "dc_job.h"
+#include "dc_openssl.h"
 
 
 #ifndef DEBUG_SMTP
@@ -53,6 +54,7 @@ void dc_smtp_unref(dc_smtp_t* smtp)
 	}
 	dc_smtp_disconnect(smtp);
 	free(smtp->from);
+	free(smtp->error);
 	free(smtp);
 }
 
@@ -89,9 +91,10 @@ static void logger(mailsmtp* smtp, int log_type, const char* buffer__, size_t si
 
 int dc_smtp_connect(dc_smtp_t* smtp, const dc_loginparam_t* lp)
 {
-	int success = 0;
-	int r = 0;
-	int try_esmtp = 0;
+	int   success = 0;
+	int   r = 0;
+	int   try_esmtp = 0;
+	char* tls_host = NULL;
 
 	if (smtp==NULL || lp==NULL) {
 		return 0;
@@ -127,6 +130,9 @@ int dc_smtp_connect(dc_smtp_t* smtp, const dc_loginparam_t* lp)
 		mailsmtp_set_logger(smtp->etpan, logger, smtp);
 	#endif
 
+	/* TLS sessions are cached by host to speed up reconnects, see dc_openssl_tls_session_cb() */
+	tls_host = dc_mprintf("%s:%i", lp->send_server, (int)lp->send_port);
+
 	/* connect to SMTP server */
 	if (lp->server_flags&(DC_LP_SMTP_SOCKET_STARTTLS|DC_LP_SMTP_SOCKET_PLAIN))
 	{
@@ -137,7 +143,7 @@ int dc_smtp_connect(dc_smtp_t* smtp, const dc_loginparam_t* lp)
 	}
 	else
 	{
-		if ((r=mailsmtp_ssl_connect(smtp->etpan, lp->send_server, lp->send_port)) != MAILSMTP_NO_ERROR) {
+		if ((r=mailsmtp_ssl_connect_with_callback(smtp->etpan, lp->send_server, lp->send_port, dc_openssl_tls_session_cb, tls_host)) != MAILSMTP_NO_ERROR) {
 			dc_log_error_if(&smtp->log_connect_errors, smtp->context, 0, "SMPT-SSL connection to %s:%i failed (%s)", lp->send_server, (int)lp->send_port, mailsmtp_strerror(r));
 			goto cleanup;
 		}
@@ -159,7 +165,7 @@ int dc_smtp_connect(dc_smtp_t* smtp, const dc_loginparam_t* lp)
 
 	if (lp->server_flags&DC_LP_SMTP_SOCKET_STARTTLS)
 	{
-		if ((r=mailsmtp_socket_starttls(smtp->etpan)) != MAILSMTP_NO_ERROR) {
+		if ((r=mailsmtp_socket_starttls_with_callback(smtp->etpan, dc_openssl_tls_session_cb, tls_host)) != MAILSMTP_NO_ERROR) {
 			dc_log_error_if(&smtp->log_connect_errors, smtp->context, 0, "SMTP-STARTTLS failed (%s)", mailsmtp_strerror(r));
 			goto cleanup;
 		}
@@ -220,12 +226,14 @@ int dc_smtp_connect(dc_smtp_t* smtp, const dc_loginparam_t* lp)
 
 cleanup:
 	if (!success) {
+		dc_openssl_forget_tls_session(tls_host); /* in case the session is the reason for the error */
 		if (smtp->etpan) {
 			mailsmtp_free(smtp->etpan);
 			smtp->etpan = NULL;
 		}
 	}
 
+	free(tls_host);
 	return success;
 }
 
@@ -249,6 +257,15 @@ void dc_smtp_disconnect(dc_smtp_t* smtp)
  ******************************************************************************/
 
 
+static void set_error(dc_smtp_t* smtp, int r, const char* what)
+{
+	free(smtp->error);
+	smtp->error = dc_mprintf("%s: %s (%s)", what, mailsmtp_strerror(r),
+		(smtp->etpan && smtp->etpan->response)? smtp->etpan->response : "no response");
+	smtp->error_etpan = r;
+}
+
+
 int dc_smtp_send_msg(dc_smtp_t* smtp, const clist* recipients, const char* data_not_terminated, size_t data_bytes)
 {
 	int        success = 0;
@@ -259,11 +276,16 @@ int dc_smtp_send_msg(dc_smtp_t* smtp, const clist* recipients, const char* data_
 		return 0;
 	}
 
+	free(smtp->error);
+	smtp->error = NULL;
+	smtp->error_etpan = MAILSMTP_NO_ERROR;
+
 	if (recipients==NULL || clist_count(recipients)==0 || data_not_terminated==NULL || data_bytes==0) {
 		return 1; // "null message" send
 	}
 
 	if (smtp->etpan==NULL) {
+		smtp->error = dc_strdup("SMTP not connected.");
 		goto cleanup;
 	}
 
@@ -277,6 +299,7 @@ int dc_smtp_send_msg(dc_smtp_t* smtp, const clist* recipients, const char* data_
 		// so, we do not log the first time this happens
 		dc_log_error_if(&smtp->log_usual_error, smtp->context, 0, "mailsmtp_mail: %s, %s (%i)", smtp->from, mailsmtp_strerror(r), (int)r);
 		smtp->log_usual_error = 1;
+		set_error(smtp, r, "mailsmtp_mail");
 		goto cleanup;
 	}
 
@@ -291,6 +314,7 @@ int dc_smtp_send_msg(dc_smtp_t* smtp, const clist* recipients, const char* data_
 				 mailesmtp_rcpt(smtp->etpan, rcpt, MAILSMTP_DSN_NOTIFY_FAILURE|MAILSMTP_DSN_NOTIFY_DELAY, NULL) :
 				  mailsmtp_rcpt(smtp->etpan, rcpt))) != MAILSMTP_NO_ERROR) {
 			dc_log_error_if(&smtp->log_connect_errors, smtp->context, 0, "Cannot add recipient %s: %s - %s", rcpt, mailsmtp_strerror(r), smtp->etpan->response);
+			set_error(smtp, r, "Cannot add recipient");
 			goto cleanup;
 		}
 	}
@@ -298,11 +322,13 @@ int dc_smtp_send_msg(dc_smtp_t* smtp, const clist* recipients, const char* data_
 	// message
 	if ((r = mailsmtp_data(smtp->etpan)) != MAILSMTP_NO_ERROR) {
 		fprintf(stderr, "mailsmtp_data: %s\n", mailsmtp_strerror(r));
+		set_error(smtp, r, "mailsmtp_data");
 		goto cleanup;
 	}
 
 	if ((r = mailsmtp_data_message(smtp->etpan, data_not_terminated, data_bytes)) != MAILSMTP_NO_ERROR) {
 		fprintf(stderr, "mailsmtp_data_message: %s\n", mailsmtp_strerror(r));
+		set_error(smtp, r, "mailsmtp_data_message");
 		goto cleanup;
 	}
 
@@ -41,6 +41,9 @@ typedef struct dc_smtp_t
 	int             log_connect_errors;
 	int             log_usual_error;
 
+	char*           error;       /* the last error of dc_smtp_send_msg(), NULL if there is none */
+	int             error_etpan; /* the libEtPan error code belonging to `error` */
+
 	dc_context_t*   context; /* only for logging! */
 } dc_smtp_t;
 
@@ -44,7 +44,16 @@ safe. However, there are some points to keep in mind:
 
 3. Using sqlite3_last_insert_rowid() causes race conditions.  If you need
    this function, you have to wrap *all* INSERTs by a critical section.
-   We recommend not to use this function. */
+   We recommend not to use this function.
+
+4. If opened with DC_OPEN_WAL, the database uses write-ahead-logging and we
+   open some additional read-only connections.  Functions called by the UI
+   that only read, may use dc_sqlite3_prepare_read() to run their SELECT
+   on one of these connections; they do not wait for the writes then.
+   dc_sqlite3_prepare_read() always uses the read-only connections, so the
+   readers only see committed data, never the changes of an open
+   transaction.  Code that must see its own uncommitted changes has to use
+   dc_sqlite3_prepare() instead. */
 
 
 /*******************************************************************************
@@ -128,6 +137,69 @@ uint32_t dc_sqlite3_get_rowid(dc_sqlite3_t* sql, const char* table, const char*
 }
 
 
+/**
+ * Prepare a SELECT statement for reading.  If the database is opened with
+ * DC_OPEN_WAL, the statement is prepared on one of the read-only connections,
+ * so that reading does not wait for writing; otherwise, this function is the
+ * same as dc_sqlite3_prepare().
+ *
+ * The statement sees the data committed when it is stepped first, changes of
+ * an open transaction are not visible - not even for the thread that opened
+ * the transaction.  So, use this function for the functions called by the UI
+ * and dc_sqlite3_prepare() for library-internal reads that may be part of a
+ * transaction.
+ *
+ * @private @memberof dc_sqlite3_t
+ * @param sql The database object.
+ * @param querystr The SELECT statement.
+ * @return The statement, must be freed using sqlite3_finalize(). NULL on errors.
+ */
+sqlite3_stmt* dc_sqlite3_prepare_read(dc_sqlite3_t* sql, const char* querystr)
+{
+	sqlite3_stmt* stmt = NULL;
+	sqlite3*      reader = NULL;
+
+	if (sql==NULL || querystr==NULL || sql->cobj==NULL) {
+		return NULL;
+	}
+
+	if (sql->readers_cnt==0) {
+		return dc_sqlite3_prepare(sql, querystr);
+	}
+
+	pthread_mutex_lock(&sql->readers_critical);
+		reader = sql->readers[sql->next_reader];
+		sql->next_reader = (sql->next_reader+1) % sql->readers_cnt;
+	pthread_mutex_unlock(&sql->readers_critical);
+
+	if (sqlite3_prepare_v2(reader, querystr, -1, &stmt, NULL) != SQLITE_OK) {
+		dc_log_error(sql->context, 0, "Query failed: %s SQLite says: %s", querystr, sqlite3_errmsg(reader));
+		return NULL;
+	}
+
+	return stmt;
+}
+
+
+static int set_journal_mode(dc_sqlite3_t* sql, const char* mode)
+{
+	/* `PRAGMA journal_mode` returns the mode really set, this may differ eg. for in-memory-databases */
+	int           success = 0;
+	char*         q3 = sqlite3_mprintf("PRAGMA journal_mode=%s;", mode);
+	sqlite3_stmt* stmt = dc_sqlite3_prepare(sql, q3);
+
+	if (sqlite3_step(stmt)==SQLITE_ROW
+	 && sqlite3_column_text(stmt, 0)
+	 && strcmp((const char*)sqlite3_column_text(stmt, 0), mode)==0) {
+		success = 1;
+	}
+
+	sqlite3_finalize(stmt);
+	sqlite3_free(q3);
+	return success;
+}
+
+
 /*******************************************************************************
  * Main interface
  ******************************************************************************/
@@ -143,6 +215,8 @@ dc_sqlite3_t* dc_sqlite3_new(dc_context_t* context)
 
 	sql->context          = context;
 
+	pthread_mutex_init(&sql->readers_critical, NULL);
+
 	return sql;
 }
 
@@ -157,12 +231,15 @@ void dc_sqlite3_unref(dc_sqlite3_t* sql)
 		dc_sqlite3_close(sql);
 	}
 
+	pthread_mutex_destroy(&sql->readers_critical);
 	free(sql);
 }
 
 
 int dc_sqlite3_open(dc_sqlite3_t* sql, const char* dbfile, int flags)
 {
+	int use_wal = 0;
+
 	if (sql==NULL || dbfile==NULL) {
 		goto cleanup;
 	}
@@ -202,6 +279,29 @@ int dc_sqlite3_open(dc_sqlite3_t* sql, const char* dbfile, int flags)
 
 	if (!(flags&DC_OPEN_READONLY))
 	{
+		// With write-ahead-logging, reading does not wait for writing, so we can read using other connections.
+		// The WAL is moved to the database by an automatic, passive checkpoint after DC_SQLITE3_WAL_AUTOCHECKPOINT pages
+		// were written and by dc_sqlite3_checkpoint(), the file is then truncated to DC_SQLITE3_WAL_SIZE_LIMIT.
+		// `PRAGMA synchronous=NORMAL` is safe with WAL: on power loss, the last transactions may get lost, however,
+		// the database stays consistent.
+		// Without DC_OPEN_WAL, we switch back to the rollback-journal, eg. to create backups readable on any system.
+		if (flags&DC_OPEN_WAL) {
+			#define DC_SQLITE3_WAL_AUTOCHECKPOINT 1000
+			#define DC_SQLITE3_WAL_SIZE_LIMIT     "4194304"
+			if (set_journal_mode(sql, "wal")) {
+				dc_sqlite3_execute(sql, "PRAGMA synchronous=NORMAL;");
+				dc_sqlite3_execute(sql, "PRAGMA journal_size_limit=" DC_SQLITE3_WAL_SIZE_LIMIT ";");
+				sqlite3_wal_autocheckpoint(sql->cobj, DC_SQLITE3_WAL_AUTOCHECKPOINT);
+				use_wal = 1;
+			}
+			else {
+				dc_log_warning(sql->context, 0, "Cannot use write-ahead-logging for \"%s\".", dbfile);
+			}
+		}
+		else {
+			set_journal_mode(sql, "delete");
+		}
+
 		int dbversion_before_update = 0;
 
 		/* Init tables to dbversion=0 */
@@ -457,6 +557,68 @@ int dc_sqlite3_open(dc_sqlite3_t* sql, const char* dbfile, int flags)
 			}
 		#undef NEW_DB_VERSION
 
+		#define NEW_DB_VERSION 41
+			if (dbversion < NEW_DB_VERSION)
+			{
+				dc_sqlite3_execute(sql, "CREATE INDEX msgs_index6 ON msgs (chat_id, timestamp);"); /* for dc_get_chat_msgs_window(), the id is implicitly part of the index */
+
+				dbversion = NEW_DB_VERSION;
+				dc_sqlite3_set_config_int(sql, "dbversion", NEW_DB_VERSION);
+			}
+		#undef NEW_DB_VERSION
+
+		#define NEW_DB_VERSION 42
+			if (dbversion < NEW_DB_VERSION)
+			{
+				/* index of the message locations on the server, see dc_get_imap_location() */
+				dc_sqlite3_execute(sql, "CREATE TABLE imap_index (rfc724_mid TEXT PRIMARY KEY, folder TEXT DEFAULT '', uidvalidity INTEGER DEFAULT 0, uid INTEGER DEFAULT 0);");
+
+				dbversion = NEW_DB_VERSION;
+				dc_sqlite3_set_config_int(sql, "dbversion", NEW_DB_VERSION);
+			}
+		#undef NEW_DB_VERSION
+
+		#define NEW_DB_VERSION 43
+			if (dbversion < NEW_DB_VERSION)
+			{
+				/* estimated size of the data a job sends, big jobs are performed after the small ones, see dc_job_perform() */
+				dc_sqlite3_execute(sql, "ALTER TABLE jobs ADD COLUMN bytes INTEGER DEFAULT 0;");
+				dc_sqlite3_execute(sql, "CREATE INDEX jobs_index2 ON jobs (foreign_id);"); /* for dc_job_kill_foreign_id() */
+
+				dbversion = NEW_DB_VERSION;
+				dc_sqlite3_set_config_int(sql, "dbversion", NEW_DB_VERSION);
+			}
+		#undef NEW_DB_VERSION
+
+		#define NEW_DB_VERSION 44
+			if (dbversion < NEW_DB_VERSION)
+			{
+				/* summary for the chatlist and for notifications, computed on insert, see dc_msg_get_summarytext_to_store();
+				existing rows are NULL and are filled from the newest to the oldest by dc_msg_backfill_summaries() */
+				dc_sqlite3_execute(sql, "ALTER TABLE msgs ADD COLUMN txt_summary TEXT DEFAULT NULL;");
+
+				sqlite3_stmt* stmt = dc_sqlite3_prepare(sql, "SELECT MAX(id) FROM msgs;");
+					if (sqlite3_step(stmt)==SQLITE_ROW) {
+						dc_sqlite3_set_config_int(sql, "summary_backfill_id", sqlite3_column_int(stmt, 0)+1);
+					}
+				sqlite3_finalize(stmt);
+
+				dbversion = NEW_DB_VERSION;
+				dc_sqlite3_set_config_int(sql, "dbversion", NEW_DB_VERSION);
+			}
+		#undef NEW_DB_VERSION
+
+		#define NEW_DB_VERSION 45
+			if (dbversion < NEW_DB_VERSION)
+			{
+				/* dc_set_imap_locations() replaces all locations of a folder on a full refresh */
+				dc_sqlite3_execute(sql, "CREATE INDEX imap_index_folder ON imap_index (folder);");
+
+				dbversion = NEW_DB_VERSION;
+				dc_sqlite3_set_config_int(sql, "dbversion", NEW_DB_VERSION);
+			}
+		#undef NEW_DB_VERSION
+
 		// (2) updates that require high-level objects (the structure is complete now and all objects are usable)
 		if (recalc_fingerprints)
 		{
@@ -473,7 +635,23 @@ int dc_sqlite3_open(dc_sqlite3_t* sql, const char* dbfile, int flags)
 		}
 	}
 
-	dc_log_info(sql->context, 0, "Opened \"%s\".", dbfile);
+	/* open the read-only connections; this is done after the tables are updated above, so they see the final schema */
+	if (use_wal)
+	{
+		while (sql->readers_cnt < DC_SQLITE3_READERS)
+		{
+			sqlite3* reader = NULL;
+			if (sqlite3_open_v2(dbfile, &reader, SQLITE_OPEN_FULLMUTEX|SQLITE_OPEN_READONLY, NULL) != SQLITE_OK) {
+				dc_log_warning(sql->context, 0, "Cannot open read-only connection to \"%s\".", dbfile);
+				sqlite3_close(reader); /* may be set up even on errors, sqlite3_close(NULL) is a harmless no-op */
+				break;
+			}
+			sqlite3_busy_timeout(reader, 10*1000);
+			sql->readers[sql->readers_cnt++] = reader;
+		}
+	}
+
+	dc_log_info(sql->context, 0, "Opened \"%s\"%s.", dbfile, sql->readers_cnt? " with write-ahead-logging" : "");
 	return 1;
 
 cleanup:
@@ -488,6 +666,14 @@ void dc_sqlite3_close(dc_sqlite3_t* sql)
 		return;
 	}
 
+	/* close the readers before the writer, so that the last connection checkpoints and removes the WAL */
+	while (sql->readers_cnt > 0) {
+		sql->readers_cnt--;
+		sqlite3_close(sql->readers[sql->readers_cnt]);
+		sql->readers[sql->readers_cnt] = NULL;
+	}
+	sql->next_reader = 0;
+
 	if (sql->cobj)
 	{
 		sqlite3_close(sql->cobj);
@@ -678,6 +864,10 @@ void dc_sqlite3_begin_transaction(dc_sqlite3_t* sql)
 		dc_sqlite3_log_error(sql, "Cannot begin transaction.");
 	}
 	sqlite3_finalize(stmt);
+
+	if (sql->context && sql->context->sql==sql) {
+		dc_msgcache_begin_write(sql->context->msgcache);
+	}
 }
 
 
@@ -688,6 +878,10 @@ void dc_sqlite3_rollback(dc_sqlite3_t* sql)
 		dc_sqlite3_log_error(sql, "Cannot rollback transaction.");
 	}
 	sqlite3_finalize(stmt);
+
+	if (sql->context && sql->context->sql==sql) {
+		dc_msgcache_end_write(sql->context->msgcache);
+	}
 }
 
 
@@ -698,4 +892,40 @@ void dc_sqlite3_commit(dc_sqlite3_t* sql)
 		dc_sqlite3_log_error(sql, "Cannot commit transaction.");
 	}
 	sqlite3_finalize(stmt);
+
+	if (sql->context && sql->context->sql==sql) {
+		dc_msgcache_end_write(sql->context->msgcache); /* after the changes are visible to the read-only connections */
+	}
+}
+
+
+/**
+ * Move the content of the WAL to the database.  The checkpoint is passive,
+ * it does not wait for readers or writers; pages that cannot be moved
+ * are moved by the next checkpoint.  As the WAL is also checkpointed
+ * automatically, calling this function is not needed, however, calling it
+ * when the writing thread gets idle moves the work from writes requested
+ * by the UI.
+ *
+ * @private @memberof dc_sqlite3_t
+ * @param sql The database object.
+ * @return None.
+ */
+void dc_sqlite3_checkpoint(dc_sqlite3_t* sql)
+{
+	int wal_pages = 0;
+	int checkpointed_pages = 0;
+
+	if (sql==NULL || sql->cobj==NULL || sql->readers_cnt==0 /*no WAL*/) {
+		return;
+	}
+
+	if (sqlite3_wal_checkpoint_v2(sql->cobj, NULL, SQLITE_CHECKPOINT_PASSIVE, &wal_pages, &checkpointed_pages)!=SQLITE_OK) {
+		dc_sqlite3_log_error(sql, "Cannot checkpoint.");
+		return;
+	}
+
+	if (wal_pages > 0) {
+		dc_log_info(sql->context, 0, "Checkpoint: %i of %i WAL pages moved to the database.", checkpointed_pages, wal_pages);
+	}
 }
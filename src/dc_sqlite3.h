@@ -43,6 +43,12 @@ typedef struct dc_sqlite3_t
 	sqlite3*        cobj;               /**< is the database given as dbfile to Open() */
 	dc_context_t*   context;            /**< used for logging and to acquire wakelocks, there may be N dc_sqlite3_t objects per context! In practise, we use 2 on backup, 1 otherwise. */
 
+	#define         DC_SQLITE3_READERS  2
+	sqlite3*        readers[DC_SQLITE3_READERS]; /**< read-only connections used by dc_sqlite3_prepare_read(), only opened in WAL mode */
+	int             readers_cnt;
+	int             next_reader;
+	pthread_mutex_t readers_critical;
+
 } dc_sqlite3_t;
 
 
@@ -50,6 +56,7 @@ dc_sqlite3_t* dc_sqlite3_new              (dc_context_t*);
 void          dc_sqlite3_unref            (dc_sqlite3_t*);
 
 #define       DC_OPEN_READONLY            0x01
+#define       DC_OPEN_WAL                 0x02 /* use write-ahead-logging and open read-only connections for dc_sqlite3_prepare_read(); without this flag, the database is switched to rollback-journaling */
 int           dc_sqlite3_open             (dc_sqlite3_t*, const char* dbfile, int flags);
 
 void          dc_sqlite3_close            (dc_sqlite3_t*);
@@ -63,6 +70,7 @@ int32_t       dc_sqlite3_get_config_int   (dc_sqlite3_t*, const char* key, int32
 
 /* tools, these functions are compatible to the corresponding sqlite3_* functions */
 sqlite3_stmt* dc_sqlite3_prepare          (dc_sqlite3_t*, const char* sql); /* the result mus be freed using sqlite3_finalize() */
+sqlite3_stmt* dc_sqlite3_prepare_read     (dc_sqlite3_t*, const char* sql); /* same as dc_sqlite3_prepare() for SELECT statements, may be run on a read-only connection */
 int           dc_sqlite3_execute          (dc_sqlite3_t*, const char* sql);
 int           dc_sqlite3_table_exists     (dc_sqlite3_t*, const char* name);
 void          dc_sqlite3_log_error        (dc_sqlite3_t*, const char* msg, ...);
@@ -72,6 +80,8 @@ void          dc_sqlite3_begin_transaction  (dc_sqlite3_t*);
 void          dc_sqlite3_commit             (dc_sqlite3_t*);
 void          dc_sqlite3_rollback           (dc_sqlite3_t*);
 
+void          dc_sqlite3_checkpoint         (dc_sqlite3_t*);
+
 
 #ifdef __cplusplus
 } /* /extern "C" */
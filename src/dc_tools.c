@@ -31,6 +31,8 @@
 #include <libetpan/libetpan.h>
 #include <libetpan/mailimap_types.h>
 #include "dc_context.h"
+#include "dc_filecopy.h"
+#include "dc_utf8.h"
 
 
 /*******************************************************************************
@@ -370,39 +372,14 @@ void dc_replace_bad_utf8_chars(char* buf)
 		return;
 	}
 
-	unsigned char* p1 = (unsigned char*)buf; /* force unsigned - otherwise the `> ' '` comparison will fail */
-	int            p1len = strlen(buf);
-	int            c = 0;
-	int            i = 0;
-	int            ix = 0;
-	int            n = 0;
-	int            j = 0;
-
-	for (i=0, ix=p1len; i < ix; i++)
-	{
-		c = p1[i];
-		     if (c > 0 && c <= 0x7f)                            { n=0; }        /* 0bbbbbbb */
-		else if ((c & 0xE0) == 0xC0)                            { n=1; }        /* 110bbbbb */
-		else if (c==0xed && i<(ix-1) && (p1[i+1] & 0xa0)==0xa0) { goto error; } /* U+d800 to U+dfff */
-		else if ((c & 0xF0) == 0xE0)                            { n=2; }        /* 1110bbbb */
-		else if ((c & 0xF8) == 0xF0)                            { n=3; }        /* 11110bbb */
-		//else if ((c & 0xFC) == 0xF8)                          { n=4; }        /* 111110bb - not valid in https://tools.ietf.org/html/rfc3629 */
-		//else if ((c & 0xFE) == 0xFC)                          { n=5; }        /* 1111110b - not valid in https://tools.ietf.org/html/rfc3629 */
-		else                                                    { goto error; }
-
-		for (j = 0; j < n && i < ix; j++) { /* n bytes matching 10bbbbbb follow ? */
-			if ((++i == ix) || (( p1[i] & 0xC0) != 0x80)) {
-				goto error;
-			}
-		}
+	size_t bytes = strlen(buf);
+	if (dc_utf8_valid_bytes(buf, bytes)==bytes) {
+		return; /* everything is fine */
 	}
 
-    /* everything is fine */
-    return;
-
-error:
 	/* there are errors in the string -> replace potential errors by the character `_`
 	(to avoid problems in filenames, we do not use eg. `?`) */
+	unsigned char* p1 = (unsigned char*)buf; /* force unsigned - otherwise the `> 0x7f` comparison will fail */
 	while (*p1) {
 		if (*p1 > 0x7f) {
 			*p1 = '_';
@@ -412,34 +389,6 @@ error:
 }
 
 
-#if 0 /* not needed at the moment */
-static size_t dc_utf8_strlen(const char* s)
-{
-	size_t i = 0;
-	size_t j = 0;
-	while (s[i]) {
-		if ((s[i]&0xC0) != 0x80)
-			j++;
-		i++;
-	}
-	return j;
-}
-#endif
-
-
-static size_t dc_utf8_strnlen(const char* s, size_t n)
-{
-	size_t i = 0;
-	size_t j = 0;
-	while (i < n) {
-		if ((s[i]&0xC0) != 0x80)
-			j++;
-		i++;
-	}
-	return j;
-}
-
-
 void dc_truncate_n_unwrap_str(char* buf, int approx_characters, int do_unwrap)
 {
 	/* Function unwraps the given string and removes unnecessary whitespace.
@@ -447,6 +396,8 @@ void dc_truncate_n_unwrap_str(char* buf, int approx_characters, int do_unwrap)
 	(as we're using UTF-8, for simplicity, we cut the string only at whitespaces). */
 	const char* ellipse_utf8 = do_unwrap? " ..." : " " DC_EDITORIAL_ELLIPSE; /* a single line is truncated `...` instead of `[...]` (the former is typically also used by the UI to fit strings in a rectangle) */
 	int lastIsCharacter = 0;
+	size_t counted_bytes = 0; /* the characters are counted incrementally, not from the start at each word */
+	size_t counted_chars = 0;
 	unsigned char* p1 = (unsigned char*)buf; /* force unsigned - otherwise the `> ' '` comparison will fail */
 	while (*p1) {
 		if (*p1 > ' ') {
@@ -455,7 +406,9 @@ void dc_truncate_n_unwrap_str(char* buf, int approx_characters, int do_unwrap)
 		else {
 			if (lastIsCharacter) {
 				size_t used_bytes = (size_t)((uintptr_t)p1 - (uintptr_t)buf);
-				if (dc_utf8_strnlen(buf, used_bytes) >= approx_characters) {
+				counted_chars += dc_utf8_strnlen(&buf[counted_bytes], used_bytes-counted_bytes);
+				counted_bytes = used_bytes;
+				if (counted_chars >= approx_characters) {
 					size_t      buf_bytes = strlen(buf);
 					if (buf_bytes-used_bytes >= strlen(ellipse_utf8) /* check if we have room for the ellipse */) {
 						strcpy((char*)p1, ellipse_utf8);
@@ -1052,51 +1005,8 @@ int dc_delete_file(const char* pathNfilename, dc_context_t* log/*may be NULL*/)
 
 int dc_copy_file(const char* src, const char* dest, dc_context_t* log/*may be NULL*/)
 {
-    int     success = 0;
-    int     fd_src = -1;
-    int     fd_dest = -1;
-    #define DC_COPY_BUF_SIZE 4096
-    char    buf[DC_COPY_BUF_SIZE];
-    size_t  bytes_read = 0;
-    int     anything_copied = 0;
-
-	if (src==NULL || dest==NULL) {
-		return 0;
-	}
-
-    if ((fd_src=open(src, O_RDONLY)) < 0) {
-		dc_log_error(log, 0, "Cannot open source file \"%s\".", src);
-        goto cleanup;
-	}
-
-    if ((fd_dest=open(dest, O_WRONLY|O_CREAT|O_EXCL, 0666)) < 0) {
-		dc_log_error(log, 0, "Cannot open destination file \"%s\".", dest);
-        goto cleanup;
-	}
-
-    while ((bytes_read=read(fd_src, buf, DC_COPY_BUF_SIZE)) > 0) {
-        if (write(fd_dest, buf, bytes_read)!=bytes_read) {
-            dc_log_error(log, 0, "Cannot write %i bytes to \"%s\".", bytes_read, dest);
-		}
-		anything_copied = 1;
-    }
-
-    if (!anything_copied) {
-		/* not a single byte copied -> check if the source is empty, too */
-		close(fd_src);
-		fd_src = -1;
-		if (dc_get_filebytes(src)!=0) {
-			dc_log_error(log, 0, "Different size information for \"%s\".", bytes_read, dest);
-			goto cleanup;
-		}
-    }
-
-    success = 1;
-
-cleanup:
-	if (fd_src >= 0) { close(fd_src); }
-	if (fd_dest >= 0) { close(fd_dest); }
-	return success;
+	/* see dc_copy_file_ex() for details, the destination must not exist */
+	return dc_copy_file_ex(src, dest, 0, NULL, NULL, log);
 }
 
 
@@ -1263,53 +1173,3 @@ cleanup:
 	}
 	return success; /* buf must be free()'d by the caller */
 }
-
-
-int dc_get_filemeta(const void* buf_start, size_t buf_bytes, uint32_t* ret_width, uint32_t *ret_height)
-{
-	/* Strategy:
-	reading GIF dimensions requires the first 10 bytes of the file
-	reading PNG dimensions requires the first 24 bytes of the file
-	reading JPEG dimensions requires scanning through jpeg chunks
-	In all formats, the file is at least 24 bytes big, so we'll read that always
-	inspired by http://www.cplusplus.com/forum/beginner/45217/ */
-	const unsigned char* buf = buf_start;
-	if (buf_bytes<24) {
-		return 0;
-	}
-
-	/* For JPEGs, we need to check the first bytes of each DCT chunk. */
-	if (buf[0]==0xFF && buf[1]==0xD8 && buf[2]==0xFF)
-	{
-		long pos = 2;
-		while (buf[pos]==0xFF)
-		{
-			if (buf[pos+1]==0xC0 || buf[pos+1]==0xC1 || buf[pos+1]==0xC2 || buf[pos+1]==0xC3 || buf[pos+1]==0xC9 || buf[pos+1]==0xCA || buf[pos+1]==0xCB) {
-				*ret_height = (buf[pos+5]<<8) + buf[pos+6]; /* sic! height is first */
-				*ret_width  = (buf[pos+7]<<8) + buf[pos+8];
-				return 1;
-			}
-			pos += 2+(buf[pos+2]<<8)+buf[pos+3];
-			if (pos+12>buf_bytes) { break; }
-		}
-	}
-
-	/* GIF: first three bytes say "GIF", next three give version number. Then dimensions */
-	if (buf[0]=='G' && buf[1]=='I' && buf[2]=='F')
-	{
-		*ret_width  = buf[6] + (buf[7]<<8);
-		*ret_height = buf[8] + (buf[9]<<8);
-		return 1;
-	}
-
-	/* PNG: the first frame is by definition an IHDR frame, which gives dimensions */
-	if (buf[0]==0x89 && buf[1]=='P' && buf[2]=='N' && buf[3]=='G' && buf[4]==0x0D && buf[5]==0x0A && buf[6]==0x1A && buf[7]==0x0A
-	 && buf[12]=='I' && buf[13]=='H' && buf[14]=='D' && buf[15]=='R')
-	{
-		*ret_width  = (buf[16]<<24) + (buf[17]<<16) + (buf[18]<<8) + (buf[19]<<0);
-		*ret_height = (buf[20]<<24) + (buf[21]<<16) + (buf[22]<<8) + (buf[23]<<0);
-		return 1;
-	}
-
-	return 0;
-}
@@ -105,7 +105,6 @@ int      dc_write_file              (const char* pathNfilename, const void* buf,
 int      dc_read_file               (const char* pathNfilename, void** buf, size_t* buf_bytes, dc_context_t* log);
 char*    dc_get_filesuffix_lc       (const char* pathNfilename); /* the returned suffix is lower-case */
 void     dc_split_filename          (const char* pathNfilename, char** ret_basename, char** ret_all_suffixes_incl_dot); /* the case of the suffix is preserved! */
-int      dc_get_filemeta            (const void* buf, size_t buf_bytes, uint32_t* ret_width, uint32_t *ret_height);
 char*    dc_get_fine_pathNfilename  (const char* folder, const char* desired_name);
 
 
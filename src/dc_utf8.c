@@ -0,0 +1,152 @@
+/*******************************************************************************
+ *
+ *                              Delta Chat Core
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ ******************************************************************************/
+
+
+
+
+#include <stdint.h>
+#include <string.h>
+#include "dc_utf8.h"
+
+
+#define HIGH_BITS  0x8080808080808080ULL
+#define LOW_BITS   0x0101010101010101ULL
+#define WORD_BYTES 8
+
+
+static uint64_t load_word(const unsigned char* p)
+{
+	uint64_t w;
+	memcpy(&w, p, WORD_BYTES); /* compiles to a single, possibly unaligned load */
+	return w;
+}
+
+
+/* returns the number of bytes of the character at `p`, 0 if it is not valid UTF-8 */
+static size_t char_bytes(const unsigned char* p, size_t bytes)
+{
+	size_t        n = 0, j = 0;
+	unsigned char c = p[0];
+
+	     if (c <= 0x7f)                                   { return 1; } /* 0bbbbbbb */
+	else if ((c & 0xE0)==0xC0)                            { n = 1; }    /* 110bbbbb */
+	else if (c==0xED && bytes>1 && (p[1] & 0xA0)==0xA0)   { return 0; } /* U+D800 to U+DFFF */
+	else if ((c & 0xF0)==0xE0)                            { n = 2; }    /* 1110bbbb */
+	else if ((c & 0xF8)==0xF0)                            { n = 3; }    /* 11110bbb, longer forms are not valid in RFC 3629 */
+	else                                                  { return 0; }
+
+	if (n >= bytes) {
+		return 0;
+	}
+
+	for (j = 1; j <= n; j++) { /* n bytes matching 10bbbbbb follow? */
+		if ((p[j] & 0xC0)!=0x80) {
+			return 0;
+		}
+	}
+
+	return n+1;
+}
+
+
+size_t dc_utf8_valid_bytes_scalar(const char* s, size_t bytes)
+{
+	const unsigned char* p = (const unsigned char*)s;
+	size_t               i = 0, n = 0;
+
+	while (i < bytes) {
+		if ((n=char_bytes(p+i, bytes-i))==0) {
+			return i;
+		}
+		i += n;
+	}
+
+	return bytes;
+}
+
+
+size_t dc_utf8_valid_bytes(const char* s, size_t bytes)
+{
+	const unsigned char* p = (const unsigned char*)s;
+	size_t               i = 0, n = 0;
+
+	if (s==NULL) {
+		return 0;
+	}
+
+	while (i < bytes) {
+		if (p[i] <= 0x7f) {
+			/* skip runs of ASCII a word at a time */
+			i += (i+WORD_BYTES <= bytes && (load_word(p+i) & HIGH_BITS)==0)? WORD_BYTES : 1;
+		}
+		else if ((n=char_bytes(p+i, bytes-i))!=0) {
+			i += n;
+		}
+		else {
+			return i;
+		}
+	}
+
+	return bytes;
+}
+
+
+size_t dc_utf8_strnlen_scalar(const char* s, size_t bytes)
+{
+	size_t i = 0, j = 0;
+
+	for (i = 0; i < bytes; i++) {
+		if ((s[i] & 0xC0)!=0x80) {
+			j++;
+		}
+	}
+
+	return j;
+}
+
+
+size_t dc_utf8_strnlen(const char* s, size_t bytes)
+{
+	size_t i = 0, j = 0;
+
+	if (s==NULL) {
+		return 0;
+	}
+
+	for (i = 0; i+WORD_BYTES <= bytes; i += WORD_BYTES) {
+		uint64_t w = load_word((const unsigned char*)s+i);
+		/* continuation bytes are 10bbbbbb: the highest bit is set, the one below is not;
+		the multiplication adds up the flags of all bytes in the highest byte */
+		uint64_t continuation = (w & ~(w<<1)) & HIGH_BITS;
+		j += WORD_BYTES - (size_t)((((continuation>>7) * LOW_BITS)) >> 56);
+	}
+
+	return j + dc_utf8_strnlen_scalar(s+i, bytes-i);
+}
+
+
+size_t dc_utf8_strlen(const char* s)
+{
+	if (s==NULL) {
+		return 0;
+	}
+
+	return dc_utf8_strnlen(s, strlen(s));
+}
@@ -0,0 +1,52 @@
+/*******************************************************************************
+ *
+ *                              Delta Chat Core
+ *                   Contact: r10s@b44t.com, http://b44t.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see http://www.gnu.org/licenses/ .
+ *
+ ******************************************************************************/
+
+
+
+
+#ifndef __DC_UTF8_H__
+#define __DC_UTF8_H__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Library-internal.
+ *
+ * UTF-8 validation and character counting on buffers with a given length.
+ * The functions look at 8 bytes at once using 64-bit words, which is fast for
+ * ASCII-heavy text and for counting; the *_scalar() functions do the same byte
+ * after byte, they are used for the remaining bytes and for testing.
+ *
+ * What is valid UTF-8 is the same as before in dc_replace_bad_utf8_chars():
+ * sequences of up to 4 bytes, surrogates are rejected, overlong forms are not. */
+
+size_t  dc_utf8_valid_bytes         (const char*, size_t bytes); /* number of bytes until the first invalid character, `bytes` if all are valid */
+size_t  dc_utf8_strnlen             (const char*, size_t bytes); /* number of characters in the given bytes, counted are all non-continuation bytes */
+size_t  dc_utf8_strlen              (const char*);
+
+size_t  dc_utf8_valid_bytes_scalar  (const char*, size_t bytes);
+size_t  dc_utf8_strnlen_scalar      (const char*, size_t bytes);
+
+
+#ifdef __cplusplus
+} /* /extern "C" */
+#endif
+#endif /* __DC_UTF8_H__ */
@@ -195,6 +195,7 @@ typedef struct _dc_chat     dc_chat_t;
 typedef struct _dc_msg      dc_msg_t;
 typedef struct _dc_contact  dc_contact_t;
 typedef struct _dc_lot      dc_lot_t;
+typedef struct _dc_scheduler dc_scheduler_t;
 
 
 /**
@@ -237,11 +238,29 @@ void            dc_perform_imap_jobs         (dc_context_t*);
 void            dc_perform_imap_fetch        (dc_context_t*);
 void            dc_perform_imap_idle         (dc_context_t*);
 void            dc_interrupt_imap_idle       (dc_context_t*);
+int             dc_perform_imap_idle_start   (dc_context_t*, int* ret_timeout_seconds);
+void            dc_perform_imap_idle_done    (dc_context_t*);
+int             dc_get_imap_interrupt_fd     (dc_context_t*);
 
 void            dc_perform_smtp_jobs         (dc_context_t*);
 void            dc_perform_smtp_idle         (dc_context_t*);
 void            dc_interrupt_smtp_idle       (dc_context_t*);
 
+/**
+ * @class dc_scheduler_t
+ *
+ * An object to run many contexts on a few threads.
+ * Instead of creating an IMAP- and an SMTP-thread for each context as described on the main page,
+ * contexts can be added to a scheduler using dc_scheduler_add().
+ * Scheduler objects are created using dc_scheduler_new().
+ * The type itself is declared with the other object types above.
+ */
+dc_scheduler_t* dc_scheduler_new             (int workers, int budget);
+void            dc_scheduler_unref           (dc_scheduler_t*);
+int             dc_scheduler_add             (dc_scheduler_t*, dc_context_t*);
+void            dc_scheduler_remove          (dc_scheduler_t*, dc_context_t*);
+char*           dc_scheduler_get_info        (dc_scheduler_t*);
+
 
 // handle chatlists
 #define         DC_GCL_ARCHIVED_ONLY         0x01
@@ -265,6 +284,7 @@ void            dc_set_draft                 (dc_context_t*, uint32_t chat_id, c
 
 #define         DC_GCM_ADDDAYMARKER          0x01
 dc_array_t*     dc_get_chat_msgs             (dc_context_t*, uint32_t chat_id, uint32_t flags, uint32_t marker1before);
+dc_array_t*     dc_get_chat_msgs_window      (dc_context_t*, uint32_t chat_id, uint32_t flags, uint32_t marker1before, uint32_t anchor_msg_id, int count);
 int             dc_get_msg_cnt               (dc_context_t*, uint32_t chat_id);
 int             dc_get_fresh_msg_cnt         (dc_context_t*, uint32_t chat_id);
 dc_array_t*     dc_get_fresh_msgs            (dc_context_t*);
@@ -298,6 +318,16 @@ void            dc_marknoticed_contact       (dc_context_t*, uint32_t contact_id
 void            dc_markseen_msgs             (dc_context_t*, const uint32_t* msg_ids, int msg_cnt);
 void            dc_star_msgs                 (dc_context_t*, const uint32_t* msg_ids, int msg_cnt, int star);
 dc_msg_t*       dc_get_msg                   (dc_context_t*, uint32_t msg_id);
+int             dc_get_msgs                  (dc_context_t*, const uint32_t* msg_ids, int msg_cnt, dc_msg_t** ret_msgs);
+
+
+// track changes
+#define         DC_CHANGE_MSG_INSERTED       1
+#define         DC_CHANGE_MSG_UPDATED        2
+#define         DC_CHANGE_MSG_DELETED        3
+#define         DC_CHANGE_CHAT               4
+uint32_t        dc_get_change_seq            (dc_context_t*);
+dc_array_t*     dc_get_changes               (dc_context_t*, uint32_t since_seq, uint32_t until_seq, int what);
 
 
 // handle contacts
@@ -321,6 +351,7 @@ dc_contact_t*   dc_get_contact               (dc_context_t*, uint32_t contact_id
 #define         DC_IMEX_IMPORT_SELF_KEYS      2 // param1 is a directory where the keys are searched in and read from
 #define         DC_IMEX_EXPORT_BACKUP        11 // param1 is a directory where the backup is written to
 #define         DC_IMEX_IMPORT_BACKUP        12 // param1 is the file with the backup to import
+#define         DC_IMEX_EXPORT_INCREMENTAL_BACKUP 13 // param1 is a directory where the changes since the last backup are written to
 void            dc_imex                      (dc_context_t*, int what, const char* param1, const char* param2);
 char*           dc_imex_has_backup           (dc_context_t*, const char* dir);
 int             dc_check_password            (dc_context_t*, const char* pw);
@@ -625,6 +656,8 @@ time_t          dc_lot_get_timestamp     (const dc_lot_t*);
  * - Chats created, deleted or archived
  * - A draft has been set
  *
+ * To find out what exactly has changed, use dc_get_changes().
+ *
  * @param data1 chat_id for single added messages
  * @param data2 msg_id for single added messages
  * @return 0
@@ -656,6 +689,17 @@ time_t          dc_lot_get_timestamp     (const dc_lot_t*);
 #define DC_EVENT_MSG_DELIVERED            2010
 
 
+/**
+ * A single message could not be sent; state changed from DC_STATE_OUT_PENDING or DC_STATE_OUT_DELIVERED to
+ * DC_STATE_OUT_ERROR, see dc_msg_get_state().  The reason is shown by dc_get_msg_info().
+ *
+ * @param data1 chat_id
+ * @param data2 msg_id
+ * @return 0
+ */
+#define DC_EVENT_MSG_FAILED               2012
+
+
 /**
  * A single message is read by the receiver; state changed from DC_STATE_OUT_DELIVERED to
  * DC_STATE_OUT_MDN_RCVD, see dc_msg_get_state().
@@ -809,6 +853,12 @@ time_t          dc_lot_get_timestamp     (const dc_lot_t*);
  *     CAVE: The string will be free()'d by the core,
  *     so make sure it is allocated using malloc() or a compatible function.
  *     If you cannot provide the content, just return 0.
+ *
+ * During dc_configure(), several URLs are requested at the same time from different threads,
+ * so the frontend must be able to handle concurrent calls of this event.
+ * The configure job does not end before all these calls have returned;
+ * as the results of the slower requests are no longer needed then,
+ * it is a good idea to use short timeouts.
  */
 #define DC_EVENT_HTTP_GET                 2100
 